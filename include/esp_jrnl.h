@@ -21,13 +21,65 @@ extern "C" {
 
 #define JRNL_INVALID_HANDLE            -1   /* invalid handle index */
 #define JRNL_MAX_HANDLES                8   /* copies WL logic for now, see MAX_WL_HANDLES */
-#define JRNL_MIN_STORE_SIZE             3   /* minimum applicable journaling store size in sectors (master sec + header + data) */
+#define JRNL_MIN_STORE_SIZE             4   /* minimum applicable journaling store size in sectors (2 master slots + header + data) */
 #define JRNL_STORE_MARKER      0x6A6B6C6D   /* journaling store identifier (first 32 bits of master sector) */
 
 typedef int32_t esp_jrnl_handle_t;
 typedef esp_err_t (*diskio_read) (int32_t handle, size_t src_addr, void *dest, size_t size);
 typedef esp_err_t (*diskio_write) (int32_t handle, size_t dest_addr, const void *src, size_t size);
 typedef esp_err_t (*diskio_erase_range) (int32_t handle, size_t start_addr, size_t size);
+typedef esp_err_t (*diskio_trim) (int32_t handle, size_t start_addr, size_t size);
+
+/**
+ * @brief Asynchronous disk request (see 'disk_submit' in esp_jrnl_diskio_t)
+ */
+typedef enum {
+    ESP_JRNL_DISKIO_OP_READ = 0,            /* read 'size' bytes at 'addr' to 'buf' */
+    ESP_JRNL_DISKIO_OP_WRITE,               /* write 'size' bytes of 'buf' to 'addr' (the range erased before) */
+    ESP_JRNL_DISKIO_OP_ERASE                /* erase 'size' bytes at 'addr' ('buf' unused) */
+} esp_jrnl_diskio_op_t;
+
+typedef void (*diskio_done) (void *arg, esp_err_t result);
+
+typedef struct {
+    esp_jrnl_diskio_op_t op;                /* requested operation */
+    size_t addr;                            /* disk address in bytes */
+    void *buf;                              /* data buffer, owned by the device until the completion */
+    size_t size;                            /* request size in bytes */
+    diskio_done done;                       /* completion callback, called exactly once per accepted request, from a task context */
+    void *done_arg;                         /* 'done' callback argument */
+} esp_jrnl_diskio_req_t;
+
+/* queues the request (the structure is copied, 'req' is free after the call). Requests of one handle must be executed
+ * in the submission order, the synchronous routines may be called meanwhile (never for a range with a request in flight).
+ * Error returned == request not accepted, 'done' never called */
+typedef esp_err_t (*diskio_submit) (int32_t handle, const esp_jrnl_diskio_req_t *req);
+
+/**
+ * @brief Journal record payload codec
+ */
+typedef enum {
+    ESP_JRNL_CODEC_NONE = 0,                /* sector data stored as is */
+    ESP_JRNL_CODEC_LZF                      /* LZF-style compression, used only when the record gets at least 1 store sector shorter */
+} esp_jrnl_codec_t;
+
+/**
+ * @brief Journal record checksum engine (recorded in the master record, see README)
+ */
+typedef enum {
+    ESP_JRNL_CHECKSUM_CRC32 = 0,            /* CRC-32 (IEEE), ROM routine on the chip */
+    ESP_JRNL_CHECKSUM_CRC32C,               /* CRC-32C (Castagnoli), slice-by-8 software or CPU CRC instructions (linux target) */
+    ESP_JRNL_CHECKSUM_XXH32                 /* xxHash32, fast non-cryptographic hash */
+} esp_jrnl_checksum_t;
+
+/**
+ * @brief Transaction commit policy (see README)
+ */
+typedef enum {
+    ESP_JRNL_COMMIT_IMMEDIATE = 0,          /* each operation committed by its esp_jrnl_stop() */
+    ESP_JRNL_COMMIT_BATCHED,                /* operations accumulated in one transaction, committed every 'commit_batch_ops' operations or at sync */
+    ESP_JRNL_COMMIT_DEFERRED                /* operations accumulated in one transaction, committed only at sync (esp_jrnl_sync(), FatFS CTRL_SYNC) */
+} esp_jrnl_commit_mode_t;
 
 /**
  * @brief File system journaling user configuration
@@ -37,13 +89,33 @@ typedef struct {
     bool replay_journal_after_mount;        /* true = apply unfinished-commit transaction if found during journal mount */
     bool force_fs_format;                   /* (re)format journaled file-system */
     size_t store_size_sectors;              /* journal store size in sectors (disk space deducted from WL partition end) */
+    bool async_commit;                      /* replay committed transactions by the shared commit executor (requires CONFIG_ESP_JRNL_COMMIT_EXECUTOR) */
+    esp_jrnl_codec_t payload_codec;         /* journal record payload codec (ESP_JRNL_CODEC_NONE = uncompressed) */
+    bool allow_store_resize;                /* mount the existing store even if its size differs from 'store_size_sectors' (the VFS layer resizes it then) */
+    const char* store_partition_label;      /* flash partition holding the store (VFS mount functions, WL-managed), NULL = the store occupies the journaled volume end */
+    esp_jrnl_checksum_t checksum;           /* journal record checksum engine for new records (existing records always verified by their own engine) */
+    esp_jrnl_commit_mode_t commit_mode;     /* when the operations get committed (operations since the last commit are lost on power-off) */
+    uint32_t commit_batch_ops;              /* ESP_JRNL_COMMIT_BATCHED: operations per transaction (> 0) */
+    bool diskio_probe;                      /* count and time all the device operations per disk region (see esp_jrnl_get_diskio_stats()) */
+    bool read_only;                         /* no writes except the replay of a committed transaction, writes and transactions refused (VFS: plain reads, EROFS) */
+    uint32_t static_record_sectors;         /* esp_jrnl_mount_static(): record buffer size in sectors, longer writes split (0 = ESP_JRNL_STATIC_RECORD_SECTORS()) */
 } esp_jrnl_config_t;
 
 #define ESP_JRNL_DEFAULT_CONFIG() { \
     .overwrite_existing = false, \
     .replay_journal_after_mount = true, \
     .force_fs_format = false, \
-    .store_size_sectors = 32 \
+    .store_size_sectors = 32, \
+    .async_commit = false, \
+    .payload_codec = ESP_JRNL_CODEC_NONE, \
+    .allow_store_resize = false, \
+    .store_partition_label = NULL, \
+    .checksum = ESP_JRNL_CHECKSUM_CRC32, \
+    .commit_mode = ESP_JRNL_COMMIT_IMMEDIATE, \
+    .commit_batch_ops = 16, \
+    .diskio_probe = false, \
+    .read_only = false, \
+    .static_record_sectors = 0 \
 }
 
 #define ESP_JRNL_VOLUME_DEFAULT_CONFIG(wl_hndl) { \
@@ -51,11 +123,18 @@ typedef struct {
     .disk_sector_size = wl_sector_size(wl_hndl) \
 }
 
+/* erase unit of the SPI flash below WL: WL sectors smaller than that get read-modify-written.
+ * SPI_FLASH_SEC_SIZE comes from spi_flash_mmap.h (via wear_levelling.h, like wl_read() below) */
+#define ESP_JRNL_WL_ERASE_BLOCK_SIZE    SPI_FLASH_SEC_SIZE
+
 #define ESP_JRNL_DISKIO_DEFAULT_CONFIG(wl_hndl) { \
     .diskio_ctrl_handle = wl_hndl, \
     .disk_read = &wl_read, \
     .disk_write = &wl_write, \
-    .disk_erase_range = &wl_erase_range \
+    .disk_erase_range = &wl_erase_range, \
+    .disk_trim = NULL, \
+    .disk_submit = NULL, \
+    .erase_block_size = ESP_JRNL_WL_ERASE_BLOCK_SIZE \
 }
 
 /**
@@ -66,6 +145,9 @@ typedef struct {
     diskio_read disk_read;                  /* disk read routine of the 'diskio_ctrl_handle' controller interface (eg wl_read). Sector-based addressing */
     diskio_write disk_write;                /* disk write routine of the 'diskio_ctrl_handle' controller interface (eg wl_write). Sector-based addressing */
     diskio_erase_range disk_erase_range;    /* disk erase range routine of the 'diskio_ctrl_handle' controller interface (eg wl_erase_range). Sector-based addressing */
+    diskio_trim disk_trim;                  /* optional discard routine for unused sectors (eg SD card DISCARD), NULL = 'disk_erase_range' used */
+    diskio_submit disk_submit;              /* optional asynchronous request queue of the controller (eg DMA-driven), NULL = the synchronous routines above only */
+    size_t erase_block_size;                /* device erase unit in bytes (eg flash sector, SD card allocation unit), 0 = the disk sector size */
 } esp_jrnl_diskio_t;
 
 /**
@@ -84,27 +166,141 @@ typedef struct {
     uint8_t fs_volume_id;                   /* see esp_jrnl_instance_t */
     esp_jrnl_volume_t volume_cfg;
     esp_jrnl_diskio_t diskio_cfg;
+    esp_jrnl_diskio_t store_diskio_cfg;     /* separate store device (optional). Zeroed (disk_read == NULL) = the store occupies the end of the journaled volume */
+    esp_jrnl_volume_t store_volume_cfg;     /* separate store device space, the store occupies its end. Sector size must match 'volume_cfg' */
 } esp_jrnl_config_extended_t;
 
+/*
+ * esp_jrnl_mount_static() memory: the instance record, 4 sector buffers (master record, tail, operation header, lookup),
+ * 3 record buffers and the payload compressor work memory. A record buffer holds 'record_sectors' data sectors (the
+ * writes get split into records of that size), 0 means the largest uncoded record fitting the store (the store size
+ * minus 2 master slots and the record header sector). The latter replays any store, smaller buffers save 3 sectors each
+ * but can't replay the longer records written by esp_jrnl_mount() instances (see esp_jrnl_mount_static())
+ */
+#define ESP_JRNL_STATIC_INSTANCE_SIZE       (640 + 64 * sizeof(void*))  /* instance record space (any configuration) */
+#define ESP_JRNL_STATIC_LZF_WORKMEM_SIZE    2048                        /* ESP_JRNL_CODEC_LZF compressor work memory */
+#define ESP_JRNL_STATIC_RECORD_SECTORS(store_size_sectors)  ((store_size_sectors) - 3)
+#define ESP_JRNL_STATIC_CHUNK_SECTORS(store_size_sectors, record_sectors) \
+    ((record_sectors) != 0 ? (size_t)(record_sectors) : (size_t)ESP_JRNL_STATIC_RECORD_SECTORS(store_size_sectors))
+#define ESP_JRNL_STATIC_MEM_SIZE(sector_size, store_size_sectors, record_sectors) \
+    (ESP_JRNL_STATIC_INSTANCE_SIZE + \
+     (4 + 3 * ESP_JRNL_STATIC_CHUNK_SECTORS(store_size_sectors, record_sectors)) * (size_t)(sector_size) + \
+     ESP_JRNL_STATIC_LZF_WORKMEM_SIZE)
+
+/* defines 'name' array usable as esp_jrnl_mount_static() memory (8-byte aligned) */
+#define ESP_JRNL_STATIC_MEM_DEFINE(name, sector_size, store_size_sectors, record_sectors) \
+    uint64_t name[(ESP_JRNL_STATIC_MEM_SIZE(sector_size, store_size_sectors, record_sectors) + sizeof(uint64_t) - 1) / sizeof(uint64_t)]
+
+/**
+ * @brief Journaling instance statistics (see esp_jrnl_get_stats())
+ */
+typedef struct {
+    uint32_t trans_started;                 /* transactions opened (batched operations joining an open transaction not counted) */
+    uint32_t trans_committed;               /* transactions marked committed (the replay follows) */
+    uint32_t trans_cancelled;               /* transactions cancelled by esp_jrnl_stop(h, false) */
+    uint64_t sectors_journaled;             /* file-system sectors written through the journal (esp_jrnl_write() within a transaction) */
+    uint64_t bytes_read;                    /* bytes read from the devices (target and store) */
+    uint64_t bytes_written;                 /* bytes written to the devices (target and store, incl. master record updates) */
+    uint64_t bytes_erased;                  /* bytes erased or discarded on the devices */
+    uint32_t master_updates;                /* master record updates */
+    uint32_t master_spare_misses;           /* master record updates that had to erase the spare slot first (not prepared ahead) */
+    uint32_t replays;                       /* committed transactions transferred to the target disk (incl. the mount replay) */
+    uint64_t replay_time_us;                /* total time spent in the replays */
+    uint32_t replay_time_max_us;            /* the longest replay */
+    uint32_t store_peak_sectors;            /* peak store occupancy by the operation records, in sectors */
+    uint32_t store_data_sectors;            /* store sectors available for the operation records (current store size) */
+    uint64_t append_time_us;                /* total time spent appending the operation records in esp_jrnl_write() and esp_jrnl_trim() */
+} esp_jrnl_stats_t;
+
+/**
+ * @brief Disk regions told apart by the diskio probe (see esp_jrnl_get_diskio_stats())
+ */
+typedef enum {
+    ESP_JRNL_REGION_FS = 0,                 /* file-system sectors (the target disk outside of the store) */
+    ESP_JRNL_REGION_STORE_DATA,             /* journaling store sectors holding the operation records */
+    ESP_JRNL_REGION_MASTER,                 /* master record slots */
+    ESP_JRNL_REGION_COUNT
+} esp_jrnl_region_t;
+
+/**
+ * @brief Device operations measured by the diskio probe
+ */
+typedef enum {
+    ESP_JRNL_DISKIO_STAT_READ = 0,          /* 'disk_read' and asynchronous reads */
+    ESP_JRNL_DISKIO_STAT_WRITE,             /* 'disk_write' and asynchronous writes */
+    ESP_JRNL_DISKIO_STAT_ERASE,             /* 'disk_erase_range' and asynchronous erases */
+    ESP_JRNL_DISKIO_STAT_TRIM,              /* 'disk_trim' */
+    ESP_JRNL_DISKIO_STAT_COUNT
+} esp_jrnl_diskio_stat_op_t;
+
+#define ESP_JRNL_DISKIO_LATENCY_BUCKETS     20  /* log2 latency buckets: [2^i, 2^(i+1)) us, bucket 0 includes 0, the last one everything above */
+
+/**
+ * @brief Operation counters of one device operation type within one disk region
+ */
+typedef struct {
+    uint64_t count;                         /* operations done */
+    uint64_t bytes;                         /* bytes read/written/erased */
+    uint64_t time_us;                       /* total operation time (asynchronous requests: from the submission to the completion) */
+    uint32_t max_us;                        /* the longest operation */
+    uint32_t latency_buckets[ESP_JRNL_DISKIO_LATENCY_BUCKETS]; /* latency distribution */
+    uint32_t errors;                        /* operations failed */
+} esp_jrnl_diskio_op_stats_t;
+
+/**
+ * @brief Diskio probe statistics of a journaling instance (target and store device together).
+ * An operation is accounted to the region of its start address
+ */
+typedef struct {
+    esp_jrnl_diskio_op_stats_t ops[ESP_JRNL_REGION_COUNT][ESP_JRNL_DISKIO_STAT_COUNT];
+} esp_jrnl_diskio_stats_t;
+
 
 /**
  * @brief Mounts FS journal store instance to wear-levelled partition, checks existence of previously
  *        created journaling log and possibly applies the operations found in the log. If all the internal steps succeed,
- *        the journal store instance is referenced by the handle returned. The handle remains uninitialized if any error appears
+ *        the journal store instance is referenced by the handle returned. The handle remains uninitialized if any error appears.
+ *        A clean journaling store found on the disk (TRANS_READY, no records, same layout) is mounted without any write
  *
  * @param[in] config  FS journal instance configuration
  * @param[out] jrnl_handle  FS journal instance handle
  *
  * @return
  *      - ESP_OK on success
- *      - ESP_ERR_INVALID_ARG on some input parameter being NULL or store_size_sectors less than JRNL_MIN_STORE_SIZE
+ *      - ESP_ERR_INVALID_ARG on some input parameter being NULL, store_size_sectors less than JRNL_MIN_STORE_SIZE or read_only combined with overwrite_existing/force_fs_format
+ *      - ESP_ERR_INVALID_SIZE if the separate store device sector size differs from the volume one or the store doesn't fit the store device
  *      - ESP_ERR_NO_MEM no more handles available or no memory left for the FS journal instance record
- *      - ESP_ERR_INVALID_STATE if volume size, sector size or journal size differ between the configuration and the master record found on disk (sanity check)
+ *      - ESP_ERR_INVALID_STATE if volume size, sector size, journal size or the store placement differ between the configuration and the master record found on disk (sanity check)
+ *      - ESP_ERR_NOT_SUPPORTED if user_cfg.async_commit is on without CONFIG_ESP_JRNL_COMMIT_EXECUTOR
  *      - errors from jrnl_replay()
  *      - errors from diskio.disk_read, diskio_write or diskio_erase_range function (eg wl_read(), wl_write() and wl_erase_range() for FatFS)
  */
 esp_err_t esp_jrnl_mount(const esp_jrnl_config_extended_t *config, esp_jrnl_handle_t* jrnl_handle);
 
+/**
+ * @brief Mounts FS journal store instance like esp_jrnl_mount(), with the instance record and all its buffers placed in
+ *        the caller's memory 'mem' (ESP_JRNL_STATIC_MEM_SIZE() bytes for the configured sector size, store size and
+ *        user_cfg.static_record_sectors, see ESP_JRNL_STATIC_MEM_DEFINE()). The instance allocates no heap memory, neither
+ *        at the mount nor in the write, commit, replay and read paths. Writes longer than the record buffers get journaled
+ *        as several records. A store holding longer records (esp_jrnl_mount() instances write records up to the store size,
+ *        LZF-encoded ones decode to even more sectors) can't be replayed by the static instance.
+ *        The memory must stay untouched until esp_jrnl_unmount()
+ *
+ * @param[in] config  FS journal instance configuration (async_commit and diskio_probe not available)
+ * @param[in] mem  instance memory, 8-byte aligned
+ * @param[in] mem_size  'mem' size in bytes (ESP_JRNL_STATIC_LZF_WORKMEM_SIZE may be left out unless ESP_JRNL_CODEC_LZF is configured)
+ * @param[out] jrnl_handle  FS journal instance handle
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG on 'mem' being NULL or unaligned, static_record_sectors above ESP_JRNL_STATIC_RECORD_SECTORS(), other errors as esp_jrnl_mount()
+ *      - ESP_ERR_INVALID_SIZE if 'mem_size' is too small for the configuration
+ *      - ESP_ERR_NOT_SUPPORTED if user_cfg.async_commit or user_cfg.diskio_probe is on
+ *      - ESP_ERR_NO_MEM from the replay of a stored record larger than the provisioned buffers (written by an esp_jrnl_mount() instance)
+ *      - errors from esp_jrnl_mount()
+ */
+esp_err_t esp_jrnl_mount_static(const esp_jrnl_config_extended_t *config, void* mem, size_t mem_size, esp_jrnl_handle_t* jrnl_handle);
+
 /**
  * @brief Deletes FS journal instance given by the handle and clears the handle afterwards
  *
@@ -118,15 +314,19 @@ esp_err_t esp_jrnl_unmount(const esp_jrnl_handle_t handle);
 
 /**
  * @brief Starts a new transaction for FS journal instance given by the handle.
- * The transaction can be started only on empty FS journal store (status must be ESP_JRNL_STATUS_TRANS_READY). Once the transaction is open
+ * The transaction can be started only on empty FS journal store (status must be ESP_JRNL_STATUS_TRANS_READY), or joined if left open by the previous
+ * operations in the batched commit modes (see esp_jrnl_stop()). Once the transaction is open
  * (status changed to ESP_JRNL_STATUS_TRANS_OPEN), all subsequent disk-write operations originated in the journaled file-system are written to the FS store first,
  * unless esp_jrnl_stop() is called for appropriate FS journal instance handle.
+ * With the direct disk access on (esp_jrnl_set_direct_io()), no transaction is opened and the call succeeds, so the journaled
+ * file-system keeps working unjournaled (eg to compare the performance). The status stays ESP_JRNL_STATUS_FS_DIRECT and
+ * the writes go straight to the target disk.
  *
  * @param handle  FS journal instance handle
  *
  * @return
  *      - ESP_OK on success
- *      - ESP_ERR_INVALID_STATE if the transaction is already started
+ *      - ESP_ERR_INVALID_STATE if the transaction is already started or the instance is mounted read-only
  *      - errors from jrnl_check_handle() or jrnl_update_master()
  */
 esp_err_t esp_jrnl_start(const esp_jrnl_handle_t handle);
@@ -144,16 +344,60 @@ esp_err_t esp_jrnl_start(const esp_jrnl_handle_t handle);
  *      - ESP_OK on success
  *      - ESP_ERR_INVALID_STATE if no transaction is open
  *      - errors from jrnl_check_handle(), jrnl_replay() and jrnl_update_master()
+ *
+ * @note With the direct disk access on, no transaction is open (see esp_jrnl_start()): esp_jrnl_stop() does nothing and returns ESP_OK
+ * for both commit = true and commit = false. The writes of the operation are on the target disk already, so a cancel is a no-op
+ * and doesn't roll anything back
+ *
+ * @note With user_cfg.async_commit on, the commit returns as soon as the transaction is marked ESP_JRNL_STATUS_TRANS_COMMIT on the disk
+ * (ie it is durable), and the replay is finished by the shared commit executor. Commits of different instances run in parallel
+ * (one worker per CPU core), the next esp_jrnl_start(), esp_jrnl_read() or esp_jrnl_unmount() of the same instance waits for the pending one.
+ * A commit that failed (asynchronous or not) leaves the transaction ESP_JRNL_STATUS_TRANS_COMMIT, the next esp_jrnl_start() or esp_jrnl_read()
+ * replays it again before going on.
+ *
+ * @note With user_cfg.commit_mode ESP_JRNL_COMMIT_BATCHED or ESP_JRNL_COMMIT_DEFERRED, esp_jrnl_stop() only finishes the operation
+ * and the transaction stays open for the following ones (the next esp_jrnl_start() joins it), until esp_jrnl_sync() is called,
+ * the batch is full, the store gets short of space or the writes spread over too many target ranges. A failed operation
+ * (commit = false) is dropped from the batched transaction, its records are rolled back to the state at its esp_jrnl_start()
+ * and the preceding operations stay in the batch.
  */
 esp_err_t esp_jrnl_stop(const esp_jrnl_handle_t handle, const bool commit);
 
+/**
+ * @brief Commit barrier: commits the operations accumulated by the batched transaction (see user_cfg.commit_mode).
+ * Called within an operation (between esp_jrnl_start() and esp_jrnl_stop(), eg by FatFS CTRL_SYNC at f_sync()), the transaction
+ * is committed by the operation's esp_jrnl_stop(). No-op if nothing is pending
+ *
+ * @param[in] handle  FS journal instance handle
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - errors from jrnl_check_handle(), jrnl_replay() and jrnl_update_master()
+ */
+esp_err_t esp_jrnl_sync(const esp_jrnl_handle_t handle);
+
+/**
+ * @brief Waits until the asynchronously committed transaction of FS journal instance given by the handle is transferred to the target disk.
+ * A failed commit is replayed again (synchronously). Returns immediately if no commit is pending or left unfinished
+ *
+ * @param handle  FS journal instance handle
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - errors from jrnl_check_handle()
+ *      - errors from jrnl_replay() of the last asynchronous commit, if its retry fails as well (the transaction stays in the store,
+ *        the replay is retried by the next esp_jrnl_start(), esp_jrnl_read() or esp_jrnl_wait_commit(), or by the next mount)
+ */
+esp_err_t esp_jrnl_wait_commit(const esp_jrnl_handle_t handle);
+
 /**
  * @brief Updates journal master record status to switch between direct disk access and the journaled one
  *
  * Sets master.status record of journal instance given by 'handle' to ESP_JRNL_STATUS_FS_DIRECT for 'direct_access' = true,
  * and to ESP_JRNL_STATUS_TRANS_READY on false, applicable only when the status is one of the two states.
  * This status allows direct I/O access to the target disk, ie it bypasses the journaling mechanism.
- * Needed for file-system mounting, formatting or similar operations.
+ * Needed for file-system mounting, formatting or similar operations. The master record on the disk is updated only if it holds
+ * other than a clean TRANS_READY store, otherwise the status is switched in RAM (both states need no replay after a power-off).
  * Should never by called directly as it brings high risk of the FS journal instance corruption and/or data loss.
  *
  * @note So far, direct disk access is applied only within jrnl_write API
@@ -182,8 +426,24 @@ esp_err_t esp_jrnl_set_direct_io(const esp_jrnl_handle_t handle, bool direct_acc
  */
 esp_err_t esp_jrnl_get_diskio_handle(const esp_jrnl_handle_t handle, int32_t* diskio_ctrl_handle);
 
+/**
+ * @brief Gets handle to the separate store device driver instance (see esp_jrnl_config_extended_t.store_diskio_cfg).
+ * Designed for internal use, mostly by the VFS implementations
+ *
+ * @param[in] handle  FS journal instance handle
+ * @param[out] store_diskio_ctrl_handle  output parameter to receive the store device handle
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the store_diskio_ctrl_handle is NULL
+ *      - ESP_ERR_NOT_FOUND if the store occupies the end of the journaled volume (no separate store device)
+ *      - errors from jrnl_check_handle()
+ */
+esp_err_t esp_jrnl_get_store_diskio_handle(const esp_jrnl_handle_t handle, int32_t* store_diskio_ctrl_handle);
+
 /**
  * @brief Gets target disk sector count for given FS journal instance handle (ie the sectors available for the file-system journaled).
+ * The whole volume, if the store sits on a separate device; the volume minus the store otherwise.
  * Designed for internal use, mostly by the VFS implementations
  *
  * @param[in] handle  FS journal instance handle
@@ -210,6 +470,54 @@ esp_err_t esp_jrnl_get_sector_count(const esp_jrnl_handle_t handle, size_t* fs_p
  */
 esp_err_t esp_jrnl_get_sector_size(const esp_jrnl_handle_t handle, size_t* sector_size);
 
+/**
+ * @brief Gets the erase block size of the journaled device in sectors (FatFS GET_BLOCK_SIZE), for the file-system
+ * data area and cluster alignment. Reported as 1 if the device's erase unit is unknown, not a power of 2 multiple
+ * of the sector size or bigger than FatFS supports (32768 sectors)
+ *
+ * @param[in] handle  FS journal instance handle
+ * @param[out] block_sectors  output parameter to receive the erase block size in sectors
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the block_sectors is NULL
+ *      - errors from jrnl_get_instance()
+ */
+esp_err_t esp_jrnl_get_erase_block_size(const esp_jrnl_handle_t handle, size_t* block_sectors);
+
+/**
+ * @brief Gets the journaling store size (in sectors) for given FS journal instance handle
+ *
+ * @param[in] handle  FS journal instance handle
+ * @param[out] store_size_sectors  output parameter to receive the store size
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the store_size_sectors is NULL
+ *      - errors from jrnl_get_instance()
+ */
+esp_err_t esp_jrnl_get_store_size(const esp_jrnl_handle_t handle, size_t* store_size_sectors);
+
+/**
+ * @brief Moves the boundary between the file-system and the journaling store (the store occupies the volume end).
+ * Only the master record gets updated (the master slots stay at the volume end, so the change is power-off safe),
+ * the file-system volume size must be adjusted by the caller: shrink the file-system before growing the store,
+ * grow the file-system after shrinking the store. The store on a separate device just changes its size within
+ * the store device, the file-system is not affected. Designed for internal use, mostly by the VFS implementations
+ * (see esp_vfs_fat_jrnl_resize_store())
+ *
+ * @param[in] handle  FS journal instance handle
+ * @param[in] store_size_sectors  new store size in sectors
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_SIZE if the size is below JRNL_MIN_STORE_SIZE, exceeds the store device or doesn't leave any sector for the file-system
+ *      - ESP_ERR_INVALID_STATE if a journaling transaction is running or the instance is mounted read-only
+ *      - errors from jrnl_get_instance(), pending commit errors
+ *      - errors from diskio.disk_write or diskio_erase_range function (eg wl_write() or wl_erase_range())
+ */
+esp_err_t esp_jrnl_resize_store(const esp_jrnl_handle_t handle, const size_t store_size_sectors);
+
 /**
  * @brief Writes 'count' of sectors starting at 'sector' index with data from 'buff' to the target disk.
  * If there is journaling transaction open (status = ESP_JRNL_STATUS_TRANS_OPEN), the data is written to FS
@@ -229,13 +537,32 @@ esp_err_t esp_jrnl_get_sector_size(const esp_jrnl_handle_t handle, size_t* secto
  *
  * @return
  *      - ESP_OK on success
- *      - ESP_ERR_INVALID_ARG if 'buff' is NULL
+ *      - ESP_ERR_INVALID_ARG if 'buff' is NULL or 'count' is 0
  *      - ESP_ERR_NO_MEM not enough memory to complete the operation
- *      - ESP_ERR_INVALID_STATE on attempt to write under invalid journal stored state
+ *      - ESP_ERR_INVALID_STATE on attempt to write under invalid journal stored state or to a read-only instance
  *      - errors from jrnl_check_handle(), jrnl_erase_range_raw(), jrnl_write_raw(), jrnl_write_raw() or jrnl_update_master()
  */
 esp_err_t esp_jrnl_write(const esp_jrnl_handle_t handle, const uint8_t *buff, const uint32_t sector, const uint32_t count);
 
+/**
+ * @brief Marks 'count' of sectors starting at 'sector' index unused (file-system TRIM). Within an open transaction
+ * the request is journaled as a record without payload and forwarded to the target disk on commit ('disk_trim',
+ * or 'disk_erase_range' if not available). The discarded sectors are remembered (RAM only) as erased, so their
+ * next writes skip the erase. With ESP_JRNL_STATUS_FS_DIRECT status the request goes to the disk right away.
+ *
+ * @param[in] handle  FS journal instance handle
+ * @param[in] sector  index of the first target disk sector
+ * @param[in] count  number of sectors
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the range exceeds the file-system sectors
+ *      - ESP_ERR_NO_MEM not enough space in the store
+ *      - ESP_ERR_INVALID_STATE on attempt to trim under invalid journal stored state or on a read-only instance
+ *      - errors from jrnl_get_instance(), diskio.disk_trim or diskio.disk_erase_range (FS_DIRECT), jrnl_update_master()
+ */
+esp_err_t esp_jrnl_trim(const esp_jrnl_handle_t handle, const uint32_t sector, const uint32_t count);
+
 /**
  * @brief Essentially redirection to underlying partition read operation (eg to wl_read()). This operation is designed
  * for the journaled file-system to access its sectors and thus there is no need to involve the journaling mechanisms.
@@ -257,6 +584,66 @@ esp_err_t esp_jrnl_write(const esp_jrnl_handle_t handle, const uint8_t *buff, co
  */
 esp_err_t esp_jrnl_read(const esp_jrnl_handle_t handle, const uint32_t sector, uint8_t *dest, const uint32_t count);
 
+/**
+ * @brief Gets the statistics counters of given FS journal instance. The counters are kept since the mount
+ * (or the last esp_jrnl_reset_stats()), they are updated atomically and can be read from any task at any time.
+ * Write amplification of the journaled volume is bytes_written / (sectors_journaled * sector size), ie the device writes
+ * against the sectors written by the file system (see also esp_jrnl_get_diskio_stats())
+ *
+ * @param[in] handle  FS journal instance handle
+ * @param[out] stats  statistics counters
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if 'stats' is NULL
+ *      - errors from jrnl_get_instance()
+ */
+esp_err_t esp_jrnl_get_stats(const esp_jrnl_handle_t handle, esp_jrnl_stats_t* stats);
+
+/**
+ * @brief Clears the statistics counters of given FS journal instance (the peak store occupancy starts from the current one)
+ *
+ * @param[in] handle  FS journal instance handle
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - errors from jrnl_get_instance()
+ */
+esp_err_t esp_jrnl_reset_stats(const esp_jrnl_handle_t handle);
+
+/**
+ * @brief Gets the total time spent appending the operation records in esp_jrnl_write() and esp_jrnl_trim() of given FS journal
+ * instance ('append_time_us' of esp_jrnl_stats_t without the other counters). Callers measuring an operation take the difference
+ * of two readings, the value drops to 0 at esp_jrnl_reset_stats()
+ *
+ * @param[in] handle  FS journal instance handle
+ * @param[out] time_us  time in microseconds
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if 'time_us' is NULL
+ *      - errors from jrnl_get_instance()
+ */
+esp_err_t esp_jrnl_get_append_time(const esp_jrnl_handle_t handle, uint64_t* time_us);
+
+/**
+ * @brief Gets the device operation statistics of given FS journal instance, collected by the diskio probe
+ * (esp_jrnl_config_t.diskio_probe). The probe wraps the target and store devices, so all the reads, writes, erases
+ * and trims are counted per disk region - file-system, store data and master record. Exact write amplification of
+ * a workload is then the bytes written to all the regions / (sectors_journaled of esp_jrnl_stats_t * sector size).
+ * Cleared by esp_jrnl_reset_stats()
+ *
+ * @param[in] handle  FS journal instance handle
+ * @param[out] stats  device operation statistics
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if 'stats' is NULL
+ *      - ESP_ERR_NOT_SUPPORTED if the instance was mounted without the diskio probe
+ *      - errors from jrnl_get_instance()
+ */
+esp_err_t esp_jrnl_get_diskio_stats(const esp_jrnl_handle_t handle, esp_jrnl_diskio_stats_t* stats);
+
 #ifdef __cplusplus
 }
 #endif
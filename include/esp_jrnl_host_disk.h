@@ -0,0 +1,129 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_jrnl.h"
+
+/*
+ * Emulated disk devices for esp_jrnl_diskio_t: RAM disk and file-backed disk image. Meant for the IDF linux target
+ * (profiling and benchmarking the journaling and the FatFS integration on a workstation), usable on the chip as well
+ * (eg RAM disk in PSRAM).
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_JRNL_HOST_DISK_MAX_HANDLES      8   /* maximum number of emulated disks existing at once */
+
+/**
+ * @brief Emulated device erase/program semantics
+ */
+typedef enum {
+    ESP_JRNL_HOST_DISK_BLOCK = 0,           /* block device (eg SD card): writes overwrite the data, erase fills the range with 0xFF */
+    ESP_JRNL_HOST_DISK_NOR                  /* NOR flash: writes only clear bits (the data ANDed), erase works on whole erase blocks (partial blocks read-modify-written) */
+} esp_jrnl_host_disk_mode_t;
+
+/**
+ * @brief Emulated disk configuration
+ */
+typedef struct {
+    const char* image_path;                 /* disk image file (created if missing, grown to the disk size with 0xFF), NULL = RAM disk */
+    size_t sector_size;                     /* disk sector size in bytes */
+    size_t sector_count;                    /* disk size in sectors */
+    size_t erase_block_size;                /* erase unit in bytes (multiple of 'sector_size'), 0 = 'sector_size'. Reported as esp_jrnl_diskio_t.erase_block_size */
+    esp_jrnl_host_disk_mode_t mode;         /* erase/program semantics */
+    uint32_t read_latency_us;               /* simulated read time per sector (0 = none) */
+    uint32_t write_latency_us;              /* simulated write time per sector (0 = none) */
+    uint32_t erase_latency_us;              /* simulated erase time per erase block (0 = none) */
+} esp_jrnl_host_disk_config_t;
+
+/* 1MB RAM disk with the SPI flash geometry, no latencies */
+#define ESP_JRNL_HOST_DISK_DEFAULT_CONFIG() { \
+    .image_path = NULL, \
+    .sector_size = 4096, \
+    .sector_count = 256, \
+    .erase_block_size = 4096, \
+    .mode = ESP_JRNL_HOST_DISK_NOR, \
+    .read_latency_us = 0, \
+    .write_latency_us = 0, \
+    .erase_latency_us = 0 \
+}
+
+/**
+ * @brief Emulated disk operation counters
+ */
+typedef struct {
+    uint64_t read_ops;                      /* disk_read calls */
+    uint64_t write_ops;                     /* disk_write calls */
+    uint64_t erase_ops;                     /* disk_erase_range calls */
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t bytes_erased;
+    uint64_t block_erases;                  /* erase blocks erased, incl. the ones read-modify-written for partial erases */
+    uint64_t unerased_writes;               /* NOR mode: writes programming bits not erased before (the data gets corrupted as on the real flash) */
+} esp_jrnl_host_disk_stats_t;
+
+/**
+ * @brief Creates an emulated disk. RAM disk contents are initialized to 0xFF (erased), the disk image file keeps its
+ * existing contents (eg to check the journal replay after a simulated reset)
+ *
+ * @param[in] config  disk configuration
+ * @param[out] out_handle  disk handle (esp_jrnl_diskio_t.diskio_ctrl_handle)
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG for NULL parameter or inconsistent geometry
+ *      - ESP_ERR_NO_MEM if the disk memory can't be allocated or all the handles are used
+ *      - ESP_FAIL if the disk image file can't be opened or grown
+ */
+esp_err_t esp_jrnl_host_disk_create(const esp_jrnl_host_disk_config_t* config, int32_t* out_handle);
+
+/**
+ * @brief Deletes the emulated disk (RAM disk contents dropped, disk image file closed). The disk must not be in use
+ *
+ * @param[in] handle  disk handle
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG for invalid handle
+ */
+esp_err_t esp_jrnl_host_disk_delete(int32_t handle);
+
+/**
+ * @brief Fills the journaling disk configuration for given emulated disk (the whole disk is used as the volume)
+ *
+ * @param[in] handle  disk handle
+ * @param[out] diskio_cfg  disk routines (may be NULL)
+ * @param[out] volume_cfg  volume geometry (may be NULL)
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG for invalid handle
+ */
+esp_err_t esp_jrnl_host_disk_get_config(int32_t handle, esp_jrnl_diskio_t* diskio_cfg, esp_jrnl_volume_t* volume_cfg);
+
+/**
+ * @brief Gets the disk operation counters
+ *
+ * @param[in] handle  disk handle
+ * @param[out] stats  counters
+ * @param[in] reset  true = zero the counters after the reading
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG for invalid handle or NULL 'stats'
+ */
+esp_err_t esp_jrnl_host_disk_get_stats(int32_t handle, esp_jrnl_host_disk_stats_t* stats, bool reset);
+
+#ifdef __cplusplus
+}
+#endif
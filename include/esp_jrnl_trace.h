@@ -0,0 +1,111 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "esp_err.h"
+
+/*
+ * Journaling event trace (CONFIG_ESP_JRNL_TRACE): timestamped events of all the journaling instances recorded
+ * into one RAM ring buffer, the oldest entries overwritten. Meant for finding out where the time of slow commits goes
+ * (erase, write, checksum, lock wait). The dump can be converted to Chrome trace/Perfetto JSON by tools/jrnl_trace2json.
+ * All the functions return ESP_ERR_NOT_SUPPORTED when the trace is not compiled in
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Trace event type. Span events cover an interval ('duration_us'), the others are instants (duration 0).
+ * The values are part of the dump format, new events get appended only
+ */
+typedef enum {
+    ESP_JRNL_TRACE_TRANS_OPEN = 0,          /* transaction opened (span of the master update). arg0 = master generation */
+    ESP_JRNL_TRACE_TRANS_COMMIT,            /* transaction commit (span, incl. the replay when synchronous). arg0 = store sectors used, arg1 = batched operations */
+    ESP_JRNL_TRACE_TRANS_CANCEL,            /* transaction cancelled (span of the master reset) */
+    ESP_JRNL_TRACE_RECORD_APPEND,           /* esp_jrnl_write() (span, incl. lock wait). arg0 = target sector, arg1 = sector count */
+    ESP_JRNL_TRACE_RECORD_TRIM,             /* esp_jrnl_trim() (span, incl. lock wait). arg0 = target sector, arg1 = sector count */
+    ESP_JRNL_TRACE_MASTER_UPDATE,           /* master record written (span). arg0 = new generation, arg1 = transaction status */
+    ESP_JRNL_TRACE_REPLAY,                  /* committed transaction transferred to the target (span). arg0 = records replayed, arg1 = esp_err_t */
+    ESP_JRNL_TRACE_REPLAY_RECORD,           /* record picked up by the replay. arg0 = target sector, arg1 = sector count | record type << 24 */
+    ESP_JRNL_TRACE_DISK_READ,               /* target device access (span, 0 for asynchronous requests). arg0 = byte address, arg1 = size */
+    ESP_JRNL_TRACE_DISK_WRITE,
+    ESP_JRNL_TRACE_DISK_ERASE,              /* incl. trims */
+    ESP_JRNL_TRACE_STORE_READ,              /* journaling store device access (span). arg0 = byte address, arg1 = size */
+    ESP_JRNL_TRACE_STORE_WRITE,
+    ESP_JRNL_TRACE_STORE_ERASE,
+    ESP_JRNL_TRACE_CHECKSUM,                /* record checksum computed (span). arg0 = data size */
+    ESP_JRNL_TRACE_LOCK_ACQUIRE,            /* transaction lock taken, the span covers the wait */
+    ESP_JRNL_TRACE_LOCK_RELEASE,            /* transaction lock released */
+    ESP_JRNL_TRACE_EVENT_COUNT
+} esp_jrnl_trace_event_t;
+
+/**
+ * @brief Trace entry
+ */
+typedef struct {
+    int64_t timestamp_us;                   /* event (span start) time, monotonic clock */
+    uint32_t duration_us;                   /* span length, 0 for instant events */
+    int16_t handle;                         /* journaling instance handle */
+    uint16_t event;                         /* esp_jrnl_trace_event_t */
+    uint32_t arg0;                          /* event arguments, see esp_jrnl_trace_event_t */
+    uint32_t arg1;
+} esp_jrnl_trace_entry_t;
+
+/**
+ * @brief Copies the entries held by the trace buffer, the oldest first. Entries being recorded or overwritten
+ * during the call are skipped, stop the journaling activity for a complete snapshot
+ *
+ * @param[out] entries  output array (NULL = only the count of available entries returned)
+ * @param[in,out] count  in: 'entries' array capacity, out: number of entries copied (available)
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG for NULL 'count'
+ *      - ESP_ERR_NOT_SUPPORTED if the trace is not compiled in
+ */
+esp_err_t esp_jrnl_trace_get(esp_jrnl_trace_entry_t* entries, size_t* count);
+
+/**
+ * @brief Prints the trace buffer contents in the text format read by tools/jrnl_trace2json:
+ *
+ *  JRNL_TRACE_BEGIN <format version> <entries held> <entries dropped>
+ *  JRNL_TRACE <timestamp_us> <duration_us> <handle> <event name> <arg0> <arg1>
+ *  ...
+ *  JRNL_TRACE_END <entries skipped>
+ *
+ * The entries are streamed in small chunks without a copy of the buffer, the ones overwritten by the events
+ * recorded during the dump are skipped.
+ *
+ * @param[in] stream  output stream (NULL = stdout)
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_SUPPORTED if the trace is not compiled in
+ */
+esp_err_t esp_jrnl_trace_dump(FILE* stream);
+
+/**
+ * @brief Drops all the entries of the trace buffer
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_SUPPORTED if the trace is not compiled in
+ */
+esp_err_t esp_jrnl_trace_clear(void);
+
+/**
+ * @brief Event name as used in the dump ("UNKNOWN" for out-of-range values)
+ */
+const char* esp_jrnl_trace_event_name(esp_jrnl_trace_event_t event);
+
+#ifdef __cplusplus
+}
+#endif
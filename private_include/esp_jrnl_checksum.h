@@ -0,0 +1,69 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Journal record checksum engines. Plain C without any IDF dependency (except of the ROM CRC32 on ESP_PLATFORM),
+ * shared with the host tools (see tools/). Engine IDs are stored in the master record, the values must never change
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JRNL_CHECKSUM_CRC32     0   /* CRC-32 (IEEE 802.3), esp_crc32_le(UINT32_MAX, ...) compatible. ROM routine on the chip */
+#define JRNL_CHECKSUM_CRC32C    1   /* CRC-32C (Castagnoli), slice-by-8 tables or SSE4.2/ARMv8 CRC instructions */
+#define JRNL_CHECKSUM_XXH32     2   /* xxHash32 (seed 0), fast non-cryptographic hash */
+#define JRNL_CHECKSUM_COUNT     3   /* number of engines known to this build */
+
+/**
+ * @brief Prepares given checksum engine for use (lookup tables built on the first call, thread-safe).
+ * Must succeed before jrnl_checksum() is called with the engine
+ *
+ * @param[in] engine  JRNL_CHECKSUM_xxx engine ID
+ *
+ * @return 0 on success, -1 for unknown engine or if the tables can't be allocated
+ */
+int jrnl_checksum_init(uint32_t engine);
+
+/**
+ * @brief Computes the checksum of 'len' bytes of 'data' by given engine (initialized by jrnl_checksum_init())
+ *
+ * @param[in] engine  JRNL_CHECKSUM_xxx engine ID
+ * @param[in] data  input data
+ * @param[in] len  input data length
+ *
+ * @return checksum value, 0 for unknown engine
+ */
+uint32_t jrnl_checksum(uint32_t engine, const void* data, size_t len);
+
+/**
+ * @brief Engine name for logs and tools ("unknown" for unknown engine)
+ */
+const char* jrnl_checksum_name(uint32_t engine);
+
+/**
+ * @brief Checks whether given engine uses the CPU CRC instructions on this machine (host builds only)
+ */
+bool jrnl_checksum_accelerated(uint32_t engine);
+
+/**
+ * @brief Engine implementations, for the benchmarks and tests. jrnl_crc32c_sw() computes the same value as
+ * jrnl_crc32c() without the CPU instructions, both require jrnl_checksum_init(JRNL_CHECKSUM_CRC32C) first
+ */
+uint32_t jrnl_crc32_le(const uint8_t* data, size_t len);
+uint32_t jrnl_crc32c(const uint8_t* data, size_t len);
+uint32_t jrnl_crc32c_sw(const uint8_t* data, size_t len);
+uint32_t jrnl_xxh32(const uint8_t* data, size_t len, uint32_t seed);
+
+#ifdef __cplusplus
+}
+#endif
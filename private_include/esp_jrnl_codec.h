@@ -0,0 +1,56 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Journal payload codecs. Plain C without any IDF dependency, shared with the host tools (see tools/)
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JRNL_CODEC_NONE         0   /* payload codec IDs stored in the record headers (esp_jrnl_codec_t), the values must never change */
+#define JRNL_CODEC_LZF          1
+
+#define JRNL_LZF_HASH_LOG       9                           /* hash table size (log2) */
+#define JRNL_LZF_HASH_SIZE      (1u << JRNL_LZF_HASH_LOG)   /* number of hash table entries */
+#define JRNL_LZF_WORKMEM_SIZE   (JRNL_LZF_HASH_SIZE * sizeof(uint32_t)) /* compressor work memory in bytes */
+
+/**
+ * @brief Compresses 'in_len' bytes of 'in' into 'out' buffer of 'out_len' bytes (LZF-style byte-oriented LZ77 coder).
+ * The coder handles both zero/pattern runs (overlapping references) and repeated structures (FAT directory entries etc.),
+ * which makes it suitable for typical file-system metadata sectors. Decoding requires no work memory at all.
+ *
+ * @param[in] in  input data
+ * @param[in] in_len  input data length
+ * @param[out] out  output buffer
+ * @param[in] out_len  output buffer size (compression is abandoned once the output would exceed it)
+ * @param[in] workmem  compressor work memory, JRNL_LZF_WORKMEM_SIZE bytes (uint32_t aligned)
+ *
+ * @return compressed data length, 0 if the data don't fit 'out_len' bytes
+ */
+size_t jrnl_lzf_compress(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_len, uint32_t* workmem);
+
+/**
+ * @brief Decompresses 'in_len' bytes of LZF data from 'in' into 'out' buffer of 'out_len' bytes
+ *
+ * @param[in] in  compressed data
+ * @param[in] in_len  compressed data length
+ * @param[out] out  output buffer
+ * @param[in] out_len  output buffer size
+ *
+ * @return decompressed data length, 0 on corrupted input or insufficient output space
+ */
+size_t jrnl_lzf_decompress(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,217 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Journaling store on-disk format: master record and operation record layouts, and the parsing helpers.
+ * Plain C without any IDF dependency, shared with the host tools (see tools/jrnl_inspect). All the stored fields
+ * have fixed width, so the host tools read the images written by the chip (the layout is checked below)
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef JRNL_STORE_MARKER
+#define JRNL_STORE_MARKER      0x6A6B6C6D   /* journaling store identifier (first 32 bits of master sector), see esp_jrnl.h */
+#endif
+
+/**
+ * @brief Journaling transaction status enumeration
+ */
+typedef enum {
+    ESP_JRNL_STATUS_FS_INIT,                /* file-system is being mounted/formatted on the journaled volume */
+    ESP_JRNL_STATUS_FS_DIRECT = ESP_JRNL_STATUS_FS_INIT, /* alias for better code readability */
+    ESP_JRNL_STATUS_TRANS_READY,            /* fresh new log or the last transaction processed completely */
+    ESP_JRNL_STATUS_TRANS_OPEN,             /* journaling transaction running */
+    ESP_JRNL_STATUS_TRANS_COMMIT            /* journaling transaction being committed to the target disk */
+} esp_jrnl_trans_status_t;
+
+/**
+ * @brief Journaling operation record type
+ */
+typedef enum {
+    ESP_JRNL_RECORD_DATA = 0,               /* target sectors data (payload encoded by 'codec') */
+    ESP_JRNL_RECORD_TRIM = 2                /* target sectors discarded by the file-system (no payload, crc32_data == 0). Value 1 is retired, never reuse it */
+} esp_jrnl_record_type_t;
+
+/**
+ * @brief Journaling operation record header. Covers one 'disk_write' operation
+ * (typical file-system API invokes several 'disk_writes' at various stages)
+ */
+typedef struct {
+    uint32_t target_sector;                 /* target sector number in the filesystem (first sector of the sequence) */
+    uint32_t sector_count;                  /* number of sectors involved in current operation */
+    uint32_t crc32_data;                    /* sector data checksum (all sectors in the sequence, decoded) */
+    uint16_t record_type;                   /* esp_jrnl_record_type_t */
+    uint16_t codec;                         /* esp_jrnl_codec_t of the payload */
+    uint32_t payload_size;                  /* stored payload size in bytes (== sector_count * sector size for ESP_JRNL_CODEC_NONE) */
+    uint32_t reserved;                      /* 0 */
+} esp_jrnl_oper_header_t;
+
+typedef struct {
+    esp_jrnl_oper_header_t header;
+    uint32_t crc32_header;                  /* operation header checksum (contents of the struct instance) */
+} esp_jrnl_operation_t;
+
+/* payload bytes stored in the header sector right after esp_jrnl_operation_t (no payload sectors needed) */
+#define JRNL_RECORD_INLINE_SIZE(sector_size)    ((sector_size) - sizeof(esp_jrnl_operation_t))
+
+/*
+ * Records with inline payload are packed in the store sectors: each one starts at the aligned end of the previous one,
+ * a zeroed header (sector_count == 0) or the sector end terminates the sequence. Records with payload sectors occupy their header sector alone
+ */
+#define JRNL_RECORD_ALIGN                       _Alignof(esp_jrnl_operation_t)
+#define JRNL_RECORD_PACKED_SIZE(payload_size)   (sizeof(esp_jrnl_operation_t) + (((payload_size) + JRNL_RECORD_ALIGN - 1) & ~((size_t)JRNL_RECORD_ALIGN - 1)))
+
+/**
+ * @brief Operation record position in the journaling store
+ */
+typedef struct {
+    uint32_t sector_index;                  /* store sector holding the record header */
+    size_t offset;                          /* record header offset within the sector (packed records) */
+} esp_jrnl_record_pos_t;
+
+/**
+ * @brief Number of store sectors occupied by the operation record (header sector + payload sectors)
+ */
+static inline uint32_t jrnl_record_sectors(const esp_jrnl_oper_header_t* header, size_t sector_size)
+{
+    if (header->payload_size <= JRNL_RECORD_INLINE_SIZE(sector_size)) {
+        return 1;
+    }
+    return 1 + (header->payload_size + sector_size - 1) / sector_size;
+}
+
+/**
+ * @brief Device properties kept in the master record (esp_jrnl_volume_t counterpart of fixed width)
+ */
+typedef struct {
+    uint32_t volume_size;                   /* device space in bytes */
+    uint32_t disk_sector_size;              /* device sector size */
+} esp_jrnl_master_volume_t;
+
+/**
+ * @brief Journaling store master record, only 1 instance defined per journaled partition.
+ * The record alternates between 2 slots (the last 2 store sectors), the slot is given by the generation parity.
+ * Each update programs the spare slot, so there is always a valid record on the disk
+ */
+typedef struct {
+    uint32_t jrnl_magic_mark;               /* journaling store master record identification stamp */
+    uint32_t store_size_sectors;            /* size of journaling store in sectors */
+    uint32_t store_volume_offset_sector;    /* index of the first journaling store sector within the store device */
+    uint32_t next_free_sector;              /* next free block. Default = 0 (relative offset in the store space) */
+    esp_jrnl_trans_status_t status;         /* transaction status. Default = ESP_JRNL_STATUS_TRANS_READY */
+    esp_jrnl_master_volume_t volume;        /* disk volume properties */
+    esp_jrnl_master_volume_t store_volume;  /* store device properties (== 'volume' unless 'store_separate') */
+    bool store_separate;                    /* the store occupies the end of a separate device, the file-system gets the whole 'volume' */
+    uint32_t checksum;                      /* operation record checksum engine (JRNL_CHECKSUM_xxx) */
+    uint32_t generation;                    /* master record update counter, the valid slot with the newest generation is the current one */
+    uint32_t crc32;                         /* master record checksum (all the items above) */
+} esp_jrnl_master_t;
+
+_Static_assert(sizeof(esp_jrnl_operation_t) == 28, "operation record layout must not change");
+_Static_assert(sizeof(esp_jrnl_master_t) == 52 && offsetof(esp_jrnl_master_t, crc32) == 48, "master record layout must not change");
+
+#define JRNL_MASTER_SLOT_COUNT          2   /* number of alternating master record slots */
+
+/* master record slot of given generation */
+#define JRNL_MASTER_SLOT(generation)    ((uint32_t)(generation) % JRNL_MASTER_SLOT_COUNT)
+
+/* store sector index of given master record slot (slot 0 == the last store sector) */
+#define JRNL_MASTER_SLOT_SECTOR(master, slot)   ((master)->store_size_sectors - 1 - (slot))
+
+/* number of store sectors available for the operation records */
+#define JRNL_STORE_DATA_SECTORS(master)         ((master)->store_size_sectors - JRNL_MASTER_SLOT_COUNT)
+
+/* number of journaled volume sectors available for the file-system (the volume end is taken by the store, unless separate) */
+#define JRNL_FS_SECTORS(master)                 ((master)->store_separate ? (master)->volume.volume_size / (master)->volume.disk_sector_size : (master)->store_volume_offset_sector)
+
+/**
+ * @brief Master record checksum (CRC32 of all the items before 'crc32', esp_crc32_le(UINT32_MAX, ...) compatible)
+ *
+ * @return checksum value, 0 if the CRC32 tables can't be allocated (host builds only)
+ */
+uint32_t jrnl_master_crc32(const esp_jrnl_master_t* master);
+
+/**
+ * @brief Checks the master record read from given slot: magic mark, checksum and the slot matching the generation
+ * (the slot is valid only if completely written and placed according to its generation)
+ *
+ * @param[in] slot_master  record at the beginning of the slot sector
+ * @param[in] slot  slot index (0 == the last store sector)
+ */
+bool jrnl_master_slot_valid(const esp_jrnl_master_t* slot_master, uint32_t slot);
+
+/**
+ * @brief Moves the master record to the next generation and seals it by the checksum. The record is to be
+ * programmed to the returned slot (the spare one), the other slot holds the previous generation
+ *
+ * @return master record slot of the new generation
+ */
+uint32_t jrnl_master_advance(esp_jrnl_master_t* master);
+
+/**
+ * @brief Checks whether 'master' is newer than 'current' (generation compare, wrap-around safe)
+ */
+static inline bool jrnl_master_newer(const esp_jrnl_master_t* master, const esp_jrnl_master_t* current)
+{
+    return (int32_t)(master->generation - current->generation) > 0;
+}
+
+/**
+ * @brief Master slot selection: takes the record read from given slot into 'master' when it is valid and newer than the one
+ *        selected so far ('*found' set on the first one). Returns false for an empty or invalid slot
+ */
+bool jrnl_master_select(const esp_jrnl_master_t* slot_master, uint32_t slot, bool* found, esp_jrnl_master_t* master);
+
+#define JRNL_IMAGE_ERR_NO_MASTER        -1  /* no valid master record in the image */
+#define JRNL_IMAGE_ERR_GEOMETRY         -2  /* master record inconsistent with the image (store geometry or checksum engine) */
+
+/**
+ * @brief Finds the newest valid master record in a raw image of the store device (host tools) and checks the recorded
+ *        store geometry against the image. 'sector_size' 0 detects the sector size (512..4096) from the master slots.
+ *        Returns the master slot, or JRNL_IMAGE_ERR_xxx
+ */
+int jrnl_find_master_in_image(const uint8_t* image, size_t image_size, size_t sector_size, esp_jrnl_master_t* master);
+
+/**
+ * @brief Moves 'pos' to the record following 'oper' ('sector_buf' holds the store sector of 'oper')
+ */
+void jrnl_record_next(const uint8_t* sector_buf, size_t sector_size, const esp_jrnl_operation_t* oper, esp_jrnl_record_pos_t* pos);
+
+#define JRNL_RECORD_DECODE_OK           0
+#define JRNL_RECORD_DECODE_ERR_SIZE     -1  /* payload size inconsistent with the record sector count */
+#define JRNL_RECORD_DECODE_ERR_DATA     -2  /* corrupted payload (decompression failed) */
+#define JRNL_RECORD_DECODE_ERR_TYPE     -3  /* unknown record type or payload codec (or a record without data) */
+
+/**
+ * @brief Decodes the payload of a data record into the target sectors content. The caller verifies
+ * the result against header.crc32_data (record checksum engine of the store)
+ *
+ * @param[in] header  operation record header
+ * @param[in] payload  stored payload, header.payload_size bytes (may equal 'data' for uncoded data records)
+ * @param[out] data  header.sector_count sectors
+ * @param[in] sector_size  sector size in bytes
+ *
+ * @return JRNL_RECORD_DECODE_OK on success, JRNL_RECORD_DECODE_ERR_xxx otherwise
+ */
+int jrnl_record_decode(const esp_jrnl_oper_header_t* header, const uint8_t* payload, uint8_t* data, size_t sector_size);
+
+/**
+ * @brief Transaction status and record type names for logs and tools ("Unknown" for out-of-range values)
+ */
+const char* jrnl_status_name(uint32_t status);
+const char* jrnl_record_type_name(uint32_t record_type);
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,10 +9,19 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdatomic.h>
 #include "esp_err.h"
 #include "esp_jrnl.h"
+#include "esp_jrnl_trace.h"
+#include "esp_jrnl_format.h"
 #include "sdkconfig.h"
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#ifdef CONFIG_ESP_JRNL_COMMIT_EXECUTOR
+#include "freertos/event_groups.h"
+#endif
+
 /*
  * File-system journaling internal structures and defines
  */
@@ -21,52 +30,113 @@
 extern "C" {
 #endif
 
+#define JRNL_TOUCHED_RANGES_MAX     16  /* target sector ranges tracked per transaction (journaled reads outside them skip the overlay) */
+#define JRNL_ERASED_RANGES_MAX      8   /* trimmed target sector ranges remembered as erased (next writes skip the erase) */
+#define JRNL_ERASE_BLOCK_SECTORS_MAX 32768 /* biggest erase block reported to FatFS (GET_BLOCK_SIZE), in sectors */
+#define JRNL_BATCH_STORE_SHARE      2   /* batched transaction committed before the next operation once it fills 1/N of the store data sectors */
+#define JRNL_IO_QUEUE_DEPTH         4   /* asynchronous disk requests in flight per instance (see esp_jrnl_diskio_t::disk_submit) */
+
 /**
- * @brief Journaling transaction status enumeration
+ * @brief Target sector range (written within the open transaction, erased)
  */
-typedef enum {
-    ESP_JRNL_STATUS_FS_INIT,                /* file-system is being mounted/formatted on the journaled volume */
-    ESP_JRNL_STATUS_FS_DIRECT = ESP_JRNL_STATUS_FS_INIT, /* alias for better code readability */
-    ESP_JRNL_STATUS_TRANS_READY,            /* fresh new log or the last transaction processed completely */
-    ESP_JRNL_STATUS_TRANS_OPEN,             /* journaling transaction running */
-    ESP_JRNL_STATUS_TRANS_COMMIT            /* journaling transaction being committed to the target disk */
-} esp_jrnl_trans_status_t;
+typedef struct {
+    uint32_t first_sector;
+    uint32_t sector_count;
+} esp_jrnl_sector_range_t;
 
 /**
- * @brief Journaling operation record header. Covers one 'disk_write' operation
- * (typical file-system API invokes several 'disk_writes' at various stages)
+ * @brief Batched transaction state at the start of an operation (see jrnl_start()), restored when the operation fails
  */
 typedef struct {
-    uint32_t target_sector;                 /* target sector number in the filesystem (first sector of the sequence) */
-    size_t sector_count;                    /* number of sectors involved in current operation */
-    uint32_t crc32_data;                    /* sector data checksum (all sectors in the sequence) */
-} esp_jrnl_oper_header_t;
+    uint32_t next_free_sector;              /* master.next_free_sector */
+    size_t tail_offset;                     /* bytes used in the tail sector (its content is re-read if flushed meanwhile) */
+    esp_jrnl_sector_range_t touched[JRNL_TOUCHED_RANGES_MAX];
+    uint8_t touched_count;
+} jrnl_savepoint_t;
 
+/**
+ * @brief Instance statistics counters (esp_jrnl_stats_t counterpart). The 32-bit ones are updated with relaxed atomic
+ * operations and readable by any task without taking the transaction lock, the 64-bit ones are plain fields updated and read
+ * under the transaction lock (64-bit atomics are library lock calls on the 32-bit targets)
+ */
 typedef struct {
-    esp_jrnl_oper_header_t header;
-    uint32_t crc32_header;                  /* operation header checksum (contents of the struct instance) */
-} esp_jrnl_operation_t;
+    atomic_uint trans_started;
+    atomic_uint trans_committed;
+    atomic_uint trans_cancelled;
+    uint64_t sectors_journaled;
+    atomic_uint sectors_read;               /* device traffic in sectors (exported in bytes) */
+    atomic_uint sectors_written;
+    atomic_uint sectors_erased;
+    atomic_uint master_updates;
+    atomic_uint master_spare_misses;
+    atomic_uint replays;
+    uint64_t replay_time_us;
+    atomic_uint replay_time_max_us;
+    atomic_uint store_peak_sectors;
+    uint64_t append_time_us;
+} esp_jrnl_stats_counters_t;
+
+typedef struct jrnl_diskio_probe jrnl_diskio_probe_t;    /* see esp_jrnl_diskio_probe.c */
 
 /**
- * @brief Journaling store master record, only 1 instance defined per journaled partition
+ * @brief Scratch buffers of the write, replay and read paths. Provisioned once by esp_jrnl_mount_static() (the sector
+ * ones of the sector size, the record ones of 'record_max_sectors'), allocated per call otherwise
  */
-typedef struct {
-    uint32_t jrnl_magic_mark;               /* journaling store master record identification stamp */
-    size_t store_size_sectors;              /* size of journaling store in sectors */
-    size_t store_volume_offset_sector;      /* index of the first journaling store sector within the volume */
-    uint32_t next_free_sector;              /* next free block. Default = 0 (relative offset in the store space) */
-    esp_jrnl_trans_status_t status;         /* transaction status. Default = ESP_JRNL_STATUS_TRANS_READY */
-    esp_jrnl_volume_t volume;               /* disk volume properties */
-} esp_jrnl_master_t;
+typedef enum {
+    JRNL_SCRATCH_HEADER,                    /* operation header sector (record written, replayed or overlaid) */
+    JRNL_SCRATCH_AUX,                       /* lookup sector (master record slots, debug printout) */
+    JRNL_SCRATCH_DATA,                      /* record: replayed/overlaid data, encoded payload of the record written */
+    JRNL_SCRATCH_DATA2,                     /* record: replayed data in flight (alternates with JRNL_SCRATCH_DATA) */
+    JRNL_SCRATCH_PAYLOAD,                   /* record: stored payload being decoded */
+    JRNL_SCRATCH_COUNT
+} jrnl_scratch_id_t;
 
 /**
  * @brief Runtime configuration of a single journaling store instance. Not stored on the target media, memory only
  */
 typedef struct {
     _lock_t trans_lock;
+    esp_jrnl_handle_t handle;               /* instance handle (index in the instance table) */
     uint8_t fs_volume_id;                   /* file-system volume ID (PDRV for FatFS) */
     esp_jrnl_diskio_t diskio;               /* disk device access configuration */
+    esp_jrnl_diskio_t store_diskio;         /* store device access configuration (== 'diskio' unless master.store_separate) */
     esp_jrnl_master_t master;               /* journal master record for given instance */
+    uint8_t* master_buf;                    /* master record sector buffer */
+    bool master_spare_blank;                /* spare master slot erased, ready for programming */
+    bool master_disk_clean;                 /* newest master record on the disk is TRANS_READY without records ('master_buf' holds its copy) */
+    bool read_only;                         /* no store or target writes (except the mount replay of a committed transaction), from esp_jrnl_config_t */
+    esp_jrnl_codec_t payload_codec;         /* record payload codec (from esp_jrnl_config_t) */
+    uint32_t* codec_workmem;                /* payload compressor work memory (NULL for ESP_JRNL_CODEC_NONE) */
+    esp_jrnl_sector_range_t touched[JRNL_TOUCHED_RANGES_MAX]; /* target ranges written in the open transaction */
+    uint8_t touched_count;                  /* number of valid 'touched' items, JRNL_TOUCHED_RANGES_MAX + 1 == overflow (batch committed) */
+    uint8_t* tail_buf;                      /* store sector being packed with inline records (flushed to 'next_free_sector' when full or on commit) */
+    size_t tail_offset;                     /* bytes used in 'tail_buf', 0 == no records pending */
+    jrnl_savepoint_t savepoint;             /* transaction state before the operation in progress (failed operation dropped from a batch) */
+    esp_jrnl_sector_range_t erased[JRNL_ERASED_RANGES_MAX]; /* target ranges known erased (trimmed, not written since) */
+    uint8_t erased_count;                   /* number of valid 'erased' items */
+    SemaphoreHandle_t io_done;              /* completions of the asynchronous disk requests (NULL == synchronous devices only) */
+    uint32_t io_pending;                    /* asynchronous requests submitted and not waited for yet (max JRNL_IO_QUEUE_DEPTH) */
+    atomic_int io_err;                      /* first error reported by the completions since the last jrnl_io_wait() */
+    esp_jrnl_commit_mode_t commit_mode;     /* transaction commit policy (from esp_jrnl_config_t) */
+    uint32_t commit_batch_ops;              /* operations per batched transaction (from esp_jrnl_config_t) */
+    bool op_open;                           /* operation in progress (between esp_jrnl_start() and esp_jrnl_stop()) */
+    uint32_t batch_ops;                     /* operations finished within the open (batched) transaction */
+    bool sync_requested;                    /* commit barrier hit within the operation in progress, commit at its esp_jrnl_stop() */
+    esp_jrnl_stats_counters_t stats;        /* statistics counters (see esp_jrnl_get_stats()) */
+    jrnl_diskio_probe_t* probe;             /* device operation statistics, 'diskio'/'store_diskio' wrapped (NULL = probe off) */
+    SemaphoreHandle_t refs_drained;         /* given by the last instance reference dropped while esp_jrnl_unmount() waits for them */
+    StaticSemaphore_t refs_drained_mem;     /* 'refs_drained' semaphore storage (no heap use, static instances included) */
+    bool static_mem;                        /* instance and buffers in the caller's memory (esp_jrnl_mount_static()), no heap use */
+    uint32_t record_max_sectors;            /* static_mem: data sectors of the largest record the scratch buffers hold (longer writes split) */
+    uint8_t* scratch[JRNL_SCRATCH_COUNT];   /* static_mem: provisioned scratch buffers (see jrnl_scratch_id_t) */
+    StaticSemaphore_t io_done_mem;          /* static_mem: 'io_done' semaphore storage */
+    SemaphoreHandle_t static_lock;          /* static_mem: transaction lock used instead of 'trans_lock' (whose mutex comes from the heap) */
+    StaticSemaphore_t static_lock_mem;      /* static_mem: 'static_lock' mutex storage */
+#ifdef CONFIG_ESP_JRNL_COMMIT_EXECUTOR
+    bool async_commit;                      /* commits replayed by the shared commit executor (see esp_jrnl_config_t) */
+    EventGroupHandle_t commit_events;       /* commit state of the instance (idle/pending) */
+    esp_err_t commit_err;                   /* result of the last asynchronous commit, reported once by jrnl_commit_wait() */
+#endif
 #ifdef CONFIG_ESP_JRNL_ENABLE_TESTMODE
     uint32_t test_config;                   /* runtime flags for internal testing, 0x0 by default */
 #endif
@@ -121,14 +191,38 @@ void print_jrnl_config_extended(const esp_jrnl_config_extended_t *config);
 esp_err_t jrnl_check_handle(const esp_jrnl_handle_t handle, const char *func);
 
 /**
- * @brief Converts FS journal store index to parent partition disk sector index
+ * @brief Looks up FS journal instance for given handle and takes a reference to it.
+ * The instance stays valid (cannot be released by esp_jrnl_unmount()) until the reference is dropped by jrnl_put_instance().
+ * The lookup is lock-free, instances of different handles never contend.
+ *
+ * @param[in] handle  instance handle
+ * @param[in] func  name of the caller function for better log readability
+ * @param[out] inst_ptr  FS journal instance pointer, set only on success
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the handle equals to JRNL_INVALID_HANDLE
+ *      - ESP_ERR_INVALID_ARG if the handle is out of range (>= JRNL_MAX_HANDLES)
+ *      - ESP_ERR_NOT_FOUND if there is no instance assigned to the handle (or the instance is being mounted/unmounted)
+ */
+esp_err_t jrnl_get_instance(const esp_jrnl_handle_t handle, const char *func, esp_jrnl_instance_t** inst_ptr);
+
+/**
+ * @brief Drops the instance reference taken by jrnl_get_instance()
+ *
+ * @param[in] inst_ptr  FS journal instance pointer (NULL is ignored)
+ */
+void jrnl_put_instance(esp_jrnl_instance_t* inst_ptr);
+
+/**
+ * @brief Converts FS journal store index to the store device sector index (the journaled volume itself, unless the store is separate)
  *
  * This function is designed for strictly internal use and provides no parameter check
  *
  * @param inst_ptr  FS journal instance pointer
  * @param jrnl_sector  journal store sector index
  *
- * @return parent partition disk sector index
+ * @return store device sector index
  */
 uint32_t jrnl_get_target_disk_sector(const esp_jrnl_instance_t* inst_ptr, const uint32_t jrnl_sector);
 
@@ -160,12 +254,27 @@ esp_err_t jrnl_read_internal(esp_jrnl_instance_t* inst_ptr, uint8_t *out_buff, u
  */
 esp_err_t jrnl_write_internal(esp_jrnl_instance_t* inst_ptr, const uint8_t *buff, const uint32_t sector, const uint32_t count);
 
+/**
+ * @brief Reads both master record slots from the disk and provides the newest valid one (magic mark, CRC32 and slot position checked)
+ *
+ * @param[in] diskio  store device access configuration
+ * @param[in] volume  store device volume configuration (the slots are the last 2 sectors of the volume)
+ * @param[out] master  master record found
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG some of the arguments are NULL
+ *      - ESP_ERR_NOT_FOUND if there is no valid master record on the disk
+ *      - errors returned by underlying diskio.disk_read operation (eg wl_read())
+ */
+esp_err_t jrnl_read_master(const esp_jrnl_diskio_t* diskio, const esp_jrnl_volume_t* volume, esp_jrnl_master_t* master);
+
 /**
  * @brief Reset's the journal master record of given instance to its defaults:
  *          - master.jrnl_magic_mark = JRNL_STORE_MARKER;
  *          - master.next_free_sector = 0;
  *          - master.status = init ? ESP_JRNL_STATUS_FS_INIT : ESP_JRNL_STATUS_TRANS_READY;
- * Other fields remain untouched.
+ * Other fields remain untouched. The record is written to the spare master slot (see esp_jrnl_master_t)
  *
  * @param inst_ptr  FS journal instance pointer
  * @param fs_direct  flag to distinguish between (initial) file-system direct access (FS mount, format, etc) and journaling-on state (JRNL transaction ready)
@@ -192,6 +301,110 @@ esp_err_t jrnl_reset_master(esp_jrnl_instance_t* jrnl, bool fs_direct);
  */
 esp_err_t jrnl_replay(esp_jrnl_instance_t* jrnl_log);
 
+#ifdef CONFIG_ESP_JRNL_COMMIT_EXECUTOR
+/**
+ * @brief Starts the shared commit executor (one worker task per CPU core), if not running yet
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NO_MEM if the commit queue or the worker tasks can't be created
+ */
+esp_err_t jrnl_executor_init(void);
+
+/**
+ * @brief Initializes/releases the asynchronous commit context of given FS journal instance
+ *
+ * @param inst_ptr  FS journal instance pointer
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NO_MEM if the commit event group can't be created
+ */
+esp_err_t jrnl_commit_ctx_init(esp_jrnl_instance_t* inst_ptr);
+void jrnl_commit_ctx_deinit(esp_jrnl_instance_t* inst_ptr);
+
+/**
+ * @brief Hands over the replay of committed transaction (master status ESP_JRNL_STATUS_TRANS_COMMIT) to the commit executor.
+ * The executor holds its own instance reference until the replay is finished
+ *
+ * @param inst_ptr  FS journal instance pointer
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NO_MEM if the commit queue is full
+ *      - errors from jrnl_get_instance() (eg instance being unmounted)
+ */
+esp_err_t jrnl_executor_submit(esp_jrnl_instance_t* inst_ptr);
+
+/**
+ * @brief Waits for the pending asynchronous commit of given FS journal instance, if any
+ *
+ * @param inst_ptr  FS journal instance pointer
+ *
+ * @return
+ *      - ESP_OK if no commit pending or the last commit succeeded
+ *      - errors from jrnl_replay() of the last asynchronous commit (reported once)
+ */
+esp_err_t jrnl_commit_wait(esp_jrnl_instance_t* inst_ptr);
+#else
+static inline esp_err_t jrnl_commit_wait(esp_jrnl_instance_t* inst_ptr)
+{
+    return ESP_OK;
+}
+#endif
+
+/**
+ * @brief Monotonic time in microseconds (statistics, probes)
+ */
+int64_t jrnl_time_us(void);
+
+/**
+ * @brief Attaches the diskio probe to given FS journal instance: 'diskio' and 'store_diskio' get replaced by the measuring
+ * wrappers of the same devices (the original routines kept by the probe). Must be called before any device access
+ *
+ * @param inst_ptr  FS journal instance pointer (handle assigned, 'diskio' and 'store_diskio' set)
+ * @param store_separate  the store occupies a separate device
+ * @param store_volume  store device geometry (the master record slots are its last sectors)
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NO_MEM if the probe can't be allocated
+ */
+esp_err_t jrnl_probe_attach(esp_jrnl_instance_t* inst_ptr, bool store_separate, const esp_jrnl_volume_t* store_volume);
+
+/**
+ * @brief Detaches the diskio probe (original device routines restored), no-op if not attached
+ */
+void jrnl_probe_detach(esp_jrnl_instance_t* inst_ptr);
+
+/**
+ * @brief Original target ('store' == false) or store device routines of the instance with the probe attached
+ */
+const esp_jrnl_diskio_t* jrnl_probe_backend(const esp_jrnl_instance_t* inst_ptr, bool store);
+
+/**
+ * @brief Copies/clears the diskio probe statistics of the instance with the probe attached
+ */
+void jrnl_probe_get_stats(esp_jrnl_instance_t* inst_ptr, esp_jrnl_diskio_stats_t* stats);
+void jrnl_probe_reset_stats(esp_jrnl_instance_t* inst_ptr);
+
+#ifdef CONFIG_ESP_JRNL_TRACE
+/**
+ * @brief Trace entry recording (timestamps by jrnl_time_us()), see esp_jrnl_trace.h.
+ * Used through the JRNL_TRACE_xxx macros below, which compile to nothing without CONFIG_ESP_JRNL_TRACE
+ */
+void jrnl_trace_record(int32_t handle, esp_jrnl_trace_event_t event, uint32_t arg0, uint32_t arg1, int64_t start_us, int64_t end_us);
+
+#define JRNL_TRACE_TIME(var)                        int64_t var = jrnl_time_us()
+#define JRNL_TRACE(inst, event, a0, a1)             do { int64_t _now = jrnl_time_us(); \
+                                                         jrnl_trace_record((inst)->handle, (event), (uint32_t)(a0), (uint32_t)(a1), _now, _now); } while(0)
+#define JRNL_TRACE_SPAN(inst, event, a0, a1, start) jrnl_trace_record((inst)->handle, (event), (uint32_t)(a0), (uint32_t)(a1), (start), jrnl_time_us())
+#else
+#define JRNL_TRACE_TIME(var)
+#define JRNL_TRACE(inst, event, a0, a1)             do {} while(0)
+#define JRNL_TRACE_SPAN(inst, event, a0, a1, start) do {} while(0)
+#endif
+
 #ifdef __cplusplus
 }
 #endif
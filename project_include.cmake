@@ -0,0 +1,67 @@
+# esp_jrnl_create_spiflash_image
+#
+# Create a journaled FAT partition image from a directory tree (tools/jrnl_mkimage/jrnl_mkimage.py) and optionally
+# flash it with the project (FLASH_IN_PROJECT). The image carries a clean journaling store, so the first
+# esp_vfs_fat_spiflash_mount_jrnl() of the partition skips the formatting. STORE_SIZE_SECTORS and CHECKSUM must match
+# the esp_jrnl_config_t used at the mount (defaults: ESP_JRNL_DEFAULT_CONFIG()).
+#
+# esp_jrnl_create_spiflash_image(partition base_dir [FLASH_IN_PROJECT] [PRESERVE_TIME]
+#                                [STORE_SIZE_SECTORS n] [CHECKSUM crc32|crc32c|xxh32] [DEPENDS dep dep dep...])
+function(esp_jrnl_create_spiflash_image partition base_dir)
+    set(options FLASH_IN_PROJECT PRESERVE_TIME)
+    set(one_value_args STORE_SIZE_SECTORS CHECKSUM)
+    set(multi DEPENDS)
+    cmake_parse_arguments(arg "${options}" "${one_value_args}" "${multi}" "${ARGN}")
+
+    idf_build_get_property(idf_path IDF_PATH)
+    idf_build_get_property(python PYTHON)
+    set(mkimage_py ${python} ${CMAKE_CURRENT_FUNCTION_LIST_DIR}/tools/jrnl_mkimage/jrnl_mkimage.py)
+
+    set(mkimage_args)
+    if(NOT CONFIG_FATFS_LFN_NONE)
+        list(APPEND mkimage_args --long_name_support)
+    endif()
+    if(NOT arg_PRESERVE_TIME)
+        list(APPEND mkimage_args --use_default_datetime)
+    endif()
+    if(CONFIG_FATFS_ONE_FAT)
+        list(APPEND mkimage_args --fat_count 1)
+    endif()
+    if(arg_STORE_SIZE_SECTORS)
+        list(APPEND mkimage_args --store_size_sectors ${arg_STORE_SIZE_SECTORS})
+    endif()
+    if(arg_CHECKSUM)
+        list(APPEND mkimage_args --checksum ${arg_CHECKSUM})
+    endif()
+
+    get_filename_component(base_dir_full_path ${base_dir} ABSOLUTE)
+
+    partition_table_get_partition_info(size "--partition-name ${partition}" "size")
+    partition_table_get_partition_info(offset "--partition-name ${partition}" "offset")
+
+    if("${size}" AND "${offset}")
+        set(image_file ${CMAKE_BINARY_DIR}/${partition}.bin)
+        add_custom_target(esp_jrnl_${partition}_bin ALL
+            COMMAND ${CMAKE_COMMAND} -E env IDF_PATH=${idf_path}
+                    ${mkimage_py} ${base_dir_full_path} ${mkimage_args}
+                    --partition_size ${size} --sector_size 4096 --output_file ${image_file}
+            )
+
+        set_property(DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}" APPEND PROPERTY
+            ADDITIONAL_CLEAN_FILES
+            ${image_file})
+
+        if(arg_DEPENDS)
+            add_dependencies(esp_jrnl_${partition}_bin ${arg_DEPENDS})
+        endif()
+
+        if(arg_FLASH_IN_PROJECT)
+            esptool_py_flash_to_partition(flash "${partition}" "${image_file}")
+            add_dependencies(flash esp_jrnl_${partition}_bin)
+        endif()
+    else()
+        set(message "Failed to create journaled FAT image for partition '${partition}'. "
+                    "Check project configuration if using the correct partition table file.")
+        fail_at_build_time(esp_jrnl_${partition}_bin "${message}")
+    endif()
+endfunction()
@@ -11,77 +11,404 @@
 #include <sys/errno.h>
 #include <sys/fcntl.h>
 #include <sys/lock.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <time.h>
 
 #include "sdkconfig.h"
 #include "esp_log.h"
-#include "esp_crc.h"
 #include "esp_jrnl_internal.h"
+#include "esp_jrnl_codec.h"
+#include "esp_jrnl_checksum.h"
 
 #ifdef CONFIG_ESP_JRNL_ENABLE_TESTMODE
 #include "esp_system.h"
 #endif
 
 static const char* TAG = "esp_jrnl";
-static _lock_t s_instances_lock;
 
-esp_jrnl_instance_t* s_jrnl_instance_ptrs[JRNL_MAX_HANDLES] = {
-        [0 ... JRNL_MAX_HANDLES - 1] = NULL
-};
+/* slot value of a handle being mounted or unmounted (never dereferenced) */
+#define JRNL_INSTANCE_RESERVED ((esp_jrnl_instance_t*)UINTPTR_MAX)
 
-static const char* jrnl_status_to_str(esp_jrnl_trans_status_t status)
+/* Instance table: pointers are published atomically by esp_jrnl_mount() and withdrawn by esp_jrnl_unmount().
+ * Each slot has its own reference counter, incremented by jrnl_get_instance() *before* the pointer is loaded,
+ * so the unmount only needs to wait for the slot counter to drain before freeing the instance. The waiting unmount
+ * parks the instance in the 'draining' slot, the reference dropped last takes it out and wakes the unmount up.
+ * No global lock is involved - operations on different handles never contend */
+static _Atomic(esp_jrnl_instance_t*) s_jrnl_instance_ptrs[JRNL_MAX_HANDLES];
+static atomic_uint s_jrnl_instance_refs[JRNL_MAX_HANDLES];
+static _Atomic(esp_jrnl_instance_t*) s_jrnl_instance_draining[JRNL_MAX_HANDLES];
+
+/* drops a slot reference, the last one wakes up the unmount waiting for the slot to drain (if any) */
+static void jrnl_ref_drop(const esp_jrnl_handle_t handle)
 {
-    switch(status)
-    {
-        case ESP_JRNL_STATUS_FS_INIT: return "Initialize/FS-direct";
-        case ESP_JRNL_STATUS_TRANS_READY: return "Ready";
-        case ESP_JRNL_STATUS_TRANS_OPEN: return "Open";
-        case ESP_JRNL_STATUS_TRANS_COMMIT: return "Commit";
+    if (atomic_fetch_sub(&s_jrnl_instance_refs[handle], 1) == 1) {
+        esp_jrnl_instance_t* draining = atomic_exchange(&s_jrnl_instance_draining[handle], NULL);
+        if (draining != NULL) {
+            xSemaphoreGive(draining->refs_drained);
+        }
     }
-
-    return "Unknown";
 }
 
-esp_err_t jrnl_check_handle(const esp_jrnl_handle_t handle, const char *func)
+esp_err_t jrnl_get_instance(const esp_jrnl_handle_t handle, const char *func, esp_jrnl_instance_t** inst_ptr)
 {
     if (handle == JRNL_INVALID_HANDLE) {
         ESP_LOGE(TAG, "%s: invalid handle", func);
         return ESP_ERR_INVALID_STATE;
     }
 
-    if (handle >= JRNL_MAX_HANDLES) {
+    if (handle < 0 || handle >= JRNL_MAX_HANDLES) {
         ESP_LOGE(TAG, "%s: instance[%ld] out of range", func, (int32_t)handle);
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (s_jrnl_instance_ptrs[handle] == NULL) {
+    //take the slot reference first, the instance cannot be released afterwards
+    atomic_fetch_add(&s_jrnl_instance_refs[handle], 1);
+
+    esp_jrnl_instance_t* inst = atomic_load(&s_jrnl_instance_ptrs[handle]);
+    if (inst == NULL || inst == JRNL_INSTANCE_RESERVED) {
+        jrnl_ref_drop(handle);
         ESP_LOGE(TAG, "%s: instance[%ld] not initialized", func, (int32_t)handle);
         return ESP_ERR_NOT_FOUND;
     }
 
+    *inst_ptr = inst;
     return ESP_OK;
 }
 
+void jrnl_put_instance(esp_jrnl_instance_t* inst_ptr)
+{
+    if (inst_ptr != NULL) {
+        jrnl_ref_drop(inst_ptr->handle);
+    }
+}
+
+esp_err_t jrnl_check_handle(const esp_jrnl_handle_t handle, const char *func)
+{
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, func, &inst_ptr);
+    jrnl_put_instance(inst_ptr);
+
+    return err;
+}
+
 uint32_t jrnl_get_target_disk_sector(const esp_jrnl_instance_t* inst_ptr, const uint32_t jrnl_sector)
 {
     return inst_ptr->master.store_volume_offset_sector + jrnl_sector;
 }
 
+/* 32-bit statistics counters: independent values, relaxed atomic updates are enough */
+#define JRNL_STATS_ADD(inst_ptr, counter, value)    atomic_fetch_add_explicit(&(inst_ptr)->stats.counter, (value), memory_order_relaxed)
+
+static void jrnl_stats_max(atomic_uint* counter, unsigned int value)
+{
+    unsigned int current = atomic_load_explicit(counter, memory_order_relaxed);
+    while (current < value && !atomic_compare_exchange_weak_explicit(counter, &current, value, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+/* store sectors taken by the records of the open transaction (incl. the tail being packed) */
+static inline uint32_t jrnl_store_used_sectors(const esp_jrnl_instance_t* inst_ptr)
+{
+    return inst_ptr->master.next_free_sector + (inst_ptr->tail_offset > 0 ? 1 : 0);
+}
+
+int64_t jrnl_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* transaction lock, the wait for it recorded by the trace */
+static inline void jrnl_trans_lock(esp_jrnl_instance_t* inst_ptr)
+{
+    JRNL_TRACE_TIME(start);
+    if (inst_ptr->static_mem) {
+        xSemaphoreTake(inst_ptr->static_lock, portMAX_DELAY);
+    }
+    else {
+        _lock_acquire(&inst_ptr->trans_lock);
+    }
+    JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_LOCK_ACQUIRE, 0, 0, start);
+}
+
+static inline void jrnl_trans_unlock(esp_jrnl_instance_t* inst_ptr)
+{
+    JRNL_TRACE(inst_ptr, ESP_JRNL_TRACE_LOCK_RELEASE, 0, 0);
+    if (inst_ptr->static_mem) {
+        xSemaphoreGive(inst_ptr->static_lock);
+    }
+    else {
+        _lock_release(&inst_ptr->trans_lock);
+    }
+}
+
+/* device access with the statistics (synchronous routines, or the request accepted by 'disk_submit'), always whole sectors */
+static inline void jrnl_stats_io(esp_jrnl_instance_t* inst_ptr, esp_jrnl_diskio_op_t op, size_t size)
+{
+    unsigned int sectors = size / inst_ptr->master.volume.disk_sector_size;
+    switch (op) {
+        case ESP_JRNL_DISKIO_OP_READ:
+            JRNL_STATS_ADD(inst_ptr, sectors_read, sectors);
+            break;
+        case ESP_JRNL_DISKIO_OP_WRITE:
+            JRNL_STATS_ADD(inst_ptr, sectors_written, sectors);
+            break;
+        default:
+            JRNL_STATS_ADD(inst_ptr, sectors_erased, sectors);
+            break;
+    }
+}
+
 /* read directly from the instance specific disk device */
 esp_err_t jrnl_read_raw(esp_jrnl_instance_t* inst_ptr, size_t src_addr, void *dest, size_t size)
 {
-    return inst_ptr->diskio.disk_read(inst_ptr->diskio.diskio_ctrl_handle, src_addr, dest, size);
+    jrnl_stats_io(inst_ptr, ESP_JRNL_DISKIO_OP_READ, size);
+    JRNL_TRACE_TIME(start);
+    esp_err_t err = inst_ptr->diskio.disk_read(inst_ptr->diskio.diskio_ctrl_handle, src_addr, dest, size);
+    JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_DISK_READ, src_addr, size, start);
+    return err;
 }
 
 /* erase_range directly for the instance specific disk device */
 static esp_err_t jrnl_write_raw(esp_jrnl_instance_t* inst_ptr, size_t dest_addr, const void *src, size_t size)
 {
-    return inst_ptr->diskio.disk_write(inst_ptr->diskio.diskio_ctrl_handle, dest_addr, src, size);
+    jrnl_stats_io(inst_ptr, ESP_JRNL_DISKIO_OP_WRITE, size);
+    JRNL_TRACE_TIME(start);
+    esp_err_t err = inst_ptr->diskio.disk_write(inst_ptr->diskio.diskio_ctrl_handle, dest_addr, src, size);
+    JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_DISK_WRITE, dest_addr, size, start);
+    return err;
 }
 
 /* erase_range directly for the instance specific disk device */
 static esp_err_t jrnl_erase_range_raw(esp_jrnl_instance_t* inst_ptr, size_t start_addr, size_t size)
 {
-    return inst_ptr->diskio.disk_erase_range(inst_ptr->diskio.diskio_ctrl_handle, start_addr, size);
+    jrnl_stats_io(inst_ptr, ESP_JRNL_DISKIO_OP_ERASE, size);
+    JRNL_TRACE_TIME(start);
+    esp_err_t err = inst_ptr->diskio.disk_erase_range(inst_ptr->diskio.diskio_ctrl_handle, start_addr, size);
+    JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_DISK_ERASE, start_addr, size, start);
+    return err;
+}
+
+/* store device counterparts of the above (the store may live on a separate device) */
+static esp_err_t jrnl_store_read_raw(esp_jrnl_instance_t* inst_ptr, size_t src_addr, void *dest, size_t size)
+{
+    jrnl_stats_io(inst_ptr, ESP_JRNL_DISKIO_OP_READ, size);
+    JRNL_TRACE_TIME(start);
+    esp_err_t err = inst_ptr->store_diskio.disk_read(inst_ptr->store_diskio.diskio_ctrl_handle, src_addr, dest, size);
+    JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_STORE_READ, src_addr, size, start);
+    return err;
+}
+
+static esp_err_t jrnl_store_write_raw(esp_jrnl_instance_t* inst_ptr, size_t dest_addr, const void *src, size_t size)
+{
+    jrnl_stats_io(inst_ptr, ESP_JRNL_DISKIO_OP_WRITE, size);
+    JRNL_TRACE_TIME(start);
+    esp_err_t err = inst_ptr->store_diskio.disk_write(inst_ptr->store_diskio.diskio_ctrl_handle, dest_addr, src, size);
+    JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_STORE_WRITE, dest_addr, size, start);
+    return err;
+}
+
+static esp_err_t jrnl_store_erase_range_raw(esp_jrnl_instance_t* inst_ptr, size_t start_addr, size_t size)
+{
+    jrnl_stats_io(inst_ptr, ESP_JRNL_DISKIO_OP_ERASE, size);
+    JRNL_TRACE_TIME(start);
+    esp_err_t err = inst_ptr->store_diskio.disk_erase_range(inst_ptr->store_diskio.diskio_ctrl_handle, start_addr, size);
+    JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_STORE_ERASE, start_addr, size, start);
+    return err;
+}
+
+/*
+ * Asynchronous disk requests. Devices without 'disk_submit' get the request done by the synchronous routines right away (shim),
+ * the others queue it and report the completion later. Submitted requests are waited for by jrnl_io_wait(), always called
+ * by the task holding the transaction lock before the buffers are released or the master record refers to the data
+ */
+static void jrnl_io_done(void* arg, esp_err_t result)
+{
+    esp_jrnl_instance_t* inst_ptr = (esp_jrnl_instance_t*)arg;
+
+    if (result != ESP_OK) {
+        int expected = ESP_OK;
+        atomic_compare_exchange_strong(&inst_ptr->io_err, &expected, result);
+    }
+    xSemaphoreGive(inst_ptr->io_done);
+}
+
+static esp_err_t jrnl_io_submit(esp_jrnl_instance_t* inst_ptr, const esp_jrnl_diskio_t* diskio, esp_jrnl_diskio_op_t op, size_t addr, void* buf, size_t size)
+{
+    jrnl_stats_io(inst_ptr, op, size);
+#ifdef CONFIG_ESP_JRNL_TRACE
+    //READ/WRITE/ERASE trace events follow the esp_jrnl_diskio_op_t order
+    esp_jrnl_trace_event_t trace_event = (diskio == &inst_ptr->store_diskio ? ESP_JRNL_TRACE_STORE_READ : ESP_JRNL_TRACE_DISK_READ) + op;
+#endif
+    JRNL_TRACE_TIME(start);
+
+    esp_err_t err;
+    if (diskio->disk_submit == NULL) {
+        switch (op) {
+            case ESP_JRNL_DISKIO_OP_READ:
+                err = diskio->disk_read(diskio->diskio_ctrl_handle, addr, buf, size);
+                break;
+            case ESP_JRNL_DISKIO_OP_WRITE:
+                err = diskio->disk_write(diskio->diskio_ctrl_handle, addr, buf, size);
+                break;
+            default:
+                err = diskio->disk_erase_range(diskio->diskio_ctrl_handle, addr, size);
+                break;
+        }
+        JRNL_TRACE_SPAN(inst_ptr, trace_event, addr, size, start);
+        return err;
+    }
+
+    //queue full: wait for a completion
+    if (inst_ptr->io_pending == JRNL_IO_QUEUE_DEPTH) {
+        xSemaphoreTake(inst_ptr->io_done, portMAX_DELAY);
+        inst_ptr->io_pending--;
+    }
+
+    esp_jrnl_diskio_req_t req = {
+        .op = op,
+        .addr = addr,
+        .buf = buf,
+        .size = size,
+        .done = jrnl_io_done,
+        .done_arg = inst_ptr
+    };
+
+    err = diskio->disk_submit(diskio->diskio_ctrl_handle, &req);
+    if (err == ESP_OK) {
+        inst_ptr->io_pending++;
+        //the device time isn't known here, the request is recorded as an instant event
+        JRNL_TRACE(inst_ptr, trace_event, addr, size);
+    }
+
+    return err;
+}
+
+/* waits for all the submitted requests, returns the first error reported */
+static esp_err_t jrnl_io_wait(esp_jrnl_instance_t* inst_ptr)
+{
+    while (inst_ptr->io_pending > 0) {
+        xSemaphoreTake(inst_ptr->io_done, portMAX_DELAY);
+        inst_ptr->io_pending--;
+    }
+
+    return (esp_err_t)atomic_exchange(&inst_ptr->io_err, ESP_OK);
+}
+
+/*
+ * Target ranges known erased: discarded by TRIM records and not written since. Writes into such a range skip the erase,
+ * the index lives in RAM only (empty after mount) and drops the ranges conservatively when running out of slots
+ */
+static bool jrnl_range_erased(const esp_jrnl_instance_t* inst_ptr, uint32_t sector, uint32_t count)
+{
+    for (uint8_t i = 0; i < inst_ptr->erased_count; i++) {
+        const esp_jrnl_sector_range_t* range = &inst_ptr->erased[i];
+        if (range->first_sector <= sector && sector + count <= range->first_sector + range->sector_count) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void jrnl_range_erased_add(esp_jrnl_instance_t* inst_ptr, uint32_t sector, uint32_t count)
+{
+    uint32_t first = sector;
+    uint32_t end = sector + count;
+
+    //merge with the overlapping and adjacent ranges
+    for (uint8_t i = 0; i < inst_ptr->erased_count; ) {
+        esp_jrnl_sector_range_t* range = &inst_ptr->erased[i];
+        uint32_t range_end = range->first_sector + range->sector_count;
+        if (range->first_sector <= end && first <= range_end) {
+            first = range->first_sector < first ? range->first_sector : first;
+            end = range_end > end ? range_end : end;
+            *range = inst_ptr->erased[--inst_ptr->erased_count];
+            continue;
+        }
+        i++;
+    }
+
+    //no free slot: the smallest range gives way
+    uint8_t slot = inst_ptr->erased_count;
+    if (slot == JRNL_ERASED_RANGES_MAX) {
+        slot = 0;
+        for (uint8_t i = 1; i < JRNL_ERASED_RANGES_MAX; i++) {
+            if (inst_ptr->erased[i].sector_count < inst_ptr->erased[slot].sector_count) {
+                slot = i;
+            }
+        }
+        if (inst_ptr->erased[slot].sector_count >= end - first) {
+            return;
+        }
+    }
+    else {
+        inst_ptr->erased_count++;
+    }
+
+    inst_ptr->erased[slot].first_sector = first;
+    inst_ptr->erased[slot].sector_count = end - first;
+}
+
+static void jrnl_range_erased_drop(esp_jrnl_instance_t* inst_ptr, uint32_t sector, uint32_t count)
+{
+    uint32_t end = sector + count;
+
+    for (uint8_t i = 0; i < inst_ptr->erased_count; ) {
+        esp_jrnl_sector_range_t* range = &inst_ptr->erased[i];
+        uint32_t range_end = range->first_sector + range->sector_count;
+        if (!(sector < range_end && range->first_sector < end)) {
+            i++;
+            continue;
+        }
+
+        bool head = range->first_sector < sector;
+        bool tail = range_end > end;
+        if (head) {
+            range->sector_count = sector - range->first_sector;
+            //split: the part past the written range kept if there is a free slot
+            if (tail && inst_ptr->erased_count < JRNL_ERASED_RANGES_MAX) {
+                inst_ptr->erased[inst_ptr->erased_count].first_sector = end;
+                inst_ptr->erased[inst_ptr->erased_count].sector_count = range_end - end;
+                inst_ptr->erased_count++;
+            }
+            i++;
+        }
+        else if (tail) {
+            range->first_sector = end;
+            range->sector_count = range_end - end;
+            i++;
+        }
+        else {
+            *range = inst_ptr->erased[--inst_ptr->erased_count];
+        }
+    }
+}
+
+/* discards the target sectors (TRIM), the range is known erased afterwards */
+static esp_err_t jrnl_trim_raw(esp_jrnl_instance_t* inst_ptr, uint32_t sector, uint32_t count)
+{
+    size_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    const esp_jrnl_diskio_t* diskio = &inst_ptr->diskio;
+
+    jrnl_stats_io(inst_ptr, ESP_JRNL_DISKIO_OP_ERASE, count * sector_size);
+    JRNL_TRACE_TIME(start);
+
+    esp_err_t err;
+    if (diskio->disk_trim != NULL) {
+        err = diskio->disk_trim(diskio->diskio_ctrl_handle, sector * sector_size, count * sector_size);
+    }
+    else {
+        err = diskio->disk_erase_range(diskio->diskio_ctrl_handle, sector * sector_size, count * sector_size);
+    }
+    JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_DISK_ERASE, sector * sector_size, count * sector_size, start);
+
+    if (err == ESP_OK) {
+        jrnl_range_erased_add(inst_ptr, sector, count);
+    }
+
+    return err;
 }
 
 esp_err_t jrnl_write_internal(esp_jrnl_instance_t* inst_ptr, const uint8_t *buff, const uint32_t sector, const uint32_t count)
@@ -95,15 +422,15 @@ esp_err_t jrnl_write_internal(esp_jrnl_instance_t* inst_ptr, const uint8_t *buff
 
     size_t sector_size = inst_ptr->master.volume.disk_sector_size;
 
-    esp_err_t err = jrnl_erase_range_raw(inst_ptr, target_sector * sector_size, count * sector_size);
+    esp_err_t err = jrnl_store_erase_range_raw(inst_ptr, target_sector * sector_size, count * sector_size);
     if (unlikely(err != ESP_OK)) {
-        ESP_LOGE(TAG, "jrnl_erase_range_raw failed (0x%08X)", err);
+        ESP_LOGE(TAG, "jrnl_store_erase_range_raw failed (0x%08X)", err);
         return err;
     }
 
-    err = jrnl_write_raw(inst_ptr, target_sector * sector_size, buff, count * sector_size);
+    err = jrnl_store_write_raw(inst_ptr, target_sector * sector_size, buff, count * sector_size);
     if (unlikely(err != ESP_OK)) {
-        ESP_LOGE(TAG, "jrnl_write_raw failed (0x%08X)", err);
+        ESP_LOGE(TAG, "jrnl_store_write_raw failed (0x%08X)", err);
     }
 
     return err;
@@ -123,9 +450,9 @@ esp_err_t jrnl_read_internal(esp_jrnl_instance_t* inst_ptr, uint8_t *out_buff, u
 
     size_t sector_size = inst_ptr->master.volume.disk_sector_size;
 
-    esp_err_t err = jrnl_read_raw(inst_ptr, target_sector * sector_size, out_buff, count * sector_size);
+    esp_err_t err = jrnl_store_read_raw(inst_ptr, target_sector * sector_size, out_buff, count * sector_size);
     if (unlikely(err != ESP_OK)) {
-        ESP_LOGE(TAG, "jrnl_read_raw failed (0x%08X)", err);
+        ESP_LOGE(TAG, "jrnl_store_read_raw failed (0x%08X)", err);
     }
 
     return err;
@@ -136,163 +463,617 @@ static void jrnl_delete_instance(esp_jrnl_instance_t* inst_ptr)
     if (inst_ptr == NULL) {
         return;
     }
-    _lock_close(&inst_ptr->trans_lock);
+    if (inst_ptr->static_lock != NULL) {
+        vSemaphoreDelete(inst_ptr->static_lock);
+    }
+    else {
+        _lock_close(&inst_ptr->trans_lock);
+    }
+    if (inst_ptr->refs_drained != NULL) {
+        vSemaphoreDelete(inst_ptr->refs_drained);
+    }
+    jrnl_probe_detach(inst_ptr);
+    if (inst_ptr->io_done != NULL) {
+        vSemaphoreDelete(inst_ptr->io_done);
+    }
+#ifdef CONFIG_ESP_JRNL_COMMIT_EXECUTOR
+    jrnl_commit_ctx_deinit(inst_ptr);
+#endif
+    //static instance: the caller's memory, nothing to release
+    if (inst_ptr->static_mem) {
+        return;
+    }
+    free(inst_ptr->master_buf);
+    free(inst_ptr->tail_buf);
+    free(inst_ptr->codec_workmem);
     free(inst_ptr);
     inst_ptr = NULL;
 }
 
-static inline esp_err_t jrnl_update_master(esp_jrnl_instance_t* jrnl, const esp_jrnl_master_t* master)
+static inline size_t jrnl_scratch_size(const esp_jrnl_instance_t* inst_ptr, jrnl_scratch_id_t id)
 {
-    ESP_LOGD(TAG, "Updating jrnl master record (status: %s)", jrnl_status_to_str(jrnl->master.status));
-    return jrnl_write_internal(jrnl, (const uint8_t*)master, jrnl->master.store_size_sectors - 1, 1);
+    size_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    return id < JRNL_SCRATCH_DATA ? sector_size : inst_ptr->record_max_sectors * sector_size;
 }
 
-/* reset the JRNL master record for given instance
- * the reset applies only to the structure items, the rest of the sector space is expected = 0 */
-esp_err_t jrnl_reset_master(esp_jrnl_instance_t* jrnl, bool fs_direct)
+/*
+ * Scratch buffer of 'size' bytes ('clear' = zeroed) for the write, replay and read paths: the provisioned one of a static
+ * instance (NULL if 'size' exceeds it), a heap block otherwise. Released by jrnl_scratch_put()
+ */
+static uint8_t* jrnl_scratch_get(const esp_jrnl_instance_t* inst_ptr, jrnl_scratch_id_t id, size_t size, bool clear)
 {
-    ESP_LOGV(TAG, "Resetting jrnl master record");
-    if (jrnl == NULL) {
-        return ESP_ERR_INVALID_ARG;
+    if (!inst_ptr->static_mem) {
+        return (uint8_t*)(clear ? calloc(1, size) : malloc(size));
     }
 
-    jrnl->master.jrnl_magic_mark = JRNL_STORE_MARKER;
-    jrnl->master.next_free_sector = 0;
-    jrnl->master.status = fs_direct ? ESP_JRNL_STATUS_FS_DIRECT : ESP_JRNL_STATUS_TRANS_READY;
-
-    return jrnl_update_master(jrnl, &jrnl->master);
+    if (size > jrnl_scratch_size(inst_ptr, id)) {
+        ESP_LOGE(TAG, "%u B exceed the provisioned buffer (records of %" PRIu32 " sectors max)", (unsigned)size, inst_ptr->record_max_sectors);
+        return NULL;
+    }
+    if (clear) {
+        memset(inst_ptr->scratch[id], 0, size);
+    }
+    return inst_ptr->scratch[id];
 }
 
-#ifdef CONFIG_ESP_JRNL_ENABLE_TESTMODE
-
-//power-off emulation: interrupt the transaction only when some data written to the journal
-#define JRNL_TEST_PRELIMINARY_EXIT(flags, msg) \
-    if (inst_ptr->master.next_free_sector > 0 && inst_ptr->test_config & flags) { \
-        ESP_LOGD(TAG, msg); \
-        esp_restart(); \
+static inline void jrnl_scratch_put(const esp_jrnl_instance_t* inst_ptr, void* buf)
+{
+    if (!inst_ptr->static_mem) {
+        free(buf);
     }
+}
 
-#define JRNL_TEST_TRANSACTION_SUSPENDED(msg) \
-    if (inst_ptr->test_config & ESP_JRNL_TEST_SUSPEND_TRANSACTION) { \
-        ESP_LOGD(TAG, msg); \
-        return ESP_OK; \
-    }
-#else
-#define JRNL_TEST_PRELIMINARY_EXIT(flags, msg)
-#define JRNL_TEST_TRANSACTION_SUSPENDED(msg)
-#endif
+_Static_assert(ESP_JRNL_CODEC_NONE == JRNL_CODEC_NONE && ESP_JRNL_CODEC_LZF == JRNL_CODEC_LZF, "esp_jrnl_codec_t must match the stored codec IDs");
+_Static_assert(ESP_JRNL_CHECKSUM_CRC32 == JRNL_CHECKSUM_CRC32 && ESP_JRNL_CHECKSUM_CRC32C == JRNL_CHECKSUM_CRC32C &&
+               ESP_JRNL_CHECKSUM_XXH32 == JRNL_CHECKSUM_XXH32, "esp_jrnl_checksum_t must match the stored engine IDs");
 
-esp_err_t jrnl_replay(esp_jrnl_instance_t* inst_ptr)
+/* operation record checksum by the engine of the store (the master record itself is always CRC32-protected) */
+static inline uint32_t jrnl_record_checksum(const esp_jrnl_instance_t* inst_ptr, const void* data, size_t size)
 {
-    ESP_LOGV(TAG, "Replaying journaled log");
-
-    if (inst_ptr == NULL) {
-        ESP_LOGE(TAG, "jrnl_replay - NULL journal log instance, operation aborted");
-        return ESP_ERR_INVALID_ARG;
-    }
+    JRNL_TRACE_TIME(start);
+    uint32_t checksum = jrnl_checksum(inst_ptr->master.checksum, data, size);
+    JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_CHECKSUM, size, 0, start);
+    return checksum;
+}
 
+/* jrnl_read_master() with the slot sector buffer given by the caller */
+static esp_err_t jrnl_read_master_slots(const esp_jrnl_diskio_t* diskio, const esp_jrnl_volume_t* volume, uint8_t* slot_buf, esp_jrnl_master_t* master)
+{
     esp_err_t err = ESP_OK;
-    _lock_acquire(&inst_ptr->trans_lock);
+    bool found = false;
 
-#ifdef CONFIG_ESP_JRNL_DEBUG_PRINT
-    print_jrnl_instance(inst_ptr);
-#endif
-
-    assert(inst_ptr->master.status != ESP_JRNL_STATUS_FS_INIT && "Attempt to reply uninitialized journaling store!");
+    for (uint32_t slot = 0; slot < JRNL_MASTER_SLOT_COUNT; slot++) {
 
-    //clean possibly uncommitted transactions
-    if (inst_ptr->master.status != ESP_JRNL_STATUS_TRANS_COMMIT) {
+        size_t slot_addr = volume->volume_size - (slot + 1) * volume->disk_sector_size;
+        err = diskio->disk_read(diskio->diskio_ctrl_handle, slot_addr, (void*)slot_buf, volume->disk_sector_size);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to read journal master slot %" PRIu32 " (0x%08X)", slot, err);
+            break;
+        }
 
-        switch (inst_ptr->master.status)
-        {
-            case ESP_JRNL_STATUS_TRANS_READY:
-                ESP_LOGD(TAG, "jrnl_replay - journaling log empty");
-                break;
-            case ESP_JRNL_STATUS_TRANS_OPEN:
-                {
-                    ESP_LOGD(TAG, "jrnl_replay - found unfinished transaction, cleaning journaling log");
-                    err = jrnl_reset_master(inst_ptr, false);
-                    if (err != ESP_OK) {
-                        ESP_LOGE(TAG, "Failed to reset journaling master record (0x%08X)", err);
-                    }
-                }
-                break;
-            default:
-                ESP_LOGD(TAG, "jrnl_replay - invalid journaling log status (%s), operation aborted", jrnl_status_to_str(inst_ptr->master.status));
-                err = ESP_ERR_INVALID_STATE;
-                break;
+        if (!jrnl_master_select((const esp_jrnl_master_t*)slot_buf, slot, &found, master)) {
+            ESP_LOGV(TAG, "Journal master slot %" PRIu32 " empty or invalid", slot);
         }
+    }
 
-        _lock_release(&inst_ptr->trans_lock);
+    if (err != ESP_OK) {
         return err;
     }
 
-    //iterate through stored operation records and try to repeat them all
-    uint32_t oper_sector_index = 0;
-    uint8_t* data = NULL;
-    uint32_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
 
-    uint8_t* header = (uint8_t *)calloc(1, sector_size);
-    if (header == NULL) {
-        ESP_LOGE(TAG, "jrnl_replay - operation header buffer allocation failed (0x%08X)", ESP_ERR_NO_MEM);
+esp_err_t jrnl_read_master(const esp_jrnl_diskio_t* diskio, const esp_jrnl_volume_t* volume, esp_jrnl_master_t* master)
+{
+    if (diskio == NULL || volume == NULL || master == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    //full sector reads (some disk drivers support only sector-aligned access)
+    uint8_t* slot_buf = (uint8_t*) malloc(volume->disk_sector_size);
+    if (slot_buf == NULL) {
         return ESP_ERR_NO_MEM;
     }
 
-    while (oper_sector_index < inst_ptr->master.next_free_sector) {
+    esp_err_t err = jrnl_read_master_slots(diskio, volume, slot_buf, master);
+    free(slot_buf);
 
-        //read the operation header
-        err = jrnl_read_internal(inst_ptr, header, oper_sector_index, 1);
-        if (err != ESP_OK) {
-            break;
-        }
+    return err;
+}
 
-        esp_jrnl_operation_t* oper_header = (esp_jrnl_operation_t*)header;
-        uint32_t crc32_header = esp_crc32_le(UINT32_MAX, header, sizeof(esp_jrnl_oper_header_t));
-        if (crc32_header != oper_header->crc32_header) {
-            err = ESP_ERR_INVALID_CRC;
-            ESP_LOGE(TAG, "jrnl_replay - operation header checksum mismatch");
-            break;
-        }
+/* store address of the spare master slot (the target of the next update) */
+static size_t jrnl_master_spare_addr(esp_jrnl_instance_t* jrnl)
+{
+    esp_jrnl_master_t* master = &jrnl->master;
+    uint32_t sector_size = master->volume.disk_sector_size;
 
-        data = (uint8_t *)calloc(oper_header->header.sector_count, sector_size);
-        if (data == NULL) {
-            err = ESP_ERR_NO_MEM;
-            ESP_LOGE(TAG, "jrnl_replay - operation data buffer allocation failed");
-            break;
-        }
+    return jrnl_get_target_disk_sector(jrnl, JRNL_MASTER_SLOT_SECTOR(master, JRNL_MASTER_SLOT(master->generation + 1))) * sector_size;
+}
 
-        //read the data
-        err = jrnl_read_internal(inst_ptr, data, oper_sector_index + 1, oper_header->header.sector_count);
-        if (err != ESP_OK) {
-            break;
-        }
+/* Erases the spare master slot ahead of the next update (no-op if already blank). Called off the state transitions: before
+ * a committed transaction is marked, before the replay transfers its records and at the end of the commit (cancel, mount).
+ * Within the transaction the slot gets erased along with the record space (jrnl_append(), jrnl_flush_tail()), so each update
+ * costs one program. Failure is not fatal, the next update erases the slot itself */
+static void jrnl_prepare_master_spare(esp_jrnl_instance_t* jrnl)
+{
+    if (jrnl->master_spare_blank) {
+        return;
+    }
 
-        uint32_t crc32_data = esp_crc32_le(UINT32_MAX, data, oper_header->header.sector_count * sector_size);
-        if (crc32_data != oper_header->header.crc32_data) {
-            err = ESP_ERR_INVALID_CRC;
-            ESP_LOGE(TAG, "jrnl_replay - operation data checksum mismatch");
-            break;
-        }
+    uint32_t spare_slot = JRNL_MASTER_SLOT(jrnl->master.generation + 1);
+    if (jrnl_store_erase_range_raw(jrnl, jrnl_master_spare_addr(jrnl), jrnl->master.volume.disk_sector_size) == ESP_OK) {
+        jrnl->master_spare_blank = true;
+    }
+    else {
+        ESP_LOGW(TAG, "Failed to erase spare jrnl master slot %" PRIu32, spare_slot);
+    }
+}
 
-        //store the data to the original location
-        err = jrnl_erase_range_raw(inst_ptr, oper_header->header.target_sector * sector_size, oper_header->header.sector_count * sector_size);
-        if (unlikely(err != ESP_OK)) {
-            break;
-        }
+/* Programs the master record to the spare slot, which becomes active, so there is always at least one valid master on the disk.
+ * The spare slot is expected erased ahead (jrnl_prepare_master_spare()), otherwise it gets erased first (fresh mount or previous failure) */
+static esp_err_t jrnl_update_master(esp_jrnl_instance_t* jrnl)
+{
+    ESP_LOGD(TAG, "Updating jrnl master record (status: %s)", jrnl_status_name(jrnl->master.status));
 
-        JRNL_TEST_PRELIMINARY_EXIT(ESP_JRNL_TEST_REPLAY_ERASE_AND_EXIT, "(jrnl_poweroff_test): Erase first target sector on replay and exit");
+    esp_jrnl_master_t* master = &jrnl->master;
+    uint32_t sector_size = master->volume.disk_sector_size;
+    uint32_t target_slot = JRNL_MASTER_SLOT(master->generation + 1);
+    size_t target_addr = jrnl_master_spare_addr(jrnl);
 
-        err = jrnl_write_raw(inst_ptr, oper_header->header.target_sector * sector_size, data, oper_header->header.sector_count * sector_size);
+    //spare slot not prepared (fresh mount or previous failure)
+    esp_err_t err = ESP_OK;
+    if (!jrnl->master_spare_blank) {
+        JRNL_STATS_ADD(jrnl, master_spare_misses, 1);
+        err = jrnl_store_erase_range_raw(jrnl, target_addr, sector_size);
+        if (unlikely(err != ESP_OK)) {
+            ESP_LOGE(TAG, "Failed to erase jrnl master slot %" PRIu32 " (0x%08X)", target_slot, err);
+            return err;
+        }
+        jrnl->master_spare_blank = true;
+    }
+
+    JRNL_TRACE_TIME(start);
+    jrnl_master_advance(master);
+    memcpy(jrnl->master_buf, master, sizeof(esp_jrnl_master_t));
+
+    jrnl->master_spare_blank = false;
+    jrnl->master_disk_clean = false;
+    err = jrnl_store_write_raw(jrnl, target_addr, jrnl->master_buf, sector_size);
+    if (unlikely(err != ESP_OK)) {
+        ESP_LOGE(TAG, "Failed to write jrnl master slot %" PRIu32 " (0x%08X)", target_slot, err);
+        master->generation--;
+        return err;
+    }
+    jrnl->master_disk_clean = master->status == ESP_JRNL_STATUS_TRANS_READY && master->next_free_sector == 0;
+    JRNL_STATS_ADD(jrnl, master_updates, 1);
+    JRNL_TRACE_SPAN(jrnl, ESP_JRNL_TRACE_MASTER_UPDATE, master->generation, master->status, start);
+
+    return ESP_OK;
+}
+
+/* reset the JRNL master record for given instance
+ * the reset applies only to the structure items, the rest of the sector space is expected = 0 */
+esp_err_t jrnl_reset_master(esp_jrnl_instance_t* jrnl, bool fs_direct)
+{
+    ESP_LOGV(TAG, "Resetting jrnl master record");
+    if (jrnl == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    jrnl->master.jrnl_magic_mark = JRNL_STORE_MARKER;
+    jrnl->master.next_free_sector = 0;
+
+    //drop the records pending in the tail sector
+    if (jrnl->tail_buf != NULL && jrnl->tail_offset > 0) {
+        memset(jrnl->tail_buf, 0, jrnl->master.volume.disk_sector_size);
+    }
+    jrnl->tail_offset = 0;
+    jrnl->master.status = fs_direct ? ESP_JRNL_STATUS_FS_DIRECT : ESP_JRNL_STATUS_TRANS_READY;
+
+    esp_err_t err = jrnl_update_master(jrnl);
+    if (err == ESP_OK) {
+        //end of the commit, the next transaction opens by one program
+        jrnl_prepare_master_spare(jrnl);
+    }
+
+    return err;
+}
+
+/* the master records describe the same journaling store (all the items except the transaction state and generation) */
+static bool jrnl_master_same_store(const esp_jrnl_master_t* master, const esp_jrnl_master_t* other)
+{
+    return master->jrnl_magic_mark == other->jrnl_magic_mark &&
+           master->store_size_sectors == other->store_size_sectors &&
+           master->store_volume_offset_sector == other->store_volume_offset_sector &&
+           master->volume.volume_size == other->volume.volume_size &&
+           master->volume.disk_sector_size == other->volume.disk_sector_size &&
+           master->store_volume.volume_size == other->store_volume.volume_size &&
+           master->store_volume.disk_sector_size == other->store_volume.disk_sector_size &&
+           master->store_separate == other->store_separate &&
+           master->checksum == other->checksum;
+}
+
+/* jrnl_reset_master() skipping the master record update if the record on the disk is already clean: FS_INIT and TRANS_READY
+ * are equal for the mount (nothing to replay), so the status change stays in RAM until the next transaction opens.
+ * Read-only instances never update the record here */
+static esp_err_t jrnl_reset_master_lazy(esp_jrnl_instance_t* jrnl, bool fs_direct)
+{
+    if (!jrnl->read_only && (!jrnl->master_disk_clean || !jrnl_master_same_store(&jrnl->master, (const esp_jrnl_master_t*)jrnl->master_buf))) {
+        return jrnl_reset_master(jrnl, fs_direct);
+    }
+
+    ESP_LOGV(TAG, "Journaling store clean on the disk or read-only, master record kept (status: %s)", jrnl_status_name(fs_direct ? ESP_JRNL_STATUS_FS_DIRECT : ESP_JRNL_STATUS_TRANS_READY));
+    jrnl->master.jrnl_magic_mark = JRNL_STORE_MARKER;
+    jrnl->master.next_free_sector = 0;
+    jrnl->master.status = fs_direct ? ESP_JRNL_STATUS_FS_DIRECT : ESP_JRNL_STATUS_TRANS_READY;
+
+    return ESP_OK;
+}
+
+/* writes the tail sector packed with inline records to the store ('next_free_sector'), the master record is left to the caller.
+ * The spare master slot for that update gets erased along with the tail sector (transaction lock held by the caller) */
+static esp_err_t jrnl_flush_tail(esp_jrnl_instance_t* inst_ptr)
+{
+    if (inst_ptr->tail_offset == 0) {
+        return ESP_OK;
+    }
+
+    uint32_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    size_t tail_addr = jrnl_get_target_disk_sector(inst_ptr, inst_ptr->master.next_free_sector) * sector_size;
+
+    ESP_LOGV(TAG, "Flushing jrnl tail sector %" PRIu32 " (%u bytes packed)", inst_ptr->master.next_free_sector, (unsigned)inst_ptr->tail_offset);
+
+    bool spare_erase = !inst_ptr->master_spare_blank;
+    esp_err_t err = jrnl_io_submit(inst_ptr, &inst_ptr->store_diskio, ESP_JRNL_DISKIO_OP_ERASE, tail_addr, NULL, sector_size);
+    if (err == ESP_OK && spare_erase) {
+        err = jrnl_io_submit(inst_ptr, &inst_ptr->store_diskio, ESP_JRNL_DISKIO_OP_ERASE, jrnl_master_spare_addr(inst_ptr), NULL, sector_size);
+    }
+    if (err == ESP_OK) {
+        err = jrnl_io_submit(inst_ptr, &inst_ptr->store_diskio, ESP_JRNL_DISKIO_OP_WRITE, tail_addr, inst_ptr->tail_buf, sector_size);
+    }
+    esp_err_t io_err = jrnl_io_wait(inst_ptr);
+    if (err == ESP_OK) {
+        err = io_err;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (spare_erase) {
+        inst_ptr->master_spare_blank = true;
+    }
+
+    inst_ptr->master.next_free_sector++;
+    inst_ptr->tail_offset = 0;
+    memset(inst_ptr->tail_buf, 0, sector_size);
+
+    return ESP_OK;
+}
+
+/* remembers the open transaction state before an operation joins it (see jrnl_savepoint_restore) */
+static void jrnl_savepoint_take(esp_jrnl_instance_t* inst_ptr)
+{
+    jrnl_savepoint_t* sp = &inst_ptr->savepoint;
+
+    sp->next_free_sector = inst_ptr->master.next_free_sector;
+    sp->tail_offset = inst_ptr->tail_offset;
+    sp->touched_count = inst_ptr->touched_count;
+    memcpy(sp->touched, inst_ptr->touched, sizeof(sp->touched));
+}
+
+/*
+ * drops the records appended since the savepoint (failed operation within a batched transaction). The store sectors past
+ * the savepoint are just left behind, a tail sector flushed meanwhile is read back from the store (its savepoint part is
+ * intact there). Caller holds the transaction lock
+ */
+static esp_err_t jrnl_savepoint_restore(esp_jrnl_instance_t* inst_ptr)
+{
+    const jrnl_savepoint_t* sp = &inst_ptr->savepoint;
+    uint32_t sector_size = inst_ptr->master.volume.disk_sector_size;
+
+    if (inst_ptr->master.next_free_sector != sp->next_free_sector && sp->tail_offset > 0) {
+        size_t tail_addr = jrnl_get_target_disk_sector(inst_ptr, sp->next_free_sector) * sector_size;
+        esp_err_t err = jrnl_store_read_raw(inst_ptr, tail_addr, inst_ptr->tail_buf, sector_size);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Can't read back jrnl tail sector %" PRIu32 " (0x%08X)", sp->next_free_sector, err);
+            return err;
+        }
+    }
+
+    inst_ptr->master.next_free_sector = sp->next_free_sector;
+    inst_ptr->tail_offset = sp->tail_offset;
+    memset(inst_ptr->tail_buf + sp->tail_offset, 0, sector_size - sp->tail_offset);
+    inst_ptr->touched_count = sp->touched_count;
+    memcpy(inst_ptr->touched, sp->touched, sizeof(inst_ptr->touched));
+
+    return ESP_OK;
+}
+
+#ifdef CONFIG_ESP_JRNL_ENABLE_TESTMODE
+
+//power-off emulation: interrupt the transaction only when some data written to the journal (flushed or packed in the tail sector)
+#define JRNL_TEST_PRELIMINARY_EXIT(flags, msg) \
+    if ((inst_ptr->master.next_free_sector > 0 || inst_ptr->tail_offset > 0) && inst_ptr->test_config & flags) { \
+        ESP_LOGD(TAG, msg); \
+        esp_restart(); \
+    }
+
+#define JRNL_TEST_TRANSACTION_SUSPENDED(msg) \
+    if (inst_ptr->test_config & ESP_JRNL_TEST_SUSPEND_TRANSACTION) { \
+        ESP_LOGD(TAG, msg); \
+        return ESP_OK; \
+    }
+#else
+#define JRNL_TEST_PRELIMINARY_EXIT(flags, msg)
+#define JRNL_TEST_TRANSACTION_SUSPENDED(msg)
+#endif
+
+/*
+ * Loads the operation record at 'pos' into '*oper'. The 'sector_buf' keeps the store sector '*buf_sector' (reloaded only when
+ * the position moves to another sector, UINT32_MAX == none loaded). Returns ESP_ERR_NOT_FOUND past the last record
+ */
+static esp_err_t jrnl_record_load(esp_jrnl_instance_t* inst_ptr, uint8_t* sector_buf, uint32_t* buf_sector, const esp_jrnl_record_pos_t* pos, esp_jrnl_operation_t** oper)
+{
+    if (pos->sector_index >= inst_ptr->master.next_free_sector) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (*buf_sector != pos->sector_index) {
+        esp_err_t err = jrnl_read_internal(inst_ptr, sector_buf, pos->sector_index, 1);
+        if (err != ESP_OK) {
+            *buf_sector = UINT32_MAX;
+            return err;
+        }
+        *buf_sector = pos->sector_index;
+    }
+
+    esp_jrnl_operation_t* oper_header = (esp_jrnl_operation_t*)(sector_buf + pos->offset);
+    uint32_t crc32_header = jrnl_record_checksum(inst_ptr, (uint8_t *)&oper_header->header, sizeof(esp_jrnl_oper_header_t));
+    if (crc32_header != oper_header->crc32_header) {
+        ESP_LOGE(TAG, "jrnl_record_load - operation header checksum mismatch (sector %" PRIu32 ", offset %u)", pos->sector_index, (unsigned)pos->offset);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    *oper = oper_header;
+    return ESP_OK;
+}
+
+/*
+ * Loads the stored payload of the operation record with header sector 'oper_sector_index' (header already loaded in 'header' buffer).
+ * Inline payloads point to the header buffer, the others are read to '*payload_buf' (to be released by jrnl_scratch_put())
+ */
+static esp_err_t jrnl_read_record_payload(esp_jrnl_instance_t* inst_ptr, const uint8_t* header, uint32_t oper_sector_index, const uint8_t** payload, uint8_t** payload_buf)
+{
+    const esp_jrnl_operation_t* oper_header = (const esp_jrnl_operation_t*)header;
+    uint32_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    uint32_t record_sectors = jrnl_record_sectors(&oper_header->header, sector_size);
+
+    *payload_buf = NULL;
+
+    if (record_sectors == 1) {
+        *payload = header + sizeof(esp_jrnl_operation_t);
+        return ESP_OK;
+    }
+
+    *payload_buf = jrnl_scratch_get(inst_ptr, JRNL_SCRATCH_PAYLOAD, (record_sectors - 1) * sector_size, false);
+    if (*payload_buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    *payload = *payload_buf;
+
+    return jrnl_read_internal(inst_ptr, *payload_buf, oper_sector_index + 1, record_sectors - 1);
+}
+
+/*
+ * Reads the data of the operation record at 'pos' (header already loaded in 'header' buffer)
+ * into 'data' buffer of header.sector_count sectors. Encoded payloads are decoded, the result is verified against header.crc32_data
+ */
+static esp_err_t jrnl_read_record_data(esp_jrnl_instance_t* inst_ptr, const uint8_t* header, const esp_jrnl_record_pos_t* pos, uint8_t* data)
+{
+    const esp_jrnl_operation_t* oper_header = (const esp_jrnl_operation_t*)header;
+    uint32_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    size_t data_size = oper_header->header.sector_count * sector_size;
+    const uint8_t* payload = NULL;
+    uint8_t* payload_buf = NULL;
+    esp_err_t err = ESP_OK;
+
+    if (oper_header->header.record_type != ESP_JRNL_RECORD_DATA) {
+        ESP_LOGE(TAG, "jrnl_read_record_data - unknown record type %u", oper_header->header.record_type);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    //uncoded payload sectors are read right into the data buffer
+    if (oper_header->header.codec == ESP_JRNL_CODEC_NONE && oper_header->header.payload_size == data_size && jrnl_record_sectors(&oper_header->header, sector_size) > 1) {
+        err = jrnl_read_internal(inst_ptr, data, pos->sector_index + 1, oper_header->header.sector_count);
+        payload = data;
+    }
+    else {
+        err = jrnl_read_record_payload(inst_ptr, header, pos->sector_index, &payload, &payload_buf);
+    }
+
+    if (err == ESP_OK) {
+        switch (jrnl_record_decode(&oper_header->header, payload, data, sector_size)) {
+            case JRNL_RECORD_DECODE_OK:
+                break;
+            case JRNL_RECORD_DECODE_ERR_SIZE:
+                err = ESP_ERR_INVALID_SIZE;
+                break;
+            case JRNL_RECORD_DECODE_ERR_TYPE:
+                ESP_LOGE(TAG, "jrnl_read_record_data - unknown payload codec %u", oper_header->header.codec);
+                err = ESP_ERR_NOT_SUPPORTED;
+                break;
+            default:
+                ESP_LOGE(TAG, "jrnl_read_record_data - operation payload decoding failed");
+                err = ESP_ERR_INVALID_RESPONSE;
+                break;
+        }
+    }
+
+    jrnl_scratch_put(inst_ptr, payload_buf);
+
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    uint32_t crc32_data = jrnl_record_checksum(inst_ptr, data, data_size);
+    if (crc32_data != oper_header->header.crc32_data) {
+        ESP_LOGE(TAG, "jrnl_read_record_data - operation data checksum mismatch");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t jrnl_replay(esp_jrnl_instance_t* inst_ptr)
+{
+    ESP_LOGV(TAG, "Replaying journaled log");
+
+    if (inst_ptr == NULL) {
+        ESP_LOGE(TAG, "jrnl_replay - NULL journal log instance, operation aborted");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_OK;
+    jrnl_trans_lock(inst_ptr);
+
+#ifdef CONFIG_ESP_JRNL_DEBUG_PRINT
+    print_jrnl_instance(inst_ptr);
+#endif
+
+    assert(inst_ptr->master.status != ESP_JRNL_STATUS_FS_INIT && "Attempt to reply uninitialized journaling store!");
+
+    //clean possibly uncommitted transactions
+    if (inst_ptr->master.status != ESP_JRNL_STATUS_TRANS_COMMIT) {
+
+        switch (inst_ptr->master.status)
+        {
+            case ESP_JRNL_STATUS_TRANS_READY:
+                ESP_LOGD(TAG, "jrnl_replay - journaling log empty");
+                break;
+            case ESP_JRNL_STATUS_TRANS_OPEN:
+                {
+                    ESP_LOGD(TAG, "jrnl_replay - found unfinished transaction, cleaning journaling log");
+                    err = jrnl_reset_master(inst_ptr, false);
+                    if (err != ESP_OK) {
+                        ESP_LOGE(TAG, "Failed to reset journaling master record (0x%08X)", err);
+                    }
+                }
+                break;
+            default:
+                ESP_LOGD(TAG, "jrnl_replay - invalid journaling log status (%s), operation aborted", jrnl_status_name(inst_ptr->master.status));
+                err = ESP_ERR_INVALID_STATE;
+                break;
+        }
+
+        jrnl_trans_unlock(inst_ptr);
+        return err;
+    }
+
+    //spare master slot ready for closing the transaction
+    jrnl_prepare_master_spare(inst_ptr);
+
+    //iterate through stored operation records and try to repeat them all. The target transfer of each record
+    //stays in flight while the next record gets loaded and verified (asynchronous target device)
+    int64_t replay_start = jrnl_time_us();
+    uint32_t replay_records = 0;
+    esp_jrnl_record_pos_t oper_pos = {0};
+    uint8_t* data = NULL;
+    uint8_t* data_in_flight = NULL;
+    uint32_t sector_size = inst_ptr->master.volume.disk_sector_size;
+
+    uint8_t* header = jrnl_scratch_get(inst_ptr, JRNL_SCRATCH_HEADER, sector_size, true);
+    if (header == NULL) {
+        ESP_LOGE(TAG, "jrnl_replay - operation header buffer allocation failed (0x%08X)", ESP_ERR_NO_MEM);
+        jrnl_trans_unlock(inst_ptr);
+        return ESP_ERR_NO_MEM;
+    }
+    uint32_t header_sector = UINT32_MAX;
+
+    while (true) {
+
+        //read the operation header
+        esp_jrnl_operation_t* oper_header = NULL;
+        err = jrnl_record_load(inst_ptr, header, &header_sector, &oper_pos, &oper_header);
+        if (err == ESP_ERR_NOT_FOUND) {
+            err = ESP_OK;
+            break;
+        }
+        if (err != ESP_OK) {
+            break;
+        }
+        replay_records++;
+        JRNL_TRACE(inst_ptr, ESP_JRNL_TRACE_REPLAY_RECORD, oper_header->header.target_sector,
+                   oper_header->header.sector_count | ((uint32_t)oper_header->header.record_type << 24));
+
+        //discarded sectors: no data, the previous transfer must be finished first (journal order)
+        if (oper_header->header.record_type == ESP_JRNL_RECORD_TRIM) {
+            err = jrnl_io_wait(inst_ptr);
+            jrnl_scratch_put(inst_ptr, data_in_flight);
+            data_in_flight = NULL;
+            if (err != ESP_OK) {
+                break;
+            }
+            //the discard is just a hint, the data of any later write is complete anyway
+            esp_err_t trim_err = jrnl_trim_raw(inst_ptr, oper_header->header.target_sector, oper_header->header.sector_count);
+            if (trim_err != ESP_OK) {
+                ESP_LOGW(TAG, "jrnl_replay - discarding target sectors %" PRIu32 "+%" PRIu32 " failed (0x%08X)", oper_header->header.target_sector, (uint32_t)oper_header->header.sector_count, trim_err);
+            }
+            jrnl_record_next(header, sector_size, oper_header, &oper_pos);
+            continue;
+        }
+
+        //static instance: the data buffers alternate, one of them may be in flight
+        jrnl_scratch_id_t data_id = data_in_flight == inst_ptr->scratch[JRNL_SCRATCH_DATA] ? JRNL_SCRATCH_DATA2 : JRNL_SCRATCH_DATA;
+        data = jrnl_scratch_get(inst_ptr, data_id, oper_header->header.sector_count * sector_size, true);
+        if (data == NULL) {
+            err = ESP_ERR_NO_MEM;
+            ESP_LOGE(TAG, "jrnl_replay - operation data buffer allocation failed");
+            break;
+        }
+
+        //read (and decode) the data
+        err = jrnl_read_record_data(inst_ptr, (const uint8_t*)oper_header, &oper_pos, data);
+        if (err != ESP_OK) {
+            break;
+        }
+
+        //one record transfer at a time, so the target sectors get written in the journal order
+        err = jrnl_io_wait(inst_ptr);
+        jrnl_scratch_put(inst_ptr, data_in_flight);
+        data_in_flight = NULL;
+        if (unlikely(err != ESP_OK)) {
+            break;
+        }
+
+        //store the data to the original location (trimmed sectors are erased already)
+        bool erased = jrnl_range_erased(inst_ptr, oper_header->header.target_sector, oper_header->header.sector_count);
+        jrnl_range_erased_drop(inst_ptr, oper_header->header.target_sector, oper_header->header.sector_count);
+        if (!erased) {
+            err = jrnl_io_submit(inst_ptr, &inst_ptr->diskio, ESP_JRNL_DISKIO_OP_ERASE, oper_header->header.target_sector * sector_size, NULL, oper_header->header.sector_count * sector_size);
+            if (unlikely(err != ESP_OK)) {
+                break;
+            }
+        }
+
+        JRNL_TEST_PRELIMINARY_EXIT(ESP_JRNL_TEST_REPLAY_ERASE_AND_EXIT, "(jrnl_poweroff_test): Erase first target sector on replay and exit");
+
+        err = jrnl_io_submit(inst_ptr, &inst_ptr->diskio, ESP_JRNL_DISKIO_OP_WRITE, oper_header->header.target_sector * sector_size, data, oper_header->header.sector_count * sector_size);
         if (unlikely(err != ESP_OK)) {
             break;
         }
 
         JRNL_TEST_PRELIMINARY_EXIT(ESP_JRNL_TEST_REPLAY_WRITE_AND_EXIT, "(jrnl_poweroff_test): Write first target sector on replay and exit");
 
-        //shift the jrnl store pointer
-        oper_sector_index += (1 + oper_header->header.sector_count);
-        free(data);
+        data_in_flight = data;
         data = NULL;
+
+        //shift the jrnl store pointer
+        jrnl_record_next(header, sector_size, oper_header, &oper_pos);
+    }
+
+    //the last transfer (or the ones left by a failure)
+    esp_err_t io_err = jrnl_io_wait(inst_ptr);
+    if (err == ESP_OK) {
+        err = io_err;
     }
 
     if (err != ESP_OK) {
@@ -306,11 +1087,21 @@ esp_err_t jrnl_replay(esp_jrnl_instance_t* inst_ptr)
         if (err != ESP_OK) {
             ESP_LOGE(TAG, "Failed to reset journaling master record (0x%08X)", err);
         }
+        else {
+            uint32_t replay_time = (uint32_t)(jrnl_time_us() - replay_start);
+            JRNL_STATS_ADD(inst_ptr, replays, 1);
+            inst_ptr->stats.replay_time_us += replay_time;
+            jrnl_stats_max(&inst_ptr->stats.replay_time_max_us, replay_time);
+        }
     }
 
-    free(header);
-    free(data);
-    _lock_release(&inst_ptr->trans_lock);
+    JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_REPLAY, replay_records, err, replay_start);
+    ESP_LOGD(TAG, "jrnl_replay - %" PRIu32 " records replayed", replay_records);
+
+    jrnl_scratch_put(inst_ptr, header);
+    jrnl_scratch_put(inst_ptr, data);
+    jrnl_scratch_put(inst_ptr, data_in_flight);
+    jrnl_trans_unlock(inst_ptr);
 
     return err;
 }
@@ -330,6 +1121,14 @@ void print_jrnl_config_extended(const esp_jrnl_config_extended_t *config)
     esp_rom_printf("    disk_read: Ox%08X\n", (uint32_t)config->diskio_cfg.disk_read);
     esp_rom_printf("    disk_write: Ox%08X\n", (uint32_t)config->diskio_cfg.disk_write);
     esp_rom_printf("    disk_erase_range: Ox%08X\n", (uint32_t)config->diskio_cfg.disk_erase_range);
+    esp_rom_printf("    erase_block_size: %u\n", config->diskio_cfg.erase_block_size);
+    if (config->store_diskio_cfg.disk_read != NULL) {
+        esp_rom_printf("  store_volume_cfg:\n");
+        esp_rom_printf("    volume_size: %u\n", config->store_volume_cfg.volume_size);
+        esp_rom_printf("    disk_sector_size: %u\n", config->store_volume_cfg.disk_sector_size);
+        esp_rom_printf("  store_diskio_cfg:\n");
+        esp_rom_printf("    diskio_ctrl_handle: %d\n", config->store_diskio_cfg.diskio_ctrl_handle);
+    }
 }
 
 void print_jrnl_master(const esp_jrnl_master_t* jrnl_master)
@@ -338,10 +1137,14 @@ void print_jrnl_master(const esp_jrnl_master_t* jrnl_master)
     esp_rom_printf("   jrnl_magic_mark: 0x%08" PRIX32 "\n", jrnl_master->jrnl_magic_mark);
     esp_rom_printf("   store_size_sectors: %" PRIu32 "\n", (uint32_t)jrnl_master->store_size_sectors);
     esp_rom_printf("   next_free_sector: %" PRIu32 "\n", jrnl_master->next_free_sector);
-    esp_rom_printf("   status: %s\n", jrnl_status_to_str(jrnl_master->status));
+    esp_rom_printf("   generation: %" PRIu32 " (slot %" PRIu32 ")\n", jrnl_master->generation, JRNL_MASTER_SLOT(jrnl_master->generation));
+    esp_rom_printf("   status: %s\n", jrnl_status_name(jrnl_master->status));
     esp_rom_printf("   volume.volume_size: %" PRIu32 "\n", (uint32_t)jrnl_master->volume.volume_size);
     esp_rom_printf("   volume.store_volume_offset_sector: %" PRIu32 "\n", (uint32_t)jrnl_master->store_volume_offset_sector);
     esp_rom_printf("   volume.disk_sector_size: %" PRIu32 "\n", (uint32_t)jrnl_master->volume.disk_sector_size);
+    esp_rom_printf("   store_separate: %u\n", jrnl_master->store_separate);
+    esp_rom_printf("   store_volume.volume_size: %" PRIu32 "\n", (uint32_t)jrnl_master->store_volume.volume_size);
+    esp_rom_printf("   checksum: %s\n", jrnl_checksum_name(jrnl_master->checksum));
 }
 
 void print_jrnl_instance(esp_jrnl_instance_t* inst_ptr)
@@ -351,44 +1154,46 @@ void print_jrnl_instance(esp_jrnl_instance_t* inst_ptr)
     print_jrnl_master(jrnl_master);
 
     //iterate through stored operation records and try to repeat them all
-    uint32_t oper_sector_index = 0;
-    uint8_t* header = (uint8_t *)calloc(1, jrnl_master->volume.disk_sector_size);
+    esp_jrnl_record_pos_t oper_pos = {0};
+    uint8_t* header = jrnl_scratch_get(inst_ptr, JRNL_SCRATCH_AUX, jrnl_master->volume.disk_sector_size, true);
     if (header == NULL) {
         ESP_LOGE(TAG, "print_jrnl_instance failed with error (0x%08X)", ESP_ERR_NO_MEM);
         return;
     }
+    uint32_t header_sector = UINT32_MAX;
 
     //journaling store can be empty
     esp_err_t err = ESP_OK;
     size_t record_count = 0;
-    while (oper_sector_index < jrnl_master->next_free_sector) {
+    while (true) {
 
         //read the operation header
-        err = jrnl_read_internal(inst_ptr, header, oper_sector_index, 1);
-        if (err != ESP_OK) {
+        esp_jrnl_operation_t* oper_header = NULL;
+        err = jrnl_record_load(inst_ptr, header, &header_sector, &oper_pos, &oper_header);
+        if (err == ESP_ERR_NOT_FOUND) {
+            err = ESP_OK;
             break;
         }
-
-        esp_jrnl_operation_t* oper_header = (esp_jrnl_operation_t*)header;
-        uint32_t crc32_header = esp_crc32_le(UINT32_MAX, header, sizeof(esp_jrnl_oper_header_t));
-        if (crc32_header != oper_header->crc32_header) {
-            err = ESP_ERR_INVALID_CRC;
-            ESP_LOGE(TAG, "print_jrnl_instance - operation header checksum mismatch, aborting");
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "print_jrnl_instance - operation header not available, aborting");
             break;
         }
 
         //print the header
-        esp_rom_printf("\n   OPER.HEADER %u:\n", record_count);
+        esp_rom_printf("\n   OPER.HEADER %u (sector %" PRIu32 ", offset %u):\n", record_count, oper_pos.sector_index, (unsigned)oper_pos.offset);
         esp_rom_printf("      header.target_sector: %" PRIu32 "\n", oper_header->header.target_sector);
         esp_rom_printf("      header.sector_count: %" PRIu32 "\n", oper_header->header.sector_count);
         esp_rom_printf("      header.crc32_data: Ox%08X\n", oper_header->header.crc32_data);
+        esp_rom_printf("      header.record_type: %u\n", oper_header->header.record_type);
+        esp_rom_printf("      header.codec: %u\n", oper_header->header.codec);
+        esp_rom_printf("      header.payload_size: %" PRIu32 "\n", oper_header->header.payload_size);
         esp_rom_printf("      crc32_header: Ox%08X\n", oper_header->crc32_header);
 
-        oper_sector_index += (1 + oper_header->header.sector_count);
+        jrnl_record_next(header, jrnl_master->volume.disk_sector_size, oper_header, &oper_pos);
         record_count++;
     }
 
-    free(header);
+    jrnl_scratch_put(inst_ptr, header);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "print_jrnl_instance failed with error (0x%08X)", err);
     }
@@ -399,23 +1204,70 @@ void print_jrnl_instance(esp_jrnl_instance_t* inst_ptr)
  * PUBLIC APIS
  */
 
-esp_err_t esp_jrnl_mount(const esp_jrnl_config_extended_t *config, esp_jrnl_handle_t *jrnl_handle)
+_Static_assert(sizeof(esp_jrnl_instance_t) <= ESP_JRNL_STATIC_INSTANCE_SIZE && ESP_JRNL_STATIC_INSTANCE_SIZE % sizeof(uint64_t) == 0,
+               "ESP_JRNL_STATIC_INSTANCE_SIZE must hold the instance record and keep the buffers aligned");
+_Static_assert(ESP_JRNL_STATIC_LZF_WORKMEM_SIZE == JRNL_LZF_WORKMEM_SIZE, "ESP_JRNL_STATIC_LZF_WORKMEM_SIZE must match the compressor");
+_Static_assert(ESP_JRNL_STATIC_RECORD_SECTORS(JRNL_MIN_STORE_SIZE) == JRNL_MIN_STORE_SIZE - JRNL_MASTER_SLOT_COUNT - 1,
+               "static record buffers must hold the largest uncoded record of the store");
+
+/* esp_jrnl_mount_static() memory needed by given configuration (the compressor work memory for ESP_JRNL_CODEC_LZF only) */
+static size_t jrnl_static_mem_size(const esp_jrnl_config_extended_t* config)
+{
+    size_t size = ESP_JRNL_STATIC_MEM_SIZE(config->volume_cfg.disk_sector_size, config->user_cfg.store_size_sectors,
+                                           config->user_cfg.static_record_sectors);
+    if (config->user_cfg.payload_codec != ESP_JRNL_CODEC_LZF) {
+        size -= ESP_JRNL_STATIC_LZF_WORKMEM_SIZE;
+    }
+    return size;
+}
+
+/* places the instance record and its buffers into the esp_jrnl_mount_static() memory (size checked by the caller) */
+static esp_jrnl_instance_t* jrnl_static_layout(const esp_jrnl_config_extended_t* config, uint8_t* mem)
+{
+    esp_jrnl_instance_t* jrnl = (esp_jrnl_instance_t*) mem;
+    memset(jrnl, 0, sizeof(esp_jrnl_instance_t));
+    jrnl->static_mem = true;
+    jrnl->record_max_sectors = ESP_JRNL_STATIC_CHUNK_SECTORS(config->user_cfg.store_size_sectors, config->user_cfg.static_record_sectors);
+
+    size_t sector_size = config->volume_cfg.disk_sector_size;
+    uint8_t* buf = mem + ESP_JRNL_STATIC_INSTANCE_SIZE;
+    jrnl->master_buf = buf;
+    buf += sector_size;
+    jrnl->tail_buf = buf;
+    buf += sector_size;
+    memset(jrnl->master_buf, 0, 2 * sector_size);
+
+    for (int id = 0; id < JRNL_SCRATCH_COUNT; id++) {
+        jrnl->scratch[id] = buf;
+        buf += id < JRNL_SCRATCH_DATA ? sector_size : jrnl->record_max_sectors * sector_size;
+    }
+    if (config->user_cfg.payload_codec == ESP_JRNL_CODEC_LZF) {
+        jrnl->codec_workmem = (uint32_t*) buf;
+    }
+
+    return jrnl;
+}
+
+/* esp_jrnl_mount() and esp_jrnl_mount_static() ('static_mem' == NULL: the instance allocated from the heap) */
+static esp_err_t jrnl_mount(const esp_jrnl_config_extended_t *config, uint8_t* static_mem, esp_jrnl_handle_t *jrnl_handle)
 {
     ESP_LOGV(TAG, "Mounting journaling store...");
 
     //sanity check
     if (config == NULL ||
         jrnl_handle == NULL ||
-        config->user_cfg.store_size_sectors < JRNL_MIN_STORE_SIZE) {
+        config->user_cfg.store_size_sectors < JRNL_MIN_STORE_SIZE ||
+        config->user_cfg.commit_mode > ESP_JRNL_COMMIT_DEFERRED ||
+        (config->user_cfg.commit_mode == ESP_JRNL_COMMIT_BATCHED && config->user_cfg.commit_batch_ops == 0) ||
+        (config->user_cfg.read_only && (config->user_cfg.overwrite_existing || config->user_cfg.force_fs_format))) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    _lock_acquire(&s_instances_lock);
-
-    //find first available handle
+    //reserve first available handle (the slot stays invisible to other APIs until the instance is published)
     esp_jrnl_handle_t out_handle = JRNL_INVALID_HANDLE;
     for (size_t i=0; i<JRNL_MAX_HANDLES; i++) {
-        if (s_jrnl_instance_ptrs[i] == NULL) {
+        esp_jrnl_instance_t* expected = NULL;
+        if (atomic_compare_exchange_strong(&s_jrnl_instance_ptrs[i], &expected, JRNL_INSTANCE_RESERVED)) {
             out_handle = i;
             break;
         }
@@ -435,46 +1287,196 @@ esp_err_t esp_jrnl_mount(const esp_jrnl_config_extended_t *config, esp_jrnl_hand
         }
 
         //create a new journaling instance for given volume
-        jrnl = (esp_jrnl_instance_t *) calloc(1, sizeof(esp_jrnl_instance_t));
-        if (jrnl == NULL) {
-            err = ESP_ERR_NO_MEM;
-            break;
+        if (static_mem != NULL) {
+            jrnl = jrnl_static_layout(config, static_mem);
+        }
+        else {
+            jrnl = (esp_jrnl_instance_t *) calloc(1, sizeof(esp_jrnl_instance_t));
+            if (jrnl == NULL) {
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
         }
 
         //init the instance
-        _lock_init(&jrnl->trans_lock);
+        if (jrnl->static_mem) {
+            jrnl->static_lock = xSemaphoreCreateMutexStatic(&jrnl->static_lock_mem);
+        }
+        else {
+            _lock_init(&jrnl->trans_lock);
+        }
+        jrnl->refs_drained = xSemaphoreCreateBinaryStatic(&jrnl->refs_drained_mem);
+        jrnl->handle = out_handle;
         jrnl->fs_volume_id = config->fs_volume_id;
         jrnl->diskio = config->diskio_cfg;
 
-        ESP_LOGV(TAG, "jrnl volume ID: %" PRIu8", total volume size: %" PRIu32 ", disk_sector_size: %" PRIu32 ", master record address: %" PRIu32,
-                 jrnl->fs_volume_id, (uint32_t)config->volume_cfg.volume_size, (uint32_t)config->volume_cfg.disk_sector_size, (uint32_t)(config->volume_cfg.volume_size - config->volume_cfg.disk_sector_size));
+        //the store on a separate device (eg internal flash for SD card volume) or at the end of the journaled volume
+        bool store_separate = config->store_diskio_cfg.disk_read != NULL;
+        const esp_jrnl_volume_t* store_volume = store_separate ? &config->store_volume_cfg : &config->volume_cfg;
+        jrnl->store_diskio = store_separate ? config->store_diskio_cfg : config->diskio_cfg;
+
+        if (store_separate && (config->store_diskio_cfg.disk_write == NULL || config->store_diskio_cfg.disk_erase_range == NULL)) {
+            err = ESP_ERR_INVALID_ARG;
+            break;
+        }
+
+        //the store keeps the volume sectors as they are, the sector sizes must match
+        if (store_volume->disk_sector_size != config->volume_cfg.disk_sector_size ||
+            config->user_cfg.store_size_sectors > store_volume->volume_size / store_volume->disk_sector_size) {
+            ESP_LOGE(TAG, "Journaling store doesn't fit the store device (sector size %" PRIu32 ", store device size %" PRIu32 ")",
+                     (uint32_t)store_volume->disk_sector_size, (uint32_t)store_volume->volume_size);
+            err = ESP_ERR_INVALID_SIZE;
+            break;
+        }
+
+        //the master record keeps the device sizes as 32-bit values (see esp_jrnl_master_volume_t)
+        if ((uint64_t)config->volume_cfg.volume_size > UINT32_MAX || (uint64_t)store_volume->volume_size > UINT32_MAX) {
+            ESP_LOGE(TAG, "Journaled volume too large (4GB max)");
+            err = ESP_ERR_INVALID_SIZE;
+            break;
+        }
+
+        //device operations measured from the very first access (master record read)
+        if (config->user_cfg.diskio_probe) {
+            err = jrnl_probe_attach(jrnl, store_separate, store_volume);
+            if (err != ESP_OK) {
+                break;
+            }
+        }
+
+        //completion tracking of the asynchronous disk requests, if any device supports them
+        if (jrnl->diskio.disk_submit != NULL || jrnl->store_diskio.disk_submit != NULL) {
+            jrnl->io_done = jrnl->static_mem ? xSemaphoreCreateCountingStatic(JRNL_IO_QUEUE_DEPTH, 0, &jrnl->io_done_mem)
+                                             : xSemaphoreCreateCounting(JRNL_IO_QUEUE_DEPTH, 0);
+            if (jrnl->io_done == NULL) {
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
+        }
+
+        if (config->user_cfg.async_commit) {
+#ifdef CONFIG_ESP_JRNL_COMMIT_EXECUTOR
+            err = jrnl_executor_init();
+            if (err == ESP_OK) {
+                err = jrnl_commit_ctx_init(jrnl);
+            }
+            if (err != ESP_OK) {
+                break;
+            }
+            jrnl->async_commit = true;
+#else
+            ESP_LOGE(TAG, "Asynchronous commit requires CONFIG_ESP_JRNL_COMMIT_EXECUTOR");
+            err = ESP_ERR_NOT_SUPPORTED;
+            break;
+#endif
+        }
+
+        //master record sector buffer (the record is always written as a full sector), store sector for packing the inline records.
+        //static instance: both provisioned by jrnl_static_layout()
+        if (!jrnl->static_mem) {
+            jrnl->master_buf = (uint8_t*) calloc(1, config->volume_cfg.disk_sector_size);
+            if (jrnl->master_buf == NULL) {
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
+
+            jrnl->tail_buf = (uint8_t*) calloc(1, config->volume_cfg.disk_sector_size);
+            if (jrnl->tail_buf == NULL) {
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
+        }
+
+        //record payload codec
+        jrnl->read_only = config->user_cfg.read_only;
+        jrnl->commit_mode = config->user_cfg.commit_mode;
+        jrnl->commit_batch_ops = config->user_cfg.commit_batch_ops;
+        jrnl->payload_codec = config->user_cfg.payload_codec;
+        if (jrnl->payload_codec == ESP_JRNL_CODEC_LZF && !jrnl->static_mem) {
+            jrnl->codec_workmem = (uint32_t*) malloc(JRNL_LZF_WORKMEM_SIZE);
+            if (jrnl->codec_workmem == NULL) {
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
+        }
+        else if (jrnl->payload_codec != ESP_JRNL_CODEC_NONE && jrnl->payload_codec != ESP_JRNL_CODEC_LZF) {
+            ESP_LOGE(TAG, "Unknown payload codec %d", jrnl->payload_codec);
+            err = ESP_ERR_INVALID_ARG;
+            break;
+        }
+
+        //record checksum engine (used for the records written by this instance)
+        if ((uint32_t)config->user_cfg.checksum >= JRNL_CHECKSUM_COUNT) {
+            ESP_LOGE(TAG, "Unknown record checksum engine %d", config->user_cfg.checksum);
+            err = ESP_ERR_INVALID_ARG;
+            break;
+        }
+        if (jrnl_checksum_init(config->user_cfg.checksum) != 0) {
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+
+        ESP_LOGV(TAG, "jrnl volume ID: %" PRIu8", total volume size: %" PRIu32 ", disk_sector_size: %" PRIu32 ", master record slots address: %" PRIu32 "%s",
+                 jrnl->fs_volume_id, (uint32_t)config->volume_cfg.volume_size, (uint32_t)config->volume_cfg.disk_sector_size,
+                 (uint32_t)(store_volume->volume_size - JRNL_MASTER_SLOT_COUNT * store_volume->disk_sector_size), store_separate ? " (separate store device)" : "");
+
+        //master record == the newest valid one of the two slots at the end of the store device
+        esp_jrnl_master_t disk_master;
+        err = jrnl->static_mem ? jrnl_read_master_slots(&jrnl->store_diskio, store_volume, jrnl->scratch[JRNL_SCRATCH_AUX], &disk_master)
+                               : jrnl_read_master(&jrnl->store_diskio, store_volume, &disk_master);
+        bool master_found = (err == ESP_OK);
+        if (err != ESP_OK && err != ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "Failed to read journal master record from disk (err 0x%08X)", err);
+            break;
+        }
+        err = ESP_OK;
+
+        //the generation always continues, so any stale record left on the disk stays older than the new ones
+        if (master_found) {
+            jrnl->master.generation = disk_master.generation;
+        }
 
         //check possibly uncommitted transaction stored in the journal, unless configured to ignore all journaled data
         bool need_fresh_journal = config->user_cfg.force_fs_format || config->user_cfg.overwrite_existing;
+        size_t store_size_sectors = config->user_cfg.store_size_sectors;
         if (!need_fresh_journal) {
 
-            //master record == the last sector before WL section
-            err = jrnl_read_raw(jrnl, config->volume_cfg.volume_size - config->volume_cfg.disk_sector_size, (void*)&jrnl->master, sizeof(esp_jrnl_master_t));
-            if (unlikely(err != ESP_OK)) {
-                ESP_LOGE(TAG, "Failed to read journal master record from disk (err 0x%08X)", err);
-                break;
-            }
+            //ensure the record validity and replay the journal, if any
+            if (master_found) {
 
-            //ensure the record validity and replay the journal, if any (MV!!!: no way to recognise whether the record is corrupted or missing completely - add extra feature?)
-            if (jrnl->master.jrnl_magic_mark == JRNL_STORE_MARKER) {
+                memcpy(&jrnl->master, &disk_master, sizeof(esp_jrnl_master_t));
+                memcpy(jrnl->master_buf, &disk_master, sizeof(esp_jrnl_master_t));
+                jrnl->master_disk_clean = disk_master.status == ESP_JRNL_STATUS_TRANS_READY && disk_master.next_free_sector == 0;
 
                 ESP_LOGV(TAG, "Found valid journal record, verifying consistency...");
 
                 if (!(config->volume_cfg.volume_size == jrnl->master.volume.volume_size &&
                        config->volume_cfg.disk_sector_size == jrnl->master.volume.disk_sector_size &&
-                       config->user_cfg.store_size_sectors == jrnl->master.store_size_sectors)) {
+                       store_separate == jrnl->master.store_separate &&
+                       store_volume->volume_size == jrnl->master.store_volume.volume_size &&
+                       (config->user_cfg.store_size_sectors == jrnl->master.store_size_sectors || config->user_cfg.allow_store_resize))) {
                     ESP_LOGE(TAG, "Journaling configuration inconsistent with found jrnl master record (record corrupted?)");
                     err = ESP_ERR_INVALID_STATE;
                     break;
                 }
 
-                //repeat open JRNL transaction, if any
-                if (config->user_cfg.replay_journal_after_mount) {
+                //keep the existing store boundary, the file-system layer moves it (see esp_jrnl_resize_store())
+                if (config->user_cfg.store_size_sectors != jrnl->master.store_size_sectors) {
+                    ESP_LOGI(TAG, "Journaling store size %" PRIu32 " differs from configured %" PRIu32 " sectors, resize pending",
+                             (uint32_t)jrnl->master.store_size_sectors, (uint32_t)config->user_cfg.store_size_sectors);
+                    store_size_sectors = jrnl->master.store_size_sectors;
+                }
+
+                //repeat open JRNL transaction, if any. A read-only instance replays only a committed transaction,
+                //the file-system is consistent otherwise (an open transaction is dropped in RAM)
+                bool replay_needed = !jrnl->read_only || jrnl->master.status == ESP_JRNL_STATUS_TRANS_COMMIT;
+                if (config->user_cfg.replay_journal_after_mount && replay_needed) {
+                    //the stored records are verified by the engine they were written with
+                    if (jrnl_checksum_init(jrnl->master.checksum) != 0) {
+                        ESP_LOGE(TAG, "Journal records checksum engine %" PRIu32 " (%s) not available", jrnl->master.checksum, jrnl_checksum_name(jrnl->master.checksum));
+                        err = ESP_ERR_NOT_SUPPORTED;
+                        break;
+                    }
                     err = jrnl_replay(jrnl);
                     if (err != ESP_OK) {
                         ESP_LOGE(TAG, "Failed to replay stored journal log (0x%08X)", err);
@@ -492,19 +1494,24 @@ esp_err_t esp_jrnl_mount(const esp_jrnl_config_extended_t *config, esp_jrnl_hand
 
         ESP_LOGV(TAG, "Creating fresh journaling store...");
 
-        jrnl->master.store_size_sectors = config->user_cfg.store_size_sectors;
-        jrnl->master.store_volume_offset_sector = config->volume_cfg.volume_size/config->volume_cfg.disk_sector_size - config->user_cfg.store_size_sectors;
-        jrnl->master.volume = config->volume_cfg;
-
-        //journal instance created with ESP_JRNL_STATUS_FS_INIT status
-        err = jrnl_reset_master(jrnl, need_fresh_journal);
+        jrnl->master.store_size_sectors = store_size_sectors;
+        jrnl->master.store_volume_offset_sector = store_volume->volume_size/store_volume->disk_sector_size - store_size_sectors;
+        jrnl->master.volume.volume_size = config->volume_cfg.volume_size;
+        jrnl->master.volume.disk_sector_size = config->volume_cfg.disk_sector_size;
+        jrnl->master.store_volume.volume_size = store_volume->volume_size;
+        jrnl->master.store_volume.disk_sector_size = store_volume->disk_sector_size;
+        jrnl->master.store_separate = store_separate;
+        jrnl->master.checksum = config->user_cfg.checksum;
+
+        //journal instance created with ESP_JRNL_STATUS_FS_INIT status (a clean store found on the disk is not rewritten)
+        err = jrnl_reset_master_lazy(jrnl, need_fresh_journal);
         if (err != ESP_OK) {
             ESP_LOGE(TAG, "Failed to reset journaling master record (0x%08X)", err);
             break;
         }
 
-        //add the new instance handle to the list and provide it to the caller
-        s_jrnl_instance_ptrs[out_handle] = jrnl;
+        //publish the new instance and provide its handle to the caller
+        atomic_store(&s_jrnl_instance_ptrs[out_handle], jrnl);
         *jrnl_handle = out_handle;
 
     } while(0);
@@ -512,220 +1519,826 @@ esp_err_t esp_jrnl_mount(const esp_jrnl_config_extended_t *config, esp_jrnl_hand
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "esp_jrnl_mount failed (0x%08X)", err);
         jrnl_delete_instance(jrnl);
+        if (out_handle != JRNL_INVALID_HANDLE) {
+            atomic_store(&s_jrnl_instance_ptrs[out_handle], NULL);
+        }
     }
     else {
         ESP_LOGV(TAG, "esp_jrnl_mount succeeded (handle: %ld)", *jrnl_handle);
     }
 
-    _lock_release(&s_instances_lock);
+    return err;
+}
+
+esp_err_t esp_jrnl_mount(const esp_jrnl_config_extended_t *config, esp_jrnl_handle_t *jrnl_handle)
+{
+    return jrnl_mount(config, NULL, jrnl_handle);
+}
+
+esp_err_t esp_jrnl_mount_static(const esp_jrnl_config_extended_t *config, void* mem, size_t mem_size, esp_jrnl_handle_t *jrnl_handle)
+{
+    if (config == NULL || mem == NULL || (uintptr_t)mem % sizeof(uint64_t) != 0 ||
+        config->user_cfg.store_size_sectors < JRNL_MIN_STORE_SIZE || config->volume_cfg.disk_sector_size % sizeof(uint64_t) != 0 ||
+        config->user_cfg.static_record_sectors > ESP_JRNL_STATIC_RECORD_SECTORS(config->user_cfg.store_size_sectors)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    //both allocate their own records (the executor tasks, the probe statistics)
+    if (config->user_cfg.async_commit || config->user_cfg.diskio_probe) {
+        ESP_LOGE(TAG, "%s - asynchronous commit and diskio probe not available for static instances", __func__);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    size_t needed = jrnl_static_mem_size(config);
+    if (mem_size < needed) {
+        ESP_LOGE(TAG, "%s - instance memory of %u B too small (%u B needed)", __func__, (unsigned)mem_size, (unsigned)needed);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    return jrnl_mount(config, (uint8_t*)mem, jrnl_handle);
+}
+
+/* commits the open transaction: the records are transferred to the target disk (by the commit executor if enabled) */
+static esp_err_t jrnl_commit(esp_jrnl_instance_t* inst_ptr)
+{
+#ifdef CONFIG_ESP_JRNL_TRACE
+    uint32_t trace_batch_ops = inst_ptr->batch_ops;
+#endif
+    JRNL_TRACE_TIME(start);
+
+    inst_ptr->batch_ops = 0;
+    inst_ptr->sync_requested = false;
+
+    JRNL_TEST_PRELIMINARY_EXIT(ESP_JRNL_TEST_STOP_SKIP_COMMIT, "(jrnl_poweroff_test): Skip committing of the current JRNL transaction");
+
+    if (inst_ptr->master.status != ESP_JRNL_STATUS_TRANS_OPEN) {
+        ESP_LOGE(TAG, "Journaling transaction not open (0x%08X)", ESP_ERR_INVALID_STATE);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    //start committing the transaction to the disk
+    ESP_LOGV(TAG, "Committing current JRNL transaction");
+
+    jrnl_trans_lock(inst_ptr);
+    esp_err_t err = jrnl_flush_tail(inst_ptr);
+    if (err == ESP_OK) {
+        jrnl_prepare_master_spare(inst_ptr);
+        inst_ptr->master.status = ESP_JRNL_STATUS_TRANS_COMMIT;
+        err = jrnl_update_master(inst_ptr);
+    }
+    jrnl_trans_unlock(inst_ptr);
+
+    JRNL_TEST_PRELIMINARY_EXIT(ESP_JRNL_TEST_STOP_SET_COMMIT_AND_EXIT, "(jrnl_poweroff_test): Set commit status to JRNL header and exit");
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "jrnl_write_internal failed (0x%08X)", err);
+        return err;
+    }
+    JRNL_STATS_ADD(inst_ptr, trans_committed, 1);
+#ifdef CONFIG_ESP_JRNL_TRACE
+    uint32_t trace_used_sectors = jrnl_store_used_sectors(inst_ptr);
+#endif
+
+#ifdef CONFIG_ESP_JRNL_COMMIT_EXECUTOR
+    //hand the transfer over to the commit executor, empty transactions are cheaper to finish right here
+    if (inst_ptr->async_commit && inst_ptr->master.next_free_sector > 0) {
+        err = jrnl_executor_submit(inst_ptr);
+        if (err == ESP_OK) {
+            JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_TRANS_COMMIT, trace_used_sectors, trace_batch_ops, start);
+            return ESP_OK;
+        }
+        ESP_LOGW(TAG, "Commit executor unavailable, committing synchronously (0x%08X)", err);
+    }
+#endif
+
+    //transfer the operations from JRNL store to the target disk
+    err = jrnl_replay(inst_ptr);
+    JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_TRANS_COMMIT, trace_used_sectors, trace_batch_ops, start);
 
     return err;
 }
 
+/*
+ * Waits for the pending commit. A failed commit (asynchronous or not) leaves the transaction committed in the store
+ * (TRANS_COMMIT), its replay is retried here, so the instance recovers without a remount. The commit error is only logged
+ * if the retry succeeds
+ */
+static esp_err_t jrnl_commit_settle(esp_jrnl_instance_t* inst_ptr)
+{
+    esp_err_t err = jrnl_commit_wait(inst_ptr);
+    if (inst_ptr->master.status != ESP_JRNL_STATUS_TRANS_COMMIT) {
+        return err;
+    }
+
+    ESP_LOGW(TAG, "Last commit of instance[%ld] not finished, replaying the committed transaction", inst_ptr->handle);
+    err = jrnl_replay(inst_ptr);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Committed transaction of instance[%ld] not replayable (0x%08X)", inst_ptr->handle, err);
+    }
+
+    return err;
+}
+
+/* commits the batched transaction left open between the operations (nothing to do otherwise) */
+static esp_err_t jrnl_batch_flush(esp_jrnl_instance_t* inst_ptr)
+{
+    if (inst_ptr->master.status != ESP_JRNL_STATUS_TRANS_OPEN || inst_ptr->op_open || inst_ptr->batch_ops == 0) {
+        return ESP_OK;
+    }
+
+    ESP_LOGV(TAG, "Committing batched JRNL transaction (%" PRIu32 " operations)", inst_ptr->batch_ops);
+    return jrnl_commit(inst_ptr);
+}
+
 esp_err_t esp_jrnl_unmount(const esp_jrnl_handle_t handle)
 {
     ESP_LOGV(TAG, "esp_jrnl_unmount (handle: %ld)", handle);
 
-    _lock_acquire(&s_instances_lock);
-
-    esp_err_t err = jrnl_check_handle(handle, __func__);
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
     if (err != ESP_OK) {
         return err;
     }
-    jrnl_delete_instance(s_jrnl_instance_ptrs[handle]);
-    s_jrnl_instance_ptrs[handle] = NULL;
 
-    _lock_release(&s_instances_lock);
+    //withdraw the instance from the table first (no new reference can be taken), only one of concurrent unmount calls can succeed
+    esp_jrnl_instance_t* expected = inst_ptr;
+    if (!atomic_compare_exchange_strong(&s_jrnl_instance_ptrs[handle], &expected, JRNL_INSTANCE_RESERVED)) {
+        ESP_LOGE(TAG, "%s: instance[%ld] already being unmounted", __func__, (int32_t)handle);
+        jrnl_put_instance(inst_ptr);
+        return ESP_ERR_NOT_FOUND;
+    }
+    jrnl_put_instance(inst_ptr);
+
+    //wait for the API calls (and the commit executor) still holding the instance. The wake-up is armed by parking
+    //the instance in the 'draining' slot, if the last reference was dropped meanwhile the unmount disarms it itself
+    while (true) {
+        atomic_store(&s_jrnl_instance_draining[handle], inst_ptr);
+        if (atomic_load(&s_jrnl_instance_refs[handle]) == 0 &&
+            atomic_exchange(&s_jrnl_instance_draining[handle], NULL) == inst_ptr) {
+            break;
+        }
+        xSemaphoreTake(inst_ptr->refs_drained, portMAX_DELAY);
+    }
+
+    //exclusive access from here: the last asynchronous commit result, then the operations batched since the last sync
+    //get committed synchronously. The data of failed commit stays in the store (replayed on the next mount)
+    err = jrnl_commit_wait(inst_ptr);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "%s: last commit of instance[%ld] failed (0x%08X)", __func__, (int32_t)handle, err);
+    }
+#ifdef CONFIG_ESP_JRNL_COMMIT_EXECUTOR
+    inst_ptr->async_commit = false;
+#endif
+    err = jrnl_batch_flush(inst_ptr);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "%s: batched transaction of instance[%ld] not committed (0x%08X)", __func__, (int32_t)handle, err);
+    }
+
+    jrnl_delete_instance(inst_ptr);
+    atomic_store(&s_jrnl_instance_ptrs[handle], NULL);
 
     return ESP_OK;
 }
 
-esp_err_t esp_jrnl_start(const esp_jrnl_handle_t handle)
+static esp_err_t jrnl_start(esp_jrnl_instance_t* inst_ptr)
 {
-    ESP_LOGD(TAG, "esp_jrnl_start (handle: %ld)", handle);
+    JRNL_TEST_TRANSACTION_SUSPENDED("esp_jrnl_start() suspended");
+
+    if (inst_ptr->read_only) {
+        ESP_LOGE(TAG, "Can't open new journaling transaction, instance mounted read-only");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = ESP_OK;
+
+    //batched transaction left open by the previous operations: joined, unless it occupies too much of the store already
+    //or its touched ranges index overflowed - the journaled reads would scan the whole store then
+    if (inst_ptr->master.status == ESP_JRNL_STATUS_TRANS_OPEN && !inst_ptr->op_open && inst_ptr->batch_ops > 0) {
+        if (jrnl_store_used_sectors(inst_ptr) < JRNL_STORE_DATA_SECTORS(&inst_ptr->master) / JRNL_BATCH_STORE_SHARE &&
+            inst_ptr->touched_count <= JRNL_TOUCHED_RANGES_MAX) {
+            jrnl_trans_lock(inst_ptr);
+            jrnl_savepoint_take(inst_ptr);
+            inst_ptr->op_open = true;
+            jrnl_trans_unlock(inst_ptr);
+            return ESP_OK;
+        }
+        err = jrnl_commit(inst_ptr);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Can't open new journaling transaction, batched transaction commit failed (0x%08X)", err);
+            return err;
+        }
+    }
 
-    esp_err_t err = jrnl_check_handle(handle, __func__);
+    //the previous transaction must be completely transferred to the target disk (a failed commit is retried)
+    err = jrnl_commit_settle(inst_ptr);
     if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Can't open new journaling transaction, previous commit failed (0x%08X)", err);
         return err;
     }
 
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[handle];
-    JRNL_TEST_TRANSACTION_SUSPENDED("esp_jrnl_start() suspended");
-
-    _lock_acquire(&inst_ptr->trans_lock);
+    jrnl_trans_lock(inst_ptr);
 
-    ESP_LOGD(TAG, "esp_jrnl_start (current status: %s)", jrnl_status_to_str(inst_ptr->master.status));
+    ESP_LOGD(TAG, "esp_jrnl_start (current status: %s)", jrnl_status_name(inst_ptr->master.status));
 
     if (inst_ptr->master.status == ESP_JRNL_STATUS_TRANS_READY) {
 
         assert(inst_ptr->master.next_free_sector == 0);
         inst_ptr->master.status = ESP_JRNL_STATUS_TRANS_OPEN;
+        inst_ptr->touched_count = 0;
+        jrnl_savepoint_take(inst_ptr);
 
         //update JRNL status on disk
         ESP_LOGV(TAG, "JRNL transaction open, updating master record");
-        err = jrnl_update_master(inst_ptr, &inst_ptr->master);
+        JRNL_TRACE_TIME(start);
+        err = jrnl_update_master(inst_ptr);
         if (err != ESP_OK) {
             ESP_LOGE(TAG, "jrnl_write_internal failed (0x%08X)", err);
         }
+        else {
+            inst_ptr->op_open = true;
+            inst_ptr->batch_ops = 0;
+            inst_ptr->sync_requested = false;
+            JRNL_STATS_ADD(inst_ptr, trans_started, 1);
+            JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_TRANS_OPEN, inst_ptr->master.generation, 0, start);
+        }
+    }
+    else if (inst_ptr->master.status == ESP_JRNL_STATUS_FS_DIRECT) {
+        //direct disk access: the operation isn't journaled, its writes go straight to the target
+        ESP_LOGV(TAG, "Direct disk access on, no JRNL transaction opened");
     }
     else {
         err = ESP_ERR_INVALID_STATE;
-        ESP_LOGE(TAG, "Can't open new journaling transaction (status=%s, err=0x%08X)", jrnl_status_to_str(inst_ptr->master.status), err);
+        ESP_LOGE(TAG, "Can't open new journaling transaction (status=%s, err=0x%08X)", jrnl_status_name(inst_ptr->master.status), err);
     }
 
-    _lock_release(&inst_ptr->trans_lock);
+    jrnl_trans_unlock(inst_ptr);
 
     return err;
 }
 
-//MV2DO: locking logic needs revamping (separate task to support multithreading)
-esp_err_t esp_jrnl_stop(const esp_jrnl_handle_t handle, const bool commit)
+esp_err_t esp_jrnl_start(const esp_jrnl_handle_t handle)
 {
-    ESP_LOGD(TAG, "esp_jrnl_stop (handle: %ld, commit: %u)", handle, commit);
+    ESP_LOGD(TAG, "esp_jrnl_start (handle: %ld)", handle);
 
-    esp_err_t err = jrnl_check_handle(handle, __func__);
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
     if (err != ESP_OK) {
         return err;
     }
 
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[handle];
+    err = jrnl_start(inst_ptr);
+    jrnl_put_instance(inst_ptr);
+
+    return err;
+}
+
+static esp_err_t jrnl_stop(esp_jrnl_instance_t* inst_ptr, const bool commit)
+{
     JRNL_TEST_TRANSACTION_SUSPENDED("esp_jrnl_stop() suspended");
 
+    esp_err_t err = jrnl_commit_wait(inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    //operation done in direct disk access mode (see jrnl_start): its writes are on the target disk already,
+    //nothing to commit and nothing to roll back - a cancel is a no-op
+    if (inst_ptr->master.status == ESP_JRNL_STATUS_FS_DIRECT) {
+        if (!commit) {
+            ESP_LOGD(TAG, "Direct disk access on, operation writes can't be cancelled");
+        }
+        return ESP_OK;
+    }
+
+    //the operation end and its batch accounting are atomic to esp_jrnl_sync(): a sync either flags the open operation
+    //or finds it counted in the batch
+    jrnl_trans_lock(inst_ptr);
+    bool op_open = inst_ptr->op_open;
+    inst_ptr->op_open = false;
+    bool batched = inst_ptr->commit_mode != ESP_JRNL_COMMIT_IMMEDIATE && op_open && inst_ptr->master.status == ESP_JRNL_STATUS_TRANS_OPEN &&
+                   (commit || inst_ptr->batch_ops > 0);
+    if (batched && commit) {
+        inst_ptr->batch_ops++;
+    }
+    jrnl_trans_unlock(inst_ptr);
+
+    //batched transaction: the operation stays in it, the commit waits for a sync or the batch limit.
+    //A failed operation is rolled back to the savepoint taken by jrnl_start, the preceding ones are kept
+    if (batched) {
+        if (!commit) {
+            jrnl_trans_lock(inst_ptr);
+            err = jrnl_savepoint_restore(inst_ptr);
+            jrnl_trans_unlock(inst_ptr);
+            if (err != ESP_OK) {
+                //the records stay (consistent, FatFS counts with the writes done anyway), the operation is counted in
+                ESP_LOGW(TAG, "Operation failed within batched JRNL transaction, its writes kept in the batch");
+                inst_ptr->batch_ops++;
+            }
+            else {
+                ESP_LOGW(TAG, "Operation failed within batched JRNL transaction, its writes dropped from the batch");
+            }
+        }
+        bool batch_full = inst_ptr->commit_mode == ESP_JRNL_COMMIT_BATCHED && inst_ptr->batch_ops >= inst_ptr->commit_batch_ops;
+        if (!inst_ptr->sync_requested && !batch_full) {
+            return ESP_OK;
+        }
+        return jrnl_commit(inst_ptr);
+    }
+
     //cancel the transaction
     if (!commit) {
         ESP_LOGV(TAG, "Canceling current JRNL transaction");
 
-        _lock_acquire(&inst_ptr->trans_lock);
+        JRNL_TRACE_TIME(start);
+        jrnl_trans_lock(inst_ptr);
+        inst_ptr->batch_ops = 0;
+        inst_ptr->sync_requested = false;
         err = jrnl_reset_master(inst_ptr, false);
-        _lock_release(&inst_ptr->trans_lock);
+        jrnl_trans_unlock(inst_ptr);
+        if (err == ESP_OK) {
+            JRNL_STATS_ADD(inst_ptr, trans_cancelled, 1);
+            JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_TRANS_CANCEL, 0, 0, start);
+        }
         return err;
     }
 
-    JRNL_TEST_PRELIMINARY_EXIT(ESP_JRNL_TEST_STOP_SKIP_COMMIT, "(jrnl_poweroff_test): Skip committing of the current JRNL transaction");
+    return jrnl_commit(inst_ptr);
+}
+
+//MV2DO: locking logic needs revamping (separate task to support multithreading)
+esp_err_t esp_jrnl_stop(const esp_jrnl_handle_t handle, const bool commit)
+{
+    ESP_LOGD(TAG, "esp_jrnl_stop (handle: %ld, commit: %u)", handle, commit);
 
-    if (inst_ptr->master.status == ESP_JRNL_STATUS_TRANS_OPEN) {
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
 
-        //start committing the transaction to the disk
-        ESP_LOGV(TAG, "Committing current JRNL transaction");
+    err = jrnl_stop(inst_ptr, commit);
+    jrnl_put_instance(inst_ptr);
 
-        _lock_acquire(&inst_ptr->trans_lock);
-        inst_ptr->master.status = ESP_JRNL_STATUS_TRANS_COMMIT;
-        err = jrnl_update_master(inst_ptr, &inst_ptr->master);
-        _lock_release(&inst_ptr->trans_lock);
+    return err;
+}
+
+esp_err_t esp_jrnl_sync(const esp_jrnl_handle_t handle)
+{
+    ESP_LOGD(TAG, "esp_jrnl_sync (handle: %ld)", handle);
+
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    //within an operation the commit is left to its esp_jrnl_stop() (the operation's writes may not be finished yet).
+    //Checked and flagged under the transaction lock, so the request can't slip past the operation end
+    jrnl_trans_lock(inst_ptr);
+    bool op_open = inst_ptr->op_open;
+    if (op_open) {
+        inst_ptr->sync_requested = true;
+    }
+    jrnl_trans_unlock(inst_ptr);
+
+    if (!op_open) {
+        err = jrnl_batch_flush(inst_ptr);
+    }
+    jrnl_put_instance(inst_ptr);
+
+    return err;
+}
+
+esp_err_t esp_jrnl_wait_commit(const esp_jrnl_handle_t handle)
+{
+    ESP_LOGV(TAG, "esp_jrnl_wait_commit (handle: %ld)", handle);
+
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = jrnl_commit_settle(inst_ptr);
+    jrnl_put_instance(inst_ptr);
+
+    return err;
+}
+
+esp_err_t esp_jrnl_get_diskio_handle(const esp_jrnl_handle_t handle, int32_t* diskio_ctrl_handle)
+{
+    if (diskio_ctrl_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    //the original device, not the probe wrapper
+    *diskio_ctrl_handle = inst_ptr->probe != NULL ? jrnl_probe_backend(inst_ptr, false)->diskio_ctrl_handle : inst_ptr->diskio.diskio_ctrl_handle;
+    jrnl_put_instance(inst_ptr);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_jrnl_get_store_diskio_handle(const esp_jrnl_handle_t handle, int32_t* store_diskio_ctrl_handle)
+{
+    if (store_diskio_ctrl_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (inst_ptr->master.store_separate) {
+        *store_diskio_ctrl_handle = inst_ptr->probe != NULL ? jrnl_probe_backend(inst_ptr, true)->diskio_ctrl_handle : inst_ptr->store_diskio.diskio_ctrl_handle;
+    }
+    else {
+        err = ESP_ERR_NOT_FOUND;
+    }
+    jrnl_put_instance(inst_ptr);
+
+    return err;
+}
+
+esp_err_t esp_jrnl_get_store_size(const esp_jrnl_handle_t handle, size_t* store_size_sectors)
+{
+    if (store_size_sectors == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    *store_size_sectors = inst_ptr->master.store_size_sectors;
+    jrnl_put_instance(inst_ptr);
+
+    return ESP_OK;
+}
+
+static esp_err_t jrnl_resize_store(esp_jrnl_instance_t* inst_ptr, const size_t store_size_sectors)
+{
+    if (inst_ptr->read_only) {
+        ESP_LOGE(TAG, "Journaling store of read-only instance can't be resized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    //a store sharing the journaled volume must leave some space for the file-system
+    size_t volume_sectors = inst_ptr->master.store_volume.volume_size / inst_ptr->master.store_volume.disk_sector_size;
+    size_t max_store_sectors = inst_ptr->master.store_separate ? volume_sectors : volume_sectors - 1;
+    if (store_size_sectors < JRNL_MIN_STORE_SIZE || store_size_sectors > max_store_sectors) {
+        ESP_LOGE(TAG, "Invalid journaling store size %" PRIu32 " (store device sectors: %" PRIu32 ")", (uint32_t)store_size_sectors, (uint32_t)volume_sectors);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    //the store must be empty (no commit pending either)
+    esp_err_t err = jrnl_batch_flush(inst_ptr);
+    if (err == ESP_OK) {
+        err = jrnl_commit_settle(inst_ptr);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    jrnl_trans_lock(inst_ptr);
+
+    do {
+        if (inst_ptr->master.status != ESP_JRNL_STATUS_TRANS_READY && inst_ptr->master.status != ESP_JRNL_STATUS_FS_DIRECT) {
+            err = ESP_ERR_INVALID_STATE;
+            ESP_LOGE(TAG, "Can't resize journaling store (status=%s)", jrnl_status_name(inst_ptr->master.status));
+            break;
+        }
+
+        if (store_size_sectors == inst_ptr->master.store_size_sectors) {
+            break;
+        }
+
+        //the master slots occupy the volume end regardless of the store size, single A/B update switches the boundary
+        size_t prev_size = inst_ptr->master.store_size_sectors;
+        size_t prev_offset = inst_ptr->master.store_volume_offset_sector;
+        inst_ptr->master.store_size_sectors = store_size_sectors;
+        inst_ptr->master.store_volume_offset_sector = volume_sectors - store_size_sectors;
+
+        err = jrnl_update_master(inst_ptr);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to update jrnl master record (0x%08X)", err);
+            inst_ptr->master.store_size_sectors = prev_size;
+            inst_ptr->master.store_volume_offset_sector = prev_offset;
+            break;
+        }
+
+        //the sectors moved between the store and the file-system don't keep their erased state
+        inst_ptr->erased_count = 0;
+
+        ESP_LOGI(TAG, "Journaling store resized: %" PRIu32 " -> %" PRIu32 " sectors", (uint32_t)prev_size, (uint32_t)store_size_sectors);
+    } while(false);
+
+    jrnl_trans_unlock(inst_ptr);
+
+    return err;
+}
+
+esp_err_t esp_jrnl_resize_store(const esp_jrnl_handle_t handle, const size_t store_size_sectors)
+{
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = jrnl_resize_store(inst_ptr, store_size_sectors);
+    jrnl_put_instance(inst_ptr);
+
+    return err;
+}
+
+esp_err_t esp_jrnl_get_sector_count(const esp_jrnl_handle_t handle, size_t* fs_part_sector_count)
+{
+    if (fs_part_sector_count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    *fs_part_sector_count = JRNL_FS_SECTORS(&inst_ptr->master);
+    jrnl_put_instance(inst_ptr);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_jrnl_get_sector_size(const esp_jrnl_handle_t handle, size_t* sector_size)
+{
+    if (sector_size == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    *sector_size = inst_ptr->master.volume.disk_sector_size;
+    jrnl_put_instance(inst_ptr);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_jrnl_get_erase_block_size(const esp_jrnl_handle_t handle, size_t* block_sectors)
+{
+    if (block_sectors == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-        JRNL_TEST_PRELIMINARY_EXIT(ESP_JRNL_TEST_STOP_SET_COMMIT_AND_EXIT, "(jrnl_poweroff_test): Set commit status to JRNL header and exit");
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
 
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "jrnl_write_internal failed (0x%08X)", err);
-            return err;
-        }
+    size_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    size_t erase_block_size = inst_ptr->diskio.erase_block_size;
+    jrnl_put_instance(inst_ptr);
 
-        //transfer the operations from JRNL store to the target disk
-        err = jrnl_replay(inst_ptr);
-    }
-    else {
-        err = ESP_ERR_INVALID_STATE;
-        ESP_LOGE(TAG, "Journaling transaction not open (0x%08X)", err);
+    //FatFS takes power of 2 block sizes up to 32768 sectors only
+    size_t blk = erase_block_size / sector_size;
+    if (blk == 0 || blk > JRNL_ERASE_BLOCK_SECTORS_MAX || (blk & (blk - 1)) != 0 || erase_block_size % sector_size != 0) {
+        blk = 1;
     }
+    *block_sectors = blk;
 
-    return err;
+    return ESP_OK;
 }
 
-esp_err_t esp_jrnl_get_diskio_handle(const esp_jrnl_handle_t handle, int32_t* diskio_ctrl_handle)
+esp_err_t esp_jrnl_get_stats(const esp_jrnl_handle_t handle, esp_jrnl_stats_t* stats)
 {
-    if (diskio_ctrl_handle == NULL) {
+    if (stats == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t err = jrnl_check_handle(handle, __func__);
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
     if (err != ESP_OK) {
         return err;
     }
 
-    *diskio_ctrl_handle = s_jrnl_instance_ptrs[handle]->diskio.diskio_ctrl_handle;
+    esp_jrnl_stats_counters_t* counters = &inst_ptr->stats;
+    uint64_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    stats->trans_started = atomic_load_explicit(&counters->trans_started, memory_order_relaxed);
+    stats->trans_committed = atomic_load_explicit(&counters->trans_committed, memory_order_relaxed);
+    stats->trans_cancelled = atomic_load_explicit(&counters->trans_cancelled, memory_order_relaxed);
+    stats->bytes_read = atomic_load_explicit(&counters->sectors_read, memory_order_relaxed) * sector_size;
+    stats->bytes_written = atomic_load_explicit(&counters->sectors_written, memory_order_relaxed) * sector_size;
+    stats->bytes_erased = atomic_load_explicit(&counters->sectors_erased, memory_order_relaxed) * sector_size;
+    stats->master_updates = atomic_load_explicit(&counters->master_updates, memory_order_relaxed);
+    stats->master_spare_misses = atomic_load_explicit(&counters->master_spare_misses, memory_order_relaxed);
+    stats->replays = atomic_load_explicit(&counters->replays, memory_order_relaxed);
+    stats->replay_time_max_us = atomic_load_explicit(&counters->replay_time_max_us, memory_order_relaxed);
+    stats->store_peak_sectors = atomic_load_explicit(&counters->store_peak_sectors, memory_order_relaxed);
+    stats->store_data_sectors = JRNL_STORE_DATA_SECTORS(&inst_ptr->master);
+
+    jrnl_trans_lock(inst_ptr);
+    stats->sectors_journaled = counters->sectors_journaled;
+    stats->replay_time_us = counters->replay_time_us;
+    stats->append_time_us = counters->append_time_us;
+    jrnl_trans_unlock(inst_ptr);
+
+    jrnl_put_instance(inst_ptr);
 
     return ESP_OK;
 }
 
-esp_err_t esp_jrnl_get_sector_count(const esp_jrnl_handle_t handle, size_t* fs_part_sector_count)
+esp_err_t esp_jrnl_reset_stats(const esp_jrnl_handle_t handle)
 {
-    if (fs_part_sector_count == NULL) {
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    //the peak restarts from the current store occupancy (transaction possibly open)
+    jrnl_trans_lock(inst_ptr);
+    esp_jrnl_stats_counters_t* counters = &inst_ptr->stats;
+    atomic_store_explicit(&counters->trans_started, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->trans_committed, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->trans_cancelled, 0, memory_order_relaxed);
+    counters->sectors_journaled = 0;
+    atomic_store_explicit(&counters->sectors_read, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->sectors_written, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->sectors_erased, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->master_updates, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->master_spare_misses, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->replays, 0, memory_order_relaxed);
+    counters->replay_time_us = 0;
+    atomic_store_explicit(&counters->replay_time_max_us, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->store_peak_sectors, jrnl_store_used_sectors(inst_ptr), memory_order_relaxed);
+    counters->append_time_us = 0;
+    if (inst_ptr->probe != NULL) {
+        jrnl_probe_reset_stats(inst_ptr);
+    }
+    jrnl_trans_unlock(inst_ptr);
+
+    jrnl_put_instance(inst_ptr);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_jrnl_get_append_time(const esp_jrnl_handle_t handle, uint64_t* time_us)
+{
+    if (time_us == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t err = jrnl_check_handle(handle, __func__);
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
     if (err != ESP_OK) {
         return err;
     }
 
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[handle];
-    *fs_part_sector_count = inst_ptr->master.volume.volume_size / inst_ptr->master.volume.disk_sector_size - inst_ptr->master.store_size_sectors;
+    jrnl_trans_lock(inst_ptr);
+    *time_us = inst_ptr->stats.append_time_us;
+    jrnl_trans_unlock(inst_ptr);
+    jrnl_put_instance(inst_ptr);
 
     return ESP_OK;
 }
 
-esp_err_t esp_jrnl_get_sector_size(const esp_jrnl_handle_t handle, size_t* sector_size)
+esp_err_t esp_jrnl_get_diskio_stats(const esp_jrnl_handle_t handle, esp_jrnl_diskio_stats_t* stats)
 {
-    if (sector_size == NULL) {
+    if (stats == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t err = jrnl_check_handle(handle, __func__);
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
     if (err != ESP_OK) {
         return err;
     }
 
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[handle];
-    *sector_size = inst_ptr->master.volume.disk_sector_size;
+    if (inst_ptr->probe != NULL) {
+        jrnl_probe_get_stats(inst_ptr, stats);
+    }
+    else {
+        err = ESP_ERR_NOT_SUPPORTED;
+    }
+    jrnl_put_instance(inst_ptr);
 
-    return ESP_OK;
+    return err;
 }
 
 esp_err_t esp_jrnl_set_direct_io(const esp_jrnl_handle_t handle, bool direct_access)
 {
     ESP_LOGV(TAG, "esp_jrnl_set_direct_io (handle: %ld, on: %u)", handle, direct_access);
 
-    esp_err_t err = jrnl_check_handle(handle, __func__);
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = jrnl_batch_flush(inst_ptr);
+    if (err == ESP_OK) {
+        err = jrnl_commit_settle(inst_ptr);
+    }
     if (err != ESP_OK) {
+        jrnl_put_instance(inst_ptr);
         return err;
     }
 
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[handle];
-    _lock_acquire(&inst_ptr->trans_lock);
+    jrnl_trans_lock(inst_ptr);
 
     //direct FS access switching cannot be required during a transaction lifetime
     if (inst_ptr->master.status != ESP_JRNL_STATUS_FS_DIRECT && inst_ptr->master.status != ESP_JRNL_STATUS_TRANS_READY) {
         err = ESP_ERR_INVALID_STATE;
     }
     else {
-        inst_ptr->master.status = direct_access ? ESP_JRNL_STATUS_FS_DIRECT : ESP_JRNL_STATUS_TRANS_READY;
-        err = jrnl_update_master(inst_ptr, &inst_ptr->master);
+        err = jrnl_reset_master_lazy(inst_ptr, direct_access);
     }
-    _lock_release(&inst_ptr->trans_lock);
+    jrnl_trans_unlock(inst_ptr);
+    jrnl_put_instance(inst_ptr);
 
     return err;
 }
 
-esp_err_t esp_jrnl_write(const esp_jrnl_handle_t handle, const uint8_t *buff, const uint32_t sector, const uint32_t count)
+/* checks the target range against the ranges written within the open transaction (true also if the index overflowed) */
+static bool jrnl_range_touched(const esp_jrnl_instance_t* inst_ptr, uint32_t sector, uint32_t count)
 {
-    ESP_LOGV(TAG, "esp_jrnl_write (handle: %ld)", handle);
+    if (inst_ptr->touched_count > JRNL_TOUCHED_RANGES_MAX) {
+        return true;
+    }
+    for (uint8_t i = 0; i < inst_ptr->touched_count; i++) {
+        const esp_jrnl_sector_range_t* range = &inst_ptr->touched[i];
+        if (sector < range->first_sector + range->sector_count && range->first_sector < sector + count) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    if (buff == NULL) {
-        return ESP_ERR_INVALID_ARG;
+static void jrnl_range_touch(esp_jrnl_instance_t* inst_ptr, uint32_t sector, uint32_t count)
+{
+    if (inst_ptr->touched_count > JRNL_TOUCHED_RANGES_MAX) {
+        return;
     }
 
-    esp_err_t err = jrnl_check_handle(handle, __func__);
-    if (err != ESP_OK) {
-        return err;
+    //extend an overlapping or adjacent range (the same sectors get rewritten often, eg FAT and directory entries)
+    uint32_t end = sector + count;
+    for (uint8_t i = 0; i < inst_ptr->touched_count; i++) {
+        esp_jrnl_sector_range_t* range = &inst_ptr->touched[i];
+        uint32_t range_end = range->first_sector + range->sector_count;
+        if (range->first_sector <= end && sector <= range_end) {
+            uint32_t first = range->first_sector < sector ? range->first_sector : sector;
+            range->sector_count = (range_end > end ? range_end : end) - first;
+            range->first_sector = first;
+            return;
+        }
+    }
+
+    if (inst_ptr->touched_count < JRNL_TOUCHED_RANGES_MAX) {
+        inst_ptr->touched[inst_ptr->touched_count].first_sector = sector;
+        inst_ptr->touched[inst_ptr->touched_count].sector_count = count;
+        inst_ptr->touched_count++;
+    }
+    else {
+        inst_ptr->touched_count = JRNL_TOUCHED_RANGES_MAX + 1;
     }
+}
+
+/* completes the operation header by the checksums of the target data and of the header itself */
+static void jrnl_record_seal(const esp_jrnl_instance_t* inst_ptr, esp_jrnl_operation_t* oper_header, const uint8_t* data, size_t data_size)
+{
+    oper_header->header.crc32_data = jrnl_record_checksum(inst_ptr, data, data_size);
+    oper_header->crc32_header = jrnl_record_checksum(inst_ptr, (uint8_t *) &oper_header->header, sizeof(esp_jrnl_oper_header_t));
+}
+
+static esp_err_t jrnl_append(esp_jrnl_instance_t* inst_ptr, const uint8_t *buff, const uint32_t sector, const uint32_t count);
 
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[handle];
+static esp_err_t jrnl_write(esp_jrnl_instance_t* inst_ptr, const uint8_t *buff, const uint32_t sector, const uint32_t count)
+{
+    esp_err_t err = ESP_OK;
     uint32_t sector_size = inst_ptr->master.volume.disk_sector_size;
 
     //allow direct disk access when FS is being formatted or for testing reasons
     if (inst_ptr->master.status == ESP_JRNL_STATUS_FS_DIRECT) {
-        ESP_LOGV(TAG, "esp_jrnl_write (handle: %ld) - direct write", handle);
-        err = jrnl_erase_range_raw(inst_ptr, sector * sector_size, count * sector_size);
+        ESP_LOGV(TAG, "esp_jrnl_write (handle: %ld) - direct write", inst_ptr->handle);
+        bool erased = jrnl_range_erased(inst_ptr, sector, count);
+        jrnl_range_erased_drop(inst_ptr, sector, count);
+        if (!erased) {
+            err = jrnl_erase_range_raw(inst_ptr, sector * sector_size, count * sector_size);
+        }
         if (err == ESP_OK) {
             err = jrnl_write_raw(inst_ptr, sector * sector_size, buff, count * sector_size);
         }
@@ -733,102 +2346,437 @@ esp_err_t esp_jrnl_write(const esp_jrnl_handle_t handle, const uint8_t *buff, co
     }
 
     //write to the journaling store only if a transaction is open
-    if (inst_ptr->master.status == ESP_JRNL_STATUS_TRANS_OPEN) {
+    if (inst_ptr->master.status != ESP_JRNL_STATUS_TRANS_OPEN) {
+        //any other case must fail to avoid JRNL corruption
+        ESP_LOGE(TAG, "esp_jrnl_write() failed due to invalid transaction status (0x%08X)", inst_ptr->master.status);
+        return ESP_ERR_INVALID_STATE;
+    }
 
-        //operation: header sector + count*[data sector]
-        if ((inst_ptr->master.next_free_sector + 1 + count) < (inst_ptr->master.store_size_sectors - 1)) {
+    jrnl_trans_lock(inst_ptr);
+    int64_t start = jrnl_time_us();
+    err = jrnl_append(inst_ptr, buff, sector, count);
+    if (err == ESP_OK) {
+        inst_ptr->stats.sectors_journaled += count;
+    }
+    inst_ptr->stats.append_time_us += jrnl_time_us() - start;
+    jrnl_trans_unlock(inst_ptr);
 
-            esp_jrnl_operation_t *oper_header = NULL;
-            _lock_acquire(&inst_ptr->trans_lock);
+    return err;
+}
 
-            do {
-                //create header
-                oper_header = (esp_jrnl_operation_t *) calloc(1, sector_size);
-                if (oper_header == NULL) {
-                    err = ESP_ERR_NO_MEM;
-                    ESP_LOGE(TAG, "esp_jrnl_write failed (can't allocate the operation header, 0x%08X)", err);
-                    break;
-                }
-                oper_header->header.target_sector = sector;
-                oper_header->header.sector_count = count;
-                oper_header->header.crc32_data = esp_crc32_le(UINT32_MAX, buff, count * sector_size);
-                oper_header->crc32_header = esp_crc32_le(UINT32_MAX, (uint8_t *) &oper_header->header, sizeof(esp_jrnl_oper_header_t));
+/* appends the operation record of 'count' sectors written to 'sector' to the open transaction (transaction lock held by the caller) */
+static esp_err_t jrnl_append(esp_jrnl_instance_t* inst_ptr, const uint8_t *buff, const uint32_t sector, const uint32_t count)
+{
+    esp_err_t err = ESP_OK;
+    uint32_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    size_t data_size = count * sector_size;
+    esp_jrnl_operation_t *oper_header = NULL;
+    uint8_t* payload_buf = NULL;
 
-                size_t oper_addr =
-                        jrnl_get_target_disk_sector(inst_ptr, inst_ptr->master.next_free_sector) * sector_size;
-                size_t oper_size = (count + 1) * sector_size;
+    do {
+        //create header
+        oper_header = (esp_jrnl_operation_t *) jrnl_scratch_get(inst_ptr, JRNL_SCRATCH_HEADER, sector_size, true);
+        if (oper_header == NULL) {
+            err = ESP_ERR_NO_MEM;
+            ESP_LOGE(TAG, "esp_jrnl_write failed (can't allocate the operation header, 0x%08X)", err);
+            break;
+        }
+        oper_header->header.target_sector = sector;
+        oper_header->header.sector_count = count;
+        oper_header->header.record_type = ESP_JRNL_RECORD_DATA;
+        oper_header->header.codec = ESP_JRNL_CODEC_NONE;
+        oper_header->header.payload_size = data_size;
+
+        //encode the payload, used only if it saves at least 1 store sector (small payloads fit the header sector)
+        const uint8_t* payload = buff;
+        if (inst_ptr->payload_codec == ESP_JRNL_CODEC_LZF) {
+            size_t max_payload_size = (count - 1) * sector_size;
+            if (max_payload_size < JRNL_RECORD_INLINE_SIZE(sector_size)) {
+                max_payload_size = JRNL_RECORD_INLINE_SIZE(sector_size);
+            }
+            payload_buf = jrnl_scratch_get(inst_ptr, JRNL_SCRATCH_DATA, max_payload_size, false);
+            if (payload_buf == NULL) {
+                err = ESP_ERR_NO_MEM;
+                ESP_LOGE(TAG, "esp_jrnl_write failed (can't allocate the payload buffer, 0x%08X)", err);
+                break;
+            }
+            size_t payload_size = jrnl_lzf_compress(buff, data_size, payload_buf, max_payload_size, inst_ptr->codec_workmem);
+            if (payload_size > 0) {
+                oper_header->header.codec = ESP_JRNL_CODEC_LZF;
+                oper_header->header.payload_size = payload_size;
+                payload = payload_buf;
+            }
+        }
 
-                ESP_LOGV(TAG, "Writing jrnl oper header+data at sector %" PRIu32 " (size %" PRIu32 ")", sector, count);
+        //operation: header sector + payload sectors, the master record slots occupy the store end.
+        //records with inline payload get packed in the tail sector, which is flushed when full (or on commit)
+        uint32_t record_sectors = jrnl_record_sectors(&oper_header->header, sector_size);
+        size_t packed_size = JRNL_RECORD_PACKED_SIZE(oper_header->header.payload_size);
+        bool flush_tail = inst_ptr->tail_offset > 0 && (record_sectors > 1 || inst_ptr->tail_offset + packed_size > sector_size);
+        if ((inst_ptr->master.next_free_sector + (flush_tail ? 1 : 0) + record_sectors) > JRNL_STORE_DATA_SECTORS(&inst_ptr->master)) {
+            err = ESP_ERR_NO_MEM;
+            ESP_LOGE(TAG, "esp_jrnl_write failed (not enough space to complete the operation, 0x%08X)", err);
+            break;
+        }
 
-                //clean 1 + count
-                err = jrnl_erase_range_raw(inst_ptr, oper_addr, oper_size);
-                if (unlikely(err != ESP_OK)) {
-                    ESP_LOGE(TAG, "esp_jrnl_write failed (jrnl_erase_range_raw(): 0x%08X)", err);
-                    break;
-                }
+        if (flush_tail) {
+            err = jrnl_flush_tail(inst_ptr);
+            if (unlikely(err != ESP_OK)) {
+                ESP_LOGE(TAG, "esp_jrnl_write failed (jrnl_flush_tail(): 0x%08X)", err);
+                break;
+            }
+        }
 
-                //write header
-                err = jrnl_write_raw(inst_ptr, oper_addr, (void *) oper_header, sector_size);
-                if (unlikely(err != ESP_OK)) {
-                    ESP_LOGE(TAG, "esp_jrnl_write failed (jrnl_write_raw(): 0x%08X)", err);
-                    break;
-                }
+        if (record_sectors == 1) {
+            jrnl_record_seal(inst_ptr, oper_header, buff, data_size);
+            memcpy((uint8_t *) oper_header + sizeof(esp_jrnl_operation_t), payload, oper_header->header.payload_size);
+            memcpy(inst_ptr->tail_buf + inst_ptr->tail_offset, oper_header, packed_size);
 
-                //write data
-                err = jrnl_write_raw(inst_ptr, oper_addr + sector_size, (void *) buff, oper_size - sector_size);
-                if (unlikely(err != ESP_OK)) {
-                    ESP_LOGE(TAG, "esp_jrnl_write failed (jrnl_write_raw(): 0x%08X)", err);
-                    break;
-                }
+            ESP_LOGV(TAG, "Packing jrnl oper header+data at sector %" PRIu32 " (size %" PRIu32 ", tail offset %u)", sector, count, (unsigned)inst_ptr->tail_offset);
+            inst_ptr->tail_offset += packed_size;
+            jrnl_range_touch(inst_ptr, sector, count);
 
-                //update jrnl record
-                inst_ptr->master.next_free_sector += (1 + count);
-                err = jrnl_update_master(inst_ptr, &inst_ptr->master);
+            //the master record follows the flushed store sectors only
+            if (flush_tail) {
+                err = jrnl_update_master(inst_ptr);
                 if (err != ESP_OK) {
                     ESP_LOGE(TAG, "jrnl_write_internal() failed (0x%08X)", err);
                 }
-            } while(false);
+            }
+            break;
+        }
 
-            _lock_release(&inst_ptr->trans_lock);
-            free(oper_header);
+        size_t oper_addr = jrnl_get_target_disk_sector(inst_ptr, inst_ptr->master.next_free_sector) * sector_size;
+        size_t payload_sectors_size = (record_sectors - 1) * sector_size;
 
-            if (err != ESP_OK) {
-                return err;
+        if (payload == payload_buf) {
+            //pad the last encoded payload sector
+            memset(payload_buf + oper_header->header.payload_size, 0, payload_sectors_size - oper_header->header.payload_size);
+        }
+
+        ESP_LOGV(TAG, "Writing jrnl oper header+data at sector %" PRIu32 " (size %" PRIu32 ", record sectors %" PRIu32 ")", sector, count, record_sectors);
+
+        //clean the record space and write the data. With asynchronous store device the checksums get computed
+        //while the requests are in flight, the header goes last
+        err = jrnl_io_submit(inst_ptr, &inst_ptr->store_diskio, ESP_JRNL_DISKIO_OP_ERASE, oper_addr, NULL, record_sectors * sector_size);
+        if (unlikely(err != ESP_OK)) {
+            ESP_LOGE(TAG, "esp_jrnl_write failed (store erase: 0x%08X)", err);
+            break;
+        }
+
+        //the spare master slot for the update below gets erased along with the record space
+        bool spare_erase = !inst_ptr->master_spare_blank;
+        if (spare_erase) {
+            err = jrnl_io_submit(inst_ptr, &inst_ptr->store_diskio, ESP_JRNL_DISKIO_OP_ERASE, jrnl_master_spare_addr(inst_ptr), NULL, sector_size);
+            if (unlikely(err != ESP_OK)) {
+                ESP_LOGE(TAG, "esp_jrnl_write failed (master slot erase: 0x%08X)", err);
+                break;
             }
         }
-        else {
-            ESP_LOGE(TAG, "esp_jrnl_write failed (not enough space to complete the operation, 0x%08X)", ESP_ERR_NO_MEM);
-            return ESP_ERR_NO_MEM;
+
+        err = jrnl_io_submit(inst_ptr, &inst_ptr->store_diskio, ESP_JRNL_DISKIO_OP_WRITE, oper_addr + sector_size, (void *) payload, payload_sectors_size);
+        if (unlikely(err != ESP_OK)) {
+            ESP_LOGE(TAG, "esp_jrnl_write failed (store data write: 0x%08X)", err);
+            break;
+        }
+
+        jrnl_record_seal(inst_ptr, oper_header, buff, data_size);
+
+        err = jrnl_io_submit(inst_ptr, &inst_ptr->store_diskio, ESP_JRNL_DISKIO_OP_WRITE, oper_addr, (void *) oper_header, sector_size);
+        if (unlikely(err != ESP_OK)) {
+            ESP_LOGE(TAG, "esp_jrnl_write failed (store header write: 0x%08X)", err);
+            break;
+        }
+
+        //the whole record must be on the disk before the master record refers to it
+        err = jrnl_io_wait(inst_ptr);
+        if (unlikely(err != ESP_OK)) {
+            ESP_LOGE(TAG, "esp_jrnl_write failed (store record write: 0x%08X)", err);
+            break;
+        }
+        if (spare_erase) {
+            inst_ptr->master_spare_blank = true;
         }
+
+        //update jrnl record
+        jrnl_range_touch(inst_ptr, sector, count);
+        inst_ptr->master.next_free_sector += record_sectors;
+        err = jrnl_update_master(inst_ptr);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "jrnl_write_internal() failed (0x%08X)", err);
+        }
+    } while(false);
+
+    //no request may keep referring to the buffers (failure paths)
+    esp_err_t io_err = jrnl_io_wait(inst_ptr);
+    if (err == ESP_OK) {
+        err = io_err;
     }
-    else {
-        //any other case must fail to avoid JRNL corruption
-        ESP_LOGE(TAG, "esp_jrnl_write() failed due to invalid transaction status (0x%08X)", inst_ptr->master.status);
+    if (err == ESP_OK) {
+        jrnl_stats_max(&inst_ptr->stats.store_peak_sectors, jrnl_store_used_sectors(inst_ptr));
+    }
+
+    jrnl_scratch_put(inst_ptr, oper_header);
+    jrnl_scratch_put(inst_ptr, payload_buf);
+
+    return err;
+}
+
+esp_err_t esp_jrnl_write(const esp_jrnl_handle_t handle, const uint8_t *buff, const uint32_t sector, const uint32_t count)
+{
+    ESP_LOGV(TAG, "esp_jrnl_write (handle: %ld)", handle);
+
+    //a record of 0 sectors would terminate the packed records sequence (see JRNL_RECORD_PACKED_SIZE)
+    if (buff == NULL || count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    //read-only instance: neither journaled nor direct disk writes
+    if (inst_ptr->read_only) {
+        ESP_LOGE(TAG, "%s - instance mounted read-only", __func__);
+        jrnl_put_instance(inst_ptr);
         return ESP_ERR_INVALID_STATE;
     }
 
-    return ESP_OK;
+    //static instance: the longer writes get journaled as several records of the provisioned size
+    JRNL_TRACE_TIME(start);
+    size_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    uint32_t done = 0;
+    do {
+        uint32_t chunk = count - done;
+        if (inst_ptr->static_mem && chunk > inst_ptr->record_max_sectors) {
+            chunk = inst_ptr->record_max_sectors;
+        }
+        err = jrnl_write(inst_ptr, buff + done * sector_size, sector + done, chunk);
+        done += chunk;
+    } while (err == ESP_OK && done < count);
+    JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_RECORD_APPEND, sector, count, start);
+    jrnl_put_instance(inst_ptr);
+
+    return err;
+}
+
+static esp_err_t jrnl_trim(esp_jrnl_instance_t* inst_ptr, const uint32_t sector, const uint32_t count)
+{
+    if (count == 0 || (uint64_t)sector + count > JRNL_FS_SECTORS(&inst_ptr->master)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_OK;
+    uint32_t sector_size = inst_ptr->master.volume.disk_sector_size;
+
+    jrnl_trans_lock(inst_ptr);
+    int64_t start = jrnl_time_us();
+
+    do {
+        //file-system maintenance: discarded right away
+        if (inst_ptr->master.status == ESP_JRNL_STATUS_FS_DIRECT) {
+            ESP_LOGV(TAG, "esp_jrnl_trim (handle: %ld) - direct trim", inst_ptr->handle);
+            err = jrnl_trim_raw(inst_ptr, sector, count);
+            break;
+        }
+
+        if (inst_ptr->master.status != ESP_JRNL_STATUS_TRANS_OPEN) {
+            ESP_LOGE(TAG, "esp_jrnl_trim() failed due to invalid transaction status (0x%08X)", inst_ptr->master.status);
+            err = ESP_ERR_INVALID_STATE;
+            break;
+        }
+
+        //header-only record, packed in the tail sector
+        esp_jrnl_operation_t oper_header = {0};
+        oper_header.header.target_sector = sector;
+        oper_header.header.sector_count = count;
+        oper_header.header.record_type = ESP_JRNL_RECORD_TRIM;
+        oper_header.header.codec = ESP_JRNL_CODEC_NONE;
+        oper_header.crc32_header = jrnl_record_checksum(inst_ptr, (uint8_t *) &oper_header.header, sizeof(esp_jrnl_oper_header_t));
+
+        size_t packed_size = JRNL_RECORD_PACKED_SIZE(0);
+        bool flush_tail = inst_ptr->tail_offset + packed_size > sector_size;
+        if ((inst_ptr->master.next_free_sector + (flush_tail ? 1 : 0) + 1) > JRNL_STORE_DATA_SECTORS(&inst_ptr->master)) {
+            err = ESP_ERR_NO_MEM;
+            ESP_LOGE(TAG, "esp_jrnl_trim failed (not enough space to complete the operation, 0x%08X)", err);
+            break;
+        }
+
+        if (flush_tail) {
+            err = jrnl_flush_tail(inst_ptr);
+            if (unlikely(err != ESP_OK)) {
+                ESP_LOGE(TAG, "esp_jrnl_trim failed (jrnl_flush_tail(): 0x%08X)", err);
+                break;
+            }
+        }
+
+        memcpy(inst_ptr->tail_buf + inst_ptr->tail_offset, &oper_header, sizeof(oper_header));
+        inst_ptr->tail_offset += packed_size;
+
+        //the journaled reads of the discarded sectors go through the overlay
+        jrnl_range_touch(inst_ptr, sector, count);
+        jrnl_stats_max(&inst_ptr->stats.store_peak_sectors, jrnl_store_used_sectors(inst_ptr));
+
+        if (flush_tail) {
+            err = jrnl_update_master(inst_ptr);
+        }
+    } while(false);
+
+    inst_ptr->stats.append_time_us += jrnl_time_us() - start;
+    jrnl_trans_unlock(inst_ptr);
+
+    return err;
+}
+
+esp_err_t esp_jrnl_trim(const esp_jrnl_handle_t handle, const uint32_t sector, const uint32_t count)
+{
+    ESP_LOGV(TAG, "esp_jrnl_trim (handle: %ld, sector: %" PRIu32 ", count: %" PRIu32 ")", handle, sector, count);
+
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    //read-only instance: neither journaled nor direct disk writes
+    if (inst_ptr->read_only) {
+        ESP_LOGE(TAG, "%s - instance mounted read-only", __func__);
+        jrnl_put_instance(inst_ptr);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    JRNL_TRACE_TIME(start);
+    err = jrnl_trim(inst_ptr, sector, count);
+    JRNL_TRACE_SPAN(inst_ptr, ESP_JRNL_TRACE_RECORD_TRIM, sector, count, start);
+    jrnl_put_instance(inst_ptr);
+
+    return err;
 }
 
 //public reading API (redirection to wl_read)
+/*
+ * Applies the records of the open transaction to the target sectors content in 'dest' (read from the target disk), in the journal order:
+ * the store records first, then the ones packed in the tail buffer. The operations see their own writes and the ones batched before them
+ */
+static esp_err_t jrnl_read_overlay(esp_jrnl_instance_t* inst_ptr, uint32_t sector, uint8_t* dest, uint32_t count)
+{
+    uint32_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    uint8_t* header = jrnl_scratch_get(inst_ptr, JRNL_SCRATCH_HEADER, sector_size, false);
+    if (header == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint8_t* data = NULL;
+    size_t data_sectors = 0;
+    uint32_t header_sector = UINT32_MAX;
+    esp_jrnl_record_pos_t pos = {0};
+    bool in_tail = false;
+    esp_err_t err = ESP_OK;
+
+    while (true) {
+        esp_jrnl_operation_t* oper_header = NULL;
+        if (!in_tail) {
+            err = jrnl_record_load(inst_ptr, header, &header_sector, &pos, &oper_header);
+            if (err == ESP_ERR_NOT_FOUND) {
+                err = ESP_OK;
+                in_tail = true;
+                pos.sector_index = inst_ptr->master.next_free_sector;
+                pos.offset = 0;
+                continue;
+            }
+            if (err != ESP_OK) {
+                break;
+            }
+        }
+        else {
+            if (pos.offset >= inst_ptr->tail_offset) {
+                break;
+            }
+            oper_header = (esp_jrnl_operation_t*)(inst_ptr->tail_buf + pos.offset);
+        }
+
+        uint32_t record_first = oper_header->header.target_sector;
+        uint32_t first = record_first > sector ? record_first : sector;
+        uint32_t end = record_first + oper_header->header.sector_count;
+        if (end > sector + count) {
+            end = sector + count;
+        }
+
+        if (first < end) {
+            if (oper_header->header.record_type == ESP_JRNL_RECORD_TRIM) {
+                memset(dest + (first - sector) * sector_size, 0xFF, (end - first) * sector_size);
+            }
+            else {
+                if (oper_header->header.sector_count > data_sectors) {
+                    jrnl_scratch_put(inst_ptr, data);
+                    data_sectors = oper_header->header.sector_count;
+                    data = jrnl_scratch_get(inst_ptr, JRNL_SCRATCH_DATA, data_sectors * sector_size, false);
+                    if (data == NULL) {
+                        err = ESP_ERR_NO_MEM;
+                        break;
+                    }
+                }
+                err = jrnl_read_record_data(inst_ptr, (const uint8_t*)oper_header, &pos, data);
+                if (err != ESP_OK) {
+                    break;
+                }
+                memcpy(dest + (first - sector) * sector_size, data + (first - record_first) * sector_size, (end - first) * sector_size);
+            }
+        }
+
+        if (!in_tail) {
+            jrnl_record_next(header, sector_size, oper_header, &pos);
+        }
+        else {
+            pos.offset += JRNL_RECORD_PACKED_SIZE(oper_header->header.payload_size);
+        }
+    }
+
+    jrnl_scratch_put(inst_ptr, data);
+    jrnl_scratch_put(inst_ptr, header);
+
+    return err;
+}
+
 esp_err_t esp_jrnl_read(const esp_jrnl_handle_t handle, uint32_t sector, uint8_t *dest, uint32_t count)
 {
     if (dest == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t err = jrnl_check_handle(handle, __func__);
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    esp_err_t err = jrnl_get_instance(handle, __func__, &inst_ptr);
     if (err != ESP_OK) {
         return err;
     }
 
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[handle];
     uint32_t sector_size = inst_ptr->master.volume.disk_sector_size;
 
     //boundary check
-    if ((sector + count) >= inst_ptr->master.store_volume_offset_sector) {
-        return ESP_ERR_INVALID_SIZE;
+    if ((sector + count) > JRNL_FS_SECTORS(&inst_ptr->master)) {
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    //the target disk is up-to-date only after the pending commit is finished
+    else if ((err = jrnl_commit_settle(inst_ptr)) != ESP_OK) {
+        ESP_LOGE(TAG, "esp_jrnl_read failed, last commit failed (0x%08X)", err);
+    }
+    else {
+        err = jrnl_read_raw(inst_ptr, sector * sector_size, dest, count * sector_size);
+
+        //sectors written by the open transaction: their journaled content counts
+        jrnl_trans_lock(inst_ptr);
+        if (err == ESP_OK && inst_ptr->master.status == ESP_JRNL_STATUS_TRANS_OPEN && jrnl_range_touched(inst_ptr, sector, count)) {
+            err = jrnl_read_overlay(inst_ptr, sector, dest, count);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "esp_jrnl_read failed, journaled sectors not readable (0x%08X)", err);
+            }
+        }
+        jrnl_trans_unlock(inst_ptr);
     }
 
-    return jrnl_read_raw(inst_ptr, sector * sector_size, dest, count * sector_size);
+    jrnl_put_instance(inst_ptr);
+
+    return err;
 }
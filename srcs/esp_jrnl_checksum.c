@@ -0,0 +1,294 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_jrnl_checksum.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_crc.h"
+#endif
+
+/* CPU CRC instructions (host builds, incl. IDF linux target) */
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define JRNL_CRC32C_X86     1
+#endif
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define JRNL_CRC_ARM        1
+#endif
+
+#define JRNL_CRC32_POLY     0xEDB88320u     /* reflected CRC-32 polynomial */
+#define JRNL_CRC32C_POLY    0x82F63B78u     /* reflected CRC-32C polynomial */
+#define JRNL_CRC_SLICES     8
+
+static inline uint32_t jrnl_ld32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint32_t jrnl_rotl32(uint32_t x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+/*
+ * Slice-by-8 CRC tables (8 x 256 entries), allocated on the first use. Concurrent initializers build their own copy,
+ * the first one published wins (no waiting on other tasks)
+ */
+static _Atomic(uint32_t*) s_crc32c_tables = NULL;
+#if !defined(ESP_PLATFORM) && !defined(JRNL_CRC_ARM)
+static _Atomic(uint32_t*) s_crc32_tables = NULL;
+#endif
+#ifdef JRNL_CRC32C_X86
+static int s_crc32c_x86 = -1;       /* SSE4.2 support, -1 == not checked yet */
+#endif
+
+static int jrnl_crc_tables_init(_Atomic(uint32_t*)* tables, uint32_t poly)
+{
+    if (atomic_load(tables) != NULL) {
+        return 0;
+    }
+
+    uint32_t* t = (uint32_t*) malloc(JRNL_CRC_SLICES * 256 * sizeof(uint32_t));
+    if (t == NULL) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c >> 1) ^ (poly & (0u - (c & 1)));
+        }
+        t[i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int s = 1; s < JRNL_CRC_SLICES; s++) {
+            uint32_t prev = t[(s - 1) * 256 + i];
+            t[s * 256 + i] = (prev >> 8) ^ t[prev & 0xFF];
+        }
+    }
+
+    uint32_t* expected = NULL;
+    if (!atomic_compare_exchange_strong(tables, &expected, t)) {
+        free(t);
+    }
+
+    return 0;
+}
+
+/* reflected CRC register update (no pre/post inversion) */
+static uint32_t jrnl_crc_sliced(const uint32_t* t, uint32_t crc, const uint8_t* p, size_t len)
+{
+    while (len >= 8) {
+        uint32_t lo = crc ^ jrnl_ld32(p);
+        uint32_t hi = jrnl_ld32(p + 4);
+        crc = t[7 * 256 + (lo & 0xFF)] ^ t[6 * 256 + ((lo >> 8) & 0xFF)] ^
+              t[5 * 256 + ((lo >> 16) & 0xFF)] ^ t[4 * 256 + (lo >> 24)] ^
+              t[3 * 256 + (hi & 0xFF)] ^ t[2 * 256 + ((hi >> 8) & 0xFF)] ^
+              t[1 * 256 + ((hi >> 16) & 0xFF)] ^ t[hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ t[(crc ^ *p++) & 0xFF];
+    }
+    return crc;
+}
+
+#ifdef JRNL_CRC32C_X86
+__attribute__((target("sse4.2")))
+static uint32_t jrnl_crc32c_x86(uint32_t crc, const uint8_t* p, size_t len)
+{
+    uint64_t c = crc;
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        c = __builtin_ia32_crc32di(c, v);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)c;
+    while (len--) {
+        crc = __builtin_ia32_crc32qi(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+uint32_t jrnl_crc32_le(const uint8_t* data, size_t len)
+{
+#if defined(ESP_PLATFORM)
+    return esp_crc32_le(UINT32_MAX, data, len);
+#elif defined(JRNL_CRC_ARM)
+    uint32_t crc = 0;
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, data, sizeof(v));
+        crc = __crc32d(crc, v);
+        data += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32b(crc, *data++);
+    }
+    return ~crc;
+#else
+    //esp_crc32_le(UINT32_MAX, ...) semantics: zero initial register, inverted result
+    return ~jrnl_crc_sliced(atomic_load_explicit(&s_crc32_tables, memory_order_acquire), 0, data, len);
+#endif
+}
+
+uint32_t jrnl_crc32c_sw(const uint8_t* data, size_t len)
+{
+    return ~jrnl_crc_sliced(atomic_load_explicit(&s_crc32c_tables, memory_order_acquire), UINT32_MAX, data, len);
+}
+
+uint32_t jrnl_crc32c(const uint8_t* data, size_t len)
+{
+#if defined(JRNL_CRC32C_X86)
+    if (s_crc32c_x86 > 0) {
+        return ~jrnl_crc32c_x86(UINT32_MAX, data, len);
+    }
+#elif defined(JRNL_CRC_ARM)
+    uint32_t crc = UINT32_MAX;
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, data, sizeof(v));
+        crc = __crc32cd(crc, v);
+        data += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32cb(crc, *data++);
+    }
+    return ~crc;
+#endif
+    return jrnl_crc32c_sw(data, len);
+}
+
+#define XXH_PRIME32_1   0x9E3779B1u
+#define XXH_PRIME32_2   0x85EBCA77u
+#define XXH_PRIME32_3   0xC2B2AE3Du
+#define XXH_PRIME32_4   0x27D4EB2Fu
+#define XXH_PRIME32_5   0x165667B1u
+
+static inline uint32_t jrnl_xxh32_round(uint32_t acc, uint32_t lane)
+{
+    acc += lane * XXH_PRIME32_2;
+    return jrnl_rotl32(acc, 13) * XXH_PRIME32_1;
+}
+
+uint32_t jrnl_xxh32(const uint8_t* data, size_t len, uint32_t seed)
+{
+    const uint8_t* p = data;
+    const uint8_t* end = data + len;
+    uint32_t h;
+
+    if (len >= 16) {
+        //4 independent lanes, processed in parallel by superscalar CPUs
+        uint32_t v1 = seed + XXH_PRIME32_1 + XXH_PRIME32_2;
+        uint32_t v2 = seed + XXH_PRIME32_2;
+        uint32_t v3 = seed;
+        uint32_t v4 = seed - XXH_PRIME32_1;
+        const uint8_t* limit = end - 16;
+        do {
+            v1 = jrnl_xxh32_round(v1, jrnl_ld32(p));
+            v2 = jrnl_xxh32_round(v2, jrnl_ld32(p + 4));
+            v3 = jrnl_xxh32_round(v3, jrnl_ld32(p + 8));
+            v4 = jrnl_xxh32_round(v4, jrnl_ld32(p + 12));
+            p += 16;
+        } while (p <= limit);
+        h = jrnl_rotl32(v1, 1) + jrnl_rotl32(v2, 7) + jrnl_rotl32(v3, 12) + jrnl_rotl32(v4, 18);
+    }
+    else {
+        h = seed + XXH_PRIME32_5;
+    }
+
+    h += (uint32_t)len;
+
+    while (p + 4 <= end) {
+        h += jrnl_ld32(p) * XXH_PRIME32_3;
+        h = jrnl_rotl32(h, 17) * XXH_PRIME32_4;
+        p += 4;
+    }
+    while (p < end) {
+        h += (*p++) * XXH_PRIME32_5;
+        h = jrnl_rotl32(h, 11) * XXH_PRIME32_1;
+    }
+
+    h ^= h >> 15;
+    h *= XXH_PRIME32_2;
+    h ^= h >> 13;
+    h *= XXH_PRIME32_3;
+    h ^= h >> 16;
+
+    return h;
+}
+
+int jrnl_checksum_init(uint32_t engine)
+{
+    switch (engine) {
+        case JRNL_CHECKSUM_CRC32:
+#if !defined(ESP_PLATFORM) && !defined(JRNL_CRC_ARM)
+            return jrnl_crc_tables_init(&s_crc32_tables, JRNL_CRC32_POLY);
+#else
+            return 0;
+#endif
+        case JRNL_CHECKSUM_CRC32C:
+#ifdef JRNL_CRC32C_X86
+            if (s_crc32c_x86 < 0) {
+                s_crc32c_x86 = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+            }
+#endif
+            //the tables are needed by jrnl_crc32c_sw() anyway
+            return jrnl_crc_tables_init(&s_crc32c_tables, JRNL_CRC32C_POLY);
+        case JRNL_CHECKSUM_XXH32:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+uint32_t jrnl_checksum(uint32_t engine, const void* data, size_t len)
+{
+    switch (engine) {
+        case JRNL_CHECKSUM_CRC32:
+            return jrnl_crc32_le((const uint8_t*)data, len);
+        case JRNL_CHECKSUM_CRC32C:
+            return jrnl_crc32c((const uint8_t*)data, len);
+        case JRNL_CHECKSUM_XXH32:
+            return jrnl_xxh32((const uint8_t*)data, len, 0);
+        default:
+            return 0;
+    }
+}
+
+const char* jrnl_checksum_name(uint32_t engine)
+{
+    switch (engine) {
+        case JRNL_CHECKSUM_CRC32:
+            return "crc32";
+        case JRNL_CHECKSUM_CRC32C:
+            return "crc32c";
+        case JRNL_CHECKSUM_XXH32:
+            return "xxh32";
+        default:
+            return "unknown";
+    }
+}
+
+bool jrnl_checksum_accelerated(uint32_t engine)
+{
+#if defined(JRNL_CRC32C_X86)
+    return engine == JRNL_CHECKSUM_CRC32C && s_crc32c_x86 > 0;
+#elif defined(JRNL_CRC_ARM)
+    return engine == JRNL_CHECKSUM_CRC32 || engine == JRNL_CHECKSUM_CRC32C;
+#else
+    return false;
+#endif
+}
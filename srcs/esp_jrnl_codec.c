@@ -0,0 +1,163 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "esp_jrnl_codec.h"
+
+/*
+ * LZF-style stream format:
+ *  - 000LLLLL                      literal run of L+1 bytes (1-32) follows
+ *  - LLLOOOOO OOOOOOOO             back-reference of L+2 bytes (L = 1-6), offset O+1 (1-8192)
+ *  - 111OOOOO LLLLLLLL OOOOOOOO    back-reference of L+9 bytes (9-264), offset O+1
+ */
+
+#define JRNL_LZF_MAX_LIT        32
+#define JRNL_LZF_MAX_OFF        8192
+#define JRNL_LZF_MAX_REF        (255 + 7 + 2)
+#define JRNL_LZF_MIN_MATCH      3
+
+static inline uint32_t jrnl_lzf_hash(const uint8_t* p)
+{
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - JRNL_LZF_HASH_LOG);
+}
+
+static inline int jrnl_lzf_put_literals(const uint8_t* lit, size_t lit_len, uint8_t* out, size_t* op, size_t out_len)
+{
+    while (lit_len > 0) {
+        size_t run = lit_len > JRNL_LZF_MAX_LIT ? JRNL_LZF_MAX_LIT : lit_len;
+        if (*op + 1 + run > out_len) {
+            return 0;
+        }
+        out[(*op)++] = (uint8_t)(run - 1);
+        memcpy(out + *op, lit, run);
+        *op += run;
+        lit += run;
+        lit_len -= run;
+    }
+    return 1;
+}
+
+size_t jrnl_lzf_compress(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_len, uint32_t* workmem)
+{
+    if (in == NULL || out == NULL || workmem == NULL || in_len == 0) {
+        return 0;
+    }
+
+    //hash table keeps (input position + 1) of the latest 3-byte sequence, 0 == empty
+    memset(workmem, 0, JRNL_LZF_WORKMEM_SIZE);
+
+    size_t ip = 0;
+    size_t op = 0;
+    size_t anchor = 0;
+
+    while (ip + JRNL_LZF_MIN_MATCH <= in_len) {
+
+        uint32_t h = jrnl_lzf_hash(in + ip);
+        size_t ref = workmem[h];
+        workmem[h] = (uint32_t)(ip + 1);
+
+        if (ref == 0 || ip - (ref - 1) > JRNL_LZF_MAX_OFF || memcmp(in + ref - 1, in + ip, JRNL_LZF_MIN_MATCH) != 0) {
+            ip++;
+            continue;
+        }
+
+        ref--;
+        size_t max_len = in_len - ip;
+        if (max_len > JRNL_LZF_MAX_REF) {
+            max_len = JRNL_LZF_MAX_REF;
+        }
+        size_t len = JRNL_LZF_MIN_MATCH;
+        while (len < max_len && in[ref + len] == in[ip + len]) {
+            len++;
+        }
+
+        if (!jrnl_lzf_put_literals(in + anchor, ip - anchor, out, &op, out_len)) {
+            return 0;
+        }
+
+        size_t off = ip - ref - 1;
+        size_t l = len - 2;
+        if (op + (l < 7 ? 2 : 3) > out_len) {
+            return 0;
+        }
+        if (l < 7) {
+            out[op++] = (uint8_t)((l << 5) | (off >> 8));
+        }
+        else {
+            out[op++] = (uint8_t)((7 << 5) | (off >> 8));
+            out[op++] = (uint8_t)(l - 7);
+        }
+        out[op++] = (uint8_t)(off & 0xFF);
+
+        //index the positions covered by the match to find following repetitions
+        size_t match_end = ip + len;
+        for (ip++; ip < match_end && ip + JRNL_LZF_MIN_MATCH <= in_len; ip++) {
+            workmem[jrnl_lzf_hash(in + ip)] = (uint32_t)(ip + 1);
+        }
+        ip = match_end;
+        anchor = ip;
+    }
+
+    if (!jrnl_lzf_put_literals(in + anchor, in_len - anchor, out, &op, out_len)) {
+        return 0;
+    }
+
+    return op;
+}
+
+size_t jrnl_lzf_decompress(const uint8_t* in, size_t in_len, uint8_t* out, size_t out_len)
+{
+    if (in == NULL || out == NULL) {
+        return 0;
+    }
+
+    size_t ip = 0;
+    size_t op = 0;
+
+    while (ip < in_len) {
+        size_t ctrl = in[ip++];
+
+        //literal run
+        if (ctrl < JRNL_LZF_MAX_LIT) {
+            size_t run = ctrl + 1;
+            if (ip + run > in_len || op + run > out_len) {
+                return 0;
+            }
+            memcpy(out + op, in + ip, run);
+            ip += run;
+            op += run;
+            continue;
+        }
+
+        //back-reference
+        size_t len = ctrl >> 5;
+        if (len == 7) {
+            if (ip >= in_len) {
+                return 0;
+            }
+            len += in[ip++];
+        }
+        len += 2;
+
+        if (ip >= in_len) {
+            return 0;
+        }
+        size_t off = (((ctrl & 0x1F) << 8) | in[ip++]) + 1;
+        if (off > op || op + len > out_len) {
+            return 0;
+        }
+
+        //byte copy, the reference may overlap the output (runs)
+        const uint8_t* ref = out + op - off;
+        for (size_t i = 0; i < len; i++) {
+            out[op + i] = ref[i];
+        }
+        op += len;
+    }
+
+    return op;
+}
@@ -0,0 +1,289 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Diskio probe (esp_jrnl_config_t.diskio_probe): esp_jrnl_diskio_t wrapper sitting between the journaling instance
+ * and its target/store devices. Each device operation is forwarded to the original routine, counted and timed,
+ * and accounted to the disk region it starts in (file-system, store data, master record)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/lock.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_jrnl_internal.h"
+
+static const char* TAG = "esp_jrnl_probe";
+
+#define JRNL_PROBE_TARGET           0   /* device index of the journaled volume */
+#define JRNL_PROBE_STORE            1   /* device index of the journaling store (the same device unless separate) */
+#define JRNL_PROBE_DEVICES          2
+
+/* wrapper 'diskio_ctrl_handle' = instance handle and device index */
+#define JRNL_PROBE_HANDLE(jrnl_handle, device)  ((int32_t)((jrnl_handle) * JRNL_PROBE_DEVICES + (device)))
+#define JRNL_PROBE_INSTANCE(probe_handle)       ((probe_handle) / JRNL_PROBE_DEVICES)
+#define JRNL_PROBE_DEVICE(probe_handle)         ((probe_handle) % JRNL_PROBE_DEVICES)
+
+_Static_assert((int)ESP_JRNL_DISKIO_OP_READ == (int)ESP_JRNL_DISKIO_STAT_READ && (int)ESP_JRNL_DISKIO_OP_WRITE == (int)ESP_JRNL_DISKIO_STAT_WRITE &&
+               (int)ESP_JRNL_DISKIO_OP_ERASE == (int)ESP_JRNL_DISKIO_STAT_ERASE, "esp_jrnl_diskio_op_t must match esp_jrnl_diskio_stat_op_t");
+
+/**
+ * @brief Asynchronous request in flight (the completion gets forwarded to the original callback)
+ */
+typedef struct {
+    jrnl_diskio_probe_t* probe;
+    bool in_use;
+    uint8_t device;
+    uint8_t op;                             /* esp_jrnl_diskio_stat_op_t */
+    size_t addr;
+    size_t size;
+    int64_t start_us;
+    diskio_done done;                       /* original completion callback */
+    void* done_arg;
+} jrnl_probe_req_t;
+
+struct jrnl_diskio_probe {
+    esp_jrnl_instance_t* inst;              /* owner instance (current store boundary) */
+    esp_jrnl_diskio_t backend[JRNL_PROBE_DEVICES]; /* original device routines */
+    bool store_separate;                    /* the target device holds the file-system only */
+    uint32_t master_first_sector;           /* first master slot sector of the store device */
+    size_t sector_size;
+    _lock_t lock;                           /* 'stats' and 'reqs' */
+    esp_jrnl_diskio_stats_t stats;
+    jrnl_probe_req_t reqs[JRNL_PROBE_DEVICES * JRNL_IO_QUEUE_DEPTH];
+};
+
+static jrnl_diskio_probe_t* s_jrnl_probes[JRNL_MAX_HANDLES];
+
+static esp_jrnl_region_t jrnl_probe_region(const jrnl_diskio_probe_t* probe, int device, size_t addr)
+{
+    if (device == JRNL_PROBE_TARGET && probe->store_separate) {
+        return ESP_JRNL_REGION_FS;
+    }
+
+    //master slots never move, the store data start does (esp_jrnl_resize_store())
+    uint32_t sector = addr / probe->sector_size;
+    if (sector >= probe->master_first_sector) {
+        return ESP_JRNL_REGION_MASTER;
+    }
+    if (sector >= probe->inst->master.store_volume_offset_sector) {
+        return ESP_JRNL_REGION_STORE_DATA;
+    }
+    return ESP_JRNL_REGION_FS;
+}
+
+/* called with 'probe->lock' taken */
+static void jrnl_probe_account(jrnl_diskio_probe_t* probe, int device, esp_jrnl_diskio_stat_op_t op, size_t addr, size_t size, int64_t time_us, esp_err_t err)
+{
+    esp_jrnl_diskio_op_stats_t* stats = &probe->stats.ops[jrnl_probe_region(probe, device, addr)][op];
+    uint32_t time = time_us > 0 ? (uint32_t)time_us : 0;
+
+    size_t bucket = 0;
+    while (bucket < ESP_JRNL_DISKIO_LATENCY_BUCKETS - 1 && (time >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+
+    stats->count++;
+    stats->bytes += size;
+    stats->time_us += time;
+    if (time > stats->max_us) {
+        stats->max_us = time;
+    }
+    stats->latency_buckets[bucket]++;
+    if (err != ESP_OK) {
+        stats->errors++;
+    }
+}
+
+static esp_err_t jrnl_probe_sync(int32_t handle, esp_jrnl_diskio_stat_op_t op, size_t addr, void* buf, size_t size)
+{
+    jrnl_diskio_probe_t* probe = s_jrnl_probes[JRNL_PROBE_INSTANCE(handle)];
+    int device = JRNL_PROBE_DEVICE(handle);
+    const esp_jrnl_diskio_t* backend = &probe->backend[device];
+
+    int64_t start = jrnl_time_us();
+    esp_err_t err;
+    switch (op) {
+        case ESP_JRNL_DISKIO_STAT_READ:
+            err = backend->disk_read(backend->diskio_ctrl_handle, addr, buf, size);
+            break;
+        case ESP_JRNL_DISKIO_STAT_WRITE:
+            err = backend->disk_write(backend->diskio_ctrl_handle, addr, buf, size);
+            break;
+        case ESP_JRNL_DISKIO_STAT_TRIM:
+            err = backend->disk_trim(backend->diskio_ctrl_handle, addr, size);
+            break;
+        default:
+            err = backend->disk_erase_range(backend->diskio_ctrl_handle, addr, size);
+            break;
+    }
+    int64_t time = jrnl_time_us() - start;
+
+    _lock_acquire(&probe->lock);
+    jrnl_probe_account(probe, device, op, addr, size, time, err);
+    _lock_release(&probe->lock);
+
+    return err;
+}
+
+static esp_err_t jrnl_probe_read(int32_t handle, size_t src_addr, void* dest, size_t size)
+{
+    return jrnl_probe_sync(handle, ESP_JRNL_DISKIO_STAT_READ, src_addr, dest, size);
+}
+
+static esp_err_t jrnl_probe_write(int32_t handle, size_t dest_addr, const void* src, size_t size)
+{
+    return jrnl_probe_sync(handle, ESP_JRNL_DISKIO_STAT_WRITE, dest_addr, (void*)src, size);
+}
+
+static esp_err_t jrnl_probe_erase_range(int32_t handle, size_t start_addr, size_t size)
+{
+    return jrnl_probe_sync(handle, ESP_JRNL_DISKIO_STAT_ERASE, start_addr, NULL, size);
+}
+
+static esp_err_t jrnl_probe_trim(int32_t handle, size_t start_addr, size_t size)
+{
+    return jrnl_probe_sync(handle, ESP_JRNL_DISKIO_STAT_TRIM, start_addr, NULL, size);
+}
+
+static void jrnl_probe_done(void* arg, esp_err_t result)
+{
+    jrnl_probe_req_t* req = (jrnl_probe_req_t*)arg;
+    jrnl_diskio_probe_t* probe = req->probe;
+    int64_t time = jrnl_time_us() - req->start_us;
+
+    _lock_acquire(&probe->lock);
+    jrnl_probe_account(probe, req->device, (esp_jrnl_diskio_stat_op_t)req->op, req->addr, req->size, time, result);
+    diskio_done done = req->done;
+    void* done_arg = req->done_arg;
+    req->in_use = false;
+    _lock_release(&probe->lock);
+
+    done(done_arg, result);
+}
+
+static esp_err_t jrnl_probe_submit(int32_t handle, const esp_jrnl_diskio_req_t* req)
+{
+    jrnl_diskio_probe_t* probe = s_jrnl_probes[JRNL_PROBE_INSTANCE(handle)];
+    int device = JRNL_PROBE_DEVICE(handle);
+    const esp_jrnl_diskio_t* backend = &probe->backend[device];
+
+    //request context, the instance keeps at most JRNL_IO_QUEUE_DEPTH requests in flight
+    jrnl_probe_req_t* probe_req = NULL;
+    _lock_acquire(&probe->lock);
+    for (size_t i = 0; i < sizeof(probe->reqs) / sizeof(probe->reqs[0]); i++) {
+        if (!probe->reqs[i].in_use) {
+            probe_req = &probe->reqs[i];
+            probe_req->in_use = true;
+            break;
+        }
+    }
+    _lock_release(&probe->lock);
+
+    if (probe_req == NULL) {
+        ESP_LOGE(TAG, "No free request slot (handle %ld)", (long)handle);
+        return ESP_ERR_NO_MEM;
+    }
+
+    probe_req->probe = probe;
+    probe_req->device = device;
+    probe_req->op = req->op;
+    probe_req->addr = req->addr;
+    probe_req->size = req->size;
+    probe_req->done = req->done;
+    probe_req->done_arg = req->done_arg;
+    probe_req->start_us = jrnl_time_us();
+
+    esp_jrnl_diskio_req_t fwd_req = *req;
+    fwd_req.done = jrnl_probe_done;
+    fwd_req.done_arg = probe_req;
+
+    esp_err_t err = backend->disk_submit(backend->diskio_ctrl_handle, &fwd_req);
+    if (err != ESP_OK) {
+        //not accepted, no completion comes
+        _lock_acquire(&probe->lock);
+        jrnl_probe_account(probe, device, (esp_jrnl_diskio_stat_op_t)req->op, req->addr, 0, 0, err);
+        probe_req->in_use = false;
+        _lock_release(&probe->lock);
+    }
+
+    return err;
+}
+
+/* wrapper with the capabilities of the original device */
+static void jrnl_probe_wrap(esp_jrnl_diskio_t* diskio, esp_jrnl_handle_t jrnl_handle, int device)
+{
+    diskio->diskio_ctrl_handle = JRNL_PROBE_HANDLE(jrnl_handle, device);
+    diskio->disk_read = jrnl_probe_read;
+    diskio->disk_write = jrnl_probe_write;
+    diskio->disk_erase_range = jrnl_probe_erase_range;
+    diskio->disk_trim = diskio->disk_trim != NULL ? jrnl_probe_trim : NULL;
+    diskio->disk_submit = diskio->disk_submit != NULL ? jrnl_probe_submit : NULL;
+}
+
+esp_err_t jrnl_probe_attach(esp_jrnl_instance_t* inst_ptr, bool store_separate, const esp_jrnl_volume_t* store_volume)
+{
+    jrnl_diskio_probe_t* probe = (jrnl_diskio_probe_t*)calloc(1, sizeof(jrnl_diskio_probe_t));
+    if (probe == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    _lock_init(&probe->lock);
+    probe->inst = inst_ptr;
+    probe->backend[JRNL_PROBE_TARGET] = inst_ptr->diskio;
+    probe->backend[JRNL_PROBE_STORE] = inst_ptr->store_diskio;
+    probe->store_separate = store_separate;
+    probe->sector_size = store_volume->disk_sector_size;
+    probe->master_first_sector = store_volume->volume_size / store_volume->disk_sector_size - JRNL_MASTER_SLOT_COUNT;
+
+    s_jrnl_probes[inst_ptr->handle] = probe;
+    inst_ptr->probe = probe;
+
+    jrnl_probe_wrap(&inst_ptr->diskio, inst_ptr->handle, JRNL_PROBE_TARGET);
+    jrnl_probe_wrap(&inst_ptr->store_diskio, inst_ptr->handle, JRNL_PROBE_STORE);
+
+    return ESP_OK;
+}
+
+void jrnl_probe_detach(esp_jrnl_instance_t* inst_ptr)
+{
+    jrnl_diskio_probe_t* probe = inst_ptr->probe;
+    if (probe == NULL) {
+        return;
+    }
+
+    inst_ptr->diskio = probe->backend[JRNL_PROBE_TARGET];
+    inst_ptr->store_diskio = probe->backend[JRNL_PROBE_STORE];
+    inst_ptr->probe = NULL;
+    s_jrnl_probes[inst_ptr->handle] = NULL;
+
+    _lock_close(&probe->lock);
+    free(probe);
+}
+
+const esp_jrnl_diskio_t* jrnl_probe_backend(const esp_jrnl_instance_t* inst_ptr, bool store)
+{
+    return &inst_ptr->probe->backend[store ? JRNL_PROBE_STORE : JRNL_PROBE_TARGET];
+}
+
+void jrnl_probe_get_stats(esp_jrnl_instance_t* inst_ptr, esp_jrnl_diskio_stats_t* stats)
+{
+    jrnl_diskio_probe_t* probe = inst_ptr->probe;
+
+    _lock_acquire(&probe->lock);
+    memcpy(stats, &probe->stats, sizeof(esp_jrnl_diskio_stats_t));
+    _lock_release(&probe->lock);
+}
+
+void jrnl_probe_reset_stats(esp_jrnl_instance_t* inst_ptr)
+{
+    jrnl_diskio_probe_t* probe = inst_ptr->probe;
+
+    _lock_acquire(&probe->lock);
+    memset(&probe->stats, 0, sizeof(esp_jrnl_diskio_stats_t));
+    _lock_release(&probe->lock);
+}
@@ -0,0 +1,154 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Shared commit executor: replays committed journaling transactions on worker tasks (one per CPU core),
+ * so the commits of independently mounted volumes (eg SPI Flash and SD card) run in parallel.
+ * Each instance has max 1 commit pending (the next esp_jrnl_start() waits for it), which keeps the per-volume ordering.
+ */
+
+#include <sys/lock.h>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_jrnl_internal.h"
+
+#ifdef CONFIG_ESP_JRNL_COMMIT_EXECUTOR
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#define JRNL_COMMIT_IDLE_BIT    BIT0    /* no commit pending for the instance */
+
+static const char* TAG = "esp_jrnl_exec";
+static _lock_t s_executor_lock;
+static QueueHandle_t s_commit_queue = NULL;
+
+static void jrnl_commit_worker(void* arg)
+{
+    esp_jrnl_instance_t* inst_ptr = NULL;
+
+    for (;;) {
+        if (xQueueReceive(s_commit_queue, &inst_ptr, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        ESP_LOGD(TAG, "Committing jrnl instance %ld (core %d)", inst_ptr->handle, xPortGetCoreID());
+
+        esp_err_t err = jrnl_replay(inst_ptr);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Asynchronous commit of jrnl instance %ld failed (0x%08X)", inst_ptr->handle, err);
+        }
+
+        //publish the result and release the reference taken by jrnl_executor_submit()
+        inst_ptr->commit_err = err;
+        xEventGroupSetBits(inst_ptr->commit_events, JRNL_COMMIT_IDLE_BIT);
+        jrnl_put_instance(inst_ptr);
+    }
+}
+
+esp_err_t jrnl_executor_init(void)
+{
+    esp_err_t err = ESP_OK;
+
+    _lock_acquire(&s_executor_lock);
+
+    if (s_commit_queue == NULL) {
+
+        //one slot per instance is enough, each instance has max 1 commit pending
+        QueueHandle_t queue = xQueueCreate(JRNL_MAX_HANDLES, sizeof(esp_jrnl_instance_t*));
+        if (queue == NULL) {
+            err = ESP_ERR_NO_MEM;
+        }
+        else {
+            s_commit_queue = queue;
+
+            //the workers never exit, the executor is shared by all the instances for the application lifetime
+            BaseType_t workers = 0;
+            for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++) {
+                if (xTaskCreatePinnedToCore(jrnl_commit_worker, "jrnl_commit", CONFIG_ESP_JRNL_COMMIT_EXECUTOR_STACK_SIZE, NULL,
+                                            CONFIG_ESP_JRNL_COMMIT_EXECUTOR_PRIORITY, NULL, core) == pdPASS) {
+                    workers++;
+                }
+                else {
+                    ESP_LOGW(TAG, "Failed to create commit worker on core %d", core);
+                }
+            }
+
+            if (workers == 0) {
+                vQueueDelete(s_commit_queue);
+                s_commit_queue = NULL;
+                err = ESP_ERR_NO_MEM;
+            }
+        }
+    }
+
+    _lock_release(&s_executor_lock);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "jrnl_executor_init failed (0x%08X)", err);
+    }
+
+    return err;
+}
+
+esp_err_t jrnl_commit_ctx_init(esp_jrnl_instance_t* inst_ptr)
+{
+    inst_ptr->commit_err = ESP_OK;
+    inst_ptr->commit_events = xEventGroupCreate();
+    if (inst_ptr->commit_events == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    xEventGroupSetBits(inst_ptr->commit_events, JRNL_COMMIT_IDLE_BIT);
+
+    return ESP_OK;
+}
+
+void jrnl_commit_ctx_deinit(esp_jrnl_instance_t* inst_ptr)
+{
+    if (inst_ptr->commit_events != NULL) {
+        vEventGroupDelete(inst_ptr->commit_events);
+        inst_ptr->commit_events = NULL;
+    }
+}
+
+esp_err_t jrnl_executor_submit(esp_jrnl_instance_t* inst_ptr)
+{
+    //the worker needs its own instance reference, fails if the instance is being unmounted
+    esp_jrnl_instance_t* worker_ref = NULL;
+    esp_err_t err = jrnl_get_instance(inst_ptr->handle, __func__, &worker_ref);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    xEventGroupClearBits(inst_ptr->commit_events, JRNL_COMMIT_IDLE_BIT);
+
+    if (xQueueSend(s_commit_queue, &worker_ref, 0) != pdTRUE) {
+        xEventGroupSetBits(inst_ptr->commit_events, JRNL_COMMIT_IDLE_BIT);
+        jrnl_put_instance(worker_ref);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t jrnl_commit_wait(esp_jrnl_instance_t* inst_ptr)
+{
+    if (inst_ptr->commit_events == NULL) {
+        return ESP_OK;
+    }
+
+    xEventGroupWaitBits(inst_ptr->commit_events, JRNL_COMMIT_IDLE_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+
+    //the result is reported once
+    esp_err_t err = inst_ptr->commit_err;
+    inst_ptr->commit_err = ESP_OK;
+
+    return err;
+}
+
+#endif //CONFIG_ESP_JRNL_COMMIT_EXECUTOR
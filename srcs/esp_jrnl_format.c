@@ -0,0 +1,161 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Journaling store format helpers (see esp_jrnl_format.h), used by the component and by the host tools
+ */
+
+#include <string.h>
+#include "esp_jrnl_format.h"
+#include "esp_jrnl_checksum.h"
+#include "esp_jrnl_codec.h"
+
+uint32_t jrnl_master_crc32(const esp_jrnl_master_t* master)
+{
+    if (jrnl_checksum_init(JRNL_CHECKSUM_CRC32) != 0) {
+        return 0;
+    }
+    return jrnl_checksum(JRNL_CHECKSUM_CRC32, master, offsetof(esp_jrnl_master_t, crc32));
+}
+
+bool jrnl_master_slot_valid(const esp_jrnl_master_t* slot_master, uint32_t slot)
+{
+    return slot_master->jrnl_magic_mark == JRNL_STORE_MARKER &&
+           slot_master->crc32 == jrnl_master_crc32(slot_master) &&
+           JRNL_MASTER_SLOT(slot_master->generation) == slot;
+}
+
+uint32_t jrnl_master_advance(esp_jrnl_master_t* master)
+{
+    master->generation++;
+    master->crc32 = jrnl_master_crc32(master);
+    return JRNL_MASTER_SLOT(master->generation);
+}
+
+bool jrnl_master_select(const esp_jrnl_master_t* slot_master, uint32_t slot, bool* found, esp_jrnl_master_t* master)
+{
+    if (!jrnl_master_slot_valid(slot_master, slot)) {
+        return false;
+    }
+
+    if (!*found || jrnl_master_newer(slot_master, master)) {
+        memcpy(master, slot_master, sizeof(esp_jrnl_master_t));
+        *found = true;
+    }
+
+    return true;
+}
+
+/* newest valid master record of the store device image of given sector size */
+static int jrnl_find_master_slot(const uint8_t* image, size_t image_size, size_t sector_size, esp_jrnl_master_t* master)
+{
+    bool found = false;
+
+    if (image_size < JRNL_MASTER_SLOT_COUNT * sector_size) {
+        return JRNL_IMAGE_ERR_NO_MASTER;
+    }
+
+    for (uint32_t slot = 0; slot < JRNL_MASTER_SLOT_COUNT; slot++) {
+        //copied out, the image buffer is not aligned for the record
+        esp_jrnl_master_t slot_master;
+        memcpy(&slot_master, image + image_size - (slot + 1) * sector_size, sizeof(slot_master));
+        if (slot_master.store_volume.disk_sector_size == sector_size) {
+            jrnl_master_select(&slot_master, slot, &found, master);
+        }
+    }
+
+    //the slot of a valid record follows from its generation
+    return found ? (int)JRNL_MASTER_SLOT(master->generation) : JRNL_IMAGE_ERR_NO_MASTER;
+}
+
+int jrnl_find_master_in_image(const uint8_t* image, size_t image_size, size_t sector_size, esp_jrnl_master_t* master)
+{
+    int slot = JRNL_IMAGE_ERR_NO_MASTER;
+
+    if (sector_size != 0) {
+        slot = jrnl_find_master_slot(image, image_size, sector_size, master);
+    } else {
+        for (sector_size = 512; sector_size <= 4096 && slot < 0; sector_size *= 2) {
+            slot = jrnl_find_master_slot(image, image_size, sector_size, master);
+        }
+    }
+    if (slot < 0) {
+        return slot;
+    }
+
+    //same checks as the mount: the store within the device, one sector size, known checksum engine
+    sector_size = master->store_volume.disk_sector_size;
+    uint64_t store_end = ((uint64_t)master->store_volume_offset_sector + master->store_size_sectors) * sector_size;
+    if (master->store_size_sectors <= JRNL_MASTER_SLOT_COUNT || store_end > image_size ||
+        master->volume.disk_sector_size != sector_size || master->next_free_sector > JRNL_STORE_DATA_SECTORS(master) ||
+        jrnl_checksum_init(master->checksum) != 0) {
+        return JRNL_IMAGE_ERR_GEOMETRY;
+    }
+
+    return slot;
+}
+
+void jrnl_record_next(const uint8_t* sector_buf, size_t sector_size, const esp_jrnl_operation_t* oper, esp_jrnl_record_pos_t* pos)
+{
+    uint32_t record_sectors = jrnl_record_sectors(&oper->header, sector_size);
+    if (record_sectors == 1) {
+        size_t next_offset = pos->offset + JRNL_RECORD_PACKED_SIZE(oper->header.payload_size);
+        if (next_offset + sizeof(esp_jrnl_operation_t) <= sector_size &&
+            ((const esp_jrnl_operation_t*)(sector_buf + next_offset))->header.sector_count != 0) {
+            pos->offset = next_offset;
+            return;
+        }
+    }
+
+    pos->sector_index += record_sectors;
+    pos->offset = 0;
+}
+
+int jrnl_record_decode(const esp_jrnl_oper_header_t* header, const uint8_t* payload, uint8_t* data, size_t sector_size)
+{
+    size_t data_size = (size_t)header->sector_count * sector_size;
+
+    if (header->record_type != ESP_JRNL_RECORD_DATA) {
+        return JRNL_RECORD_DECODE_ERR_TYPE;
+    }
+
+    switch (header->codec) {
+        case JRNL_CODEC_NONE:
+            if (header->payload_size != data_size) {
+                return JRNL_RECORD_DECODE_ERR_SIZE;
+            }
+            if (payload != data) {
+                memcpy(data, payload, data_size);
+            }
+            return JRNL_RECORD_DECODE_OK;
+        case JRNL_CODEC_LZF:
+            return jrnl_lzf_decompress(payload, header->payload_size, data, data_size) == data_size ? JRNL_RECORD_DECODE_OK : JRNL_RECORD_DECODE_ERR_DATA;
+        default:
+            return JRNL_RECORD_DECODE_ERR_TYPE;
+    }
+}
+
+const char* jrnl_status_name(uint32_t status)
+{
+    switch (status) {
+        case ESP_JRNL_STATUS_FS_INIT: return "Initialize/FS-direct";
+        case ESP_JRNL_STATUS_TRANS_READY: return "Ready";
+        case ESP_JRNL_STATUS_TRANS_OPEN: return "Open";
+        case ESP_JRNL_STATUS_TRANS_COMMIT: return "Commit";
+    }
+
+    return "Unknown";
+}
+
+const char* jrnl_record_type_name(uint32_t record_type)
+{
+    switch (record_type) {
+        case ESP_JRNL_RECORD_DATA: return "Data";
+        case ESP_JRNL_RECORD_TRIM: return "Trim";
+    }
+
+    return "Unknown";
+}
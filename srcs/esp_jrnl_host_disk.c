@@ -0,0 +1,390 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/lock.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_jrnl_host_disk.h"
+
+static const char* TAG = "esp_jrnl_host_disk";
+
+typedef struct {
+    esp_jrnl_host_disk_config_t cfg;        /* 'image_path' not kept (NULL) */
+    size_t size;                            /* disk size in bytes */
+    uint8_t* mem;                           /* RAM disk contents, NULL for the disk image */
+    int fd;                                 /* disk image file descriptor, -1 for the RAM disk */
+    uint8_t* scratch;                       /* one sector, for NOR programming and erasing of the disk image */
+    esp_jrnl_host_disk_stats_t stats;
+    _lock_t lock;                           /* serializes the operations (commit executor vs the caller) */
+} esp_jrnl_host_disk_t;
+
+static esp_jrnl_host_disk_t* s_host_disks[ESP_JRNL_HOST_DISK_MAX_HANDLES] = { NULL };
+static _lock_t s_host_disks_lock;
+
+static esp_jrnl_host_disk_t* host_disk_get(int32_t handle)
+{
+    if (handle < 0 || handle >= ESP_JRNL_HOST_DISK_MAX_HANDLES) {
+        return NULL;
+    }
+    return s_host_disks[handle];
+}
+
+static void host_disk_delay(uint32_t unit_us, size_t units)
+{
+    if (unit_us > 0 && units > 0) {
+        usleep((useconds_t)(unit_us * units));
+    }
+}
+
+static esp_err_t host_disk_media_read(esp_jrnl_host_disk_t* disk, size_t addr, void* dest, size_t size)
+{
+    if (disk->mem != NULL) {
+        memcpy(dest, disk->mem + addr, size);
+        return ESP_OK;
+    }
+
+    uint8_t* ptr = (uint8_t*)dest;
+    while (size > 0) {
+        ssize_t res = pread(disk->fd, ptr, size, (off_t)addr);
+        if (res <= 0) {
+            ESP_LOGE(TAG, "disk image read failed at %u", (unsigned)addr);
+            return ESP_FAIL;
+        }
+        ptr += res;
+        addr += (size_t)res;
+        size -= (size_t)res;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t host_disk_media_write(esp_jrnl_host_disk_t* disk, size_t addr, const void* src, size_t size)
+{
+    if (disk->mem != NULL) {
+        memcpy(disk->mem + addr, src, size);
+        return ESP_OK;
+    }
+
+    const uint8_t* ptr = (const uint8_t*)src;
+    while (size > 0) {
+        ssize_t res = pwrite(disk->fd, ptr, size, (off_t)addr);
+        if (res <= 0) {
+            ESP_LOGE(TAG, "disk image write failed at %u", (unsigned)addr);
+            return ESP_FAIL;
+        }
+        ptr += res;
+        addr += (size_t)res;
+        size -= (size_t)res;
+    }
+    return ESP_OK;
+}
+
+/* NOR flash programming: bits can go 1 -> 0 only */
+static esp_err_t host_disk_program(esp_jrnl_host_disk_t* disk, size_t addr, const uint8_t* src, size_t size)
+{
+    while (size > 0) {
+        size_t chunk = size < disk->cfg.sector_size ? size : disk->cfg.sector_size;
+        uint8_t* cur = disk->mem != NULL ? disk->mem + addr : disk->scratch;
+        if (disk->mem == NULL) {
+            esp_err_t err = host_disk_media_read(disk, addr, cur, chunk);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+
+        bool unerased = false;
+        for (size_t i = 0; i < chunk; i++) {
+            unerased |= (cur[i] & src[i]) != src[i];
+            cur[i] &= src[i];
+        }
+        if (unerased) {
+            disk->stats.unerased_writes++;
+            ESP_LOGW(TAG, "NOR write over non-erased data at %u", (unsigned)addr);
+        }
+
+        if (disk->mem == NULL) {
+            esp_err_t err = host_disk_media_write(disk, addr, cur, chunk);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        addr += chunk;
+        src += chunk;
+        size -= chunk;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t host_disk_fill_erased(esp_jrnl_host_disk_t* disk, size_t addr, size_t size)
+{
+    if (disk->mem != NULL) {
+        memset(disk->mem + addr, 0xFF, size);
+        return ESP_OK;
+    }
+
+    memset(disk->scratch, 0xFF, disk->cfg.sector_size);
+    while (size > 0) {
+        size_t chunk = size < disk->cfg.sector_size ? size : disk->cfg.sector_size;
+        esp_err_t err = host_disk_media_write(disk, addr, disk->scratch, chunk);
+        if (err != ESP_OK) {
+            return err;
+        }
+        addr += chunk;
+        size -= chunk;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t host_disk_read(int32_t handle, size_t src_addr, void *dest, size_t size)
+{
+    esp_jrnl_host_disk_t* disk = host_disk_get(handle);
+    if (disk == NULL || dest == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (src_addr > disk->size || size > disk->size - src_addr) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    _lock_acquire(&disk->lock);
+    esp_err_t err = host_disk_media_read(disk, src_addr, dest, size);
+    disk->stats.read_ops++;
+    disk->stats.bytes_read += size;
+    _lock_release(&disk->lock);
+
+    host_disk_delay(disk->cfg.read_latency_us, (size + disk->cfg.sector_size - 1) / disk->cfg.sector_size);
+
+    return err;
+}
+
+static esp_err_t host_disk_write(int32_t handle, size_t dest_addr, const void *src, size_t size)
+{
+    esp_jrnl_host_disk_t* disk = host_disk_get(handle);
+    if (disk == NULL || src == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (dest_addr > disk->size || size > disk->size - dest_addr) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    _lock_acquire(&disk->lock);
+    esp_err_t err;
+    if (disk->cfg.mode == ESP_JRNL_HOST_DISK_NOR) {
+        err = host_disk_program(disk, dest_addr, (const uint8_t*)src, size);
+    }
+    else {
+        err = host_disk_media_write(disk, dest_addr, src, size);
+    }
+    disk->stats.write_ops++;
+    disk->stats.bytes_written += size;
+    _lock_release(&disk->lock);
+
+    host_disk_delay(disk->cfg.write_latency_us, (size + disk->cfg.sector_size - 1) / disk->cfg.sector_size);
+
+    return err;
+}
+
+static esp_err_t host_disk_erase_range(int32_t handle, size_t start_addr, size_t size)
+{
+    esp_jrnl_host_disk_t* disk = host_disk_get(handle);
+    if (disk == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (start_addr % disk->cfg.sector_size != 0 || size % disk->cfg.sector_size != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (start_addr > disk->size || size > disk->size - start_addr) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    //erase blocks touched. The data outside the range survives the partial block erase (WL-like read-modify-write),
+    //costing the rewrite of the block remainder
+    size_t block_size = disk->cfg.erase_block_size;
+    size_t blocks = 0;
+    size_t rewritten_sectors = 0;
+    if (size > 0) {
+        size_t first_block = start_addr / block_size;
+        size_t end_block = (start_addr + size + block_size - 1) / block_size;
+        blocks = end_block - first_block;
+        if (disk->cfg.mode == ESP_JRNL_HOST_DISK_NOR) {
+            rewritten_sectors = (blocks * block_size - size) / disk->cfg.sector_size;
+        }
+    }
+
+    _lock_acquire(&disk->lock);
+    esp_err_t err = host_disk_fill_erased(disk, start_addr, size);
+    disk->stats.erase_ops++;
+    disk->stats.bytes_erased += size;
+    disk->stats.block_erases += blocks;
+    _lock_release(&disk->lock);
+
+    host_disk_delay(disk->cfg.erase_latency_us, blocks);
+    host_disk_delay(disk->cfg.write_latency_us, rewritten_sectors);
+
+    return err;
+}
+
+static void host_disk_free(esp_jrnl_host_disk_t* disk)
+{
+    if (disk->fd >= 0) {
+        close(disk->fd);
+    }
+    _lock_close(&disk->lock);
+    free(disk->scratch);
+    free(disk->mem);
+    free(disk);
+}
+
+esp_err_t esp_jrnl_host_disk_create(const esp_jrnl_host_disk_config_t* config, int32_t* out_handle)
+{
+    if (config == NULL || out_handle == NULL || config->sector_size == 0 || config->sector_count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t block_size = config->erase_block_size == 0 ? config->sector_size : config->erase_block_size;
+    if (block_size % config->sector_size != 0 || config->sector_count > SIZE_MAX / config->sector_size) {
+        ESP_LOGE(TAG, "Invalid disk geometry (sector size %u, sector count %u, erase block %u)",
+                 (unsigned)config->sector_size, (unsigned)config->sector_count, (unsigned)config->erase_block_size);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_jrnl_host_disk_t* disk = (esp_jrnl_host_disk_t*) calloc(1, sizeof(esp_jrnl_host_disk_t));
+    if (disk == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    disk->cfg = *config;
+    disk->cfg.image_path = NULL;
+    disk->cfg.erase_block_size = block_size;
+    disk->size = config->sector_size * config->sector_count;
+    disk->fd = -1;
+    _lock_init(&disk->lock);
+
+    esp_err_t err = ESP_OK;
+
+    do {
+        disk->scratch = (uint8_t*) malloc(config->sector_size);
+        if (disk->scratch == NULL) {
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+
+        if (config->image_path == NULL) {
+            disk->mem = (uint8_t*) malloc(disk->size);
+            if (disk->mem == NULL) {
+                ESP_LOGE(TAG, "Failed to allocate %u bytes for the RAM disk", (unsigned)disk->size);
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
+            memset(disk->mem, 0xFF, disk->size);
+            break;
+        }
+
+        disk->fd = open(config->image_path, O_RDWR | O_CREAT, 0644);
+        if (disk->fd < 0) {
+            ESP_LOGE(TAG, "Failed to open disk image %s", config->image_path);
+            err = ESP_FAIL;
+            break;
+        }
+
+        //a new (or shorter) image grows as an erased device
+        struct stat st;
+        if (fstat(disk->fd, &st) != 0) {
+            err = ESP_FAIL;
+            break;
+        }
+        if ((size_t)st.st_size < disk->size) {
+            size_t image_size = (size_t)st.st_size;
+            err = host_disk_fill_erased(disk, image_size, disk->size - image_size);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to grow disk image %s to %u bytes", config->image_path, (unsigned)disk->size);
+                break;
+            }
+        }
+    } while(0);
+
+    if (err == ESP_OK) {
+        err = ESP_ERR_NO_MEM;
+        _lock_acquire(&s_host_disks_lock);
+        for (int32_t i = 0; i < ESP_JRNL_HOST_DISK_MAX_HANDLES; i++) {
+            if (s_host_disks[i] == NULL) {
+                s_host_disks[i] = disk;
+                *out_handle = i;
+                err = ESP_OK;
+                break;
+            }
+        }
+        _lock_release(&s_host_disks_lock);
+    }
+
+    if (err != ESP_OK) {
+        host_disk_free(disk);
+        return err;
+    }
+
+    ESP_LOGD(TAG, "Disk %ld created (%s, %u x %u B sectors, erase block %u B)", (long)*out_handle,
+             config->image_path != NULL ? config->image_path : "RAM", (unsigned)config->sector_count,
+             (unsigned)config->sector_size, (unsigned)block_size);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_jrnl_host_disk_delete(int32_t handle)
+{
+    _lock_acquire(&s_host_disks_lock);
+    esp_jrnl_host_disk_t* disk = host_disk_get(handle);
+    if (disk != NULL) {
+        s_host_disks[handle] = NULL;
+    }
+    _lock_release(&s_host_disks_lock);
+
+    if (disk == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    host_disk_free(disk);
+    return ESP_OK;
+}
+
+esp_err_t esp_jrnl_host_disk_get_config(int32_t handle, esp_jrnl_diskio_t* diskio_cfg, esp_jrnl_volume_t* volume_cfg)
+{
+    esp_jrnl_host_disk_t* disk = host_disk_get(handle);
+    if (disk == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (diskio_cfg != NULL) {
+        memset(diskio_cfg, 0, sizeof(esp_jrnl_diskio_t));
+        diskio_cfg->diskio_ctrl_handle = handle;
+        diskio_cfg->disk_read = host_disk_read;
+        diskio_cfg->disk_write = host_disk_write;
+        diskio_cfg->disk_erase_range = host_disk_erase_range;
+        diskio_cfg->erase_block_size = disk->cfg.erase_block_size;
+    }
+    if (volume_cfg != NULL) {
+        volume_cfg->volume_size = disk->size;
+        volume_cfg->disk_sector_size = disk->cfg.sector_size;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_jrnl_host_disk_get_stats(int32_t handle, esp_jrnl_host_disk_stats_t* stats, bool reset)
+{
+    esp_jrnl_host_disk_t* disk = host_disk_get(handle);
+    if (disk == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    _lock_acquire(&disk->lock);
+    *stats = disk->stats;
+    if (reset) {
+        memset(&disk->stats, 0, sizeof(disk->stats));
+    }
+    _lock_release(&disk->lock);
+
+    return ESP_OK;
+}
@@ -0,0 +1,199 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Journaling event trace ring buffer (see esp_jrnl_trace.h). Writers claim the slots by an atomic counter,
+ * no lock is taken on the recording path. Each slot carries the stamp of the claim it holds, stored last,
+ * so the readers skip the entries being written or overwritten meanwhile
+ */
+
+#include <stdatomic.h>
+#include <inttypes.h>
+#include "sdkconfig.h"
+#include "esp_jrnl_trace.h"
+#include "esp_jrnl_internal.h"
+
+#define JRNL_TRACE_FORMAT_VERSION   1
+#define JRNL_TRACE_DUMP_CHUNK       8       /* entries copied at once by esp_jrnl_trace_dump() (on the stack) */
+
+static const char* s_jrnl_trace_event_names[ESP_JRNL_TRACE_EVENT_COUNT] = {
+    [ESP_JRNL_TRACE_TRANS_OPEN] = "TRANS_OPEN",
+    [ESP_JRNL_TRACE_TRANS_COMMIT] = "TRANS_COMMIT",
+    [ESP_JRNL_TRACE_TRANS_CANCEL] = "TRANS_CANCEL",
+    [ESP_JRNL_TRACE_RECORD_APPEND] = "RECORD_APPEND",
+    [ESP_JRNL_TRACE_RECORD_TRIM] = "RECORD_TRIM",
+    [ESP_JRNL_TRACE_MASTER_UPDATE] = "MASTER_UPDATE",
+    [ESP_JRNL_TRACE_REPLAY] = "REPLAY",
+    [ESP_JRNL_TRACE_REPLAY_RECORD] = "REPLAY_RECORD",
+    [ESP_JRNL_TRACE_DISK_READ] = "DISK_READ",
+    [ESP_JRNL_TRACE_DISK_WRITE] = "DISK_WRITE",
+    [ESP_JRNL_TRACE_DISK_ERASE] = "DISK_ERASE",
+    [ESP_JRNL_TRACE_STORE_READ] = "STORE_READ",
+    [ESP_JRNL_TRACE_STORE_WRITE] = "STORE_WRITE",
+    [ESP_JRNL_TRACE_STORE_ERASE] = "STORE_ERASE",
+    [ESP_JRNL_TRACE_CHECKSUM] = "CHECKSUM",
+    [ESP_JRNL_TRACE_LOCK_ACQUIRE] = "LOCK_ACQUIRE",
+    [ESP_JRNL_TRACE_LOCK_RELEASE] = "LOCK_RELEASE"
+};
+
+const char* esp_jrnl_trace_event_name(esp_jrnl_trace_event_t event)
+{
+    if ((unsigned)event >= ESP_JRNL_TRACE_EVENT_COUNT) {
+        return "UNKNOWN";
+    }
+    return s_jrnl_trace_event_names[event];
+}
+
+#ifdef CONFIG_ESP_JRNL_TRACE
+
+//the claim counter wraps at 2^32, the slot sequence stays continuous only with a power of two ring size
+_Static_assert((CONFIG_ESP_JRNL_TRACE_ENTRIES & (CONFIG_ESP_JRNL_TRACE_ENTRIES - 1)) == 0, "CONFIG_ESP_JRNL_TRACE_ENTRIES must be a power of two");
+#define JRNL_TRACE_SLOT(index)      ((index) & (CONFIG_ESP_JRNL_TRACE_ENTRIES - 1))
+
+typedef struct {
+    esp_jrnl_trace_entry_t entry;
+    atomic_uint stamp;                      /* claim index + 1 of the complete entry (the claim index while being written) */
+} jrnl_trace_slot_t;
+
+static jrnl_trace_slot_t s_jrnl_trace[CONFIG_ESP_JRNL_TRACE_ENTRIES];
+static atomic_uint s_jrnl_trace_head;      /* entries recorded since the last clear (claim indexes) */
+
+void jrnl_trace_record(int32_t handle, esp_jrnl_trace_event_t event, uint32_t arg0, uint32_t arg1, int64_t start_us, int64_t end_us)
+{
+    unsigned int index = atomic_fetch_add_explicit(&s_jrnl_trace_head, 1, memory_order_relaxed);
+    jrnl_trace_slot_t* slot = &s_jrnl_trace[JRNL_TRACE_SLOT(index)];
+
+    atomic_store_explicit(&slot->stamp, index, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->entry.timestamp_us = start_us;
+    slot->entry.duration_us = (uint32_t)(end_us - start_us);
+    slot->entry.handle = (int16_t)handle;
+    slot->entry.event = (uint16_t)event;
+    slot->entry.arg0 = arg0;
+    slot->entry.arg1 = arg1;
+
+    atomic_store_explicit(&slot->stamp, index + 1, memory_order_release);
+}
+
+/* entries held by the ring: claim indexes [*first, head) */
+static size_t jrnl_trace_window(unsigned int* first, unsigned int* dropped)
+{
+    unsigned int head = atomic_load(&s_jrnl_trace_head);
+    size_t available = head < CONFIG_ESP_JRNL_TRACE_ENTRIES ? head : CONFIG_ESP_JRNL_TRACE_ENTRIES;
+
+    *first = head - available;
+    if (dropped != NULL) {
+        *dropped = head - available;
+    }
+    return available;
+}
+
+/* copies the entries of claim indexes [first, first + count), the oldest first. The ones being written or
+ * overwritten meanwhile (stamp not matching the claim) are skipped, returns the number of entries copied */
+static size_t jrnl_trace_copy(unsigned int first, size_t count, esp_jrnl_trace_entry_t* entries)
+{
+    size_t copied = 0;
+    for (size_t i = 0; i < count; i++) {
+        unsigned int index = first + i;
+        jrnl_trace_slot_t* slot = &s_jrnl_trace[JRNL_TRACE_SLOT(index)];
+
+        unsigned int stamp = atomic_load_explicit(&slot->stamp, memory_order_acquire);
+        if (stamp != index + 1) {
+            continue;
+        }
+        entries[copied] = slot->entry;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->stamp, memory_order_relaxed) != stamp) {
+            continue;
+        }
+        copied++;
+    }
+
+    return copied;
+}
+
+esp_err_t esp_jrnl_trace_get(esp_jrnl_trace_entry_t* entries, size_t* count)
+{
+    if (count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    unsigned int first = 0;
+    size_t available = jrnl_trace_window(&first, NULL);
+    if (entries == NULL) {
+        *count = available;
+        return ESP_OK;
+    }
+
+    //the newest '*count' entries
+    size_t wanted = available < *count ? available : *count;
+    *count = jrnl_trace_copy(first + (unsigned int)(available - wanted), wanted, entries);
+    return ESP_OK;
+}
+
+esp_err_t esp_jrnl_trace_dump(FILE* stream)
+{
+    if (stream == NULL) {
+        stream = stdout;
+    }
+
+    unsigned int first = 0;
+    unsigned int dropped = 0;
+    size_t available = jrnl_trace_window(&first, &dropped);
+
+    //streamed in chunks, the entries recorded meanwhile may overwrite the ones not printed yet (counted as skipped)
+    fprintf(stream, "JRNL_TRACE_BEGIN %d %u %u\n", JRNL_TRACE_FORMAT_VERSION, (unsigned)available, dropped);
+    esp_jrnl_trace_entry_t chunk[JRNL_TRACE_DUMP_CHUNK];
+    size_t printed = 0;
+    for (size_t done = 0; done < available; done += JRNL_TRACE_DUMP_CHUNK) {
+        size_t wanted = available - done < JRNL_TRACE_DUMP_CHUNK ? available - done : JRNL_TRACE_DUMP_CHUNK;
+        size_t count = jrnl_trace_copy(first + (unsigned int)done, wanted, chunk);
+        for (size_t i = 0; i < count; i++) {
+            const esp_jrnl_trace_entry_t* entry = &chunk[i];
+            fprintf(stream, "JRNL_TRACE %" PRId64 " %" PRIu32 " %d %s %" PRIu32 " %" PRIu32 "\n",
+                    entry->timestamp_us, entry->duration_us, entry->handle,
+                    esp_jrnl_trace_event_name((esp_jrnl_trace_event_t)entry->event), entry->arg0, entry->arg1);
+        }
+        printed += count;
+    }
+    fprintf(stream, "JRNL_TRACE_END %u\n", (unsigned)(available - printed));
+    fflush(stream);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_jrnl_trace_clear(void)
+{
+    //stale stamps never match a claim index + 1 below 2^32 - 1
+    for (size_t i = 0; i < CONFIG_ESP_JRNL_TRACE_ENTRIES; i++) {
+        atomic_store_explicit(&s_jrnl_trace[i].stamp, 0, memory_order_relaxed);
+    }
+    atomic_store(&s_jrnl_trace_head, 0);
+    return ESP_OK;
+}
+
+#else //CONFIG_ESP_JRNL_TRACE
+
+esp_err_t esp_jrnl_trace_get(esp_jrnl_trace_entry_t* entries, size_t* count)
+{
+    (void)entries;
+    (void)count;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_jrnl_trace_dump(FILE* stream)
+{
+    (void)stream;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_jrnl_trace_clear(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif //CONFIG_ESP_JRNL_TRACE
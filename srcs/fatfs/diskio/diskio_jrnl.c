@@ -36,7 +36,9 @@ DSTATUS ff_jrnl_status(BYTE pdrv)
 }
 
 /* On the command GET_SECTOR_COUNT, return modified partition size in sectors(WL sector count - JRNL sector count)
- * All other commands are processed by WL */
+ * CTRL_SYNC commits the batched journaling transaction (see esp_jrnl_sync())
+ * GET_BLOCK_SIZE reports the erase block of the device below the journal (see esp_jrnl_diskio_t::erase_block_size)
+ * CTRL_TRIM is journaled (see esp_jrnl_trim()), all other commands are processed by WL */
 DRESULT ff_jrnl_ioctl(BYTE pdrv, BYTE cmd, void *buff)
 {
     ESP_LOGV(TAG, "ff_jrnl_ioctl: pdrv=%i, cmd=%i\n", pdrv, cmd);
@@ -46,6 +48,14 @@ DRESULT ff_jrnl_ioctl(BYTE pdrv, BYTE cmd, void *buff)
 
     switch (cmd) {
         case CTRL_SYNC:
+            {
+                //f_sync() & co: commit barrier for the operations batched so far (see esp_jrnl_config_t::commit_mode)
+                esp_err_t err = esp_jrnl_sync(jrnl_handle);
+                if (unlikely(err != ESP_OK)) {
+                    ESP_LOGE(TAG, "esp_jrnl_sync failed (0x%08X)", err);
+                    return RES_ERROR;
+                }
+            }
             return RES_OK;
         case GET_SECTOR_COUNT:
             {
@@ -74,7 +84,30 @@ DRESULT ff_jrnl_ioctl(BYTE pdrv, BYTE cmd, void *buff)
             }
             return RES_OK;
         case GET_BLOCK_SIZE:
-            return RES_ERROR;
+            {
+                //erase block size in sectors, f_mkfs() aligns the FAT volume areas to it
+                size_t ff_block_size;
+                esp_err_t err = esp_jrnl_get_erase_block_size(jrnl_handle, &ff_block_size);
+                if (unlikely(err != ESP_OK)) {
+                    ESP_LOGE(TAG, "esp_jrnl_get_erase_block_size failed (0x%08X)", err);
+                    return RES_ERROR;
+                }
+
+                ESP_LOGV(TAG, "ff_block_size: %" PRIu32, (uint32_t)ff_block_size);
+                *((DWORD*) buff) = ff_block_size;
+            }
+            return RES_OK;
+        case CTRL_TRIM:
+            {
+                //inclusive sector range {start, end}, issued by FatFS built with FF_USE_TRIM when clusters get freed
+                const LBA_t* range = (const LBA_t*) buff;
+                esp_err_t err = esp_jrnl_trim(jrnl_handle, (uint32_t)range[0], (uint32_t)(range[1] - range[0] + 1));
+                if (unlikely(err != ESP_OK)) {
+                    ESP_LOGE(TAG, "esp_jrnl_trim failed (0x%08X)", err);
+                    return RES_ERROR;
+                }
+            }
+            return RES_OK;
     }
 
     return RES_ERROR;
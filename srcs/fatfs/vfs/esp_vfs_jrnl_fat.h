@@ -6,6 +6,7 @@
 
 #pragma once
 #include <stddef.h>
+#include "sdkconfig.h"
 #include "esp_err.h"
 #include "esp_vfs_fat.h"
 #include "esp_jrnl.h"
@@ -14,6 +15,47 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Installs esp_fs_journal instance on a disk device given by its access routines, initializes FAT filesystem
+ * on top of it and registers it in VFS. Generic counterpart of the SPI flash and SDMMC functions, eg for the emulated
+ * disks of esp_jrnl_host_disk.h on linux target. The disk device stays owned by the caller and must outlive the mount.
+ *
+ * @param[in] base_path        path where FATFS partition should be mounted (e.g. "/ramdisk")
+ * @param[in] diskio_cfg       disk device access routines
+ * @param[in] volume_cfg       disk device geometry (the whole 'volume_size' holds the FAT volume and the journaling store)
+ * @param[in] mount_config     pointer to structure with extra parameters for mounting FATFS
+ * @param[in] jrnl_config      pointer to structure with esp_fs_journal instance configuration
+ * @param[out] jrnl_handle     esp_fs_journal instance handle (needed for unmounting)
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_ARG    if any of the input parameters is NULL
+ *      - ESP_ERR_NO_MEM         if the maximum count of volumes is mounted or FatFS required memory can not be allocated
+ *      - ESP_ERR_NOT_SUPPORTED  if 'store_partition_label' is set on linux target
+ *      - ESP_FAIL               if partition can not be mounted due to internal FatFS error
+ *      - other error codes from FATFS drivers and esp_fs_journal component
+ */
+esp_err_t esp_vfs_fat_diskio_mount_jrnl(const char* base_path,
+                                        const esp_jrnl_diskio_t* diskio_cfg,
+                                        const esp_jrnl_volume_t* volume_cfg,
+                                        const esp_vfs_fat_mount_config_t* mount_config,
+                                        const esp_jrnl_config_t* jrnl_config,
+                                        esp_jrnl_handle_t* jrnl_handle);
+
+/**
+ * @brief Unmounts FAT filesystem mounted by esp_vfs_fat_diskio_mount_jrnl (the disk device is left to the caller)
+ *
+ * @param[in,out] jrnl_handle    esp_fs_journal instance handle returned by esp_vfs_fat_diskio_mount_jrnl
+ * @param[in] base_path         path where partition should be registered (e.g. "/ramdisk")
+ *
+ * @return
+ *      - ESP_OK                on success
+ *      - ESP_ERR_INVALID_ARG   if any of the parameters is invalid
+ *      - other error codes from esp_jrnl_unmount()
+ */
+esp_err_t esp_vfs_fat_diskio_unmount_jrnl(esp_jrnl_handle_t* jrnl_handle, const char* base_path);
+
+#if !CONFIG_IDF_TARGET_LINUX
 /**
 * @brief Convenience function to install esp_fs_journal instance, initialize FAT filesystem in SPI flash and register it in VFS
 *
@@ -105,6 +147,125 @@ esp_err_t esp_vfs_fat_sdmmc_mount_jrnl(const char* base_path,
  *      - other error codes from esp_vfs_fat_unregister_path_jrnl() API calls
  */
 esp_err_t esp_vfs_fat_sdmmc_unmount_jrnl(esp_jrnl_handle_t* jrnl_handle, const char* base_path);
+#endif //!CONFIG_IDF_TARGET_LINUX
+
+/**
+ * @brief Resizes the journaling store of mounted FAT volume without reformatting (the file-system gives or takes
+ * the sectors at the volume end). Growing the store requires the clusters to be released being free.
+ * No file may be open on the volume during the operation, the volume is remounted internally.
+ * Supported for FAT12/FAT16 volumes without partition table, the FAT type must not change by the resizing.
+ *
+ * The operation is power-off safe: the FAT volume is shrunk before the store gets bigger and grown only after the store
+ * got smaller. An interrupted resizing leaves a consistent volume, possibly with some sectors unused (the resizing
+ * can be repeated - see 'allow_store_resize' in esp_jrnl_config_t)
+ *
+ * @param[in] base_path           path where the FAT volume is mounted (e.g. "/spiflash")
+ * @param[in] store_size_sectors  new journaling store size in sectors
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_ARG    if 'base_path' is NULL
+ *      - ESP_ERR_NOT_FOUND      if no journaled FAT volume is registered at 'base_path'
+ *      - ESP_ERR_INVALID_STATE  if any file is open or the clusters to be released are in use
+ *      - ESP_ERR_INVALID_SIZE   if the new size is not applicable to the store or to the FAT volume
+ *      - ESP_FAIL               if the volume can't be remounted
+ *      - other error codes from vfs_fat_jrnl_set_volume_sectors() and esp_jrnl_resize_store()
+ */
+esp_err_t esp_vfs_fat_jrnl_resize_store(const char* base_path, size_t store_size_sectors);
+
+/**
+ * @brief Journaled VFS operations with latency histograms (CONFIG_ESP_JRNL_VFS_LATENCY_STATS)
+ */
+typedef enum {
+    ESP_VFS_JRNL_OP_OPEN = 0,
+    ESP_VFS_JRNL_OP_WRITE,                  /* write() and pwrite() */
+    ESP_VFS_JRNL_OP_CLOSE,
+    ESP_VFS_JRNL_OP_RENAME,
+    ESP_VFS_JRNL_OP_UNLINK,
+    ESP_VFS_JRNL_OP_MKDIR,
+    ESP_VFS_JRNL_OP_TRUNCATE,               /* truncate() and ftruncate() */
+    ESP_VFS_JRNL_OP_FSYNC,
+    ESP_VFS_JRNL_OP_COUNT
+} esp_vfs_jrnl_op_t;
+
+/**
+ * @brief Parts of the journaled VFS operation measured separately
+ */
+typedef enum {
+    ESP_VFS_JRNL_PHASE_TOTAL = 0,           /* whole operation, incl. waiting for the transaction of other task */
+    ESP_VFS_JRNL_PHASE_FATFS,               /* FatFS processing and the target disk reads (journal appends excluded) */
+    ESP_VFS_JRNL_PHASE_APPEND,              /* appending the operation records (esp_jrnl_write/trim() called by FatFS) */
+    ESP_VFS_JRNL_PHASE_COMMIT,              /* esp_jrnl_stop(): marking the transaction committed and the replay */
+    ESP_VFS_JRNL_PHASE_COUNT
+} esp_vfs_jrnl_phase_t;
+
+#define ESP_VFS_JRNL_LATENCY_BUCKETS    24  /* bucket i counts latencies in [2^i, 2^(i+1)) us (bucket 0 from 0us, the last one unbounded) */
+
+/**
+ * @brief Latency histogram of one operation phase
+ */
+typedef struct {
+    uint32_t count;                         /* operations measured */
+    uint32_t max_us;                        /* the longest one */
+    uint64_t sum_us;                        /* total time (mean = sum_us / count) */
+    uint32_t buckets[ESP_VFS_JRNL_LATENCY_BUCKETS];  /* log2-scaled buckets */
+} esp_vfs_jrnl_latency_hist_t;
+
+/**
+ * @brief Latency summary derived from the histogram. The percentiles are upper bounds of the buckets holding them
+ * (at most 2x the exact value), capped by 'max_us'
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t mean_us;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+} esp_vfs_jrnl_latency_summary_t;
+
+/**
+ * @brief Gets the latency histogram and/or its summary of given operation phase on the journaled FAT volume. The histograms
+ * are collected since the mount (or esp_vfs_fat_jrnl_reset_latency()), only the operations completed successfully
+ * by the journaling layer (esp_jrnl_start/stop() passed) are measured, regardless of the VFS call result
+ *
+ * @param[in] base_path   path where the FAT volume is mounted (e.g. "/spiflash")
+ * @param[in] op          operation
+ * @param[in] phase       operation phase
+ * @param[out] hist       histogram copy (may be NULL)
+ * @param[out] summary    percentiles (may be NULL)
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_ARG    if 'base_path' is NULL or 'op'/'phase' out of range
+ *      - ESP_ERR_NOT_FOUND      if no journaled FAT volume is registered at 'base_path'
+ *      - ESP_ERR_NOT_SUPPORTED  if CONFIG_ESP_JRNL_VFS_LATENCY_STATS is disabled (or the histograms couldn't be allocated at the mount)
+ */
+esp_err_t esp_vfs_fat_jrnl_get_latency(const char* base_path, esp_vfs_jrnl_op_t op, esp_vfs_jrnl_phase_t phase,
+                                       esp_vfs_jrnl_latency_hist_t* hist, esp_vfs_jrnl_latency_summary_t* summary);
+
+/**
+ * @brief Latency at given fraction of the operations in the histogram, the way the summary's percentiles are derived.
+ * For histograms merged by the caller (eg one phase of all the operations)
+ *
+ * @param[in] hist        histogram
+ * @param[in] per_mille   fraction of the operations (500 = median, 990 = 99th percentile)
+ *
+ * @return upper bound of the bucket holding the percentile (capped by 'max_us'), 0 for an empty histogram
+ */
+uint32_t esp_vfs_fat_jrnl_latency_percentile(const esp_vfs_jrnl_latency_hist_t* hist, uint32_t per_mille);
+
+/**
+ * @brief Clears all the latency histograms of the journaled FAT volume
+ *
+ * @param[in] base_path   path where the FAT volume is mounted
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_ARG    if 'base_path' is NULL
+ *      - ESP_ERR_NOT_FOUND      if no journaled FAT volume is registered at 'base_path'
+ *      - ESP_ERR_NOT_SUPPORTED  if CONFIG_ESP_JRNL_VFS_LATENCY_STATS is disabled
+ */
+esp_err_t esp_vfs_fat_jrnl_reset_latency(const char* base_path);
 
 #ifdef __cplusplus
 }
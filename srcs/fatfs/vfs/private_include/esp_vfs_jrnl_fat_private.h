@@ -8,6 +8,8 @@
 #include <stddef.h>
 #include "esp_err.h"
 #include "esp_vfs_fat.h"
+#include "esp_jrnl.h"
+#include "esp_vfs_jrnl_fat.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -41,6 +43,51 @@ esp_err_t vfs_fat_register_pdrv_jrnl_handle(const uint8_t pdrv, const esp_jrnl_h
 */
 esp_err_t vfs_fat_unregister_pdrv_jrnl_handle(const esp_jrnl_handle_t jrnl_handle);
 
+/**
+* @brief Sets the FAT volume size recorded in the boot sector (BPB) and clears/checks the FAT entries of the clusters
+* added/removed. The volume must be unmounted, only FAT12/FAT16 volumes without partition table (FM_SFD) are supported
+* and the FAT type must not change. All the changes are written in a single journaling transaction.
+* For internal use only (see esp_vfs_fat_jrnl_resize_store()).
+*
+* @param[in] jrnl_handle        handle of FS journaling instance holding the FAT volume
+* @param[in] fs_sector_count    new FAT volume size in sectors
+*
+* @return
+*      - ESP_OK                 on success
+*      - ESP_ERR_NOT_FOUND      if no FAT boot sector is found
+*      - ESP_ERR_NOT_SUPPORTED  for FAT32 volumes
+*      - ESP_ERR_INVALID_SIZE   if the new size changes the FAT type or exceeds the FAT capacity
+*      - ESP_ERR_INVALID_STATE  if clusters to be removed are in use
+*      - ESP_ERR_NO_MEM         if the working buffers can't be allocated
+*      - errors from esp_jrnl_read/write/start/stop()
+*/
+esp_err_t vfs_fat_jrnl_set_volume_sectors(const esp_jrnl_handle_t jrnl_handle, const size_t fs_sector_count);
+
+/**
+* @brief Mounts wear-levelling on the flash partition given by the label and sets it as the separate journaling store device
+* (store_diskio_cfg and store_volume_cfg of 'jrnl_config_ext'). For internal use only.
+*
+* @param[in] partition_label        label of the store partition (data type, any subtype)
+* @param[in,out] jrnl_config_ext    journaling configuration to update
+*
+* @return
+*      - ESP_OK                 on success
+*      - ESP_ERR_NOT_FOUND      if the partition doesn't exist
+*      - errors from wl_mount()
+*/
+esp_err_t vfs_fat_jrnl_store_partition_mount(const char* partition_label, esp_jrnl_config_extended_t* jrnl_config_ext);
+
+/**
+* @brief Unmounts wear-levelling of the store partition mounted by vfs_fat_jrnl_store_partition_mount(). For internal use only.
+*
+* @param[in] store_diskio_handle    store device handle (see esp_jrnl_get_store_diskio_handle())
+*
+* @return
+*      - ESP_OK                 on success
+*      - errors from wl_unmount()
+*/
+esp_err_t vfs_fat_jrnl_store_partition_unmount(int32_t store_diskio_handle);
+
 /**
  * @brief Register FATFS with journaled VFS component
  *
@@ -48,13 +95,14 @@ esp_err_t vfs_fat_unregister_pdrv_jrnl_handle(const esp_jrnl_handle_t jrnl_handl
  * registering journaled variant of the VFS FAT APIs
  *
  * @param conf  pointer to esp_vfs_fat_conf_t configuration structure
+ * @param read_only  register the plain (non-journaled) read APIs, the modifying ones fail with EROFS
  * @param[out] out_fs  pointer to FATFS structure which can be used for FATFS f_mount call is returned via this argument.
  * @return
  *      - ESP_OK on success
  *      - ESP_ERR_INVALID_STATE if esp_vfs_fat_register was already called
  *      - ESP_ERR_NO_MEM if not enough memory or too many VFSes already registered
  */
-esp_err_t vfs_fat_register_cfg_jrnl(const esp_vfs_fat_conf_t* conf, FATFS** out_fs);
+esp_err_t vfs_fat_register_cfg_jrnl(const esp_vfs_fat_conf_t* conf, bool read_only, FATFS** out_fs);
 
 /**
  * @brief Unregister FATFS from journaled VFS
@@ -67,6 +115,47 @@ esp_err_t vfs_fat_register_cfg_jrnl(const esp_vfs_fat_conf_t* conf, FATFS** out_
  */
 esp_err_t vfs_fat_unregister_path_jrnl(const char* base_path);
 
+/**
+ * @brief Latency histograms of one journaled FAT volume (all the operations and phases, see esp_vfs_jrnl_op_t)
+ */
+typedef struct vfs_fat_jrnl_latency vfs_fat_jrnl_latency_t;
+
+/**
+ * @brief Allocates zeroed latency histograms. For internal use only.
+ *
+ * @return histograms or NULL if out of memory
+ */
+vfs_fat_jrnl_latency_t* vfs_fat_jrnl_latency_create(void);
+
+/**
+ * @brief Releases the latency histograms created by vfs_fat_jrnl_latency_create() (NULL accepted). For internal use only.
+ */
+void vfs_fat_jrnl_latency_delete(vfs_fat_jrnl_latency_t* latency);
+
+/**
+ * @brief Records one operation into the histograms of all its phases. For internal use only.
+ *
+ * @param[in] latency   histograms
+ * @param[in] op        operation
+ * @param[in] phase_us  durations of the phases (indexed by esp_vfs_jrnl_phase_t)
+ */
+void vfs_fat_jrnl_latency_record(vfs_fat_jrnl_latency_t* latency, esp_vfs_jrnl_op_t op, const uint32_t phase_us[ESP_VFS_JRNL_PHASE_COUNT]);
+
+/**
+ * @brief Copies the histogram of given operation phase and/or computes its summary. For internal use only.
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_ARG    if 'op' or 'phase' is out of range
+ */
+esp_err_t vfs_fat_jrnl_latency_get(vfs_fat_jrnl_latency_t* latency, esp_vfs_jrnl_op_t op, esp_vfs_jrnl_phase_t phase,
+                                   esp_vfs_jrnl_latency_hist_t* hist, esp_vfs_jrnl_latency_summary_t* summary);
+
+/**
+ * @brief Clears all the histograms. For internal use only.
+ */
+void vfs_fat_jrnl_latency_reset(vfs_fat_jrnl_latency_t* latency);
+
 #ifdef __cplusplus
 }
 #endif
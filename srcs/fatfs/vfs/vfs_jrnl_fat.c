@@ -15,6 +15,9 @@
 #include "esp_vfs.h"
 #include "esp_vfs_fat.h"
 #include "esp_jrnl.h"
+#include "esp_vfs_jrnl_fat.h"
+#include "esp_jrnl_internal.h"
+#include "private_include/esp_vfs_jrnl_fat_private.h"
 
 static const char* TAG = "vfs_jrnl_fat";
 
@@ -1231,6 +1234,74 @@ static esp_jrnl_handle_t s_jrnl_handles[JRNL_MAX_HANDLES] = {[0 ... JRNL_MAX_HAN
         return retval; \
     }
 
+/* Operation latency measurement around esp_jrnl_start/stop() (plain start/stop calls if disabled).
+ * The append time is the growth of the instance's esp_jrnl_write/trim() time during the FatFS part */
+typedef struct {
+#ifdef CONFIG_ESP_JRNL_VFS_LATENCY_STATS
+    int64_t start_us;
+    int64_t fs_start_us;
+    uint64_t append_start_us;
+#else
+    uint8_t unused;
+#endif
+} vfs_fat_jrnl_probe_t;
+
+#ifdef CONFIG_ESP_JRNL_VFS_LATENCY_STATS
+static vfs_fat_jrnl_latency_t* s_jrnl_latency[JRNL_MAX_HANDLES] = { NULL };
+#endif
+
+static inline esp_err_t vfs_fat_jrnl_op_start(vfs_fat_jrnl_probe_t* probe, esp_jrnl_handle_t jrnl_handle)
+{
+#ifdef CONFIG_ESP_JRNL_VFS_LATENCY_STATS
+    probe->start_us = jrnl_time_us();
+    esp_err_t err = esp_jrnl_start(jrnl_handle);
+    if (err == ESP_OK && esp_jrnl_get_append_time(jrnl_handle, &probe->append_start_us) != ESP_OK) {
+        probe->append_start_us = 0;
+    }
+    probe->fs_start_us = jrnl_time_us();
+    return err;
+#else
+    (void)probe;
+    return esp_jrnl_start(jrnl_handle);
+#endif
+}
+
+static inline esp_err_t vfs_fat_jrnl_op_stop(vfs_fat_jrnl_probe_t* probe, esp_jrnl_handle_t jrnl_handle, bool commit, uint8_t pdrv, esp_vfs_jrnl_op_t op)
+{
+#ifdef CONFIG_ESP_JRNL_VFS_LATENCY_STATS
+    int64_t commit_start_us = jrnl_time_us();
+    uint64_t append_end_us = 0;
+    esp_jrnl_get_append_time(jrnl_handle, &append_end_us);
+
+    esp_err_t err = esp_jrnl_stop(jrnl_handle, commit);
+    vfs_fat_jrnl_latency_t* latency = pdrv < JRNL_MAX_HANDLES ? s_jrnl_latency[pdrv] : NULL;
+    if (err != ESP_OK || latency == NULL) {
+        return err;
+    }
+
+    //the counter drops at esp_jrnl_reset_stats()
+    uint32_t fs_us = (uint32_t)(commit_start_us - probe->fs_start_us);
+    uint32_t append_us = append_end_us >= probe->append_start_us ? (uint32_t)(append_end_us - probe->append_start_us) : 0;
+    if (append_us > fs_us) {
+        append_us = fs_us;
+    }
+
+    uint32_t phase_us[ESP_VFS_JRNL_PHASE_COUNT];
+    phase_us[ESP_VFS_JRNL_PHASE_TOTAL] = (uint32_t)(jrnl_time_us() - probe->start_us);
+    phase_us[ESP_VFS_JRNL_PHASE_FATFS] = fs_us - append_us;
+    phase_us[ESP_VFS_JRNL_PHASE_APPEND] = append_us;
+    phase_us[ESP_VFS_JRNL_PHASE_COMMIT] = (uint32_t)(jrnl_time_us() - commit_start_us);
+    vfs_fat_jrnl_latency_record(latency, op, phase_us);
+
+    return ESP_OK;
+#else
+    (void)probe;
+    (void)pdrv;
+    (void)op;
+    return esp_jrnl_stop(jrnl_handle, commit);
+#endif
+}
+
 static int vfs_fat_open_jrnl(void* ctx, const char * path, int flags, int mode)
 {
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
@@ -1238,9 +1309,10 @@ static int vfs_fat_open_jrnl(void* ctx, const char * path, int flags, int mode)
 
     ESP_LOGV(TAG, "vfs_fat_open_jrnl (path: %s, flags: %d, mode: %d, pdrv: %d, jrnl_handle: %ld", path, flags, mode, fat_ctx->fs.pdrv, jrnl_handle);
 
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_start(jrnl_handle), EBADF, -1);
+    vfs_fat_jrnl_probe_t probe;
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_start(&probe, jrnl_handle), EBADF, -1);
     int fd = vfs_fat_open(ctx, path, flags, mode);
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_stop(jrnl_handle, fd >= 0), EBADF, -1);
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_stop(&probe, jrnl_handle, fd >= 0, fat_ctx->fs.pdrv, ESP_VFS_JRNL_OP_OPEN), EBADF, -1);
 
     return fd;
 }
@@ -1250,9 +1322,10 @@ static ssize_t vfs_fat_write_jrnl(void* ctx, int fd, const void * data, size_t s
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
     esp_jrnl_handle_t jrnl_handle = s_jrnl_handles[fat_ctx->fs.pdrv];
 
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_start(jrnl_handle), EBADF, -1);
+    vfs_fat_jrnl_probe_t probe;
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_start(&probe, jrnl_handle), EBADF, -1);
     ssize_t written = vfs_fat_write(ctx, fd, data, size);
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_stop(jrnl_handle, written >= 0), EBADF, -1);
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_stop(&probe, jrnl_handle, written >= 0, fat_ctx->fs.pdrv, ESP_VFS_JRNL_OP_WRITE), EBADF, -1);
 
     return written;
 }
@@ -1288,9 +1361,10 @@ static ssize_t vfs_fat_pwrite_jrnl(void *ctx, int fd, const void *src, size_t si
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
     esp_jrnl_handle_t jrnl_handle = s_jrnl_handles[fat_ctx->fs.pdrv];
 
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_start(jrnl_handle), EBADF, -1);
+    vfs_fat_jrnl_probe_t probe;
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_start(&probe, jrnl_handle), EBADF, -1);
     ssize_t written = vfs_fat_pwrite(ctx, fd, src, size, offset);
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_stop(jrnl_handle, written >= 0), EBADF, -1);
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_stop(&probe, jrnl_handle, written >= 0, fat_ctx->fs.pdrv, ESP_VFS_JRNL_OP_WRITE), EBADF, -1);
 
     return written;
 }
@@ -1300,9 +1374,10 @@ static ssize_t vfs_fat_fsync_jrnl(void* ctx, int fd)
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
     esp_jrnl_handle_t jrnl_handle = s_jrnl_handles[fat_ctx->fs.pdrv];
 
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_start(jrnl_handle), EBADF, -1);
+    vfs_fat_jrnl_probe_t probe;
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_start(&probe, jrnl_handle), EBADF, -1);
     int res = vfs_fat_fsync(ctx, fd);
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_stop(jrnl_handle, res == 0), EBADF, -1);
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_stop(&probe, jrnl_handle, res == 0, fat_ctx->fs.pdrv, ESP_VFS_JRNL_OP_FSYNC), EBADF, -1);
 
     return res;
 }
@@ -1312,9 +1387,10 @@ static int vfs_fat_close_jrnl(void* ctx, int fd)
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
     esp_jrnl_handle_t jrnl_handle = s_jrnl_handles[fat_ctx->fs.pdrv];
 
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_start(jrnl_handle), EBADF, -1);
+    vfs_fat_jrnl_probe_t probe;
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_start(&probe, jrnl_handle), EBADF, -1);
     int rc = vfs_fat_close(ctx, fd);
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_stop(jrnl_handle, rc >= 0), EBADF, -1);
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_stop(&probe, jrnl_handle, rc >= 0, fat_ctx->fs.pdrv, ESP_VFS_JRNL_OP_CLOSE), EBADF, -1);
 
     return rc;
 }
@@ -1337,9 +1413,10 @@ static int vfs_fat_unlink_jrnl(void* ctx, const char *path)
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
     esp_jrnl_handle_t jrnl_handle = s_jrnl_handles[fat_ctx->fs.pdrv];
 
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_start(jrnl_handle), EBADF, -1);
+    vfs_fat_jrnl_probe_t probe;
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_start(&probe, jrnl_handle), EBADF, -1);
     int res = vfs_fat_unlink(ctx, path);
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_stop(jrnl_handle, res == 0), EBADF, -1);
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_stop(&probe, jrnl_handle, res == 0, fat_ctx->fs.pdrv, ESP_VFS_JRNL_OP_UNLINK), EBADF, -1);
 
     return res;
 }
@@ -1361,9 +1438,10 @@ static int vfs_fat_rename_jrnl(void* ctx, const char *src, const char *dst)
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
     esp_jrnl_handle_t jrnl_handle = s_jrnl_handles[fat_ctx->fs.pdrv];
 
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_start(jrnl_handle), EBADF, -1);
+    vfs_fat_jrnl_probe_t probe;
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_start(&probe, jrnl_handle), EBADF, -1);
     int res = vfs_fat_rename(ctx, src, dst);
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_stop(jrnl_handle, res == 0), EBADF, -1);
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_stop(&probe, jrnl_handle, res == 0, fat_ctx->fs.pdrv, ESP_VFS_JRNL_OP_RENAME), EBADF, -1);
 
     return res;
 }
@@ -1414,9 +1492,10 @@ static int vfs_fat_mkdir_jrnl(void* ctx, const char* name, mode_t mode)
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
     esp_jrnl_handle_t jrnl_handle = s_jrnl_handles[fat_ctx->fs.pdrv];
 
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_start(jrnl_handle), EBADF, -1);
+    vfs_fat_jrnl_probe_t probe;
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_start(&probe, jrnl_handle), EBADF, -1);
     int res = vfs_fat_mkdir(ctx, name, mode);
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_stop(jrnl_handle, res == 0), EBADF, -1);
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_stop(&probe, jrnl_handle, res == 0, fat_ctx->fs.pdrv, ESP_VFS_JRNL_OP_MKDIR), EBADF, -1);
 
     return res;
 }
@@ -1438,9 +1517,10 @@ static int vfs_fat_truncate_jrnl(void* ctx, const char *path, off_t length)
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
     esp_jrnl_handle_t jrnl_handle = s_jrnl_handles[fat_ctx->fs.pdrv];
 
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_start(jrnl_handle), EBADF, -1);
+    vfs_fat_jrnl_probe_t probe;
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_start(&probe, jrnl_handle), EBADF, -1);
     int res = vfs_fat_truncate(ctx, path, length);
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_stop(jrnl_handle, res == 0), EBADF, -1);
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_stop(&probe, jrnl_handle, res == 0, fat_ctx->fs.pdrv, ESP_VFS_JRNL_OP_TRUNCATE), EBADF, -1);
 
     return res;
 }
@@ -1450,9 +1530,10 @@ static int vfs_fat_ftruncate_jrnl(void* ctx, int fd, off_t length)
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
     esp_jrnl_handle_t jrnl_handle = s_jrnl_handles[fat_ctx->fs.pdrv];
 
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_start(jrnl_handle), EBADF, -1);
+    vfs_fat_jrnl_probe_t probe;
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_start(&probe, jrnl_handle), EBADF, -1);
     int res = vfs_fat_ftruncate(ctx, fd, length);
-    ESP_JRNL_CHECK_ERRNO(esp_jrnl_stop(jrnl_handle, res == 0), EBADF, -1);
+    ESP_JRNL_CHECK_ERRNO(vfs_fat_jrnl_op_stop(&probe, jrnl_handle, res == 0, fat_ctx->fs.pdrv, ESP_VFS_JRNL_OP_TRUNCATE), EBADF, -1);
 
     return res;
 }
@@ -1470,6 +1551,68 @@ static int vfs_fat_utime_jrnl(void *ctx, const char *path, const struct utimbuf
 }
 #endif //CONFIG_VFS_SUPPORT_DIR
 
+/* Read-only volume (esp_jrnl_config_t.read_only): the reads call the plain VFS APIs (no transaction around),
+ * the modifying calls are refused with EROFS before reaching FatFS */
+
+static int vfs_fat_open_ro(void* ctx, const char * path, int flags, int mode)
+{
+    if ((flags & O_ACCMODE) != O_RDONLY || (flags & (O_CREAT | O_TRUNC | O_APPEND)) != 0) {
+        errno = EROFS;
+        return -1;
+    }
+    return vfs_fat_open(ctx, path, flags, mode);
+}
+
+static ssize_t vfs_fat_write_ro(void* ctx, int fd, const void * data, size_t size)
+{
+    errno = EROFS;
+    return -1;
+}
+
+static ssize_t vfs_fat_pwrite_ro(void *ctx, int fd, const void *src, size_t size, off_t offset)
+{
+    errno = EROFS;
+    return -1;
+}
+
+#ifdef CONFIG_VFS_SUPPORT_DIR
+static int vfs_fat_path_ro(void* ctx, const char *path)
+{
+    errno = EROFS;
+    return -1;
+}
+
+static int vfs_fat_path2_ro(void* ctx, const char *src, const char *dst)
+{
+    errno = EROFS;
+    return -1;
+}
+
+static int vfs_fat_mkdir_ro(void* ctx, const char* name, mode_t mode)
+{
+    errno = EROFS;
+    return -1;
+}
+
+static int vfs_fat_truncate_ro(void* ctx, const char *path, off_t length)
+{
+    errno = EROFS;
+    return -1;
+}
+
+static int vfs_fat_ftruncate_ro(void* ctx, int fd, off_t length)
+{
+    errno = EROFS;
+    return -1;
+}
+
+static int vfs_fat_utime_ro(void *ctx, const char *path, const struct utimbuf *times)
+{
+    errno = EROFS;
+    return -1;
+}
+#endif //CONFIG_VFS_SUPPORT_DIR
+
 
 /* internal helpers */
 
@@ -1511,7 +1654,45 @@ static esp_err_t vfs_fat_get_default_api(esp_vfs_t *vfs)
     return ESP_OK;
 }
 
-esp_err_t vfs_fat_register_cfg_jrnl(const esp_vfs_fat_conf_t* conf, FATFS** out_fs)
+static esp_err_t vfs_fat_get_read_only_api(esp_vfs_t *vfs)
+{
+    if (vfs == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    vfs->flags = ESP_VFS_FLAG_CONTEXT_PTR;
+    vfs->write_p = &vfs_fat_write_ro;
+    vfs->lseek_p = &vfs_fat_lseek;
+    vfs->read_p = &vfs_fat_read;
+    vfs->pread_p = &vfs_fat_pread;
+    vfs->pwrite_p = &vfs_fat_pwrite_ro;
+    vfs->open_p = &vfs_fat_open_ro;
+    vfs->close_p = &vfs_fat_close;
+    vfs->fstat_p = &vfs_fat_fstat;
+    vfs->fsync_p = &vfs_fat_fsync;
+#ifdef CONFIG_VFS_SUPPORT_DIR
+    vfs->stat_p = &vfs_fat_stat;
+    vfs->link_p = &vfs_fat_path2_ro;
+    vfs->unlink_p = &vfs_fat_path_ro;
+    vfs->rename_p = &vfs_fat_path2_ro;
+    vfs->opendir_p = &vfs_fat_opendir;
+    vfs->closedir_p = &vfs_fat_closedir;
+    vfs->readdir_p = &vfs_fat_readdir;
+    vfs->readdir_r_p = &vfs_fat_readdir_r;
+    vfs->seekdir_p = &vfs_fat_seekdir;
+    vfs->telldir_p = &vfs_fat_telldir;
+    vfs->mkdir_p = &vfs_fat_mkdir_ro;
+    vfs->rmdir_p = &vfs_fat_path_ro;
+    vfs->access_p = &vfs_fat_access;
+    vfs->truncate_p = &vfs_fat_truncate_ro;
+    vfs->ftruncate_p = &vfs_fat_ftruncate_ro;
+    vfs->utime_p = &vfs_fat_utime_ro;
+#endif // CONFIG_VFS_SUPPORT_DIR
+
+    return ESP_OK;
+}
+
+esp_err_t vfs_fat_register_cfg_jrnl(const esp_vfs_fat_conf_t* conf, bool read_only, FATFS** out_fs)
 {
     size_t ctx = find_context_index_by_path(conf->base_path);
     if (ctx < FF_VOLUMES) {
@@ -1547,7 +1728,7 @@ esp_err_t vfs_fat_register_cfg_jrnl(const esp_vfs_fat_conf_t* conf, FATFS** out_
 
     //register VFS/FatFS interface
     esp_vfs_t vfs;
-    err = vfs_fat_get_default_api(&vfs);
+    err = read_only ? vfs_fat_get_read_only_api(&vfs) : vfs_fat_get_default_api(&vfs);
     if (err == ESP_OK) {
         err = esp_vfs_register(conf->base_path, &vfs, fat_ctx);
     }
@@ -1599,6 +1780,14 @@ esp_err_t vfs_fat_register_pdrv_jrnl_handle(const uint8_t pdrv, const esp_jrnl_h
 
     s_jrnl_handles[pdrv] = jrnl_handle;
 
+#ifdef CONFIG_ESP_JRNL_VFS_LATENCY_STATS
+    //diagnostics only, the volume works without them
+    s_jrnl_latency[pdrv] = vfs_fat_jrnl_latency_create();
+    if (s_jrnl_latency[pdrv] == NULL) {
+        ESP_LOGW(TAG, "Failed to allocate latency histograms for pdrv=%u", pdrv);
+    }
+#endif
+
     return ESP_OK;
 }
 
@@ -1611,9 +1800,172 @@ esp_err_t vfs_fat_unregister_pdrv_jrnl_handle(const esp_jrnl_handle_t jrnl_handl
     for (int i=0; i<JRNL_MAX_HANDLES; i++) {
         if (jrnl_handle == s_jrnl_handles[i]) {
             s_jrnl_handles[i] = JRNL_INVALID_HANDLE;
+#ifdef CONFIG_ESP_JRNL_VFS_LATENCY_STATS
+            vfs_fat_jrnl_latency_delete(s_jrnl_latency[i]);
+            s_jrnl_latency[i] = NULL;
+#endif
             return ESP_OK;
         }
     }
 
     return ESP_ERR_NOT_FOUND;
 }
+
+esp_err_t esp_vfs_fat_jrnl_resize_store(const char* base_path, size_t store_size_sectors)
+{
+    if (base_path == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t ctx = find_context_index_by_path(base_path);
+    if (ctx == FF_VOLUMES) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    vfs_fat_ctx_t* fat_ctx = s_fat_ctxs[ctx];
+    _lock_acquire(&fat_ctx->lock);
+
+    esp_err_t err = ESP_OK;
+    bool remount = false;
+
+    do {
+        esp_jrnl_handle_t jrnl_handle = fat_ctx->fs.pdrv < JRNL_MAX_HANDLES ? s_jrnl_handles[fat_ctx->fs.pdrv] : JRNL_INVALID_HANDLE;
+        if (jrnl_handle == JRNL_INVALID_HANDLE) {
+            err = ESP_ERR_NOT_FOUND;
+            break;
+        }
+
+        for (size_t i = 0; i < fat_ctx->max_files; i++) {
+            if (fat_ctx->files[i].obj.fs != NULL) {
+                ESP_LOGE(TAG, "Can't resize journaling store of %s, files open", base_path);
+                err = ESP_ERR_INVALID_STATE;
+                break;
+            }
+        }
+        if (err != ESP_OK) {
+            break;
+        }
+
+        size_t fs_sectors = 0;
+        size_t store_sectors = 0;
+        err = esp_jrnl_get_sector_count(jrnl_handle, &fs_sectors);
+        if (err == ESP_OK) {
+            err = esp_jrnl_get_store_size(jrnl_handle, &store_sectors);
+        }
+        if (err != ESP_OK || store_sectors == store_size_sectors) {
+            break;
+        }
+
+        //the store on a separate device doesn't affect the FAT volume
+        int32_t store_diskio_handle;
+        if (esp_jrnl_get_store_diskio_handle(jrnl_handle, &store_diskio_handle) == ESP_OK) {
+            err = esp_jrnl_resize_store(jrnl_handle, store_size_sectors);
+            break;
+        }
+
+        if (store_size_sectors >= fs_sectors + store_sectors) {
+            err = ESP_ERR_INVALID_SIZE;
+            break;
+        }
+        size_t new_fs_sectors = fs_sectors + store_sectors - store_size_sectors;
+
+        //the FAT volume gets reloaded after the resizing (new FAT geometry and free cluster info)
+        FRESULT fres = f_mount(NULL, fat_ctx->fat_drive, 0);
+        if (fres != FR_OK) {
+            ESP_LOGE(TAG, "f_mount(unmount) failed (%d)", fres);
+            err = ESP_FAIL;
+            break;
+        }
+        remount = true;
+
+        //never let the FAT volume overlap the store: shrink FS -> grow store, shrink store -> grow FS
+        if (store_size_sectors > store_sectors) {
+            err = vfs_fat_jrnl_set_volume_sectors(jrnl_handle, new_fs_sectors);
+            if (err == ESP_OK) {
+                err = esp_jrnl_resize_store(jrnl_handle, store_size_sectors);
+            }
+        }
+        else {
+            err = esp_jrnl_resize_store(jrnl_handle, store_size_sectors);
+            if (err == ESP_OK) {
+                err = vfs_fat_jrnl_set_volume_sectors(jrnl_handle, new_fs_sectors);
+            }
+        }
+    } while(0);
+
+    if (remount) {
+        FRESULT fres = f_mount(&fat_ctx->fs, fat_ctx->fat_drive, 1);
+        if (fres != FR_OK) {
+            ESP_LOGE(TAG, "f_mount after store resizing failed (%d)", fres);
+            if (err == ESP_OK) {
+                err = ESP_FAIL;
+            }
+        }
+    }
+
+    _lock_release(&fat_ctx->lock);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_vfs_fat_jrnl_resize_store failed for %s (0x%08X)", base_path, err);
+    }
+
+    return err;
+}
+
+#ifdef CONFIG_ESP_JRNL_VFS_LATENCY_STATS
+static vfs_fat_jrnl_latency_t* vfs_fat_jrnl_latency_by_path(const char* base_path, esp_err_t* err)
+{
+    size_t ctx = find_context_index_by_path(base_path);
+    if (ctx == FF_VOLUMES) {
+        *err = ESP_ERR_NOT_FOUND;
+        return NULL;
+    }
+
+    uint8_t pdrv = s_fat_ctxs[ctx]->fs.pdrv;
+    vfs_fat_jrnl_latency_t* latency = pdrv < JRNL_MAX_HANDLES && s_jrnl_handles[pdrv] != JRNL_INVALID_HANDLE ? s_jrnl_latency[pdrv] : NULL;
+    *err = latency != NULL ? ESP_OK : ESP_ERR_NOT_SUPPORTED;
+    return latency;
+}
+#endif
+
+esp_err_t esp_vfs_fat_jrnl_get_latency(const char* base_path, esp_vfs_jrnl_op_t op, esp_vfs_jrnl_phase_t phase,
+                                       esp_vfs_jrnl_latency_hist_t* hist, esp_vfs_jrnl_latency_summary_t* summary)
+{
+    if (base_path == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+#ifdef CONFIG_ESP_JRNL_VFS_LATENCY_STATS
+    esp_err_t err;
+    vfs_fat_jrnl_latency_t* latency = vfs_fat_jrnl_latency_by_path(base_path, &err);
+    if (latency == NULL) {
+        return err;
+    }
+    return vfs_fat_jrnl_latency_get(latency, op, phase, hist, summary);
+#else
+    (void)op;
+    (void)phase;
+    (void)hist;
+    (void)summary;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t esp_vfs_fat_jrnl_reset_latency(const char* base_path)
+{
+    if (base_path == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+#ifdef CONFIG_ESP_JRNL_VFS_LATENCY_STATS
+    esp_err_t err;
+    vfs_fat_jrnl_latency_t* latency = vfs_fat_jrnl_latency_by_path(base_path, &err);
+    if (latency == NULL) {
+        return err;
+    }
+    vfs_fat_jrnl_latency_reset(latency);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
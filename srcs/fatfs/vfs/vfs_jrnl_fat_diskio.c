@@ -0,0 +1,237 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Journaled FAT volume on any disk device given by esp_jrnl_diskio_t (eg the emulated disks of esp_jrnl_host_disk.h).
+ * The disk device is owned by the caller, it must outlive the mount.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_vfs.h"
+#include "esp_vfs_fat.h"
+#include "esp_vfs_jrnl_fat.h"
+#include "diskio_impl.h"
+#include "../diskio/diskio_jrnl.h"
+#include "private_include/esp_vfs_jrnl_fat_private.h"
+#include "vfs_fat_internal.h"
+
+static const char* TAG = "vfs_jrnl_fat_diskio";
+
+esp_err_t esp_vfs_fat_diskio_mount_jrnl(const char* base_path,
+                                        const esp_jrnl_diskio_t* diskio_cfg,
+                                        const esp_jrnl_volume_t* volume_cfg,
+                                        const esp_vfs_fat_mount_config_t* mount_config,
+                                        const esp_jrnl_config_t* jrnl_config,
+                                        esp_jrnl_handle_t* jrnl_handle)
+{
+    //sanity check
+    if (base_path == NULL || diskio_cfg == NULL || volume_cfg == NULL || mount_config == NULL ||
+        jrnl_config == NULL || jrnl_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    BYTE pdrv = 0xFF;
+    if (ff_diskio_get_drive(&pdrv) != ESP_OK) {
+        ESP_LOGD(TAG, "the maximum count of volumes is already mounted");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGD(TAG, "using pdrv=%i", pdrv);
+    char drv[3] = {(char) ('0' + pdrv), ':', 0};
+
+    esp_jrnl_handle_t jrnl_handle_temp = JRNL_INVALID_HANDLE;
+#if !CONFIG_IDF_TARGET_LINUX
+    int32_t store_diskio_handle = JRNL_INVALID_HANDLE;
+#endif
+    esp_err_t result = ESP_FAIL;
+
+    do {
+        //1. mount journaling layer (ESP_JRNL_STATUS_FS_INIT)
+        esp_jrnl_config_extended_t jrnl_config_ext = {
+                .user_cfg = *jrnl_config,
+                .fs_volume_id = pdrv,
+                .volume_cfg = *volume_cfg,
+                .diskio_cfg = *diskio_cfg
+        };
+
+        //optional store on a flash partition
+        if (jrnl_config->store_partition_label != NULL) {
+#if CONFIG_IDF_TARGET_LINUX
+            ESP_LOGE(TAG, "Journaling store partition not supported on linux target");
+            result = ESP_ERR_NOT_SUPPORTED;
+            break;
+#else
+            result = vfs_fat_jrnl_store_partition_mount(jrnl_config->store_partition_label, &jrnl_config_ext);
+            if (result != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to mount journaling store partition '%s', error: 0x%08X", jrnl_config->store_partition_label, result);
+                break;
+            }
+            store_diskio_handle = jrnl_config_ext.store_diskio_cfg.diskio_ctrl_handle;
+#endif
+        }
+
+        result = esp_jrnl_mount(&jrnl_config_ext, &jrnl_handle_temp);
+        if (result != ESP_OK) {
+            ESP_LOGE(TAG, "esp_jrnl_mount failed for pdrv=%i, error: 0x%08X)", pdrv, result);
+            break;
+        }
+
+        //2. connect FATFS IO to the journaling component
+        result = ff_diskio_register_jrnl(pdrv, jrnl_handle_temp);
+        if (result != ESP_OK) {
+            ESP_LOGE(TAG, "ff_diskio_register_jrnl failed for pdrv=%i, error: 0x%08X", pdrv, result);
+            break;
+        }
+
+        //3. register FATFS partition
+        FATFS *fs;
+        esp_vfs_fat_conf_t conf = {
+                .base_path = base_path,
+                .fat_drive = drv,
+                .max_files = mount_config->max_files,
+        };
+        result = vfs_fat_register_cfg_jrnl(&conf, jrnl_config->read_only, &fs);
+        //ESP_ERR_INVALID_STATE == already registered with VFS
+        if (result != ESP_ERR_INVALID_STATE && result != ESP_OK) {
+            ESP_LOGE(TAG, "vfs_fat_register failed for pdrv=%i, error: 0x%08X", pdrv, result);
+            break;
+        }
+
+        //4. connect JRNL instance to FATFS volume
+        result = vfs_fat_register_pdrv_jrnl_handle(pdrv, jrnl_handle_temp);
+        if (result != ESP_OK) {
+            ESP_LOGE(TAG, "esp_vfs_fat_register_pdrv_jrnl_handle failed for pdrv=%i, error: 0x%08X", pdrv, result);
+            break;
+        }
+
+        //5. mount the filesystem (format, if not yet done or required by config)
+        bool need_mount_again = jrnl_config->force_fs_format;
+        if (!need_mount_again) {
+            FRESULT fres = f_mount(fs, drv, 1);
+            if (fres != FR_OK) {
+                need_mount_again = (fres == FR_NO_FILESYSTEM || fres == FR_INT_ERR) && mount_config->format_if_mount_failed && !jrnl_config->read_only;
+                if (!need_mount_again) {
+                    ESP_LOGE(TAG, "f_mount failed (%d)", fres);
+                    result = ESP_FAIL;
+                    break;
+                }
+            }
+        }
+
+        if (need_mount_again) {
+            const size_t workbuf_size = 4096;
+            void *workbuf = ff_memalloc(workbuf_size);
+            if (workbuf == NULL) {
+                result = ESP_ERR_NO_MEM;
+                break;
+            }
+
+            size_t alloc_unit_size = esp_vfs_fat_get_allocation_unit_size(volume_cfg->disk_sector_size, mount_config->allocation_unit_size);
+            size_t align_sectors = 1;
+            if (esp_jrnl_get_erase_block_size(jrnl_handle_temp, &align_sectors) != ESP_OK) {
+                align_sectors = 1;
+            }
+
+            MKFS_PARM opt = {(BYTE)(FM_ANY | FM_SFD), 0, align_sectors, 0, alloc_unit_size};
+            FRESULT fresult = f_mkfs(drv, &opt, workbuf, workbuf_size);
+            if (fresult == FR_MKFS_ABORTED && align_sectors > 1) {
+                ESP_LOGW(TAG, "Volume too small for %u sectors alignment, formatting unaligned", (unsigned)align_sectors);
+                opt.align = 1;
+                fresult = f_mkfs(drv, &opt, workbuf, workbuf_size);
+            }
+            ff_memfree(workbuf);
+
+            if (fresult != FR_OK) {
+                ESP_LOGE(TAG, "f_mkfs failed (%d)", fresult);
+                result = ESP_FAIL;
+                break;
+            }
+
+            fresult = f_mount(fs, drv, 0);
+            if (fresult != FR_OK) {
+                ESP_LOGE(TAG, "f_mount after (re)format failed (%d)", fresult);
+                result = ESP_FAIL;
+                break;
+            }
+        }
+
+        //set journal store as ready
+        result = esp_jrnl_set_direct_io(jrnl_handle_temp, false);
+        if (result != ESP_OK) {
+            ESP_LOGE(TAG, "esp_jrnl_set_direct_io failed for pdrv=%i, error: 0x%08X", pdrv, result);
+            break;
+        }
+
+        //6. move the store boundary to the configured size, the volume stays usable with the previous one on failure
+        if (jrnl_config->allow_store_resize && !jrnl_config->read_only) {
+            esp_err_t resize_err = esp_vfs_fat_jrnl_resize_store(base_path, jrnl_config->store_size_sectors);
+            if (resize_err != ESP_OK) {
+                ESP_LOGW(TAG, "Journaling store resizing failed for pdrv=%i (0x%08X), keeping the previous store size", pdrv, resize_err);
+            }
+        }
+    } while(0);
+
+    if (result == ESP_OK) {
+        *jrnl_handle = jrnl_handle_temp;
+        ESP_LOGD(TAG, "Mount successful (pdrv=%i, jrnl_handle=%ld)", pdrv, (long)*jrnl_handle);
+        return ESP_OK;
+    }
+
+    if (jrnl_handle_temp != JRNL_INVALID_HANDLE) {
+        esp_err_t err_temp = esp_vfs_fat_diskio_unmount_jrnl(&jrnl_handle_temp, base_path);
+        if (err_temp != ESP_OK) {
+            ESP_LOGE(TAG, "esp_vfs_fat_diskio_unmount_jrnl() failed with error 0x%08X)", err_temp);
+        }
+    }
+#if !CONFIG_IDF_TARGET_LINUX
+    else if (store_diskio_handle != JRNL_INVALID_HANDLE) {
+        vfs_fat_jrnl_store_partition_unmount(store_diskio_handle);
+    }
+#endif
+
+    return result;
+}
+
+esp_err_t esp_vfs_fat_diskio_unmount_jrnl(esp_jrnl_handle_t* jrnl_handle, const char* base_path)
+{
+    if (jrnl_handle == NULL || *jrnl_handle == JRNL_INVALID_HANDLE || base_path == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int32_t store_diskio_handle;
+    bool store_separate = esp_jrnl_get_store_diskio_handle(*jrnl_handle, &store_diskio_handle) == ESP_OK;
+
+    //disconnect JRNL from FAT volume
+    vfs_fat_unregister_pdrv_jrnl_handle(*jrnl_handle);
+
+    BYTE pdrv = ff_diskio_get_pdrv_jrnl(*jrnl_handle);
+    if (pdrv != 0xff) {
+        char drv[3] = {(char)('0' + pdrv), ':', 0};
+        f_mount(0, drv, 0);
+        ff_diskio_clear_pdrv_jrnl(*jrnl_handle);
+        ff_diskio_unregister(pdrv);
+    }
+
+    esp_err_t err = esp_jrnl_unmount(*jrnl_handle);
+    *jrnl_handle = JRNL_INVALID_HANDLE;
+
+    vfs_fat_unregister_path_jrnl(base_path);
+
+#if !CONFIG_IDF_TARGET_LINUX
+    if (store_separate) {
+        esp_err_t err_store = vfs_fat_jrnl_store_partition_unmount(store_diskio_handle);
+        if (err == ESP_OK) {
+            err = err_store;
+        }
+    }
+#else
+    (void)store_separate;
+#endif
+
+    return err;
+}
@@ -0,0 +1,115 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Latency histograms of the journaled VFS operations (CONFIG_ESP_JRNL_VFS_LATENCY_STATS). Fixed log2-scaled buckets:
+ * recording is a few increments under the lock, the percentiles are derived from the buckets on request.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/lock.h>
+#include "esp_vfs_jrnl_fat.h"
+#include "private_include/esp_vfs_jrnl_fat_private.h"
+
+struct vfs_fat_jrnl_latency {
+    _lock_t lock;
+    esp_vfs_jrnl_latency_hist_t hist[ESP_VFS_JRNL_OP_COUNT][ESP_VFS_JRNL_PHASE_COUNT];
+};
+
+static inline size_t latency_bucket(uint32_t us)
+{
+    size_t bucket = us < 2 ? 0 : (size_t)(31 - __builtin_clz(us));
+    return bucket < ESP_VFS_JRNL_LATENCY_BUCKETS ? bucket : ESP_VFS_JRNL_LATENCY_BUCKETS - 1;
+}
+
+/* latency at given fraction (per mille) of the operations: upper bound of the bucket reaching it */
+uint32_t esp_vfs_fat_jrnl_latency_percentile(const esp_vfs_jrnl_latency_hist_t* hist, uint32_t per_mille)
+{
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = ((uint64_t)hist->count * per_mille + 999) / 1000;
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < ESP_VFS_JRNL_LATENCY_BUCKETS; i++) {
+        cumulative += hist->buckets[i];
+        if (cumulative >= rank) {
+            uint32_t upper = i < ESP_VFS_JRNL_LATENCY_BUCKETS - 1 ? (uint32_t)((2ULL << i) - 1) : UINT32_MAX;
+            return upper < hist->max_us ? upper : hist->max_us;
+        }
+    }
+
+    return hist->max_us;
+}
+
+vfs_fat_jrnl_latency_t* vfs_fat_jrnl_latency_create(void)
+{
+    vfs_fat_jrnl_latency_t* latency = (vfs_fat_jrnl_latency_t*)calloc(1, sizeof(vfs_fat_jrnl_latency_t));
+    if (latency != NULL) {
+        _lock_init(&latency->lock);
+    }
+    return latency;
+}
+
+void vfs_fat_jrnl_latency_delete(vfs_fat_jrnl_latency_t* latency)
+{
+    if (latency == NULL) {
+        return;
+    }
+    _lock_close(&latency->lock);
+    free(latency);
+}
+
+void vfs_fat_jrnl_latency_record(vfs_fat_jrnl_latency_t* latency, esp_vfs_jrnl_op_t op, const uint32_t phase_us[ESP_VFS_JRNL_PHASE_COUNT])
+{
+    _lock_acquire(&latency->lock);
+    for (size_t phase = 0; phase < ESP_VFS_JRNL_PHASE_COUNT; phase++) {
+        esp_vfs_jrnl_latency_hist_t* hist = &latency->hist[op][phase];
+        uint32_t us = phase_us[phase];
+        hist->count++;
+        hist->sum_us += us;
+        if (us > hist->max_us) {
+            hist->max_us = us;
+        }
+        hist->buckets[latency_bucket(us)]++;
+    }
+    _lock_release(&latency->lock);
+}
+
+esp_err_t vfs_fat_jrnl_latency_get(vfs_fat_jrnl_latency_t* latency, esp_vfs_jrnl_op_t op, esp_vfs_jrnl_phase_t phase,
+                                   esp_vfs_jrnl_latency_hist_t* hist, esp_vfs_jrnl_latency_summary_t* summary)
+{
+    if ((unsigned)op >= ESP_VFS_JRNL_OP_COUNT || (unsigned)phase >= ESP_VFS_JRNL_PHASE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_vfs_jrnl_latency_hist_t copy;
+    _lock_acquire(&latency->lock);
+    copy = latency->hist[op][phase];
+    _lock_release(&latency->lock);
+
+    if (hist != NULL) {
+        *hist = copy;
+    }
+
+    if (summary != NULL) {
+        summary->count = copy.count;
+        summary->mean_us = copy.count > 0 ? (uint32_t)(copy.sum_us / copy.count) : 0;
+        summary->p50_us = esp_vfs_fat_jrnl_latency_percentile(&copy, 500);
+        summary->p99_us = esp_vfs_fat_jrnl_latency_percentile(&copy, 990);
+        summary->max_us = copy.max_us;
+    }
+
+    return ESP_OK;
+}
+
+void vfs_fat_jrnl_latency_reset(vfs_fat_jrnl_latency_t* latency)
+{
+    _lock_acquire(&latency->lock);
+    memset(latency->hist, 0, sizeof(latency->hist));
+    _lock_release(&latency->lock);
+}
@@ -0,0 +1,245 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * FAT volume size adjustment for the journaling store resizing. Works directly on the boot sector (BPB) and the FAT area
+ * of an unmounted FAT12/FAT16 volume (FatFS 'FM_SFD' layout, ie no partition table), all the changes are written
+ * in a single journaling transaction.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_jrnl.h"
+#include "private_include/esp_vfs_jrnl_fat_private.h"
+
+static const char* TAG = "vfs_jrnl_fat_resize";
+
+#define BPB_BYTS_PER_SEC    11
+#define BPB_SEC_PER_CLUS    13
+#define BPB_RSVD_SEC_CNT    14
+#define BPB_NUM_FATS        16
+#define BPB_ROOT_ENT_CNT    17
+#define BPB_TOT_SEC16       19
+#define BPB_FAT_SZ16        22
+#define BPB_TOT_SEC32       32
+#define BS_55AA             510
+
+#define FAT_MAX_FAT12       0xFF5   /* max FAT12 clusters (FatFS MAX_FAT12) */
+#define FAT_MAX_FAT16       0xFFF5  /* max FAT16 clusters (FatFS MAX_FAT16) */
+#define FAT_DIR_ENTRY_SIZE  32
+
+static inline uint16_t ld_word(const uint8_t* ptr)
+{
+    return (uint16_t)(ptr[0] | (ptr[1] << 8));
+}
+
+static inline uint32_t ld_dword(const uint8_t* ptr)
+{
+    return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) | ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+static inline void st_word(uint8_t* ptr, uint16_t val)
+{
+    ptr[0] = (uint8_t)val;
+    ptr[1] = (uint8_t)(val >> 8);
+}
+
+static inline void st_dword(uint8_t* ptr, uint32_t val)
+{
+    ptr[0] = (uint8_t)val;
+    ptr[1] = (uint8_t)(val >> 8);
+    ptr[2] = (uint8_t)(val >> 16);
+    ptr[3] = (uint8_t)(val >> 24);
+}
+
+/* FAT entry width in bits for given cluster count (FatFS rules), 32 == FAT32 (not supported) */
+static inline uint32_t fat_entry_bits(uint32_t cluster_count)
+{
+    if (cluster_count <= FAT_MAX_FAT12) {
+        return 12;
+    }
+    return cluster_count <= FAT_MAX_FAT16 ? 16 : 32;
+}
+
+/* byte offset of the FAT entry within the FAT */
+static inline uint32_t fat_entry_offset(uint32_t entry, uint32_t bits)
+{
+    return bits == 12 ? entry + entry / 2 : entry * 2;
+}
+
+/* 'fat' holds the FAT part starting at byte 'fat_offset' */
+static uint32_t fat_entry_get(const uint8_t* fat, uint32_t fat_offset, uint32_t entry, uint32_t bits)
+{
+    const uint8_t* ptr = fat + fat_entry_offset(entry, bits) - fat_offset;
+    if (bits == 16) {
+        return ld_word(ptr);
+    }
+    return (entry & 1) ? (ld_word(ptr) >> 4) : (ld_word(ptr) & 0xFFF);
+}
+
+static void fat_entry_clear(uint8_t* fat, uint32_t fat_offset, uint32_t entry, uint32_t bits)
+{
+    uint8_t* ptr = fat + fat_entry_offset(entry, bits) - fat_offset;
+    if (bits == 16) {
+        st_word(ptr, 0);
+    }
+    else if (entry & 1) {
+        ptr[0] &= 0x0F;
+        ptr[1] = 0;
+    }
+    else {
+        ptr[0] = 0;
+        ptr[1] &= 0xF0;
+    }
+}
+
+esp_err_t vfs_fat_jrnl_set_volume_sectors(const esp_jrnl_handle_t jrnl_handle, const size_t fs_sector_count)
+{
+    size_t sector_size = 0;
+    esp_err_t err = esp_jrnl_get_sector_size(jrnl_handle, &sector_size);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    uint8_t* bpb = (uint8_t*) malloc(sector_size);
+    uint8_t* fat = NULL;
+    bool trans_open = false;
+
+    do {
+        if (bpb == NULL) {
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+
+        err = esp_jrnl_read(jrnl_handle, 0, bpb, 1);
+        if (err != ESP_OK) {
+            break;
+        }
+
+        //FAT boot sector at the volume start
+        if (ld_word(bpb + BS_55AA) != 0xAA55 || (bpb[0] != 0xEB && bpb[0] != 0xE9) || ld_word(bpb + BPB_BYTS_PER_SEC) != sector_size) {
+            ESP_LOGE(TAG, "No FAT boot sector found on the volume");
+            err = ESP_ERR_NOT_FOUND;
+            break;
+        }
+
+        uint32_t sec_per_clus = bpb[BPB_SEC_PER_CLUS];
+        uint32_t rsvd_sec_cnt = ld_word(bpb + BPB_RSVD_SEC_CNT);
+        uint32_t num_fats = bpb[BPB_NUM_FATS];
+        uint32_t fat_size = ld_word(bpb + BPB_FAT_SZ16);
+        uint32_t tot_sec = ld_word(bpb + BPB_TOT_SEC16);
+        if (tot_sec == 0) {
+            tot_sec = ld_dword(bpb + BPB_TOT_SEC32);
+        }
+        if (fat_size == 0 || sec_per_clus == 0 || num_fats == 0) {
+            ESP_LOGE(TAG, "FAT32 or invalid FAT volume, resizing not supported");
+            err = ESP_ERR_NOT_SUPPORTED;
+            break;
+        }
+
+        uint32_t root_dir_sectors = (ld_word(bpb + BPB_ROOT_ENT_CNT) * FAT_DIR_ENTRY_SIZE + sector_size - 1) / sector_size;
+        uint32_t sys_sectors = rsvd_sec_cnt + num_fats * fat_size + root_dir_sectors;
+        if (fs_sector_count <= sys_sectors + sec_per_clus || tot_sec <= sys_sectors) {
+            ESP_LOGE(TAG, "FAT volume size %u too small", (unsigned)fs_sector_count);
+            err = ESP_ERR_INVALID_SIZE;
+            break;
+        }
+
+        if (fs_sector_count == tot_sec) {
+            break;
+        }
+
+        //the FAT type is given by the cluster count, it must stay the same. The existing FAT must be big enough
+        uint32_t old_clusters = (tot_sec - sys_sectors) / sec_per_clus;
+        uint32_t new_clusters = (fs_sector_count - sys_sectors) / sec_per_clus;
+        uint32_t bits = fat_entry_bits(old_clusters);
+        if (bits == 32 || bits != fat_entry_bits(new_clusters) || (uint64_t)fat_size * sector_size * 8 / bits < new_clusters + 2) {
+            ESP_LOGE(TAG, "FAT volume can't be resized to %u sectors (FAT%u, %u -> %u clusters)", (unsigned)fs_sector_count, (unsigned)bits, (unsigned)old_clusters, (unsigned)new_clusters);
+            err = ESP_ERR_INVALID_SIZE;
+            break;
+        }
+
+        //FAT entries of the clusters being removed must be free, the ones being added are cleared (not maintained out of the volume)
+        uint32_t first_entry = (new_clusters < old_clusters ? new_clusters : old_clusters) + 2;
+        uint32_t end_entry = (new_clusters < old_clusters ? old_clusters : new_clusters) + 2;
+        uint32_t first_fat_sector = fat_entry_offset(first_entry, bits) / sector_size;
+        uint32_t fat_sectors = (fat_entry_offset(end_entry - 1, bits) + 1) / sector_size - first_fat_sector + 1;
+
+        fat = (uint8_t*) calloc(fat_sectors + 1, sector_size);
+        if (fat == NULL) {
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+        err = esp_jrnl_read(jrnl_handle, rsvd_sec_cnt + first_fat_sector, fat, fat_sectors);
+        if (err != ESP_OK) {
+            break;
+        }
+
+        uint32_t fat_offset = first_fat_sector * sector_size;
+        bool fat_dirty = false;
+        for (uint32_t entry = first_entry; entry < end_entry && err == ESP_OK; entry++) {
+            if (fat_entry_get(fat, fat_offset, entry, bits) == 0) {
+                continue;
+            }
+            if (new_clusters < old_clusters) {
+                ESP_LOGE(TAG, "Cluster %u in use, FAT volume can't be shrunk to %u sectors", (unsigned)entry, (unsigned)fs_sector_count);
+                err = ESP_ERR_INVALID_STATE;
+            }
+            else {
+                fat_entry_clear(fat, fat_offset, entry, bits);
+                fat_dirty = true;
+            }
+        }
+        if (err != ESP_OK) {
+            break;
+        }
+
+        if (fs_sector_count < 0x10000) {
+            st_word(bpb + BPB_TOT_SEC16, (uint16_t)fs_sector_count);
+            st_dword(bpb + BPB_TOT_SEC32, 0);
+        }
+        else {
+            st_word(bpb + BPB_TOT_SEC16, 0);
+            st_dword(bpb + BPB_TOT_SEC32, (uint32_t)fs_sector_count);
+        }
+
+        //all the changes applied at once
+        err = esp_jrnl_start(jrnl_handle);
+        if (err != ESP_OK) {
+            break;
+        }
+        trans_open = true;
+
+        err = esp_jrnl_write(jrnl_handle, bpb, 0, 1);
+        for (uint32_t i = 0; i < num_fats && fat_dirty && err == ESP_OK; i++) {
+            err = esp_jrnl_write(jrnl_handle, fat, rsvd_sec_cnt + i * fat_size + first_fat_sector, fat_sectors);
+        }
+        if (err != ESP_OK) {
+            break;
+        }
+
+        trans_open = false;
+        err = esp_jrnl_stop(jrnl_handle, true);
+        if (err != ESP_OK) {
+            break;
+        }
+
+        ESP_LOGI(TAG, "FAT volume resized: %u -> %u sectors (%u -> %u clusters)", (unsigned)tot_sec, (unsigned)fs_sector_count, (unsigned)old_clusters, (unsigned)new_clusters);
+    } while(0);
+
+    if (trans_open) {
+        esp_jrnl_stop(jrnl_handle, false);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "vfs_fat_jrnl_set_volume_sectors failed (0x%08X)", err);
+    }
+
+    free(fat);
+    free(bpb);
+
+    return err;
+}
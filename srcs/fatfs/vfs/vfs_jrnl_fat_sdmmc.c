@@ -51,6 +51,18 @@ static esp_err_t jrnl_sdmmc_erase(int32_t handle, size_t start_addr, size_t size
     return sdmmc_erase_sectors(card, start_addr / sector_size, size / sector_size, SDMMC_ERASE_ARG);
 }
 
+/* unused sectors: DISCARD if the card supports it (no erase state guaranteed, but the card doesn't need erasing anyway) */
+static esp_err_t jrnl_sdmmc_trim(int32_t handle, size_t start_addr, size_t size)
+{
+    sdmmc_card_t* card = (sdmmc_card_t*)handle;
+    size_t sector_size = card->csd.sector_size;
+    if (start_addr % sector_size != 0 || size % sector_size != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sdmmc_erase_arg_t arg = sdmmc_can_discard(card) == ESP_OK ? SDMMC_DISCARD_ARG : SDMMC_ERASE_ARG;
+    return sdmmc_erase_sectors(card, start_addr / sector_size, size / sector_size, arg);
+}
+
 esp_err_t esp_vfs_fat_sdmmc_mount_jrnl(const char* base_path,
                                        const sdmmc_host_t* host_config,
                                        const void* slot_config,
@@ -62,6 +74,7 @@ esp_err_t esp_vfs_fat_sdmmc_mount_jrnl(const char* base_path,
     esp_err_t err = ESP_OK;
     sdmmc_card_t* card = NULL;
     esp_jrnl_handle_t jrnl_handle_temp = JRNL_INVALID_HANDLE;
+    int32_t store_diskio_handle = JRNL_INVALID_HANDLE;
     BYTE pdrv = 0xFF;
 
     if (base_path == NULL || host_config == NULL || mount_config == NULL || 
@@ -116,7 +129,9 @@ esp_err_t esp_vfs_fat_sdmmc_mount_jrnl(const char* base_path,
         .diskio_ctrl_handle = (int32_t)card,
         .disk_read = jrnl_sdmmc_read,
         .disk_write = jrnl_sdmmc_write,
-        .disk_erase_range = jrnl_sdmmc_erase
+        .disk_erase_range = jrnl_sdmmc_erase,
+        .disk_trim = jrnl_sdmmc_trim,
+        .erase_block_size = (size_t)card->ssr.alloc_unit_kb * 1024    //0 for MMC cards (no SD status)
     };
 
     esp_jrnl_volume_t volume_cfg = {
@@ -138,6 +153,16 @@ esp_err_t esp_vfs_fat_sdmmc_mount_jrnl(const char* base_path,
         .diskio_cfg = diskio_cfg
     };
 
+    //optional store on internal flash partition (sector size must match the card, see CONFIG_WL_SECTOR_SIZE)
+    if (jrnl_config->store_partition_label != NULL) {
+        err = vfs_fat_jrnl_store_partition_mount(jrnl_config->store_partition_label, &jrnl_config_ext);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "vfs_fat_jrnl_store_partition_mount failed (0x%x)", err);
+            goto fail;
+        }
+        store_diskio_handle = jrnl_config_ext.store_diskio_cfg.diskio_ctrl_handle;
+    }
+
     err = esp_jrnl_mount(&jrnl_config_ext, &jrnl_handle_temp);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "esp_jrnl_mount failed (0x%x)", err);
@@ -156,7 +181,7 @@ esp_err_t esp_vfs_fat_sdmmc_mount_jrnl(const char* base_path,
         .fat_drive = drv,
         .max_files = mount_config->max_files,
     };
-    err = vfs_fat_register_cfg_jrnl(&conf, &fs);
+    err = vfs_fat_register_cfg_jrnl(&conf, jrnl_config->read_only, &fs);
     if (err != ESP_ERR_INVALID_STATE && err != ESP_OK) {
         ESP_LOGE(TAG, "vfs_fat_register failed (0x%x)", err);
         goto fail;
@@ -172,7 +197,7 @@ esp_err_t esp_vfs_fat_sdmmc_mount_jrnl(const char* base_path,
     if (!need_mount_again) {
         FRESULT fres = f_mount(fs, drv, 1);
         if (fres != FR_OK) {
-            need_mount_again = (fres == FR_NO_FILESYSTEM || fres == FR_INT_ERR) && mount_config->format_if_mount_failed;
+            need_mount_again = (fres == FR_NO_FILESYSTEM || fres == FR_INT_ERR) && mount_config->format_if_mount_failed && !jrnl_config->read_only;
             if (!need_mount_again) {
                 ESP_LOGE(TAG, "f_mount failed (%d)", fres);
                 err = ESP_FAIL;
@@ -190,8 +215,18 @@ esp_err_t esp_vfs_fat_sdmmc_mount_jrnl(const char* base_path,
             goto fail;
         }
         
-        const MKFS_PARM opt = {(BYTE)(FM_ANY | FM_SFD), 0, 0, 0, alloc_unit_size};
+        //data area aligned to the card's allocation unit, small volumes fall back to the unaligned layout
+        size_t align_sectors = 1;
+        if (esp_jrnl_get_erase_block_size(jrnl_handle_temp, &align_sectors) != ESP_OK) {
+            align_sectors = 1;
+        }
+        MKFS_PARM opt = {(BYTE)(FM_ANY | FM_SFD), 0, align_sectors, 0, alloc_unit_size};
         FRESULT fres = f_mkfs(drv, &opt, workbuf, workbuf_size);
+        if (fres == FR_MKFS_ABORTED && align_sectors > 1) {
+            ESP_LOGW(TAG, "Volume too small for %u sectors alignment, formatting unaligned", (unsigned)align_sectors);
+            opt.align = 1;
+            fres = f_mkfs(drv, &opt, workbuf, workbuf_size);
+        }
         ff_memfree(workbuf);
         if (fres != FR_OK) {
             ESP_LOGE(TAG, "f_mkfs failed (%d)", fres);
@@ -213,6 +248,14 @@ esp_err_t esp_vfs_fat_sdmmc_mount_jrnl(const char* base_path,
         goto fail;
     }
 
+    //move the store boundary to the configured size, the volume stays usable with the previous one on failure
+    if (jrnl_config->allow_store_resize && !jrnl_config->read_only) {
+        esp_err_t resize_err = esp_vfs_fat_jrnl_resize_store(base_path, jrnl_config->store_size_sectors);
+        if (resize_err != ESP_OK) {
+            ESP_LOGW(TAG, "Journaling store resizing failed (0x%x), keeping the previous store size", resize_err);
+        }
+    }
+
     *jrnl_handle = jrnl_handle_temp;
     return ESP_OK;
 
@@ -220,6 +263,9 @@ fail:
     if (jrnl_handle_temp != JRNL_INVALID_HANDLE) {
         esp_vfs_fat_sdmmc_unmount_jrnl(&jrnl_handle_temp, base_path);
     } else {
+        if (store_diskio_handle != JRNL_INVALID_HANDLE) {
+            vfs_fat_jrnl_store_partition_unmount(store_diskio_handle);
+        }
         if (card) {
             if (card->host.flags & SDMMC_HOST_FLAG_SPI) {
                 sdspi_host_remove_device(card->host.slot);
@@ -247,6 +293,9 @@ esp_err_t esp_vfs_fat_sdmmc_unmount_jrnl(esp_jrnl_handle_t* jrnl_handle, const c
     }
     sdmmc_card_t* card = (sdmmc_card_t*)card_handle_int;
 
+    int32_t store_diskio_handle;
+    bool store_separate = esp_jrnl_get_store_diskio_handle(*jrnl_handle, &store_diskio_handle) == ESP_OK;
+
     vfs_fat_unregister_pdrv_jrnl_handle(*jrnl_handle);
 
     BYTE pdrv = ff_diskio_get_pdrv_jrnl(*jrnl_handle);
@@ -262,6 +311,13 @@ esp_err_t esp_vfs_fat_sdmmc_unmount_jrnl(esp_jrnl_handle_t* jrnl_handle, const c
 
     vfs_fat_unregister_path_jrnl(base_path);
 
+    if (store_separate) {
+        esp_err_t err_store = vfs_fat_jrnl_store_partition_unmount(store_diskio_handle);
+        if (err == ESP_OK) {
+            err = err_store;
+        }
+    }
+
     if (card) {
         if (card->host.flags & SDMMC_HOST_FLAG_SPI) {
             sdspi_host_remove_device(card->host.slot);
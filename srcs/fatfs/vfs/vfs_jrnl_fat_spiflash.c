@@ -50,6 +50,7 @@ esp_err_t esp_vfs_fat_spiflash_mount_jrnl(const char* base_path,
     esp_jrnl_handle_t jrnl_handle_temp = JRNL_INVALID_HANDLE;
     esp_err_t result = ESP_FAIL;
     wl_handle_t wl_handle = WL_INVALID_HANDLE;
+    int32_t store_wl_handle = WL_INVALID_HANDLE;
 
     do {
         //1. install wear levelling
@@ -69,6 +70,16 @@ esp_err_t esp_vfs_fat_spiflash_mount_jrnl(const char* base_path,
                 .diskio_cfg = ESP_JRNL_DISKIO_DEFAULT_CONFIG(wl_handle)
         };
 
+        //optional store on a separate partition
+        if (jrnl_config->store_partition_label != NULL) {
+            result = vfs_fat_jrnl_store_partition_mount(jrnl_config->store_partition_label, &jrnl_config_ext);
+            if (result != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to mount journaling store partition '%s', error: 0x%08X", jrnl_config->store_partition_label, result);
+                break;
+            }
+            store_wl_handle = jrnl_config_ext.store_diskio_cfg.diskio_ctrl_handle;
+        }
+
         result = esp_jrnl_mount(&jrnl_config_ext, &jrnl_handle_temp);
         if (result != ESP_OK) {
             ESP_LOGE(TAG, "esp_jrnl_mount failed for pdrv=%i, error: 0x%08X)", pdrv, result);
@@ -89,7 +100,7 @@ esp_err_t esp_vfs_fat_spiflash_mount_jrnl(const char* base_path,
                 .fat_drive = drv,
                 .max_files = mount_config->max_files,
         };
-        result = vfs_fat_register_cfg_jrnl(&conf, &fs);
+        result = vfs_fat_register_cfg_jrnl(&conf, jrnl_config->read_only, &fs);
         //ESP_ERR_INVALID_STATE == already registered with VFS
         if (result != ESP_ERR_INVALID_STATE && result != ESP_OK) {
             ESP_LOGE(TAG, "vfs_fat_register failed for pdrv=%i, error: 0x%08X", pdrv, result);
@@ -111,7 +122,7 @@ esp_err_t esp_vfs_fat_spiflash_mount_jrnl(const char* base_path,
             FRESULT fres = f_mount(fs, drv, 1);
             if (fres != FR_OK) {
                 need_mount_again =
-                        (fres == FR_NO_FILESYSTEM || fres == FR_INT_ERR) && mount_config->format_if_mount_failed;
+                        (fres == FR_NO_FILESYSTEM || fres == FR_INT_ERR) && mount_config->format_if_mount_failed && !jrnl_config->read_only;
                 if (!need_mount_again) {
                     ESP_LOGE(TAG, "f_mount failed (%d)", fres);
                     result = ESP_FAIL;
@@ -131,10 +142,20 @@ esp_err_t esp_vfs_fat_spiflash_mount_jrnl(const char* base_path,
             }
 
             size_t alloc_unit_size = esp_vfs_fat_get_allocation_unit_size(CONFIG_WL_SECTOR_SIZE, mount_config->allocation_unit_size);
-            ESP_LOGD(TAG, "Formatting FATFS partition (allocation unit size=%d)", alloc_unit_size);
+            size_t align_sectors = 1;
+            if (esp_jrnl_get_erase_block_size(jrnl_handle_temp, &align_sectors) != ESP_OK) {
+                align_sectors = 1;
+            }
+            ESP_LOGD(TAG, "Formatting FATFS partition (allocation unit size=%d, alignment=%d sectors)", alloc_unit_size, align_sectors);
 
-            const MKFS_PARM opt = {(BYTE)(FM_ANY | FM_SFD), 0, 0, 0, alloc_unit_size};
+            //data area and clusters aligned to the flash erase sectors (512B WL sectors would straddle them otherwise)
+            MKFS_PARM opt = {(BYTE)(FM_ANY | FM_SFD), 0, align_sectors, 0, alloc_unit_size};
             FRESULT fresult = f_mkfs(drv, &opt, workbuf, workbuf_size);
+            if (fresult == FR_MKFS_ABORTED && align_sectors > 1) {
+                ESP_LOGW(TAG, "Partition too small for %d sectors alignment, formatting unaligned", align_sectors);
+                opt.align = 1;
+                fresult = f_mkfs(drv, &opt, workbuf, workbuf_size);
+            }
 
             ff_memfree(workbuf);
             workbuf = NULL;
@@ -160,6 +181,14 @@ esp_err_t esp_vfs_fat_spiflash_mount_jrnl(const char* base_path,
             ESP_LOGE(TAG, "esp_jrnl_set_direct_io failed for pdrv=%i, error: 0x%08X", pdrv, result);
             break;
         }
+
+        //7. move the store boundary to the configured size, the volume stays usable with the previous one on failure
+        if (jrnl_config->allow_store_resize && !jrnl_config->read_only) {
+            esp_err_t resize_err = esp_vfs_fat_jrnl_resize_store(base_path, jrnl_config->store_size_sectors);
+            if (resize_err != ESP_OK) {
+                ESP_LOGW(TAG, "Journaling store resizing failed for pdrv=%i (0x%08X), keeping the previous store size", pdrv, resize_err);
+            }
+        }
     } while(0);
 
     if (result == ESP_OK) {
@@ -167,6 +196,10 @@ esp_err_t esp_vfs_fat_spiflash_mount_jrnl(const char* base_path,
         ESP_LOGD(TAG, "Mount successful (pdrv=%i, jrnl_handle=%ld)", pdrv, *jrnl_handle);
     }
     else {
+        //the store partition belongs to the journaling instance once mounted
+        if (jrnl_handle_temp == JRNL_INVALID_HANDLE && store_wl_handle != WL_INVALID_HANDLE) {
+            vfs_fat_jrnl_store_partition_unmount(store_wl_handle);
+        }
         esp_err_t err_temp = esp_vfs_fat_spiflash_unmount_jrnl(&jrnl_handle_temp, base_path);
         if (err_temp != ESP_OK) {
             ESP_LOGE(TAG, "esp_vfs_fat_spiflash_unmount_jrnl() failed with error 0x%08X)", err_temp);
@@ -211,6 +244,11 @@ esp_err_t esp_vfs_fat_spiflash_unmount_jrnl(esp_jrnl_handle_t* jrnl_handle, cons
         goto unmount_exit;
     }
 
+    int32_t store_wl_handle = WL_INVALID_HANDLE;
+    if (esp_jrnl_get_store_diskio_handle(*jrnl_handle, &store_wl_handle) != ESP_OK) {
+        store_wl_handle = WL_INVALID_HANDLE;
+    }
+
     //unmount JRNL instance
     err = esp_jrnl_unmount(*jrnl_handle);
     if (err != ESP_OK) {
@@ -219,8 +257,12 @@ esp_err_t esp_vfs_fat_spiflash_unmount_jrnl(esp_jrnl_handle_t* jrnl_handle, cons
 
     *jrnl_handle = JRNL_INVALID_HANDLE;
 
-    //unmount WL component & unregister base_path
+    //unmount WL component(s) & unregister base_path
     esp_err_t err_drv = wl_unmount(wl_handle);
+    if (store_wl_handle != WL_INVALID_HANDLE) {
+        esp_err_t err_store = vfs_fat_jrnl_store_partition_unmount(store_wl_handle);
+        if (err_drv == ESP_OK) err_drv = err_store;
+    }
     err = vfs_fat_unregister_path_jrnl(base_path);
     if (err == ESP_OK) err = err_drv;
 
@@ -228,3 +270,33 @@ unmount_exit:
     ESP_LOGD(TAG, "Unmounting JRNL done with 0x%08X", err);
     return err;
 }
+
+esp_err_t vfs_fat_jrnl_store_partition_mount(const char* partition_label, esp_jrnl_config_extended_t* jrnl_config_ext)
+{
+    const esp_partition_t *store_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partition_label);
+    if (store_partition == NULL) {
+        ESP_LOGE(TAG, "Failed to find journaling store partition (type='data', partition_label='%s'). Check the partition table.", partition_label);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    wl_handle_t store_wl_handle = WL_INVALID_HANDLE;
+    esp_err_t result = wl_mount(store_partition, &store_wl_handle);
+    if (result != ESP_OK) {
+        ESP_LOGE(TAG, "failed to mount wear levelling layer of the store partition, error: 0x%08X", result);
+        return result;
+    }
+
+    esp_jrnl_diskio_t store_diskio_cfg = ESP_JRNL_DISKIO_DEFAULT_CONFIG(store_wl_handle);
+    esp_jrnl_volume_t store_volume_cfg = ESP_JRNL_VOLUME_DEFAULT_CONFIG(store_wl_handle);
+    jrnl_config_ext->store_diskio_cfg = store_diskio_cfg;
+    jrnl_config_ext->store_volume_cfg = store_volume_cfg;
+
+    ESP_LOGD(TAG, "Journaling store partition '%s' mounted (wl_handle=%ld, size=%" PRIu32 ")", partition_label, store_wl_handle, (uint32_t)store_volume_cfg.volume_size);
+
+    return ESP_OK;
+}
+
+esp_err_t vfs_fat_jrnl_store_partition_unmount(int32_t store_diskio_handle)
+{
+    return wl_unmount((wl_handle_t)store_diskio_handle);
+}
@@ -28,7 +28,6 @@
 
 static const char* TAG = "test_esp_jrnl_adv";
 static esp_jrnl_handle_t s_jrnl_handle = JRNL_INVALID_HANDLE;
-extern esp_jrnl_instance_t* s_jrnl_instance_ptrs[JRNL_MAX_HANDLES];
 
 const char* s_basepath = "/spiflash";
 const char* s_partlabel = "jrnl";
@@ -36,6 +35,16 @@ const char* s_partlabel = "jrnl";
 static uint8_t* s_buf_write = NULL;
 static uint8_t* s_buf_read = NULL;
 
+static esp_jrnl_instance_t* test_get_jrnl_instance(const esp_jrnl_handle_t handle)
+{
+    //instance stays valid until unmounted by the test itself
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    if (jrnl_get_instance(handle, __func__, &inst_ptr) == ESP_OK) {
+        jrnl_put_instance(inst_ptr);
+    }
+    return inst_ptr;
+}
+
 static void test_memset_pattern(const uint8_t* pattern, const size_t pattern_size, uint8_t* out_buffer, const size_t out_buffer_size)
 {
     assert(pattern_size < out_buffer_size);
@@ -49,7 +58,7 @@ static void test_memset_pattern(const uint8_t* pattern, const size_t pattern_siz
 static void test_check_inst_master_ready(esp_jrnl_handle_t handle)
 {
     TEST_ASSERT_NOT_EQUAL(JRNL_INVALID_HANDLE, handle);
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[handle];
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(handle);
     TEST_ASSERT_NOT_NULL(inst_ptr);
     TEST_ASSERT_EQUAL(inst_ptr->master.status, ESP_JRNL_STATUS_TRANS_READY);
     TEST_ASSERT_EQUAL(inst_ptr->master.next_free_sector, 0);
@@ -70,7 +79,9 @@ static esp_err_t test_read_jrnl_master_sector(esp_jrnl_master_t* master)
         return err;
     }
 
-    err = wl_read(wl_handle, wl_size(wl_handle) - wl_sector_size(wl_handle), (void*)master, sizeof(esp_jrnl_master_t));
+    esp_jrnl_diskio_t diskio = ESP_JRNL_DISKIO_DEFAULT_CONFIG(wl_handle);
+    esp_jrnl_volume_t volume = ESP_JRNL_VOLUME_DEFAULT_CONFIG(wl_handle);
+    err = jrnl_read_master(&diskio, &volume, master);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to read jrnl master record from disk, error: 0x%08X", err);
     }
@@ -119,7 +130,7 @@ static void test_setup_jrnl(esp_jrnl_config_t* jrnl_config)
     esp_jrnl_config_t* jrnl_config_def = NULL;
 
     if (jrnl_config == NULL) {
-        jrnl_config_def = (esp_jrnl_config_t*)malloc(sizeof(esp_jrnl_config_t));
+        jrnl_config_def = (esp_jrnl_config_t*)calloc(1, sizeof(esp_jrnl_config_t));
         TEST_ASSERT(jrnl_config_def != NULL);
 
         jrnl_config_def->store_size_sectors = 32;
@@ -153,7 +164,7 @@ static void jrnl_create_file_early_exit(uint32_t flags)
 {
     //create fresh FatFS partition
     test_setup_jrnl(NULL);
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[s_jrnl_handle];
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
     TEST_ASSERT_NOT_NULL(inst_ptr);
 
     //1. when testing the fclose() scenario, don't interrupt the first transaction
@@ -313,7 +324,7 @@ static void jrnl_fwrite_file_early_exit(uint32_t flags)
     TEST_ASSERT_EQUAL(-1, stat(test_file_name, &f_stat));
 
     //get the journal store instance
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[s_jrnl_handle];
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
     TEST_ASSERT_NOT_NULL(inst_ptr);
     inst_ptr->test_config = flags;
 #ifdef CONFIG_ESP_JRNL_DEBUG_PRINT
@@ -427,7 +438,7 @@ static void jrnl_mkdir_early_exit(uint32_t flags)
 {
     //create clean FatFS partition
     test_setup_jrnl(NULL);
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[s_jrnl_handle];
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
     TEST_ASSERT_NOT_NULL(inst_ptr);
 
     //configure the jrnl component to exit transactions preliminary
@@ -555,7 +566,7 @@ static void jrnl_rename_early_exit(uint32_t flags)
     TEST_ASSERT_EQUAL(-1, stat(test_file_name, &f_stat));
 
     //get the journal store instance
-    esp_jrnl_instance_t *inst_ptr = s_jrnl_instance_ptrs[s_jrnl_handle];
+    esp_jrnl_instance_t *inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
     TEST_ASSERT_NOT_NULL(inst_ptr);
     inst_ptr->test_config = flags;
 #ifdef CONFIG_ESP_JRNL_DEBUG_PRINT
@@ -650,6 +661,60 @@ TEST_CASE_MULTIPLE_STAGES("RENAME FILE - continue replay and exit", "[jrnl_adv]"
 TEST_CASE_MULTIPLE_STAGES("RENAME FILE - finish replay and exit", "[jrnl_adv]", jrnl_rename_unfinish_5, jrnl_rename_unfinish_check_committing);
 
 
+/* *******************************************************************************************
+ * PACKED RECORDS
+ *
+ * Small compressed records are packed in the tail sector buffered in RAM, which is flushed to the store on commit.
+ * A transaction of such records only has nothing in the store yet when interrupted before the commit
+ * (master.next_free_sector == 0), the power-off must roll it back all the same
+ */
+
+/* create an empty file with compressed records (the directory entry update fits inline) and skip the commit of fclose() */
+static void jrnl_packed_create_skip_commit(void)
+{
+    esp_jrnl_config_t jrnl_cfg = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_cfg.overwrite_existing = true;
+    jrnl_cfg.force_fs_format = true;
+    jrnl_cfg.replay_journal_after_mount = false;
+    jrnl_cfg.payload_codec = ESP_JRNL_CODEC_LZF;
+    test_setup_jrnl(&jrnl_cfg);
+
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
+    TEST_ASSERT_NOT_NULL(inst_ptr);
+
+    char test_file_name[64] = {0};
+    snprintf(test_file_name, sizeof(test_file_name), "%s/%s", s_basepath, "testfil4.txt");
+    FILE* testfile = fopen(test_file_name, "w+");
+    TEST_ASSERT_NOT_NULL(testfile);
+
+    inst_ptr->test_config = ESP_JRNL_TEST_STOP_SKIP_COMMIT;
+    fclose(testfile);
+    TEST_FAIL_MESSAGE("transaction of packed records not interrupted");
+}
+
+/* the transaction stayed open without any store sector, the mount drops it and the file doesn't exist */
+static void jrnl_packed_create_check(void)
+{
+    esp_jrnl_master_t jrnl_master;
+    TEST_ESP_OK(test_read_jrnl_master_sector(&jrnl_master));
+    TEST_ASSERT_EQUAL(ESP_JRNL_STATUS_TRANS_OPEN, jrnl_master.status);
+    TEST_ASSERT_EQUAL_UINT32(0, jrnl_master.next_free_sector);
+
+    esp_jrnl_config_t jrnl_cfg = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_cfg.payload_codec = ESP_JRNL_CODEC_LZF;
+    test_setup_jrnl(&jrnl_cfg);
+    test_check_inst_master_ready(s_jrnl_handle);
+
+    char test_file_name[64] = {0};
+    snprintf(test_file_name, sizeof(test_file_name), "%s/%s", s_basepath, "testfil4.txt");
+    TEST_ASSERT(fopen(test_file_name, "r") == NULL);
+    TEST_ASSERT(errno == ENOENT);
+
+    test_teardown_jrnl();
+}
+
+TEST_CASE_MULTIPLE_STAGES("CREATE FILE (packed records) - skip commit", "[jrnl_adv]", jrnl_packed_create_skip_commit, jrnl_packed_create_check);
+
 void app_main(void)
 {
     unity_run_menu();
@@ -14,18 +14,21 @@
 #include "unity_fixture.h"
 #include "esp_log.h"
 #include "esp_random.h"
+#include "esp_heap_caps.h"
 #include "esp_vfs_fat.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_vfs_jrnl_fat.h"
 #include "esp_jrnl_internal.h"
+#include "esp_jrnl_trace.h"
+#include "esp_jrnl_checksum.h"
 #include "sdkconfig.h"
 #include <errno.h>
 #include "esp_crc.h"
 
 static const char* TAG = "test_esp_jrnl_basic";
 static esp_jrnl_handle_t s_jrnl_handle;
-extern esp_jrnl_instance_t* s_jrnl_instance_ptrs[JRNL_MAX_HANDLES];
 
 const char* s_basepath = "/spiflash";
 const char* s_partlabel = "jrnl";
@@ -33,6 +36,16 @@ const char* s_partlabel = "jrnl";
 static uint8_t* s_buf_write = NULL;
 static uint8_t* s_buf_read = NULL;
 
+static esp_jrnl_instance_t* test_get_jrnl_instance(const esp_jrnl_handle_t handle)
+{
+    //instance stays valid until unmounted by the test itself
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    if (jrnl_get_instance(handle, __func__, &inst_ptr) == ESP_OK) {
+        jrnl_put_instance(inst_ptr);
+    }
+    return inst_ptr;
+}
+
 static void test_setup(void)
 {
     esp_vfs_fat_sdmmc_mount_config_t mount_config = {
@@ -67,9 +80,11 @@ static esp_err_t test_get_jrnl_master(const esp_jrnl_handle_t handle, esp_jrnl_m
     size_t wlpartsize = wl_size(wl_handle);
     TEST_ASSERT(wlpartsize > 0);
 
-    esp_err_t err = wl_read(wl_handle, wlpartsize-wlsectorsize, (void*)jrnl_master, sizeof(esp_jrnl_master_t));
+    esp_jrnl_diskio_t diskio = ESP_JRNL_DISKIO_DEFAULT_CONFIG(wl_handle);
+    esp_jrnl_volume_t volume = ESP_JRNL_VOLUME_DEFAULT_CONFIG(wl_handle);
+    esp_err_t err = jrnl_read_master(&diskio, &volume, jrnl_master);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "wl_read (test_get_jrnl_master) failed with 0x%08X", err);
+        ESP_LOGE(TAG, "jrnl_read_master (test_get_jrnl_master) failed with 0x%08X", err);
     }
 
     return err;
@@ -134,9 +149,10 @@ TEST(jrnl_basic, jrnl_creation)
     size_t wlsectorcount = wlpartsize/wlsectorsize;
     ESP_LOGV(TAG, "target partition size: %lu, wl sector size: %u, wl partition size: %u, wl sector count: %u", jrnl_partition->size, wlsectorsize, wlpartsize, wlsectorcount);
 
-    //jrnl master is stored in the last sector of available area within WL partition
+    //jrnl master is stored in one of the last 2 sectors of available area within WL partition
     esp_jrnl_master_t jrnl_master;
-    TEST_ESP_OK(wl_read(wl_handle, wlpartsize-wlsectorsize, (void*)&jrnl_master, sizeof(esp_jrnl_master_t)));
+    TEST_ESP_OK(test_get_jrnl_master(s_jrnl_handle, &jrnl_master));
+    TEST_ASSERT(jrnl_master.generation > 0);
 
 #ifdef CONFIG_ESP_JRNL_DEBUG_PRINT
     print_jrnl_master(&jrnl_master);
@@ -167,7 +183,7 @@ TEST(jrnl_basic, internal_reads_writes)
     esp_jrnl_master_t jrnl_master;
     TEST_ESP_OK(test_get_jrnl_master(s_jrnl_handle, &jrnl_master));
 
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[s_jrnl_handle];
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
     TEST_ASSERT_NOT_NULL(inst_ptr);
 
     TEST_ASSERT(jrnl_get_target_disk_sector(inst_ptr, 1) == jrnl_master.store_volume_offset_sector + 1);
@@ -196,14 +212,15 @@ TEST(jrnl_basic, reset_master)
     esp_jrnl_master_t jrnl_master;
     TEST_ESP_OK(test_get_jrnl_master(s_jrnl_handle, &jrnl_master));
 
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[s_jrnl_handle];
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
     TEST_ASSERT_NOT_NULL(inst_ptr);
 
-    //modify master record data
+    //modify master record data (corrupt the active slot)
+    uint32_t active_slot_sector = JRNL_MASTER_SLOT_SECTOR(&jrnl_master, JRNL_MASTER_SLOT(jrnl_master.generation));
     jrnl_master.status = ESP_JRNL_STATUS_TRANS_OPEN;
     jrnl_master.next_free_sector = 0xFFFFFFFF;
     jrnl_master.jrnl_magic_mark = 0xFFFFFFFF;
-    TEST_ESP_OK(jrnl_write_internal(inst_ptr, (const uint8_t*)&jrnl_master, jrnl_master.store_size_sectors - 1, 1));
+    TEST_ESP_OK(jrnl_write_internal(inst_ptr, (const uint8_t*)&jrnl_master, active_slot_sector, 1));
 
     //reset the record and verify
     TEST_ESP_OK(jrnl_reset_master(inst_ptr, false));
@@ -225,6 +242,55 @@ TEST(jrnl_basic, reset_master)
     test_teardown();
 }
 
+TEST(jrnl_basic, master_slots)
+{
+    test_setup();
+
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
+    TEST_ASSERT_NOT_NULL(inst_ptr);
+
+    //the end of a transaction erases the spare slot ahead of the next one
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, false));
+    TEST_ASSERT(inst_ptr->master_spare_blank);
+
+    esp_jrnl_master_t jrnl_master;
+    TEST_ESP_OK(test_get_jrnl_master(s_jrnl_handle, &jrnl_master));
+    uint32_t generation = jrnl_master.generation;
+    TEST_ASSERT(generation == inst_ptr->master.generation);
+
+    //each update goes to the other slot with the next generation, the transition itself erases nothing
+    esp_jrnl_stats_t stats_before, stats_after;
+    TEST_ESP_OK(esp_jrnl_get_stats(s_jrnl_handle, &stats_before));
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_get_stats(s_jrnl_handle, &stats_after));
+    TEST_ASSERT(stats_after.bytes_erased == stats_before.bytes_erased);
+    TEST_ASSERT(stats_after.master_updates == stats_before.master_updates + 1);
+
+    TEST_ESP_OK(test_get_jrnl_master(s_jrnl_handle, &jrnl_master));
+    TEST_ASSERT(jrnl_master.generation == generation + 1);
+    TEST_ASSERT(jrnl_master.status == ESP_JRNL_STATUS_TRANS_OPEN);
+    TEST_ASSERT_FALSE(inst_ptr->master_spare_blank);
+
+    //the stale slot is left intact until the transaction ends
+    size_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    s_buf_read = (uint8_t*)calloc(1, sector_size);
+    TEST_ASSERT(s_buf_read);
+    TEST_ESP_OK(jrnl_read_internal(inst_ptr, s_buf_read, JRNL_MASTER_SLOT_SECTOR(&jrnl_master, JRNL_MASTER_SLOT(generation)), 1));
+    TEST_ASSERT(((esp_jrnl_master_t*)s_buf_read)->jrnl_magic_mark == JRNL_STORE_MARKER);
+    TEST_ASSERT(((esp_jrnl_master_t*)s_buf_read)->generation == generation);
+
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, false));
+    TEST_ESP_OK(test_get_jrnl_master(s_jrnl_handle, &jrnl_master));
+    TEST_ASSERT(jrnl_master.generation == generation + 2);
+    TEST_ASSERT(jrnl_master.status == ESP_JRNL_STATUS_TRANS_READY);
+    TEST_ASSERT(inst_ptr->master_spare_blank);
+    TEST_ESP_OK(jrnl_read_internal(inst_ptr, s_buf_read, JRNL_MASTER_SLOT_SECTOR(&jrnl_master, JRNL_MASTER_SLOT(generation + 1)), 1));
+    TEST_ASSERT(((esp_jrnl_master_t*)s_buf_read)->jrnl_magic_mark != JRNL_STORE_MARKER);
+
+    test_teardown();
+}
+
 TEST(jrnl_basic, jrnl_start)
 {
     test_setup();
@@ -257,9 +323,14 @@ TEST(jrnl_basic, jrnl_mount_unmount)
     };
 
     TEST_ESP_OK(esp_vfs_fat_spiflash_mount_jrnl(s_basepath, s_partlabel, &mount_config, &jrnl_config, &s_jrnl_handle));
+    esp_jrnl_handle_t stale_handle = s_jrnl_handle;
     TEST_ESP_OK(esp_vfs_fat_spiflash_unmount_jrnl(&s_jrnl_handle, s_basepath));
     TEST_ASSERT(s_jrnl_handle == JRNL_INVALID_HANDLE);
 
+    //unmounting a stale handle fails and keeps the instance table usable for following mounts
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, esp_jrnl_unmount(stale_handle));
+    TEST_ASSERT_NULL(test_get_jrnl_instance(stale_handle));
+
     jrnl_config.overwrite_existing = false;
     jrnl_config.force_fs_format = false;
     TEST_ESP_OK(esp_vfs_fat_spiflash_mount_jrnl(s_basepath, s_partlabel, &mount_config, &jrnl_config, &s_jrnl_handle));
@@ -271,7 +342,7 @@ TEST(jrnl_basic, direct_read_write)
 {
     test_setup();
 
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[s_jrnl_handle];
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
     TEST_ASSERT_NOT_NULL(inst_ptr);
 
     //set INIT status to get direct read/write access to the target disk
@@ -303,6 +374,52 @@ TEST(jrnl_basic, direct_read_write)
     test_teardown();
 }
 
+TEST(jrnl_basic, direct_start_stop)
+{
+    test_setup();
+
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
+    TEST_ASSERT_NOT_NULL(inst_ptr);
+
+    size_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    s_buf_write = (uint8_t*)malloc(sector_size);
+    TEST_ASSERT(s_buf_write);
+    s_buf_read = (uint8_t*)calloc(1, sector_size);
+    TEST_ASSERT(s_buf_read);
+
+    const uint8_t pattern[] = "DIRECTIO";
+    test_memset_pattern(pattern, sizeof(pattern), s_buf_write, sector_size);
+    size_t test_target_sector = 17;
+
+    //direct disk access: start and stop succeed, no transaction gets opened
+    TEST_ESP_OK(esp_jrnl_set_direct_io(s_jrnl_handle, true));
+    TEST_ESP_OK(esp_jrnl_reset_stats(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ASSERT_EQUAL(ESP_JRNL_STATUS_FS_DIRECT, inst_ptr->master.status);
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, inst_ptr->master.next_free_sector);
+
+    //cancel is a no-op, the write is on the target disk already
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, false));
+    TEST_ASSERT_EQUAL(ESP_JRNL_STATUS_FS_DIRECT, inst_ptr->master.status);
+    TEST_ESP_OK(esp_jrnl_read(s_jrnl_handle, test_target_sector, s_buf_read, 1));
+    TEST_ASSERT(memcmp(s_buf_read, s_buf_write, sector_size) == 0);
+
+    esp_jrnl_stats_t stats;
+    TEST_ESP_OK(esp_jrnl_get_stats(s_jrnl_handle, &stats));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.trans_started);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.trans_cancelled);
+    TEST_ASSERT(stats.sectors_journaled == 0);
+
+    //journaled access again: the next start opens a transaction
+    TEST_ESP_OK(esp_jrnl_set_direct_io(s_jrnl_handle, false));
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ASSERT_EQUAL(ESP_JRNL_STATUS_TRANS_OPEN, inst_ptr->master.status);
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, false));
+
+    test_teardown();
+}
+
 TEST(jrnl_basic, jrnl_start_write)
 {
     test_setup();
@@ -311,7 +428,7 @@ TEST(jrnl_basic, jrnl_start_write)
     TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
 
     //prepare testing data
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[s_jrnl_handle];
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
     TEST_ASSERT_NOT_NULL(inst_ptr);
 
     esp_jrnl_master_t jrnl_master;
@@ -362,7 +479,7 @@ TEST(jrnl_basic, jrnl_stop_replay)
     TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
 
     //prepare testing data
-    esp_jrnl_instance_t* inst_ptr = s_jrnl_instance_ptrs[s_jrnl_handle];
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
     TEST_ASSERT_NOT_NULL(inst_ptr);
 
     esp_jrnl_master_t jrnl_master;
@@ -417,16 +534,910 @@ TEST(jrnl_basic, jrnl_stop_replay)
     test_teardown();
 }
 
+TEST(jrnl_basic, jrnl_compressed_write)
+{
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+            .format_if_mount_failed = true,
+            .max_files = 5
+    };
+
+    esp_jrnl_config_t jrnl_config = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_config.overwrite_existing = true;
+    jrnl_config.force_fs_format = true;
+    jrnl_config.payload_codec = ESP_JRNL_CODEC_LZF;
+
+    TEST_ESP_OK(esp_vfs_fat_spiflash_mount_jrnl(s_basepath, s_partlabel, &mount_config, &jrnl_config, &s_jrnl_handle));
+
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
+    TEST_ASSERT_NOT_NULL(inst_ptr);
+
+    size_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    s_buf_write = (uint8_t*)calloc(1, sector_size);
+    TEST_ASSERT(s_buf_write);
+    s_buf_read = (uint8_t*)calloc(1, sector_size);
+    TEST_ASSERT(s_buf_read);
+
+    const uint8_t buff_pattern[] = "ABCDEFGHABCDEFGH";
+    test_memset_pattern(buff_pattern, sizeof(buff_pattern), s_buf_write, sector_size);
+
+    //repeated pattern compresses into the header (packed in the tail sector, nothing flushed to jrnl store yet)
+    size_t test_target_sector = 14;
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector, 1));
+    TEST_ASSERT(inst_ptr->master.next_free_sector == 0);
+    TEST_ASSERT(inst_ptr->tail_offset > 0);
+
+    esp_jrnl_operation_t *oper_header = (esp_jrnl_operation_t*)inst_ptr->tail_buf;
+    TEST_ASSERT(oper_header->header.codec == ESP_JRNL_CODEC_LZF);
+    TEST_ASSERT(oper_header->header.payload_size <= JRNL_RECORD_INLINE_SIZE(sector_size));
+    TEST_ASSERT(oper_header->header.crc32_data == esp_crc32_le(UINT32_MAX, s_buf_write, sector_size));
+
+    //empty write refused, the records packed after it would be cut off
+    size_t tail_offset = inst_ptr->tail_offset;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector, 0));
+    TEST_ASSERT(inst_ptr->tail_offset == tail_offset);
+
+    //the following small records share the tail sector
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector + 1, 1));
+    TEST_ASSERT(inst_ptr->master.next_free_sector == 0);
+    TEST_ASSERT(inst_ptr->tail_offset == 2 * tail_offset);
+
+    //commit flushes the tail sector and decodes the payloads to the target sectors
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, true));
+    memset(s_buf_read, 0, sector_size);
+    TEST_ESP_OK(esp_jrnl_read(s_jrnl_handle, test_target_sector, s_buf_read, 1));
+    TEST_ASSERT(memcmp(s_buf_read, s_buf_write, sector_size) == 0);
+    memset(s_buf_read, 0, sector_size);
+    TEST_ESP_OK(esp_jrnl_read(s_jrnl_handle, test_target_sector + 1, s_buf_read, 1));
+    TEST_ASSERT(memcmp(s_buf_read, s_buf_write, sector_size) == 0);
+
+    test_teardown();
+}
+
+TEST(jrnl_basic, jrnl_batch_failed_op)
+{
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+            .format_if_mount_failed = true,
+            .max_files = 5
+    };
+
+    esp_jrnl_config_t jrnl_config = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_config.overwrite_existing = true;
+    jrnl_config.force_fs_format = true;
+    jrnl_config.commit_mode = ESP_JRNL_COMMIT_DEFERRED;
+    jrnl_config.payload_codec = ESP_JRNL_CODEC_LZF;
+
+    TEST_ESP_OK(esp_vfs_fat_spiflash_mount_jrnl(s_basepath, s_partlabel, &mount_config, &jrnl_config, &s_jrnl_handle));
+
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
+    TEST_ASSERT_NOT_NULL(inst_ptr);
+
+    size_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    s_buf_write = (uint8_t*)calloc(4, sector_size);
+    TEST_ASSERT(s_buf_write);
+    s_buf_read = (uint8_t*)calloc(4, sector_size);
+    TEST_ASSERT(s_buf_read);
+
+    size_t test_target_sector = 16;
+    uint8_t* target_orig = (uint8_t*)calloc(4, sector_size);
+    TEST_ASSERT(target_orig);
+    TEST_ESP_OK(esp_jrnl_read(s_jrnl_handle, test_target_sector, target_orig, 4));
+
+    //1. successful operation, inline record packed in the tail sector
+    memset(s_buf_write, 0x11, sector_size);
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector, 1));
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, true));
+    TEST_ASSERT(inst_ptr->master.status == ESP_JRNL_STATUS_TRANS_OPEN);
+    uint32_t next_free_sector = inst_ptr->master.next_free_sector;
+    size_t tail_offset = inst_ptr->tail_offset;
+    TEST_ASSERT(tail_offset > 0);
+
+    //2. failed operation: rewrites the first target and flushes the tail sector by a multi-sector record
+    for (size_t i = 0; i < 4 * sector_size; i++) {
+        s_buf_write[i] = (uint8_t)esp_random();
+    }
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector, 4));
+    TEST_ASSERT(inst_ptr->master.next_free_sector > next_free_sector);
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, false));
+
+    //its records rolled back, the batch goes on
+    TEST_ASSERT(inst_ptr->master.status == ESP_JRNL_STATUS_TRANS_OPEN);
+    TEST_ASSERT(inst_ptr->master.next_free_sector == next_free_sector);
+    TEST_ASSERT(inst_ptr->tail_offset == tail_offset);
+    TEST_ESP_OK(esp_jrnl_read(s_jrnl_handle, test_target_sector, s_buf_read, 2));
+    memset(s_buf_write, 0x11, sector_size);
+    TEST_ASSERT(memcmp(s_buf_read, s_buf_write, sector_size) == 0);
+    TEST_ASSERT(memcmp(s_buf_read + sector_size, target_orig + sector_size, sector_size) == 0);
+
+    //3. successful operation after the failed one, committed with the first one
+    memset(s_buf_write, 0x33, sector_size);
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector + 2, 1));
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, true));
+    TEST_ESP_OK(esp_jrnl_sync(s_jrnl_handle));
+    TEST_ASSERT(inst_ptr->master.status == ESP_JRNL_STATUS_TRANS_READY);
+
+    memcpy(s_buf_write + sector_size, target_orig + sector_size, sector_size);
+    memset(s_buf_write + 2 * sector_size, 0x33, sector_size);
+    memcpy(s_buf_write + 3 * sector_size, target_orig + 3 * sector_size, sector_size);
+    memset(s_buf_write, 0x11, sector_size);
+    TEST_ESP_OK(esp_jrnl_read(s_jrnl_handle, test_target_sector, s_buf_read, 4));
+    TEST_ASSERT(memcmp(s_buf_read, s_buf_write, 4 * sector_size) == 0);
+
+    free(target_orig);
+    test_teardown();
+}
+
+TEST(jrnl_basic, jrnl_batch_touched_overflow)
+{
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+            .format_if_mount_failed = true,
+            .max_files = 5
+    };
+
+    esp_jrnl_config_t jrnl_config = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_config.overwrite_existing = true;
+    jrnl_config.force_fs_format = true;
+    jrnl_config.commit_mode = ESP_JRNL_COMMIT_DEFERRED;
+    jrnl_config.payload_codec = ESP_JRNL_CODEC_LZF;
+
+    TEST_ESP_OK(esp_vfs_fat_spiflash_mount_jrnl(s_basepath, s_partlabel, &mount_config, &jrnl_config, &s_jrnl_handle));
+
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
+    TEST_ASSERT_NOT_NULL(inst_ptr);
+
+    size_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    s_buf_write = (uint8_t*)calloc(1, sector_size);
+    TEST_ASSERT(s_buf_write);
+
+    //one operation per separate target range: the batch stays open while the touched ranges index holds them
+    size_t test_target_sector = 16;
+    for (uint32_t i = 0; i <= JRNL_TOUCHED_RANGES_MAX; i++) {
+        memset(s_buf_write, 0x40 + i, sector_size);
+        TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+        TEST_ASSERT(inst_ptr->batch_ops == i);
+        TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector + 2 * i, 1));
+        TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, true));
+        TEST_ASSERT(inst_ptr->master.status == ESP_JRNL_STATUS_TRANS_OPEN);
+    }
+    TEST_ASSERT(inst_ptr->touched_count > JRNL_TOUCHED_RANGES_MAX);
+
+    //index overflowed: the next operation commits the batch and opens a new transaction
+    esp_jrnl_stats_t stats_before;
+    TEST_ESP_OK(esp_jrnl_get_stats(s_jrnl_handle, &stats_before));
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    esp_jrnl_stats_t stats_after;
+    TEST_ESP_OK(esp_jrnl_get_stats(s_jrnl_handle, &stats_after));
+    TEST_ASSERT_EQUAL(stats_before.trans_committed + 1, stats_after.trans_committed);
+    TEST_ASSERT(inst_ptr->batch_ops == 0);
+    TEST_ASSERT(inst_ptr->touched_count == 0);
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, true));
+
+    test_teardown();
+}
+
+TEST(jrnl_basic, jrnl_checksum_engines)
+{
+    //reference values
+    const uint8_t check[] = "123456789";
+    for (uint32_t engine = 0; engine < JRNL_CHECKSUM_COUNT; engine++) {
+        TEST_ASSERT(jrnl_checksum_init(engine) == 0);
+    }
+    TEST_ASSERT(jrnl_checksum_init(JRNL_CHECKSUM_COUNT) != 0);
+    TEST_ASSERT_EQUAL_HEX32(esp_crc32_le(UINT32_MAX, check, 9), jrnl_checksum(JRNL_CHECKSUM_CRC32, check, 9));
+    TEST_ASSERT_EQUAL_HEX32(0xE3069283, jrnl_checksum(JRNL_CHECKSUM_CRC32C, check, 9));
+    TEST_ASSERT_EQUAL_HEX32(0xE3069283, jrnl_crc32c_sw(check, 9));
+    TEST_ASSERT_EQUAL_HEX32(0x02CC5D05, jrnl_checksum(JRNL_CHECKSUM_XXH32, check, 0));
+    TEST_ASSERT_EQUAL_HEX32(0x937BAD67, jrnl_checksum(JRNL_CHECKSUM_XXH32, check, 9));
+
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+            .format_if_mount_failed = true,
+            .max_files = 5
+    };
+
+    esp_jrnl_config_t jrnl_config = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_config.overwrite_existing = true;
+    jrnl_config.force_fs_format = true;
+
+    //unknown engine refused
+    jrnl_config.checksum = (esp_jrnl_checksum_t)JRNL_CHECKSUM_COUNT;
+    TEST_ASSERT(esp_vfs_fat_spiflash_mount_jrnl(s_basepath, s_partlabel, &mount_config, &jrnl_config, &s_jrnl_handle) != ESP_OK);
+
+    const esp_jrnl_checksum_t engines[] = {ESP_JRNL_CHECKSUM_CRC32C, ESP_JRNL_CHECKSUM_XXH32};
+    for (size_t i = 0; i < sizeof(engines)/sizeof(engines[0]); i++) {
+
+        jrnl_config.checksum = engines[i];
+        TEST_ESP_OK(esp_vfs_fat_spiflash_mount_jrnl(s_basepath, s_partlabel, &mount_config, &jrnl_config, &s_jrnl_handle));
+
+        esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
+        TEST_ASSERT_NOT_NULL(inst_ptr);
+        TEST_ASSERT(inst_ptr->master.checksum == (uint32_t)engines[i]);
+
+        size_t sector_size = inst_ptr->master.volume.disk_sector_size;
+        s_buf_write = (uint8_t*)malloc(2 * sector_size);
+        TEST_ASSERT(s_buf_write);
+        s_buf_read = (uint8_t*)calloc(2, sector_size);
+        TEST_ASSERT(s_buf_read);
+        esp_fill_random(s_buf_write, 2 * sector_size);
+
+        //record checksums computed by the engine of the store
+        size_t test_target_sector = 16;
+        TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+        TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector, 2));
+
+        esp_jrnl_operation_t oper_header;
+        TEST_ESP_OK(jrnl_read_internal(inst_ptr, s_buf_read, 0, 1));
+        memcpy(&oper_header, s_buf_read, sizeof(oper_header));
+        TEST_ASSERT_EQUAL_HEX32(jrnl_checksum(engines[i], &oper_header.header, sizeof(esp_jrnl_oper_header_t)), oper_header.crc32_header);
+        TEST_ASSERT_EQUAL_HEX32(jrnl_checksum(engines[i], s_buf_write, 2 * sector_size), oper_header.header.crc32_data);
+
+        //replay verifies the records by the same engine
+        TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, true));
+        memset(s_buf_read, 0, 2 * sector_size);
+        TEST_ESP_OK(esp_jrnl_read(s_jrnl_handle, test_target_sector, s_buf_read, 2));
+        TEST_ASSERT(memcmp(s_buf_read, s_buf_write, 2 * sector_size) == 0);
+
+        test_teardown();
+
+        free(s_buf_write);
+        s_buf_write = NULL;
+        free(s_buf_read);
+        s_buf_read = NULL;
+    }
+}
+
+/* asynchronous WL device emulation: the requests get executed in order by a separate task */
+typedef struct {
+    QueueHandle_t queue;
+    uint32_t submitted;
+} test_async_disk_t;
+
+static test_async_disk_t s_async_disk;
+
+static void test_async_disk_task(void* arg)
+{
+    wl_handle_t wl_handle = (wl_handle_t)(intptr_t)arg;
+    esp_jrnl_diskio_req_t req;
+
+    while (xQueueReceive(s_async_disk.queue, &req, portMAX_DELAY) == pdTRUE) {
+        if (req.done == NULL) {
+            break;
+        }
+        esp_err_t err;
+        switch (req.op) {
+            case ESP_JRNL_DISKIO_OP_READ:
+                err = wl_read(wl_handle, req.addr, req.buf, req.size);
+                break;
+            case ESP_JRNL_DISKIO_OP_WRITE:
+                err = wl_write(wl_handle, req.addr, req.buf, req.size);
+                break;
+            default:
+                err = wl_erase_range(wl_handle, req.addr, req.size);
+                break;
+        }
+        req.done(req.done_arg, err);
+    }
+
+    vTaskDelete(NULL);
+}
+
+static esp_err_t test_async_disk_submit(int32_t handle, const esp_jrnl_diskio_req_t* req)
+{
+    s_async_disk.submitted++;
+    return xQueueSend(s_async_disk.queue, req, portMAX_DELAY) == pdTRUE ? ESP_OK : ESP_FAIL;
+}
+
+TEST(jrnl_basic, jrnl_async_diskio)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, s_partlabel);
+    TEST_ASSERT_NOT_NULL(partition);
+    wl_handle_t wl_handle = WL_INVALID_HANDLE;
+    TEST_ESP_OK(wl_mount(partition, &wl_handle));
+
+    s_async_disk.queue = xQueueCreate(JRNL_IO_QUEUE_DEPTH, sizeof(esp_jrnl_diskio_req_t));
+    TEST_ASSERT_NOT_NULL(s_async_disk.queue);
+    s_async_disk.submitted = 0;
+    TEST_ASSERT(xTaskCreate(test_async_disk_task, "async_disk", 4096, (void*)(intptr_t)wl_handle, 5, NULL) == pdPASS);
+
+    esp_jrnl_config_extended_t config = {
+        .user_cfg = ESP_JRNL_DEFAULT_CONFIG(),
+        .fs_volume_id = 0,
+        .volume_cfg = ESP_JRNL_VOLUME_DEFAULT_CONFIG(wl_handle),
+        .diskio_cfg = ESP_JRNL_DISKIO_DEFAULT_CONFIG(wl_handle)
+    };
+    config.user_cfg.overwrite_existing = true;
+    config.diskio_cfg.disk_submit = test_async_disk_submit;
+
+    esp_jrnl_handle_t jrnl_handle = JRNL_INVALID_HANDLE;
+    TEST_ESP_OK(esp_jrnl_mount(&config, &jrnl_handle));
+
+    size_t sector_size = config.volume_cfg.disk_sector_size;
+    s_buf_write = (uint8_t*)malloc(4 * sector_size);
+    TEST_ASSERT(s_buf_write);
+    s_buf_read = (uint8_t*)calloc(4, sector_size);
+    TEST_ASSERT(s_buf_read);
+    esp_fill_random(s_buf_write, 4 * sector_size);
+
+    //records written by the queued requests, committed data transferred the same way
+    TEST_ESP_OK(esp_jrnl_start(jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(jrnl_handle, s_buf_write, 10, 2));
+    TEST_ESP_OK(esp_jrnl_write(jrnl_handle, s_buf_write + 2 * sector_size, 20, 2));
+    TEST_ASSERT(s_async_disk.submitted == 6);
+    TEST_ESP_OK(esp_jrnl_stop(jrnl_handle, true));
+    TEST_ASSERT(s_async_disk.submitted == 10);
+
+    TEST_ESP_OK(esp_jrnl_read(jrnl_handle, 10, s_buf_read, 2));
+    TEST_ESP_OK(esp_jrnl_read(jrnl_handle, 20, s_buf_read + 2 * sector_size, 2));
+    TEST_ASSERT(memcmp(s_buf_read, s_buf_write, 4 * sector_size) == 0);
+
+    TEST_ESP_OK(esp_jrnl_unmount(jrnl_handle));
+
+    esp_jrnl_diskio_req_t stop_req = {0};
+    xQueueSend(s_async_disk.queue, &stop_req, portMAX_DELAY);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    vQueueDelete(s_async_disk.queue);
+    wl_unmount(wl_handle);
+}
+
+/* instance memory for the largest WL sector, store of 8 sectors (records of 5 sectors max) */
+static ESP_JRNL_STATIC_MEM_DEFINE(s_jrnl_static_mem, 4096, 8, 0);
+
+TEST(jrnl_basic, jrnl_static_mount)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, s_partlabel);
+    TEST_ASSERT_NOT_NULL(partition);
+    wl_handle_t wl_handle = WL_INVALID_HANDLE;
+    TEST_ESP_OK(wl_mount(partition, &wl_handle));
+
+    esp_jrnl_config_extended_t config = {
+        .user_cfg = ESP_JRNL_DEFAULT_CONFIG(),
+        .fs_volume_id = 0,
+        .volume_cfg = ESP_JRNL_VOLUME_DEFAULT_CONFIG(wl_handle),
+        .diskio_cfg = ESP_JRNL_DISKIO_DEFAULT_CONFIG(wl_handle)
+    };
+    config.user_cfg.overwrite_existing = true;
+    config.user_cfg.store_size_sectors = 8;
+    config.user_cfg.payload_codec = ESP_JRNL_CODEC_LZF;
+
+    //the memory must fit the configuration, no heap-allocating features
+    esp_jrnl_handle_t jrnl_handle = JRNL_INVALID_HANDLE;
+    size_t mem_size = ESP_JRNL_STATIC_MEM_SIZE(config.volume_cfg.disk_sector_size, config.user_cfg.store_size_sectors,
+                                               config.user_cfg.static_record_sectors);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, esp_jrnl_mount_static(&config, s_jrnl_static_mem, mem_size - 1, &jrnl_handle));
+    config.user_cfg.diskio_probe = true;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, esp_jrnl_mount_static(&config, s_jrnl_static_mem, mem_size, &jrnl_handle));
+    config.user_cfg.diskio_probe = false;
+
+    TEST_ESP_OK(esp_jrnl_mount_static(&config, s_jrnl_static_mem, mem_size, &jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_set_direct_io(jrnl_handle, false));
+
+    size_t sector_size = config.volume_cfg.disk_sector_size;
+    s_buf_write = (uint8_t*)malloc(10 * sector_size);
+    TEST_ASSERT(s_buf_write);
+    s_buf_read = (uint8_t*)calloc(12, sector_size);
+    TEST_ASSERT(s_buf_read);
+    esp_fill_random(s_buf_write, 10 * sector_size);
+
+    //records of 5 sectors max (the store holds 6 data sectors): random data in 2 transactions, then a compressible
+    //12-sector write split into 3 records (inline LZF payloads) and a small change read back by the overlay
+    size_t heap_free = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    for (int i = 0; i < 2; i++) {
+        TEST_ESP_OK(esp_jrnl_start(jrnl_handle));
+        TEST_ESP_OK(esp_jrnl_write(jrnl_handle, s_buf_write + i * 5 * sector_size, 10 + i * 5, 5));
+        TEST_ESP_OK(esp_jrnl_stop(jrnl_handle, true));
+    }
+
+    memset(s_buf_read, 0x5A, 12 * sector_size);
+    TEST_ESP_OK(esp_jrnl_start(jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(jrnl_handle, s_buf_read, 30, 12));
+    s_buf_write[100] ^= 0xFF;
+    TEST_ESP_OK(esp_jrnl_write(jrnl_handle, s_buf_write, 10, 2));
+    TEST_ESP_OK(esp_jrnl_read(jrnl_handle, 10, s_buf_read, 2));
+    TEST_ASSERT(memcmp(s_buf_read, s_buf_write, 2 * sector_size) == 0);
+    TEST_ESP_OK(esp_jrnl_stop(jrnl_handle, true));
+
+    TEST_ESP_OK(esp_jrnl_read(jrnl_handle, 10, s_buf_read, 10));
+    TEST_ASSERT(memcmp(s_buf_read, s_buf_write, 10 * sector_size) == 0);
+    TEST_ESP_OK(esp_jrnl_read(jrnl_handle, 30, s_buf_read, 12));
+    for (size_t i = 0; i < 12 * sector_size; i++) {
+        TEST_ASSERT_EQUAL_HEX8(0x5A, s_buf_read[i]);
+    }
+    TEST_ASSERT_EQUAL(heap_free, heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+    TEST_ESP_OK(esp_jrnl_unmount(jrnl_handle));
+
+    //record buffers of 2 sectors: 3 sectors less each, a 4-sector write journaled as 2 records
+    config.user_cfg.overwrite_existing = false;
+    config.user_cfg.static_record_sectors = ESP_JRNL_STATIC_RECORD_SECTORS(8) + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_jrnl_mount_static(&config, s_jrnl_static_mem, mem_size, &jrnl_handle));
+    config.user_cfg.static_record_sectors = 2;
+    size_t chunk_mem_size = ESP_JRNL_STATIC_MEM_SIZE(sector_size, 8, 2);
+    TEST_ASSERT_EQUAL(mem_size - 9 * sector_size, chunk_mem_size);
+    TEST_ESP_OK(esp_jrnl_mount_static(&config, s_jrnl_static_mem, chunk_mem_size, &jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_set_direct_io(jrnl_handle, false));
+
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(jrnl_handle);
+    esp_fill_random(s_buf_write, 4 * sector_size);
+    TEST_ESP_OK(esp_jrnl_start(jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(jrnl_handle, s_buf_write, 10, 4));
+    TEST_ASSERT_EQUAL_UINT32(6, inst_ptr->master.next_free_sector);
+    TEST_ESP_OK(esp_jrnl_stop(jrnl_handle, true));
+    TEST_ESP_OK(esp_jrnl_read(jrnl_handle, 10, s_buf_read, 4));
+    TEST_ASSERT(memcmp(s_buf_read, s_buf_write, 4 * sector_size) == 0);
+
+    TEST_ESP_OK(esp_jrnl_unmount(jrnl_handle));
+    wl_unmount(wl_handle);
+}
+
+TEST(jrnl_basic, jrnl_erase_block_size)
+{
+    test_setup();
+
+    size_t sector_size = 0;
+    TEST_ESP_OK(esp_jrnl_get_sector_size(s_jrnl_handle, &sector_size));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_jrnl_get_erase_block_size(s_jrnl_handle, NULL));
+
+    //WL sectors of 512B or 4kB, flash erase sector of 4kB
+    size_t block_sectors = 0;
+    TEST_ESP_OK(esp_jrnl_get_erase_block_size(s_jrnl_handle, &block_sectors));
+    TEST_ASSERT_EQUAL(ESP_JRNL_WL_ERASE_BLOCK_SIZE / sector_size, block_sectors);
+
+    //the volume formatted by test_setup(): FAT data area starts at an erase block boundary
+    s_buf_read = (uint8_t*)malloc(sector_size);
+    TEST_ASSERT(s_buf_read);
+    TEST_ESP_OK(esp_jrnl_read(s_jrnl_handle, 0, s_buf_read, 1));
+    TEST_ASSERT(s_buf_read[510] == 0x55 && s_buf_read[511] == 0xAA);
+    uint32_t rsvd_sectors = s_buf_read[14] | (s_buf_read[15] << 8);
+    uint32_t fat_sectors = s_buf_read[22] | (s_buf_read[23] << 8);
+    uint32_t root_entries = s_buf_read[17] | (s_buf_read[18] << 8);
+    uint32_t data_start = rsvd_sectors + s_buf_read[16] * fat_sectors + (root_entries * 32 + sector_size - 1) / sector_size;
+    TEST_ASSERT_EQUAL(0, data_start % block_sectors);
+
+    test_teardown();
+}
+
+TEST(jrnl_basic, jrnl_trim)
+{
+    test_setup();
+
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
+    TEST_ASSERT_NOT_NULL(inst_ptr);
+
+    size_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    s_buf_write = (uint8_t*)malloc(2 * sector_size);
+    TEST_ASSERT(s_buf_write);
+    s_buf_read = (uint8_t*)malloc(2 * sector_size);
+    TEST_ASSERT(s_buf_read);
+
+    //last 2 sectors of the file-system (unused by the fresh FAT volume)
+    size_t fs_sector_count = 0;
+    TEST_ESP_OK(esp_jrnl_get_sector_count(s_jrnl_handle, &fs_sector_count));
+    uint32_t test_target_sector = fs_sector_count - 2;
+
+    uint8_t pattern[] = {0xDE, 0xAD, 0xBE, 0xEF};
+    test_memset_pattern(pattern, sizeof(pattern), s_buf_write, 2 * sector_size);
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector, 2));
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, true));
+
+    //trim only within a transaction, and only the file-system sectors
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_jrnl_trim(s_jrnl_handle, test_target_sector, 2));
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_jrnl_trim(s_jrnl_handle, test_target_sector, 3));
+
+    //header-only record packed in the tail sector, the target untouched until the commit
+    uint32_t next_free_sector = inst_ptr->master.next_free_sector;
+    TEST_ESP_OK(esp_jrnl_trim(s_jrnl_handle, test_target_sector, 2));
+    TEST_ASSERT(inst_ptr->master.next_free_sector == next_free_sector);
+    esp_jrnl_operation_t *oper_header = (esp_jrnl_operation_t*)inst_ptr->tail_buf;
+    TEST_ASSERT(oper_header->header.record_type == ESP_JRNL_RECORD_TRIM);
+    TEST_ASSERT(oper_header->header.payload_size == 0);
+    TEST_ASSERT(oper_header->header.target_sector == test_target_sector);
+    TEST_ASSERT(oper_header->header.sector_count == 2);
+
+    //the open transaction reads the range as erased, the target keeps the data until the commit
+    TEST_ESP_OK(esp_jrnl_read(s_jrnl_handle, test_target_sector, s_buf_read, 2));
+    for (size_t i = 0; i < 2 * sector_size; i++) {
+        TEST_ASSERT(s_buf_read[i] == 0xFF);
+    }
+    TEST_ESP_OK(inst_ptr->diskio.disk_read(inst_ptr->diskio.diskio_ctrl_handle, test_target_sector * sector_size, s_buf_read, 2 * sector_size));
+    TEST_ASSERT(memcmp(s_buf_read, s_buf_write, 2 * sector_size) == 0);
+
+    //WL erases the range on commit
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, true));
+    TEST_ASSERT(inst_ptr->erased_count == 1);
+    TEST_ESP_OK(esp_jrnl_read(s_jrnl_handle, test_target_sector, s_buf_read, 2));
+    for (size_t i = 0; i < 2 * sector_size; i++) {
+        TEST_ASSERT(s_buf_read[i] == 0xFF);
+    }
+
+    //any write into the range drops it from the erased set
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector + 1, 1));
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, true));
+    TEST_ASSERT(inst_ptr->erased_count == 1);
+    TEST_ASSERT(inst_ptr->erased[0].first_sector == test_target_sector);
+    TEST_ASSERT(inst_ptr->erased[0].sector_count == 1);
+    TEST_ESP_OK(esp_jrnl_read(s_jrnl_handle, test_target_sector + 1, s_buf_read, 1));
+    TEST_ASSERT(memcmp(s_buf_read, s_buf_write, sector_size) == 0);
+
+    test_teardown();
+}
+
+TEST(jrnl_basic, jrnl_stats)
+{
+    test_setup();
+
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
+    TEST_ASSERT_NOT_NULL(inst_ptr);
+
+    size_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    s_buf_write = (uint8_t*)malloc(2 * sector_size);
+    TEST_ASSERT(s_buf_write);
+
+    size_t fs_sector_count = 0;
+    TEST_ESP_OK(esp_jrnl_get_sector_count(s_jrnl_handle, &fs_sector_count));
+    uint32_t test_target_sector = fs_sector_count - 2;
+
+    esp_jrnl_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_jrnl_get_stats(s_jrnl_handle, NULL));
+    TEST_ESP_OK(esp_jrnl_reset_stats(s_jrnl_handle));
+
+    //1 committed and 1 cancelled transaction
+    uint8_t pattern[] = {0xDE, 0xAD, 0xBE, 0xEF};
+    test_memset_pattern(pattern, sizeof(pattern), s_buf_write, 2 * sector_size);
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector, 2));
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, true));
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector, 1));
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, false));
+
+    TEST_ESP_OK(esp_jrnl_get_stats(s_jrnl_handle, &stats));
+    TEST_ASSERT_EQUAL_UINT32(2, stats.trans_started);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.trans_committed);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.trans_cancelled);
+    TEST_ASSERT(stats.sectors_journaled == 3);
+    TEST_ASSERT(stats.bytes_written >= 3 * sector_size);
+    TEST_ASSERT(stats.master_updates >= 3);
+    TEST_ASSERT(stats.store_peak_sectors > 0 && stats.store_peak_sectors <= stats.store_data_sectors);
+
+    TEST_ESP_OK(esp_jrnl_reset_stats(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_get_stats(s_jrnl_handle, &stats));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.trans_started);
+    TEST_ASSERT(stats.bytes_written == 0 && stats.sectors_journaled == 0);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.store_peak_sectors);
+
+    test_teardown();
+}
+
+TEST(jrnl_basic, jrnl_diskio_probe)
+{
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+            .format_if_mount_failed = true,
+            .max_files = 5
+    };
+
+    esp_jrnl_config_t jrnl_config = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_config.overwrite_existing = true;
+    jrnl_config.force_fs_format = true;
+    jrnl_config.diskio_probe = true;
+
+    TEST_ESP_OK(esp_vfs_fat_spiflash_mount_jrnl(s_basepath, s_partlabel, &mount_config, &jrnl_config, &s_jrnl_handle));
+
+    //the original device handle still reported
+    esp_jrnl_master_t jrnl_master;
+    TEST_ESP_OK(test_get_jrnl_master(s_jrnl_handle, &jrnl_master));
+
+    size_t sector_size = 0;
+    TEST_ESP_OK(esp_jrnl_get_sector_size(s_jrnl_handle, &sector_size));
+    s_buf_write = (uint8_t*)calloc(2, sector_size);
+    TEST_ASSERT(s_buf_write);
+    uint8_t pattern[] = {0xDE, 0xAD, 0xBE, 0xEF};
+    test_memset_pattern(pattern, sizeof(pattern), s_buf_write, 2 * sector_size);
+
+    static esp_jrnl_diskio_stats_t diskio_stats;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_jrnl_get_diskio_stats(s_jrnl_handle, NULL));
+    TEST_ESP_OK(esp_jrnl_reset_stats(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_get_diskio_stats(s_jrnl_handle, &diskio_stats));
+    TEST_ASSERT(diskio_stats.ops[ESP_JRNL_REGION_MASTER][ESP_JRNL_DISKIO_STAT_WRITE].count == 0);
+
+    //1 committed transaction of 2 records: records in the store, master updates, the replay to the file-system region
+    size_t test_target_sector = 12;
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector, 2));
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector + 2, 2));
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, true));
+    TEST_ESP_OK(esp_jrnl_wait_commit(s_jrnl_handle));
+
+    esp_jrnl_stats_t stats;
+    TEST_ESP_OK(esp_jrnl_get_stats(s_jrnl_handle, &stats));
+    TEST_ESP_OK(esp_jrnl_get_diskio_stats(s_jrnl_handle, &diskio_stats));
+
+    TEST_ASSERT(diskio_stats.ops[ESP_JRNL_REGION_FS][ESP_JRNL_DISKIO_STAT_WRITE].bytes == 4 * sector_size);
+    TEST_ASSERT(diskio_stats.ops[ESP_JRNL_REGION_STORE_DATA][ESP_JRNL_DISKIO_STAT_WRITE].bytes >= 4 * sector_size);
+    TEST_ASSERT(diskio_stats.ops[ESP_JRNL_REGION_MASTER][ESP_JRNL_DISKIO_STAT_WRITE].count >= 4);
+
+    //the spare master slot erased ahead of each update (the records erase it along with their space), never by the update itself
+    TEST_ASSERT_EQUAL_UINT32(0, stats.master_spare_misses);
+    TEST_ASSERT_EQUAL_UINT32(diskio_stats.ops[ESP_JRNL_REGION_MASTER][ESP_JRNL_DISKIO_STAT_WRITE].count,
+                             diskio_stats.ops[ESP_JRNL_REGION_MASTER][ESP_JRNL_DISKIO_STAT_ERASE].count);
+
+    //the probe sees the same device traffic as the instance counters
+    uint64_t bytes_written = 0;
+    for (int region = 0; region < ESP_JRNL_REGION_COUNT; region++) {
+        const esp_jrnl_diskio_op_stats_t* op_stats = &diskio_stats.ops[region][ESP_JRNL_DISKIO_STAT_WRITE];
+        uint32_t bucket_sum = 0;
+        for (int i = 0; i < ESP_JRNL_DISKIO_LATENCY_BUCKETS; i++) {
+            bucket_sum += op_stats->latency_buckets[i];
+        }
+        TEST_ASSERT(bucket_sum == op_stats->count);
+        TEST_ASSERT_EQUAL_UINT32(0, op_stats->errors);
+        bytes_written += op_stats->bytes;
+    }
+    TEST_ASSERT(bytes_written == stats.bytes_written);
+
+    test_teardown();
+}
+
+TEST(jrnl_basic, jrnl_clean_mount)
+{
+    //fresh journaling store, left clean by the unmount
+    test_setup();
+    esp_jrnl_master_t jrnl_master;
+    TEST_ESP_OK(test_get_jrnl_master(s_jrnl_handle, &jrnl_master));
+    uint32_t generation = jrnl_master.generation;
+    test_teardown();
+
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+            .format_if_mount_failed = false,
+            .max_files = 5
+    };
+
+    esp_jrnl_config_t jrnl_config = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_config.diskio_probe = true;
+
+    //the remount (including the direct disk access switching) doesn't touch the master record slots
+    TEST_ESP_OK(esp_vfs_fat_spiflash_mount_jrnl(s_basepath, s_partlabel, &mount_config, &jrnl_config, &s_jrnl_handle));
+
+    static esp_jrnl_diskio_stats_t diskio_stats;
+    TEST_ESP_OK(esp_jrnl_get_diskio_stats(s_jrnl_handle, &diskio_stats));
+    TEST_ASSERT_EQUAL_UINT32(0, diskio_stats.ops[ESP_JRNL_REGION_MASTER][ESP_JRNL_DISKIO_STAT_WRITE].count);
+    TEST_ASSERT_EQUAL_UINT32(0, diskio_stats.ops[ESP_JRNL_REGION_MASTER][ESP_JRNL_DISKIO_STAT_ERASE].count);
+
+    TEST_ESP_OK(esp_jrnl_set_direct_io(s_jrnl_handle, true));
+    TEST_ESP_OK(esp_jrnl_set_direct_io(s_jrnl_handle, false));
+    TEST_ESP_OK(test_get_jrnl_master(s_jrnl_handle, &jrnl_master));
+    TEST_ASSERT(jrnl_master.generation == generation);
+    TEST_ASSERT(jrnl_master.status == ESP_JRNL_STATUS_TRANS_READY);
+
+    //the first transaction writes the master record as usual
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(test_get_jrnl_master(s_jrnl_handle, &jrnl_master));
+    TEST_ASSERT(jrnl_master.generation == generation + 1);
+    TEST_ASSERT(jrnl_master.status == ESP_JRNL_STATUS_TRANS_OPEN);
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, false));
+
+    TEST_ESP_OK(esp_jrnl_get_diskio_stats(s_jrnl_handle, &diskio_stats));
+    TEST_ASSERT_EQUAL_UINT32(2, diskio_stats.ops[ESP_JRNL_REGION_MASTER][ESP_JRNL_DISKIO_STAT_WRITE].count);
+
+    test_teardown();
+}
+
+#ifdef CONFIG_ESP_JRNL_TRACE
+TEST(jrnl_basic, jrnl_trace)
+{
+    test_setup();
+
+    esp_jrnl_instance_t* inst_ptr = test_get_jrnl_instance(s_jrnl_handle);
+    TEST_ASSERT_NOT_NULL(inst_ptr);
+
+    size_t sector_size = inst_ptr->master.volume.disk_sector_size;
+    s_buf_write = (uint8_t*)malloc(2 * sector_size);
+    TEST_ASSERT(s_buf_write);
+
+    size_t fs_sector_count = 0;
+    TEST_ESP_OK(esp_jrnl_get_sector_count(s_jrnl_handle, &fs_sector_count));
+    uint32_t test_target_sector = fs_sector_count - 2;
+
+    //1 committed transaction of 2 records
+    TEST_ESP_OK(esp_jrnl_trace_clear());
+    uint8_t pattern[] = {0xDE, 0xAD, 0xBE, 0xEF};
+    test_memset_pattern(pattern, sizeof(pattern), s_buf_write, 2 * sector_size);
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector, 2));
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector, 1));
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, true));
+
+    size_t count = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_jrnl_trace_get(NULL, NULL));
+    TEST_ESP_OK(esp_jrnl_trace_get(NULL, &count));
+    TEST_ASSERT(count > 0);
+
+    esp_jrnl_trace_entry_t* entries = (esp_jrnl_trace_entry_t*)calloc(count, sizeof(esp_jrnl_trace_entry_t));
+    TEST_ASSERT(entries);
+    TEST_ESP_OK(esp_jrnl_trace_get(entries, &count));
+
+    uint32_t seen[ESP_JRNL_TRACE_EVENT_COUNT] = {0};
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL(s_jrnl_handle, entries[i].handle);
+        TEST_ASSERT(entries[i].event < ESP_JRNL_TRACE_EVENT_COUNT);
+        seen[entries[i].event]++;
+    }
+    free(entries);
+
+    TEST_ASSERT_EQUAL_UINT32(1, seen[ESP_JRNL_TRACE_TRANS_OPEN]);
+    TEST_ASSERT_EQUAL_UINT32(1, seen[ESP_JRNL_TRACE_TRANS_COMMIT]);
+    TEST_ASSERT_EQUAL_UINT32(2, seen[ESP_JRNL_TRACE_RECORD_APPEND]);
+    TEST_ASSERT_EQUAL_UINT32(1, seen[ESP_JRNL_TRACE_REPLAY]);
+    TEST_ASSERT_EQUAL_UINT32(2, seen[ESP_JRNL_TRACE_REPLAY_RECORD]);
+    TEST_ASSERT(seen[ESP_JRNL_TRACE_MASTER_UPDATE] >= 3);
+    TEST_ASSERT(seen[ESP_JRNL_TRACE_STORE_WRITE] > 0 && seen[ESP_JRNL_TRACE_DISK_WRITE] > 0);
+    TEST_ASSERT(seen[ESP_JRNL_TRACE_LOCK_ACQUIRE] > 0);
+    TEST_ASSERT_EQUAL_UINT32(seen[ESP_JRNL_TRACE_LOCK_ACQUIRE], seen[ESP_JRNL_TRACE_LOCK_RELEASE]);
+
+    TEST_ESP_OK(esp_jrnl_trace_dump(stdout));
+    TEST_ESP_OK(esp_jrnl_trace_clear());
+    TEST_ESP_OK(esp_jrnl_trace_get(NULL, &count));
+    TEST_ASSERT_EQUAL(0, count);
+
+    test_teardown();
+}
+#endif
+
+#ifdef CONFIG_ESP_JRNL_COMMIT_EXECUTOR
+TEST(jrnl_basic, jrnl_async_commit)
+{
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+            .format_if_mount_failed = true,
+            .max_files = 5
+    };
+
+    esp_jrnl_config_t jrnl_config = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_config.overwrite_existing = true;
+    jrnl_config.force_fs_format = true;
+    jrnl_config.async_commit = true;
+
+    TEST_ESP_OK(esp_vfs_fat_spiflash_mount_jrnl(s_basepath, s_partlabel, &mount_config, &jrnl_config, &s_jrnl_handle));
+
+    size_t sector_size = 0;
+    TEST_ESP_OK(esp_jrnl_get_sector_size(s_jrnl_handle, &sector_size));
+    s_buf_write = (uint8_t*)calloc(1, sector_size);
+    TEST_ASSERT(s_buf_write);
+    s_buf_read = (uint8_t*)calloc(1, sector_size);
+    TEST_ASSERT(s_buf_read);
+
+    const uint8_t buff_pattern[] = "ABCDEFGHABCDEFGH";
+    test_memset_pattern(buff_pattern, sizeof(buff_pattern), s_buf_write, sector_size);
+
+    //commit gets finished by the executor, the following read waits for it
+    size_t test_target_sector = 12;
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector, 1));
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, true));
+    TEST_ESP_OK(esp_jrnl_read(s_jrnl_handle, test_target_sector, s_buf_read, 1));
+    TEST_ASSERT(memcmp(s_buf_read, s_buf_write, sector_size) == 0);
+
+    //explicit wait leaves the store clean
+    TEST_ESP_OK(esp_jrnl_start(s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(s_jrnl_handle, s_buf_write, test_target_sector + 1, 1));
+    TEST_ESP_OK(esp_jrnl_stop(s_jrnl_handle, true));
+    TEST_ESP_OK(esp_jrnl_wait_commit(s_jrnl_handle));
+
+    esp_jrnl_master_t jrnl_master;
+    TEST_ESP_OK(test_get_jrnl_master(s_jrnl_handle, &jrnl_master));
+    TEST_ASSERT(jrnl_master.next_free_sector == 0);
+    TEST_ASSERT(jrnl_master.status == ESP_JRNL_STATUS_TRANS_READY);
+
+    test_teardown();
+}
+
+/* WL writes failing within the file-system area while 'fail' is set (store writes pass) */
+static struct {
+    size_t fs_size;
+    volatile bool fail;
+} s_failing_disk;
+
+static esp_err_t test_failing_disk_write(wl_handle_t handle, size_t dest_addr, const void *src, size_t size)
+{
+    if (s_failing_disk.fail && dest_addr < s_failing_disk.fs_size) {
+        return ESP_FAIL;
+    }
+    return wl_write(handle, dest_addr, src, size);
+}
+
+TEST(jrnl_basic, jrnl_async_commit_failure)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, s_partlabel);
+    TEST_ASSERT_NOT_NULL(partition);
+    wl_handle_t wl_handle = WL_INVALID_HANDLE;
+    TEST_ESP_OK(wl_mount(partition, &wl_handle));
+
+    esp_jrnl_config_extended_t config = {
+        .user_cfg = ESP_JRNL_DEFAULT_CONFIG(),
+        .fs_volume_id = 0,
+        .volume_cfg = ESP_JRNL_VOLUME_DEFAULT_CONFIG(wl_handle),
+        .diskio_cfg = ESP_JRNL_DISKIO_DEFAULT_CONFIG(wl_handle)
+    };
+    config.user_cfg.overwrite_existing = true;
+    config.user_cfg.async_commit = true;
+    config.diskio_cfg.disk_write = test_failing_disk_write;
+
+    esp_jrnl_handle_t jrnl_handle = JRNL_INVALID_HANDLE;
+    TEST_ESP_OK(esp_jrnl_mount(&config, &jrnl_handle));
+
+    size_t sector_size = config.volume_cfg.disk_sector_size;
+    size_t fs_sectors = 0;
+    TEST_ESP_OK(esp_jrnl_get_sector_count(jrnl_handle, &fs_sectors));
+    s_failing_disk.fs_size = fs_sectors * sector_size;
+
+    s_buf_write = (uint8_t*)malloc(2 * sector_size);
+    TEST_ASSERT(s_buf_write);
+    s_buf_read = (uint8_t*)calloc(2, sector_size);
+    TEST_ASSERT(s_buf_read);
+    esp_fill_random(s_buf_write, 2 * sector_size);
+
+    //replay by the executor fails, the transaction stays committed in the store
+    size_t test_target_sector = 12;
+    s_failing_disk.fail = true;
+    TEST_ESP_OK(esp_jrnl_start(jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(jrnl_handle, s_buf_write, test_target_sector, 1));
+    TEST_ESP_OK(esp_jrnl_stop(jrnl_handle, true));
+    TEST_ASSERT(esp_jrnl_wait_commit(jrnl_handle) != ESP_OK);
+
+    esp_jrnl_master_t jrnl_master;
+    TEST_ESP_OK(jrnl_read_master(&config.diskio_cfg, &config.volume_cfg, &jrnl_master));
+    TEST_ASSERT(jrnl_master.status == ESP_JRNL_STATUS_TRANS_COMMIT);
+
+    //the next transaction replays it again first, no remount needed
+    s_failing_disk.fail = false;
+    TEST_ESP_OK(esp_jrnl_start(jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_write(jrnl_handle, s_buf_write + sector_size, test_target_sector + 1, 1));
+    TEST_ESP_OK(esp_jrnl_stop(jrnl_handle, true));
+    TEST_ESP_OK(esp_jrnl_wait_commit(jrnl_handle));
+
+    TEST_ESP_OK(esp_jrnl_read(jrnl_handle, test_target_sector, s_buf_read, 2));
+    TEST_ASSERT(memcmp(s_buf_read, s_buf_write, 2 * sector_size) == 0);
+
+    TEST_ESP_OK(jrnl_read_master(&config.diskio_cfg, &config.volume_cfg, &jrnl_master));
+    TEST_ASSERT(jrnl_master.status == ESP_JRNL_STATUS_TRANS_READY);
+
+    TEST_ESP_OK(esp_jrnl_unmount(jrnl_handle));
+    wl_unmount(wl_handle);
+}
+#endif
+
 TEST_GROUP_RUNNER(fs_journaling_basic)
 {
     RUN_TEST_CASE(jrnl_basic, jrnl_creation);
     RUN_TEST_CASE(jrnl_basic, internal_reads_writes);
     RUN_TEST_CASE(jrnl_basic, reset_master);
+    RUN_TEST_CASE(jrnl_basic, master_slots);
     RUN_TEST_CASE(jrnl_basic, jrnl_start);
     RUN_TEST_CASE(jrnl_basic, jrnl_mount_unmount);
     RUN_TEST_CASE(jrnl_basic, direct_read_write);
+    RUN_TEST_CASE(jrnl_basic, direct_start_stop);
     RUN_TEST_CASE(jrnl_basic, jrnl_start_write);
     RUN_TEST_CASE(jrnl_basic, jrnl_stop_replay);
+    RUN_TEST_CASE(jrnl_basic, jrnl_compressed_write);
+    RUN_TEST_CASE(jrnl_basic, jrnl_batch_failed_op);
+    RUN_TEST_CASE(jrnl_basic, jrnl_batch_touched_overflow);
+    RUN_TEST_CASE(jrnl_basic, jrnl_checksum_engines);
+    RUN_TEST_CASE(jrnl_basic, jrnl_async_diskio);
+    RUN_TEST_CASE(jrnl_basic, jrnl_static_mount);
+    RUN_TEST_CASE(jrnl_basic, jrnl_erase_block_size);
+    RUN_TEST_CASE(jrnl_basic, jrnl_trim);
+    RUN_TEST_CASE(jrnl_basic, jrnl_stats);
+    RUN_TEST_CASE(jrnl_basic, jrnl_diskio_probe);
+    RUN_TEST_CASE(jrnl_basic, jrnl_clean_mount);
+#ifdef CONFIG_ESP_JRNL_TRACE
+    RUN_TEST_CASE(jrnl_basic, jrnl_trace);
+#endif
+#ifdef CONFIG_ESP_JRNL_COMMIT_EXECUTOR
+    RUN_TEST_CASE(jrnl_basic, jrnl_async_commit);
+    RUN_TEST_CASE(jrnl_basic, jrnl_async_commit_failure);
+#endif
 }
 
 void app_main(void)
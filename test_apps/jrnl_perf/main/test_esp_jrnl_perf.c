@@ -0,0 +1,306 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Throughput benchmark of the journaled FAT volume. Each workload runs on a freshly formatted volume, once journaled
+ * and once with the direct disk access (esp_jrnl_set_direct_io()), the results are printed as single-line JSON records
+ * 'JRNL_PERF {...}' collected by pytest_esp_jrnl_perf.py. The volume is the 'jrnl' flash partition on the chip targets
+ * and an emulated NOR flash RAM disk (esp_jrnl_host_disk.h) on the linux target.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_vfs_fat.h"
+#include "esp_vfs_jrnl_fat.h"
+#include "esp_jrnl.h"
+#include "esp_jrnl_host_disk.h"
+#include "esp_jrnl_internal.h"
+
+static const char* TAG = "test_esp_jrnl_perf";
+
+#define PERF_BASE_PATH              "/perf"
+#define PERF_PARTITION_LABEL        "jrnl"
+#define PERF_STORE_SECTORS          32
+#define PERF_ERASE_BLOCK_SIZE       4096
+
+/* workload sizes (the volume has about 850kB of free space) */
+#define PERF_SMALL_FILES            32
+#define PERF_SMALL_FILE_SIZE        64
+#define PERF_LOG_LINES              128
+#define PERF_LOG_LINE_SIZE          96
+#define PERF_SEQ_FILE_SIZE          (256 * 1024)
+#define PERF_SEQ_CHUNK_SIZE         4096
+#define PERF_DIR_CYCLES             16
+#define PERF_RENAME_CYCLES          32
+#define PERF_RENAME_FILE_SIZE       256
+
+#define PERF_CHECK(cond) \
+    if (!(cond)) { \
+        ESP_LOGE(TAG, "%s:%d: check failed: %s", __func__, __LINE__, #cond); \
+        abort(); \
+    }
+
+typedef enum {
+    PERF_MODE_JOURNAL = 0,
+    PERF_MODE_DIRECT,
+    PERF_MODE_COUNT
+} perf_mode_t;
+
+static const char* s_mode_names[PERF_MODE_COUNT] = {"journal", "direct"};
+
+/* workload routine: returns the number of operations done, 'bytes' = file data written */
+typedef size_t (*perf_workload_fn_t)(size_t* bytes);
+
+typedef struct {
+    const char* name;
+    perf_workload_fn_t run;
+} perf_workload_t;
+
+static esp_jrnl_handle_t s_jrnl_handle = JRNL_INVALID_HANDLE;
+static uint8_t s_buf[PERF_SEQ_CHUNK_SIZE];
+
+#if CONFIG_IDF_TARGET_LINUX
+static int32_t s_disk_handle = -1;
+#endif
+
+
+static void perf_path(char* path, size_t size, const char* name, unsigned index)
+{
+    snprintf(path, size, "%s/%s%03u", PERF_BASE_PATH, name, index);
+}
+
+static void perf_write_file(const char* path, size_t size, bool sync)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC);
+    PERF_CHECK(fd >= 0);
+    PERF_CHECK(write(fd, s_buf, size) == (ssize_t)size);
+    if (sync) {
+        PERF_CHECK(fsync(fd) == 0);
+    }
+    PERF_CHECK(close(fd) == 0);
+}
+
+/* fresh volume for each workload run */
+static void perf_mount(perf_mode_t mode)
+{
+    esp_vfs_fat_mount_config_t mount_config = {
+            .format_if_mount_failed = true,
+            .max_files = 5
+    };
+    esp_jrnl_config_t jrnl_config = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_config.store_size_sectors = PERF_STORE_SECTORS;
+    jrnl_config.overwrite_existing = true;
+    jrnl_config.force_fs_format = true;
+    jrnl_config.diskio_probe = true;
+
+#if CONFIG_IDF_TARGET_LINUX
+    esp_jrnl_diskio_t diskio_cfg;
+    esp_jrnl_volume_t volume_cfg;
+    ESP_ERROR_CHECK(esp_jrnl_host_disk_get_config(s_disk_handle, &diskio_cfg, &volume_cfg));
+    ESP_ERROR_CHECK(esp_vfs_fat_diskio_mount_jrnl(PERF_BASE_PATH, &diskio_cfg, &volume_cfg, &mount_config, &jrnl_config, &s_jrnl_handle));
+#else
+    ESP_ERROR_CHECK(esp_vfs_fat_spiflash_mount_jrnl(PERF_BASE_PATH, PERF_PARTITION_LABEL, &mount_config, &jrnl_config, &s_jrnl_handle));
+#endif
+
+    if (mode == PERF_MODE_DIRECT) {
+        ESP_ERROR_CHECK(esp_jrnl_set_direct_io(s_jrnl_handle, true));
+    }
+}
+
+static void perf_unmount(void)
+{
+#if CONFIG_IDF_TARGET_LINUX
+    ESP_ERROR_CHECK(esp_vfs_fat_diskio_unmount_jrnl(&s_jrnl_handle, PERF_BASE_PATH));
+#else
+    ESP_ERROR_CHECK(esp_vfs_fat_spiflash_unmount_jrnl(&s_jrnl_handle, PERF_BASE_PATH));
+#endif
+}
+
+
+/* Workloads */
+
+//create, write a few bytes and close many small files
+static size_t perf_small_files(size_t* bytes)
+{
+    char path[64];
+    for (unsigned i = 0; i < PERF_SMALL_FILES; i++) {
+        perf_path(path, sizeof(path), "sf", i);
+        perf_write_file(path, PERF_SMALL_FILE_SIZE, false);
+    }
+    *bytes = PERF_SMALL_FILES * PERF_SMALL_FILE_SIZE;
+    return PERF_SMALL_FILES;
+}
+
+//log file: append a line and fsync it
+static size_t perf_append_log(size_t* bytes)
+{
+    int fd = open(PERF_BASE_PATH "/log.txt", O_WRONLY | O_CREAT | O_APPEND);
+    PERF_CHECK(fd >= 0);
+    for (unsigned i = 0; i < PERF_LOG_LINES; i++) {
+        PERF_CHECK(write(fd, s_buf, PERF_LOG_LINE_SIZE) == PERF_LOG_LINE_SIZE);
+        PERF_CHECK(fsync(fd) == 0);
+    }
+    PERF_CHECK(close(fd) == 0);
+    *bytes = PERF_LOG_LINES * PERF_LOG_LINE_SIZE;
+    return PERF_LOG_LINES;
+}
+
+//one large file written in big chunks
+static size_t perf_seq_write(size_t* bytes)
+{
+    int fd = open(PERF_BASE_PATH "/seq.bin", O_WRONLY | O_CREAT | O_TRUNC);
+    PERF_CHECK(fd >= 0);
+    for (size_t written = 0; written < PERF_SEQ_FILE_SIZE; written += PERF_SEQ_CHUNK_SIZE) {
+        PERF_CHECK(write(fd, s_buf, PERF_SEQ_CHUNK_SIZE) == PERF_SEQ_CHUNK_SIZE);
+    }
+    PERF_CHECK(close(fd) == 0);
+    *bytes = PERF_SEQ_FILE_SIZE;
+    return PERF_SEQ_FILE_SIZE / PERF_SEQ_CHUNK_SIZE;
+}
+
+//directory created, filled, emptied and removed
+static size_t perf_dir_churn(size_t* bytes)
+{
+    char dir_path[64];
+    char file_path[96];
+    for (unsigned i = 0; i < PERF_DIR_CYCLES; i++) {
+        perf_path(dir_path, sizeof(dir_path), "dir", i);
+        PERF_CHECK(mkdir(dir_path, 0777) == 0);
+        snprintf(file_path, sizeof(file_path), "%s/f.txt", dir_path);
+        perf_write_file(file_path, PERF_SMALL_FILE_SIZE, false);
+        PERF_CHECK(unlink(file_path) == 0);
+        PERF_CHECK(rmdir(dir_path) == 0);
+    }
+    *bytes = PERF_DIR_CYCLES * PERF_SMALL_FILE_SIZE;
+    return PERF_DIR_CYCLES;
+}
+
+//atomic file replacement: new contents in a temporary file, renamed over the old one
+static size_t perf_rename_replace(size_t* bytes)
+{
+    const char* target = PERF_BASE_PATH "/cfg.bin";
+    const char* tmp = PERF_BASE_PATH "/cfg.tmp";
+    perf_write_file(target, PERF_RENAME_FILE_SIZE, false);
+    for (unsigned i = 0; i < PERF_RENAME_CYCLES; i++) {
+        perf_write_file(tmp, PERF_RENAME_FILE_SIZE, true);
+        PERF_CHECK(unlink(target) == 0);
+        PERF_CHECK(rename(tmp, target) == 0);
+    }
+    *bytes = PERF_RENAME_CYCLES * PERF_RENAME_FILE_SIZE;
+    return PERF_RENAME_CYCLES;
+}
+
+static const perf_workload_t s_workloads[] = {
+    {"small_files", perf_small_files},
+    {"append_log", perf_append_log},
+    {"seq_write", perf_seq_write},
+    {"dir_churn", perf_dir_churn},
+    {"rename_replace", perf_rename_replace},
+};
+
+
+/* Commit latency over all the operations: the per-operation histograms merged */
+static void perf_commit_latency(esp_vfs_jrnl_latency_hist_t* merged)
+{
+    memset(merged, 0, sizeof(esp_vfs_jrnl_latency_hist_t));
+    for (int op = 0; op < ESP_VFS_JRNL_OP_COUNT; op++) {
+        esp_vfs_jrnl_latency_hist_t hist;
+        if (esp_vfs_fat_jrnl_get_latency(PERF_BASE_PATH, op, ESP_VFS_JRNL_PHASE_COMMIT, &hist, NULL) != ESP_OK) {
+            return;
+        }
+        merged->count += hist.count;
+        merged->sum_us += hist.sum_us;
+        if (hist.max_us > merged->max_us) {
+            merged->max_us = hist.max_us;
+        }
+        for (size_t i = 0; i < ESP_VFS_JRNL_LATENCY_BUCKETS; i++) {
+            merged->buckets[i] += hist.buckets[i];
+        }
+    }
+}
+
+static void perf_run(const perf_workload_t* workload, perf_mode_t mode)
+{
+    perf_mount(mode);
+
+    //formatting and mounting not measured
+    ESP_ERROR_CHECK(esp_jrnl_reset_stats(s_jrnl_handle));
+    esp_vfs_fat_jrnl_reset_latency(PERF_BASE_PATH);
+
+    size_t bytes = 0;
+    int64_t start_us = jrnl_time_us();
+    size_t ops = workload->run(&bytes);
+    int64_t elapsed_us = jrnl_time_us() - start_us;
+    if (elapsed_us <= 0) {
+        elapsed_us = 1;
+    }
+
+    esp_jrnl_stats_t stats;
+    ESP_ERROR_CHECK(esp_jrnl_get_stats(s_jrnl_handle, &stats));
+    static esp_jrnl_diskio_stats_t diskio_stats;
+    ESP_ERROR_CHECK(esp_jrnl_get_diskio_stats(s_jrnl_handle, &diskio_stats));
+    esp_vfs_jrnl_latency_hist_t commit;
+    perf_commit_latency(&commit);
+    size_t sector_size = 0;
+    ESP_ERROR_CHECK(esp_jrnl_get_sector_size(s_jrnl_handle, &sector_size));
+
+    perf_unmount();
+
+    double erase_blocks = (double)stats.bytes_erased / PERF_ERASE_BLOCK_SIZE;
+
+    //write amplification: all the device writes against the sectors written by FatFS (see esp_jrnl_get_diskio_stats()).
+    //Nothing is journaled with the direct disk access, the FatFS writes are the file-system region writes then
+    uint64_t fs_written = diskio_stats.ops[ESP_JRNL_REGION_FS][ESP_JRNL_DISKIO_STAT_WRITE].bytes;
+    uint64_t store_written = diskio_stats.ops[ESP_JRNL_REGION_STORE_DATA][ESP_JRNL_DISKIO_STAT_WRITE].bytes;
+    uint64_t master_written = diskio_stats.ops[ESP_JRNL_REGION_MASTER][ESP_JRNL_DISKIO_STAT_WRITE].bytes;
+    uint64_t fatfs_written = mode == PERF_MODE_DIRECT ? fs_written : stats.sectors_journaled * sector_size;
+    printf("JRNL_PERF {\"workload\":\"%s\",\"mode\":\"%s\",\"ops\":%u,\"bytes\":%u,\"elapsed_us\":%lld,"
+           "\"ops_per_s\":%.1f,\"mb_per_s\":%.4f,\"erases_per_op\":%.2f,\"device_bytes_written_per_op\":%.0f,"
+           "\"fs_bytes_written\":%llu,\"store_bytes_written\":%llu,\"master_bytes_written\":%llu,\"write_amplification\":%.2f,"
+           "\"transactions\":%u,\"commit_count\":%u,\"commit_mean_us\":%u,\"commit_p50_us\":%u,\"commit_p99_us\":%u,\"commit_max_us\":%u}\n",
+           workload->name, s_mode_names[mode], (unsigned)ops, (unsigned)bytes, (long long)elapsed_us,
+           ops * 1e6 / elapsed_us, bytes / (double)elapsed_us, erase_blocks / ops, (double)stats.bytes_written / ops,
+           (unsigned long long)fs_written, (unsigned long long)store_written, (unsigned long long)master_written,
+           fatfs_written > 0 ? (double)(fs_written + store_written + master_written) / fatfs_written : 0.0,
+           (unsigned)stats.trans_committed, (unsigned)commit.count,
+           commit.count > 0 ? (unsigned)(commit.sum_us / commit.count) : 0,
+           (unsigned)esp_vfs_fat_jrnl_latency_percentile(&commit, 500), (unsigned)esp_vfs_fat_jrnl_latency_percentile(&commit, 990), (unsigned)commit.max_us);
+    fflush(stdout);
+}
+
+void app_main(void)
+{
+    for (size_t i = 0; i < sizeof(s_buf); i++) {
+        s_buf[i] = (uint8_t)('A' + i % 26);
+    }
+
+#if CONFIG_IDF_TARGET_LINUX
+    //1MB NOR flash RAM disk, SPI flash geometry
+    esp_jrnl_host_disk_config_t disk_config = ESP_JRNL_HOST_DISK_DEFAULT_CONFIG();
+    ESP_ERROR_CHECK(esp_jrnl_host_disk_create(&disk_config, &s_disk_handle));
+#endif
+
+    printf("JRNL_PERF_START\n");
+    for (size_t i = 0; i < sizeof(s_workloads) / sizeof(s_workloads[0]); i++) {
+        for (int mode = 0; mode < PERF_MODE_COUNT; mode++) {
+            perf_run(&s_workloads[i], (perf_mode_t)mode);
+        }
+    }
+    printf("JRNL_PERF_DONE\n");
+    fflush(stdout);
+
+#if CONFIG_IDF_TARGET_LINUX
+    ESP_ERROR_CHECK(esp_jrnl_host_disk_delete(s_disk_handle));
+    exit(0);
+#endif
+}
@@ -0,0 +1,72 @@
+# SPDX-FileCopyrightText: 2024-2025 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: CC0-1.0
+
+import json
+import os
+import time
+
+import pytest
+from pytest_embedded import Dut
+from pytest_embedded_idf.utils import idf_parametrize
+
+# JRNL_PERF_RESULT: result file path (default jrnl_perf_<target>.json next to this file)
+# JRNL_PERF_BASELINE: result file of a previous run, the test fails if any ops/s drops below (1 - JRNL_PERF_TOLERANCE) of it
+RESULT_ENV = "JRNL_PERF_RESULT"
+BASELINE_ENV = "JRNL_PERF_BASELINE"
+TOLERANCE_ENV = "JRNL_PERF_TOLERANCE"
+DEFAULT_TOLERANCE = 0.2
+
+
+def collect_results(dut: Dut) -> list:
+    dut.expect_exact("JRNL_PERF_START", timeout=60)
+    results = []
+    while True:
+        match = dut.expect(r"JRNL_PERF (\{.*\})\r?\n|JRNL_PERF_DONE", timeout=600)
+        if match.group(1) is None:
+            return results
+        results.append(json.loads(match.group(1).decode()))
+
+
+def check_baseline(results: list) -> None:
+    baseline_path = os.getenv(BASELINE_ENV)
+    if not baseline_path:
+        return
+    tolerance = float(os.getenv(TOLERANCE_ENV, DEFAULT_TOLERANCE))
+    with open(baseline_path) as f:
+        baseline = {(r["workload"], r["mode"]): r for r in json.load(f)["results"]}
+
+    regressions = []
+    for result in results:
+        ref = baseline.get((result["workload"], result["mode"]))
+        if ref and result["ops_per_s"] < ref["ops_per_s"] * (1 - tolerance):
+            regressions.append("{}/{}: {:.1f} ops/s (baseline {:.1f})".format(result["workload"], result["mode"],
+                                                                          result["ops_per_s"], ref["ops_per_s"]))
+    assert not regressions, "Performance regression: " + ", ".join(regressions)
+
+
+def run_benchmark(dut: Dut, target: str) -> None:
+    results = collect_results(dut)
+    assert results, "no benchmark results"
+
+    result_path = os.getenv(RESULT_ENV) or os.path.join(os.path.dirname(__file__), "jrnl_perf_{}.json".format(target))
+    with open(result_path, "w") as f:
+        json.dump({"target": target, "timestamp": int(time.time()), "results": results}, f, indent=2)
+
+    for r in results:
+        print("{:<16}{:<9}{:>10.1f} ops/s {:>8.3f} MB/s {:>7.2f} erases/op {:>6.2f} WA  commit p50/p99/max {}/{}/{} us".format(
+            r["workload"], r["mode"], r["ops_per_s"], r["mb_per_s"], r["erases_per_op"], r["write_amplification"],
+            r["commit_p50_us"], r["commit_p99_us"], r["commit_max_us"]))
+
+    check_baseline(results)
+
+
+@pytest.mark.generic
+@idf_parametrize("target", ["esp32"], indirect=["target"])
+def test_jrnl_perf(dut: Dut) -> None:
+    run_benchmark(dut, dut.target)
+
+
+@pytest.mark.host_test
+@idf_parametrize("target", ["linux"], indirect=["target"])
+def test_jrnl_perf_linux(dut: Dut) -> None:
+    run_benchmark(dut, "linux")
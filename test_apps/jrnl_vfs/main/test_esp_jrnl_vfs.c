@@ -13,6 +13,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <utime.h>
+#include <dirent.h>
 #include "unity.h"
 #include "unity_fixture.h"
 #include "esp_log.h"
@@ -22,13 +23,13 @@
 #include "freertos/task.h"
 #include "esp_vfs_jrnl_fat.h"
 #include "esp_jrnl_internal.h"
+#include "esp_jrnl_host_disk.h"
 #include "sdkconfig.h"
 #include "esp_crc.h"
 
 
 static const char* TAG = "test_esp_jrnl_vfs";
 static esp_jrnl_handle_t s_jrnl_handle;
-extern esp_jrnl_instance_t* s_jrnl_instance_ptrs[JRNL_MAX_HANDLES];
 static wl_handle_t s_wl_handle = WL_INVALID_HANDLE;
 
 const char* s_basepath = "/spiflash";
@@ -49,7 +50,7 @@ static void test_setup_jrnl(esp_jrnl_config_t* jrnl_config)
     esp_jrnl_config_t* jrnl_config_def = NULL;
 
     if (jrnl_config == NULL) {
-        jrnl_config_def = (esp_jrnl_config_t*)malloc(sizeof(esp_jrnl_config_t));
+        jrnl_config_def = (esp_jrnl_config_t*)calloc(1, sizeof(esp_jrnl_config_t));
         TEST_ASSERT(jrnl_config_def != NULL);
 
         jrnl_config_def->store_size_sectors = 32;
@@ -442,6 +443,437 @@ TEST(jrnl_vfs_fat, jrnl_create_nocommit)
     test_teardown_no_jrnl();
 }
 
+//store resizing of mounted volume, resizing on mount
+TEST(jrnl_vfs_fat, jrnl_resize_store)
+{
+    const uint8_t buff[] = "OOPPQQRRSSTTUUVV";
+    char test_file_name[64] = {0};
+    snprintf(test_file_name, sizeof(test_file_name), "%s/%s", s_basepath, "test.txt");
+
+    //1. create a file on fresh journaled FS (store: 32 sectors)
+    test_setup_jrnl(NULL);
+    FILE* testfile = fopen(test_file_name, "w+");
+    TEST_ASSERT_NOT_NULL(testfile);
+    TEST_ASSERT(fwrite(buff, sizeof(buff), 1, testfile) > 0);
+    TEST_ASSERT(fclose(testfile) == 0);
+
+    size_t fs_sectors = 0;
+    size_t store_sectors = 0;
+    TEST_ESP_OK(esp_jrnl_get_sector_count(s_jrnl_handle, &fs_sectors));
+    TEST_ESP_OK(esp_jrnl_get_store_size(s_jrnl_handle, &store_sectors));
+    TEST_ASSERT_EQUAL(32, store_sectors);
+    size_t volume_sectors = fs_sectors + store_sectors;
+
+    //2. grow & shrink the store, the file must survive. No resizing with open files
+    testfile = fopen(test_file_name, "r");
+    TEST_ASSERT_NOT_NULL(testfile);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_vfs_fat_jrnl_resize_store(s_basepath, 48));
+    TEST_ASSERT(fclose(testfile) == 0);
+
+    TEST_ESP_OK(esp_vfs_fat_jrnl_resize_store(s_basepath, 48));
+    TEST_ESP_OK(esp_jrnl_get_store_size(s_jrnl_handle, &store_sectors));
+    TEST_ESP_OK(esp_jrnl_get_sector_count(s_jrnl_handle, &fs_sectors));
+    TEST_ASSERT_EQUAL(48, store_sectors);
+    TEST_ASSERT_EQUAL(volume_sectors - 48, fs_sectors);
+
+    TEST_ESP_OK(esp_vfs_fat_jrnl_resize_store(s_basepath, 24));
+    TEST_ESP_OK(esp_jrnl_get_store_size(s_jrnl_handle, &store_sectors));
+    TEST_ASSERT_EQUAL(24, store_sectors);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, esp_vfs_fat_jrnl_resize_store(s_basepath, volume_sectors));
+
+    uint8_t buff_read[sizeof(buff)] = {0};
+    testfile = fopen(test_file_name, "r");
+    TEST_ASSERT_NOT_NULL(testfile);
+    TEST_ASSERT(fread(buff_read, sizeof(buff_read), 1, testfile) > 0);
+    TEST_ASSERT(fclose(testfile) == 0);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(buff, buff_read, sizeof(buff));
+    test_teardown_jrnl();
+
+    //3. configured size differs from the existing store: mount fails unless resizing allowed
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+            .format_if_mount_failed = false,
+            .max_files = 5
+    };
+    esp_jrnl_config_t jrnl_config = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_config.store_size_sectors = 32;
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, esp_vfs_fat_spiflash_mount_jrnl(s_basepath, s_partlabel, &mount_config, &jrnl_config, &s_jrnl_handle));
+    s_jrnl_handle = JRNL_INVALID_HANDLE;
+
+    jrnl_config.allow_store_resize = true;
+    TEST_ESP_OK(esp_vfs_fat_spiflash_mount_jrnl(s_basepath, s_partlabel, &mount_config, &jrnl_config, &s_jrnl_handle));
+    TEST_ESP_OK(esp_jrnl_get_store_size(s_jrnl_handle, &store_sectors));
+    TEST_ASSERT_EQUAL(32, store_sectors);
+    test_teardown_jrnl();
+
+    //4. check the file in non-journaled FS
+    test_setup_no_jrnl();
+    memset(buff_read, 0, sizeof(buff_read));
+    testfile = fopen(test_file_name, "r");
+    TEST_ASSERT_NOT_NULL(testfile);
+    TEST_ASSERT(fread(buff_read, sizeof(buff_read), 1, testfile) > 0);
+    TEST_ASSERT(fclose(testfile) == 0);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(buff, buff_read, sizeof(buff));
+    test_teardown_no_jrnl();
+}
+
+//journaling store on a separate partition
+TEST(jrnl_vfs_fat, jrnl_separate_store)
+{
+    const uint8_t buff[] = "WWXXYYZZ00112233";
+    char test_file_name[64] = {0};
+    snprintf(test_file_name, sizeof(test_file_name), "%s/%s", s_basepath, "test.txt");
+
+    //1. fresh journaled FS with the store in 'jrnlstore' partition, the FS takes the whole 'jrnl' partition
+    esp_jrnl_config_t jrnl_config = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_config.store_size_sectors = 16;
+    jrnl_config.overwrite_existing = true;
+    jrnl_config.force_fs_format = true;
+    jrnl_config.store_partition_label = "jrnlstore";
+    test_setup_jrnl(&jrnl_config);
+
+    int32_t wl_handle;
+    int32_t store_wl_handle;
+    TEST_ESP_OK(esp_jrnl_get_diskio_handle(s_jrnl_handle, &wl_handle));
+    TEST_ESP_OK(esp_jrnl_get_store_diskio_handle(s_jrnl_handle, &store_wl_handle));
+    TEST_ASSERT_NOT_EQUAL(wl_handle, store_wl_handle);
+
+    size_t fs_sectors = 0;
+    TEST_ESP_OK(esp_jrnl_get_sector_count(s_jrnl_handle, &fs_sectors));
+    TEST_ASSERT_EQUAL(wl_size(wl_handle) / wl_sector_size(wl_handle), fs_sectors);
+
+    FILE* testfile = fopen(test_file_name, "w+");
+    TEST_ASSERT_NOT_NULL(testfile);
+    TEST_ASSERT(fwrite(buff, sizeof(buff), 1, testfile) > 0);
+    TEST_ASSERT(fclose(testfile) == 0);
+
+    //store resizing doesn't touch the FS
+    TEST_ESP_OK(esp_vfs_fat_jrnl_resize_store(s_basepath, 24));
+    size_t fs_sectors_after = 0;
+    TEST_ESP_OK(esp_jrnl_get_sector_count(s_jrnl_handle, &fs_sectors_after));
+    TEST_ASSERT_EQUAL(fs_sectors, fs_sectors_after);
+    test_teardown_jrnl();
+
+    //2. remount (no format) with the same store partition
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+            .format_if_mount_failed = false,
+            .max_files = 5
+    };
+    jrnl_config.overwrite_existing = false;
+    jrnl_config.force_fs_format = false;
+    jrnl_config.store_size_sectors = 24;
+    TEST_ESP_OK(esp_vfs_fat_spiflash_mount_jrnl(s_basepath, s_partlabel, &mount_config, &jrnl_config, &s_jrnl_handle));
+    TEST_ASSERT(unlink(test_file_name) == 0);
+    test_teardown_jrnl();
+
+    //3. check in non-journaled FS
+    test_setup_no_jrnl();
+    TEST_ASSERT(fopen(test_file_name, "r") == NULL);
+    TEST_ASSERT(errno == ENOENT);
+    test_teardown_no_jrnl();
+}
+
+TEST(jrnl_vfs_fat, jrnl_deferred_commit)
+{
+    const uint8_t buff[] = "0123456789ABCDEF";
+    char test_file_name[64] = {0};
+    snprintf(test_file_name, sizeof(test_file_name), "%s/%s", s_basepath, "test_dc.txt");
+
+    //1. writes accumulated in one transaction, committed by fsync()
+    esp_jrnl_config_t jrnl_config = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_config.overwrite_existing = true;
+    jrnl_config.force_fs_format = true;
+    jrnl_config.commit_mode = ESP_JRNL_COMMIT_DEFERRED;
+    test_setup_jrnl(&jrnl_config);
+
+    esp_jrnl_instance_t* inst_ptr = NULL;
+    TEST_ESP_OK(jrnl_get_instance(s_jrnl_handle, __func__, &inst_ptr));
+    jrnl_put_instance(inst_ptr);
+
+    int fd = open(test_file_name, O_RDWR | O_CREAT | O_TRUNC);
+    TEST_ASSERT_NOT_EQUAL(fd, -1);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(sizeof(buff), write(fd, buff, sizeof(buff)));
+    }
+    TEST_ASSERT(inst_ptr->master.status == ESP_JRNL_STATUS_TRANS_OPEN);
+    TEST_ASSERT(inst_ptr->batch_ops >= 5);
+
+    TEST_ASSERT_EQUAL(0, fsync(fd));
+    TEST_ASSERT(inst_ptr->master.status == ESP_JRNL_STATUS_TRANS_READY);
+    TEST_ASSERT(inst_ptr->batch_ops == 0);
+
+    //2. the batched data readable before the commit, committed by close() (f_close() syncs)
+    TEST_ASSERT_EQUAL(sizeof(buff), write(fd, buff, sizeof(buff)));
+    s_buf_read = calloc(1, sizeof(buff));
+    TEST_ASSERT_NOT_NULL(s_buf_read);
+    TEST_ASSERT_EQUAL(sizeof(buff), pread(fd, s_buf_read, sizeof(buff), 4 * sizeof(buff)));
+    TEST_ASSERT(memcmp(s_buf_read, buff, sizeof(buff)) == 0);
+    TEST_ASSERT(inst_ptr->master.status == ESP_JRNL_STATUS_TRANS_OPEN);
+    TEST_ASSERT_EQUAL(0, close(fd));
+    TEST_ASSERT(inst_ptr->master.status == ESP_JRNL_STATUS_TRANS_READY);
+    test_teardown_jrnl();
+
+    //3. check in non-journaled FS
+    test_setup_no_jrnl();
+    struct stat st;
+    TEST_ASSERT_EQUAL(0, stat(test_file_name, &st));
+    TEST_ASSERT_EQUAL(5 * sizeof(buff), st.st_size);
+    test_teardown_no_jrnl();
+}
+
+TEST(jrnl_vfs_fat, jrnl_host_ramdisk)
+{
+    const char* ramdisk_basepath = "/ramdisk";
+    const uint8_t buff[] = "0123456789ABCDEF";
+    char test_file_name[64] = {0};
+    snprintf(test_file_name, sizeof(test_file_name), "%s/%s", ramdisk_basepath, "test_rd.txt");
+
+    //128kB NOR-like RAM disk (512B sectors, 4kB erase blocks)
+    esp_jrnl_host_disk_config_t disk_config = ESP_JRNL_HOST_DISK_DEFAULT_CONFIG();
+    disk_config.sector_size = 512;
+    disk_config.sector_count = 256;
+    int32_t disk_handle = -1;
+    TEST_ESP_OK(esp_jrnl_host_disk_create(&disk_config, &disk_handle));
+
+    esp_jrnl_diskio_t diskio_cfg;
+    esp_jrnl_volume_t volume_cfg;
+    TEST_ESP_OK(esp_jrnl_host_disk_get_config(disk_handle, &diskio_cfg, &volume_cfg));
+    TEST_ASSERT(volume_cfg.volume_size == 256 * 512);
+    TEST_ASSERT(diskio_cfg.erase_block_size == 4096);
+
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+            .format_if_mount_failed = true,
+            .max_files = 5
+    };
+    esp_jrnl_config_t jrnl_config = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_config.store_size_sectors = 16;
+    jrnl_config.overwrite_existing = true;
+    jrnl_config.force_fs_format = true;
+
+    //1. new volume on the RAM disk, the file written through the journal
+    esp_jrnl_handle_t jrnl_handle = JRNL_INVALID_HANDLE;
+    TEST_ESP_OK(esp_vfs_fat_diskio_mount_jrnl(ramdisk_basepath, &diskio_cfg, &volume_cfg, &mount_config, &jrnl_config, &jrnl_handle));
+
+    FILE* f = fopen(test_file_name, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL(sizeof(buff), fwrite(buff, 1, sizeof(buff), f));
+    TEST_ASSERT_EQUAL(0, fclose(f));
+
+    TEST_ESP_OK(esp_vfs_fat_diskio_unmount_jrnl(&jrnl_handle, ramdisk_basepath));
+    TEST_ASSERT(jrnl_handle == JRNL_INVALID_HANDLE);
+
+    //2. remount of the existing volume and store
+    jrnl_config.overwrite_existing = false;
+    jrnl_config.force_fs_format = false;
+    TEST_ESP_OK(esp_vfs_fat_diskio_mount_jrnl(ramdisk_basepath, &diskio_cfg, &volume_cfg, &mount_config, &jrnl_config, &jrnl_handle));
+
+    s_buf_read = calloc(1, sizeof(buff));
+    TEST_ASSERT_NOT_NULL(s_buf_read);
+    f = fopen(test_file_name, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL(sizeof(buff), fread(s_buf_read, 1, sizeof(buff), f));
+    TEST_ASSERT_EQUAL(0, fclose(f));
+    TEST_ASSERT(memcmp(s_buf_read, buff, sizeof(buff)) == 0);
+
+    TEST_ESP_OK(esp_vfs_fat_diskio_unmount_jrnl(&jrnl_handle, ramdisk_basepath));
+
+    //3. every write hit erased space, the erases got accounted per erase block
+    esp_jrnl_host_disk_stats_t stats;
+    TEST_ESP_OK(esp_jrnl_host_disk_get_stats(disk_handle, &stats, false));
+    TEST_ASSERT(stats.unerased_writes == 0);
+    TEST_ASSERT(stats.write_ops > 0);
+    TEST_ASSERT(stats.block_erases > 0);
+
+    TEST_ESP_OK(esp_jrnl_host_disk_delete(disk_handle));
+}
+
+TEST(jrnl_vfs_fat, jrnl_read_only)
+{
+    //1. create a file and a directory in the journaled FS
+    test_setup_jrnl(NULL);
+
+    char test_file_name[64] = {0};
+    snprintf(test_file_name, sizeof(test_file_name), "%s/%s", s_basepath, "test_ro.txt");
+    char test_dir_name[64] = {0};
+    snprintf(test_dir_name, sizeof(test_dir_name), "%s/%s", s_basepath, "dir_ro");
+
+    const char test_data[] = "read-only volume test";
+    FILE* testfile = fopen(test_file_name, "w");
+    TEST_ASSERT_NOT_NULL(testfile);
+    TEST_ASSERT_EQUAL(1, fwrite(test_data, sizeof(test_data), 1, testfile));
+    TEST_ASSERT_EQUAL(0, fclose(testfile));
+    TEST_ASSERT_EQUAL(0, mkdir(test_dir_name, 0777));
+
+    test_teardown_jrnl();
+
+    //2. remount read-only: no write reaches the disk, the reads work as usual
+    esp_jrnl_config_t jrnl_config = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_config.read_only = true;
+    jrnl_config.diskio_probe = true;
+    test_setup_jrnl(&jrnl_config);
+
+    char read_data[sizeof(test_data)] = {0};
+    testfile = fopen(test_file_name, "r");
+    TEST_ASSERT_NOT_NULL(testfile);
+    TEST_ASSERT_EQUAL(1, fread(read_data, sizeof(read_data), 1, testfile));
+    TEST_ASSERT_EQUAL(0, fclose(testfile));
+    TEST_ASSERT_EQUAL_STRING(test_data, read_data);
+
+    DIR* dir = opendir(s_basepath);
+    TEST_ASSERT_NOT_NULL(dir);
+    int entries = 0;
+    while (readdir(dir) != NULL) {
+        entries++;
+    }
+    TEST_ASSERT_EQUAL(0, closedir(dir));
+    TEST_ASSERT_EQUAL(2, entries);
+
+    //3. all the modifications refused
+    errno = 0;
+    TEST_ASSERT_NULL(fopen(test_file_name, "a"));
+    TEST_ASSERT_EQUAL(EROFS, errno);
+    TEST_ASSERT_EQUAL(-1, open(test_file_name, O_RDWR));
+    TEST_ASSERT_EQUAL(EROFS, errno);
+    TEST_ASSERT_EQUAL(-1, unlink(test_file_name));
+    TEST_ASSERT_EQUAL(EROFS, errno);
+    TEST_ASSERT_EQUAL(-1, rmdir(test_dir_name));
+    TEST_ASSERT_EQUAL(EROFS, errno);
+    TEST_ASSERT_EQUAL(-1, truncate(test_file_name, 0));
+    TEST_ASSERT_EQUAL(EROFS, errno);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_jrnl_start(s_jrnl_handle));
+
+    static esp_jrnl_diskio_stats_t diskio_stats;
+    TEST_ESP_OK(esp_jrnl_get_diskio_stats(s_jrnl_handle, &diskio_stats));
+    for (int region = 0; region < ESP_JRNL_REGION_COUNT; region++) {
+        TEST_ASSERT_EQUAL_UINT32(0, diskio_stats.ops[region][ESP_JRNL_DISKIO_STAT_WRITE].count);
+        TEST_ASSERT_EQUAL_UINT32(0, diskio_stats.ops[region][ESP_JRNL_DISKIO_STAT_ERASE].count);
+    }
+
+    test_teardown_jrnl();
+}
+
+//factory image of 'image' directory, generated by jrnl_mkimage.py and flashed to 'jrnlimg' with the app
+TEST(jrnl_vfs_fat, jrnl_mkimage)
+{
+    const char* image_label = "jrnlimg";
+    const char hello_data[] = "Hello from jrnl_mkimage\n";
+    char test_file_name[64] = {0};
+    snprintf(test_file_name, sizeof(test_file_name), "%s/%s", s_basepath, "hello.txt");
+
+    //1. clean store: TRANS_READY master of generation 1 in slot 1, the spare slot 0 erased
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, image_label);
+    TEST_ASSERT_NOT_NULL(partition);
+    wl_handle_t wl_handle = WL_INVALID_HANDLE;
+    TEST_ESP_OK(wl_mount(partition, &wl_handle));
+
+    size_t sector_size = wl_sector_size(wl_handle);
+    s_buf_read = (uint8_t*)malloc(sector_size);
+    TEST_ASSERT_NOT_NULL(s_buf_read);
+
+    esp_jrnl_master_t master;
+    TEST_ESP_OK(wl_read(wl_handle, wl_size(wl_handle) - 2 * sector_size, s_buf_read, sector_size));
+    memcpy(&master, s_buf_read, sizeof(master));
+    TEST_ASSERT(jrnl_master_slot_valid(&master, 1));
+    TEST_ASSERT_EQUAL_HEX32(esp_crc32_le(UINT32_MAX, (const uint8_t*)&master, offsetof(esp_jrnl_master_t, crc32)), master.crc32);
+    TEST_ASSERT_EQUAL_UINT32(1, master.generation);
+    TEST_ASSERT_EQUAL_UINT32(ESP_JRNL_STATUS_TRANS_READY, master.status);
+    TEST_ASSERT_EQUAL_UINT32(0, master.next_free_sector);
+    TEST_ASSERT_EQUAL_UINT32(32, master.store_size_sectors);
+    TEST_ASSERT_EQUAL_UINT32(wl_size(wl_handle), master.volume.volume_size);
+    TEST_ASSERT_EQUAL_UINT32(sector_size, master.volume.disk_sector_size);
+
+    TEST_ESP_OK(wl_read(wl_handle, wl_size(wl_handle) - sector_size, s_buf_read, sector_size));
+    for (size_t i = 0; i < sector_size; i++) {
+        TEST_ASSERT_EQUAL_HEX8(0xFF, s_buf_read[i]);
+    }
+    free(s_buf_read);
+    s_buf_read = NULL;
+    TEST_ESP_OK(wl_unmount(wl_handle));
+
+    //2. the first mount only reads the master record and the file-system, nothing formatted
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+            .format_if_mount_failed = false,
+            .max_files = 5
+    };
+    esp_jrnl_config_t jrnl_config = ESP_JRNL_DEFAULT_CONFIG();
+    jrnl_config.diskio_probe = true;
+    TEST_ESP_OK(esp_vfs_fat_spiflash_mount_jrnl(s_basepath, image_label, &mount_config, &jrnl_config, &s_jrnl_handle));
+
+    static esp_jrnl_diskio_stats_t diskio_stats;
+    TEST_ESP_OK(esp_jrnl_get_diskio_stats(s_jrnl_handle, &diskio_stats));
+    for (int region = 0; region < ESP_JRNL_REGION_COUNT; region++) {
+        TEST_ASSERT_EQUAL_UINT32(0, diskio_stats.ops[region][ESP_JRNL_DISKIO_STAT_WRITE].count);
+        TEST_ASSERT_EQUAL_UINT32(0, diskio_stats.ops[region][ESP_JRNL_DISKIO_STAT_ERASE].count);
+    }
+
+    //3. the packed file readable
+    char read_data[sizeof(hello_data)] = {0};
+    FILE* testfile = fopen(test_file_name, "r");
+    TEST_ASSERT_NOT_NULL(testfile);
+    TEST_ASSERT_EQUAL(sizeof(hello_data) - 1, fread(read_data, 1, sizeof(read_data), testfile));
+    TEST_ASSERT_EQUAL(0, fclose(testfile));
+    TEST_ASSERT_EQUAL_STRING(hello_data, read_data);
+
+    TEST_ESP_OK(esp_vfs_fat_spiflash_unmount_jrnl(&s_jrnl_handle, s_basepath));
+    TEST_ASSERT(s_jrnl_handle == JRNL_INVALID_HANDLE);
+}
+
+#ifdef CONFIG_ESP_JRNL_VFS_LATENCY_STATS
+TEST(jrnl_vfs_fat, jrnl_latency_stats)
+{
+    test_setup_jrnl(NULL);
+
+    char test_file_name[64] = {0};
+    snprintf(test_file_name, sizeof(test_file_name), "%s/%s", s_basepath, "test_lat.txt");
+    uint8_t buff[] = "AABBCCDDEEFF";
+
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, esp_vfs_fat_jrnl_get_latency("/nonexistent", ESP_VFS_JRNL_OP_OPEN, ESP_VFS_JRNL_PHASE_TOTAL, NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_vfs_fat_jrnl_get_latency(s_basepath, ESP_VFS_JRNL_OP_COUNT, ESP_VFS_JRNL_PHASE_TOTAL, NULL, NULL));
+    TEST_ESP_OK(esp_vfs_fat_jrnl_reset_latency(s_basepath));
+
+    //open + 4x write + close
+    int fd = open(test_file_name, O_WRONLY | O_CREAT | O_TRUNC);
+    TEST_ASSERT_NOT_EQUAL(fd, -1);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_NOT_EQUAL(write(fd, buff, sizeof(buff)), -1);
+    }
+    TEST_ASSERT_EQUAL(0, close(fd));
+
+    esp_vfs_jrnl_latency_hist_t hist;
+    esp_vfs_jrnl_latency_summary_t summary;
+    TEST_ESP_OK(esp_vfs_fat_jrnl_get_latency(s_basepath, ESP_VFS_JRNL_OP_WRITE, ESP_VFS_JRNL_PHASE_TOTAL, &hist, &summary));
+    TEST_ASSERT_EQUAL_UINT32(4, summary.count);
+    uint32_t bucket_sum = 0;
+    for (int i = 0; i < ESP_VFS_JRNL_LATENCY_BUCKETS; i++) {
+        bucket_sum += hist.buckets[i];
+    }
+    TEST_ASSERT_EQUAL_UINT32(4, bucket_sum);
+    TEST_ASSERT(summary.p50_us <= summary.p99_us && summary.p99_us <= summary.max_us);
+    TEST_ASSERT(summary.max_us > 0);
+
+    //the phases make up the total
+    esp_vfs_jrnl_latency_summary_t phase_summary[ESP_VFS_JRNL_PHASE_COUNT];
+    uint64_t phase_sum_us = 0;
+    for (int phase = ESP_VFS_JRNL_PHASE_FATFS; phase < ESP_VFS_JRNL_PHASE_COUNT; phase++) {
+        TEST_ESP_OK(esp_vfs_fat_jrnl_get_latency(s_basepath, ESP_VFS_JRNL_OP_CLOSE, phase, &hist, &phase_summary[phase]));
+        TEST_ASSERT_EQUAL_UINT32(1, phase_summary[phase].count);
+        phase_sum_us += hist.sum_us;
+    }
+    TEST_ESP_OK(esp_vfs_fat_jrnl_get_latency(s_basepath, ESP_VFS_JRNL_OP_CLOSE, ESP_VFS_JRNL_PHASE_TOTAL, &hist, NULL));
+    TEST_ASSERT(phase_sum_us <= hist.sum_us);
+    TEST_ASSERT(phase_summary[ESP_VFS_JRNL_PHASE_APPEND].max_us > 0);
+    TEST_ASSERT(phase_summary[ESP_VFS_JRNL_PHASE_COMMIT].max_us > 0);
+
+    TEST_ESP_OK(esp_vfs_fat_jrnl_get_latency(s_basepath, ESP_VFS_JRNL_OP_OPEN, ESP_VFS_JRNL_PHASE_TOTAL, NULL, &summary));
+    TEST_ASSERT_EQUAL_UINT32(1, summary.count);
+
+    TEST_ESP_OK(esp_vfs_fat_jrnl_reset_latency(s_basepath));
+    TEST_ESP_OK(esp_vfs_fat_jrnl_get_latency(s_basepath, ESP_VFS_JRNL_OP_WRITE, ESP_VFS_JRNL_PHASE_TOTAL, NULL, &summary));
+    TEST_ASSERT_EQUAL_UINT32(0, summary.count);
+
+    test_teardown_jrnl();
+}
+#endif
+
 TEST_GROUP_RUNNER(fs_journaling_vfs)
 {
     RUN_TEST_CASE(jrnl_vfs_fat, jrnl_create_file);
@@ -451,6 +883,15 @@ TEST_GROUP_RUNNER(fs_journaling_vfs)
     RUN_TEST_CASE(jrnl_vfs_fat, jrnl_truncate_file);
     RUN_TEST_CASE(jrnl_vfs_fat, jrnl_utime);
     RUN_TEST_CASE(jrnl_vfs_fat, jrnl_mkdir_rmdir);
+    RUN_TEST_CASE(jrnl_vfs_fat, jrnl_resize_store);
+    RUN_TEST_CASE(jrnl_vfs_fat, jrnl_separate_store);
+    RUN_TEST_CASE(jrnl_vfs_fat, jrnl_deferred_commit);
+    RUN_TEST_CASE(jrnl_vfs_fat, jrnl_host_ramdisk);
+    RUN_TEST_CASE(jrnl_vfs_fat, jrnl_read_only);
+    RUN_TEST_CASE(jrnl_vfs_fat, jrnl_mkimage);
+#ifdef CONFIG_ESP_JRNL_VFS_LATENCY_STATS
+    RUN_TEST_CASE(jrnl_vfs_fat, jrnl_latency_stats);
+#endif
 }
 
 void app_main(void)
@@ -1,12 +1,53 @@
 # SPDX-FileCopyrightText: 2024-2025 Espressif Systems (Shanghai) CO LTD
 # SPDX-License-Identifier: CC0-1.0
 
+import json
+import struct
+import subprocess
+import sys
+from pathlib import Path
+
 import pytest
 from pytest_embedded import Dut
 from pytest_embedded_idf.utils import idf_parametrize
 
+COMPONENT_DIR = Path(__file__).resolve().parents[2]
+
 
 @pytest.mark.generic
 @idf_parametrize("target", ["esp32"], indirect=["target"])
 def test_jrnl_vfs(dut: Dut) -> None:
     dut.expect_unity_test_output()
+
+
+# raw image of the test app 'image' directory (the device side is the jrnl_mkimage test case): master record
+# of generation 1 in slot 1 with the spare slot erased, accepted by tools/jrnl_inspect
+@pytest.mark.host_test
+def test_jrnl_mkimage_inspect(tmp_path: Path) -> None:
+    sector_size = 512
+    image = tmp_path / "jrnl_raw.img"
+    subprocess.run([sys.executable, str(COMPONENT_DIR / "tools" / "jrnl_mkimage" / "jrnl_mkimage.py"),
+                    str(Path(__file__).parent / "image"), "--raw", "--sector_size", str(sector_size),
+                    "--partition_size", str(256 * 1024), "--output_file", str(image)], check=True)
+
+    data = image.read_bytes()
+    slot0 = data[-sector_size:]
+    slot1 = data[-2 * sector_size:-sector_size]
+    assert slot0 == b"\xff" * sector_size
+    magic, store_size_sectors, _, next_free_sector, status = struct.unpack_from("<IIIII", slot1)
+    generation = struct.unpack_from("<I", slot1, 44)[0]
+    assert (magic, store_size_sectors, next_free_sector, status, generation) == (0x6A6B6C6D, 32, 0, 1, 1)
+
+    build_dir = tmp_path / "build_inspect"
+    subprocess.run(["cmake", "-S", str(COMPONENT_DIR / "tools" / "jrnl_inspect"), "-B", str(build_dir)], check=True)
+    subprocess.run(["cmake", "--build", str(build_dir)], check=True)
+
+    # the master record checksum and the store geometry checked by the tool, exit code 2 if any fails
+    result = subprocess.run([str(build_dir / "jrnl_inspect"), "-j", str(image)], capture_output=True, text=True, check=True)
+    summary = json.loads(result.stdout)
+    assert summary["sector_size"] == sector_size
+    assert summary["master_slot"] == 1
+    assert summary["generation"] == 1
+    assert summary["status"] == "Ready"
+    assert summary["records"] == 0
+    assert not summary["corrupted"]
@@ -0,0 +1,96 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Image files of the host tools (tools/jrnl_inspect, tools/jrnl_replay): a part of a file loaded into memory and written
+ * back in place. The master record lookup in the loaded image is jrnl_find_master_in_image() (esp_jrnl_format.c).
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char* path;
+    long offset;                            /* image part used, in the file */
+    size_t size;
+    uint8_t* data;
+} jrnl_tool_image_t;
+
+/* loads 'length' bytes from 'offset' of the file (length <= 0: the rest of the file). Returns 0, or -1 reported on stderr */
+static inline int jrnl_tool_image_load(jrnl_tool_image_t* image, const char* path, long offset, long length)
+{
+    memset(image, 0, sizeof(*image));
+    image->path = path;
+
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long file_len = ftell(f);
+    if (length <= 0) {
+        length = file_len - offset;
+    }
+    if (offset < 0 || length <= 0 || offset + length > file_len) {
+        fprintf(stderr, "%s: offset/length out of the file (%ld bytes)\n", path, file_len);
+        fclose(f);
+        return -1;
+    }
+
+    image->data = malloc((size_t)length);
+    if (image->data == NULL) {
+        fprintf(stderr, "out of memory\n");
+        fclose(f);
+        return -1;
+    }
+
+    fseek(f, offset, SEEK_SET);
+    if (fread(image->data, 1, (size_t)length, f) != (size_t)length) {
+        fprintf(stderr, "%s: read failed\n", path);
+        free(image->data);
+        image->data = NULL;
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    image->offset = offset;
+    image->size = (size_t)length;
+    return 0;
+}
+
+/* writes the image back to its place in the file. Returns 0, or -1 reported on stderr */
+static inline int jrnl_tool_image_store(const jrnl_tool_image_t* image)
+{
+    FILE* f = fopen(image->path, "r+b");
+    if (f == NULL) {
+        perror(image->path);
+        return -1;
+    }
+
+    int ret = 0;
+    if (fseek(f, image->offset, SEEK_SET) != 0 || fwrite(image->data, 1, image->size, f) != image->size || fflush(f) != 0) {
+        fprintf(stderr, "%s: write failed\n", image->path);
+        ret = -1;
+    }
+    fclose(f);
+
+    return ret;
+}
+
+#ifdef __cplusplus
+}
+#endif
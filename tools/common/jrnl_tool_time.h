@@ -0,0 +1,29 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Time source shared by the host benchmarks (tools/jrnl_*_bench). The device code measures by jrnl_time_us().
+ */
+
+#pragma once
+
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* monotonic time in nanoseconds (the benchmarks time single sectors, microseconds are too coarse) */
+static inline double jrnl_tool_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#ifdef __cplusplus
+}
+#endif
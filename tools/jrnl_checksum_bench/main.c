@@ -0,0 +1,137 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host benchmark of the journal record checksum engines: computes each engine over the input files (or over
+ * a pseudo-random buffer when no file given) in record-sized chunks and reports the speed. CRC32C is measured both
+ * with the slice-by-8 tables and with the CPU CRC instructions (when supported by the machine).
+ *
+ * usage: jrnl_checksum_bench [-s record_size] [file ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_jrnl_checksum.h"
+#include "jrnl_tool_time.h"
+
+#define BENCH_RANDOM_SIZE   (4 * 1024 * 1024)
+#define BENCH_MIN_BYTES     (256 * 1024 * 1024)
+
+typedef uint32_t (*bench_fn_t)(const uint8_t* data, size_t len);
+
+static uint32_t bench_xxh32(const uint8_t* data, size_t len)
+{
+    return jrnl_xxh32(data, len, 0);
+}
+
+static void bench(const char* name, bench_fn_t fn, const uint8_t* data, size_t size, size_t record_size)
+{
+    volatile uint32_t sink = 0;
+    size_t bytes = 0;
+
+    //repeat the input until enough data is processed for a stable figure
+    double t0 = jrnl_tool_time_ns();
+    do {
+        for (size_t off = 0; off < size; off += record_size) {
+            size_t len = size - off < record_size ? size - off : record_size;
+            sink ^= fn(data + off, len);
+        }
+        bytes += size;
+    } while (bytes < BENCH_MIN_BYTES);
+    double t = jrnl_tool_time_ns() - t0;
+
+    printf("%-22s %6.3f ns/byte  %8.1f MB/s\n", name, t / bytes, bytes / t * 1e3);
+    (void)sink;
+}
+
+int main(int argc, char** argv)
+{
+    size_t record_size = 4096;
+    int first = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+        record_size = strtoul(argv[2], NULL, 0);
+        first = 3;
+    }
+    if (record_size == 0) {
+        fprintf(stderr, "usage: %s [-s record_size] [file ...]\n", argv[0]);
+        return 1;
+    }
+
+    for (uint32_t engine = 0; engine < JRNL_CHECKSUM_COUNT; engine++) {
+        if (jrnl_checksum_init(engine) != 0) {
+            fprintf(stderr, "%s: initialization failed\n", jrnl_checksum_name(engine));
+            return 1;
+        }
+    }
+
+    uint8_t* data = NULL;
+    size_t size = 0;
+
+    if (first >= argc) {
+        size = BENCH_RANDOM_SIZE;
+        data = malloc(size);
+        if (data == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        srand(1);
+        for (size_t i = 0; i < size; i++) {
+            data[i] = (uint8_t)rand();
+        }
+    }
+
+    for (int i = first; i < argc; i++) {
+        FILE* f = fopen(argv[i], "rb");
+        if (f == NULL) {
+            perror(argv[i]);
+            free(data);
+            return 1;
+        }
+        fseek(f, 0, SEEK_END);
+        long len = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        uint8_t* grown = len > 0 ? realloc(data, size + len) : data;
+        if (grown == NULL) {
+            fprintf(stderr, "out of memory\n");
+            fclose(f);
+            free(data);
+            return 1;
+        }
+        data = grown;
+        size += fread(data + size, 1, len > 0 ? (size_t)len : 0, f);
+        fclose(f);
+    }
+
+    if (size == 0) {
+        fprintf(stderr, "no input data\n");
+        free(data);
+        return 1;
+    }
+
+    //all the implementations of an engine must agree
+    if (jrnl_crc32c(data, size) != jrnl_crc32c_sw(data, size)) {
+        fprintf(stderr, "crc32c: accelerated and table results differ\n");
+        free(data);
+        return 1;
+    }
+
+    printf("input: %zu bytes, record size %zu\n", size, record_size);
+    bench("crc32", jrnl_crc32_le, data, size, record_size);
+    bench("crc32c (tables)", jrnl_crc32c_sw, data, size, record_size);
+    if (jrnl_checksum_accelerated(JRNL_CHECKSUM_CRC32C)) {
+        bench("crc32c (cpu)", jrnl_crc32c, data, size, record_size);
+    }
+    else {
+        printf("%-22s not supported by this machine\n", "crc32c (cpu)");
+    }
+    bench("xxh32", bench_xxh32, data, size, record_size);
+
+    free(data);
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host benchmark of the journal payload codec: splits the input files (eg FAT images dumped from the device)
+ * into records of 'record_sectors' sectors, encodes each record the way esp_jrnl_write() does (jrnl_append():
+ * the encoded payload used only if it saves a store sector, inline payloads packed in the tail sector) and
+ * reports the store sectors saved and the codec speed.
+ *
+ * usage: jrnl_codec_bench [-s sector_size] [-r record_sectors] file [file ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_jrnl_codec.h"
+#include "esp_jrnl_format.h"
+#include "jrnl_tool_time.h"
+
+int main(int argc, char** argv)
+{
+    size_t sector_size = 4096;
+    size_t record_sectors = 1;
+    int first = 1;
+
+    while (first + 1 < argc && argv[first][0] == '-') {
+        if (strcmp(argv[first], "-s") == 0) {
+            sector_size = strtoul(argv[first + 1], NULL, 0);
+        }
+        else if (strcmp(argv[first], "-r") == 0) {
+            record_sectors = strtoul(argv[first + 1], NULL, 0);
+        }
+        else {
+            break;
+        }
+        first += 2;
+    }
+    if (first >= argc || sector_size <= sizeof(esp_jrnl_operation_t) || record_sectors == 0) {
+        fprintf(stderr, "usage: %s [-s sector_size] [-r record_sectors] file [file ...]\n", argv[0]);
+        return 1;
+    }
+
+    //encoded payload limit as in jrnl_append(): 1 store sector less than the plain record, at least the inline size
+    size_t data_size = record_sectors * sector_size;
+    size_t max_payload_size = (record_sectors - 1) * sector_size;
+    if (max_payload_size < JRNL_RECORD_INLINE_SIZE(sector_size)) {
+        max_payload_size = JRNL_RECORD_INLINE_SIZE(sector_size);
+    }
+
+    uint8_t* in = malloc(data_size);
+    uint8_t* enc = malloc(max_payload_size);
+    uint8_t* dec = malloc(data_size);
+    uint32_t* workmem = malloc(JRNL_LZF_WORKMEM_SIZE);
+    if (in == NULL || enc == NULL || dec == NULL || workmem == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    size_t records = 0, records_enc = 0, records_inline = 0;
+    size_t bytes_in = 0, bytes_out = 0, bytes_dec = 0;
+    size_t store_raw = 0, store_enc = 0;
+    size_t tail_offset = 0;
+    double t_enc = 0, t_dec = 0;
+    int ret = 0;
+
+    for (int i = first; i < argc && ret == 0; i++) {
+        FILE* f = fopen(argv[i], "rb");
+        if (f == NULL) {
+            perror(argv[i]);
+            ret = 1;
+            break;
+        }
+
+        size_t rd;
+        while ((rd = fread(in, 1, data_size, f)) > 0) {
+            memset(in + rd, 0, data_size - rd);
+
+            double t0 = jrnl_tool_time_ns();
+            size_t out_len = jrnl_lzf_compress(in, data_size, enc, max_payload_size, workmem);
+            double t1 = jrnl_tool_time_ns();
+            t_enc += t1 - t0;
+
+            records++;
+            bytes_in += data_size;
+
+            //plain record: header sector + payload sectors
+            esp_jrnl_oper_header_t header = { .sector_count = record_sectors, .payload_size = data_size };
+            store_raw += jrnl_record_sectors(&header, sector_size);
+
+            if (out_len > 0) {
+                t0 = jrnl_tool_time_ns();
+                size_t dec_len = jrnl_lzf_decompress(enc, out_len, dec, data_size);
+                t_dec += jrnl_tool_time_ns() - t0;
+                if (dec_len != data_size || memcmp(dec, in, data_size) != 0) {
+                    fprintf(stderr, "%s: round-trip mismatch at record %zu\n", argv[i], records - 1);
+                    ret = 1;
+                    break;
+                }
+                records_enc++;
+                bytes_dec += data_size;
+                header.payload_size = out_len;
+            }
+            bytes_out += header.payload_size;
+
+            //records with inline payload get packed in the tail sector, flushed when full or before a full record
+            size_t packed_size = JRNL_RECORD_PACKED_SIZE(header.payload_size);
+            uint32_t sectors = jrnl_record_sectors(&header, sector_size);
+            if (tail_offset > 0 && (sectors > 1 || tail_offset + packed_size > sector_size)) {
+                store_enc++;
+                tail_offset = 0;
+            }
+            if (sectors == 1) {
+                records_inline++;
+                tail_offset += packed_size;
+            }
+            else {
+                store_enc += sectors;
+            }
+        }
+        fclose(f);
+    }
+
+    //the commit flushes the last tail sector
+    if (tail_offset > 0) {
+        store_enc++;
+    }
+
+    if (ret == 0 && records > 0) {
+        printf("records:          %zu of %zu sectors (sector size %zu)\n", records, record_sectors, sector_size);
+        printf("encoded:          %zu (%.1f%%)\n", records_enc, 100.0 * records_enc / records);
+        printf("stored inline:    %zu (%.1f%%)\n", records_inline, 100.0 * records_inline / records);
+        printf("payload ratio:    %.2f\n", (double)bytes_in / bytes_out);
+        printf("store sectors:    %zu -> %zu (%.1f%% less flash programmed, one transaction)\n", store_raw, store_enc, 100.0 * ((double)store_raw - store_enc) / store_raw);
+        printf("encode:           %.2f ns/byte\n", t_enc / bytes_in);
+        if (bytes_dec > 0) {
+            printf("decode:           %.2f ns/byte\n", t_dec / bytes_dec);
+        }
+    }
+
+    free(in);
+    free(enc);
+    free(dec);
+    free(workmem);
+
+    return ret;
+}
@@ -0,0 +1,394 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Offline journaling store inspector: reads a raw image of the store device (the journaled volume itself, or the separate
+ * store device), decodes the master record and the operation records by the component's own format code (esp_jrnl_format.c)
+ * and reports how the store space is spent:
+ *  - store fill level (sectors used by the records / store data sectors)
+ *  - wasted header ratio (store bytes taken by the record headers, incl. the header sectors of the non-inline records)
+ *  - wasted duplicate ratio (store bytes of the journaled target sectors rewritten again later within the transaction)
+ *  - the most duplicated target sectors
+ *
+ * The image must be the device as seen by the journal (eg SD card image, host disk image, or a wear-levelled partition
+ * read out through the WL layer), raw flash dumps of wear-levelled partitions are not decoded.
+ *
+ * usage: jrnl_inspect [-s sector_size] [-o offset] [-l length] [-a] [-q] [-j] image
+ *   -s  sector size (default: detected from the master record, 512..4096)
+ *   -o  byte offset of the store device within the image file (default 0)
+ *   -l  store device length in bytes (default: the rest of the image file)
+ *   -a  follow the records past 'next_free_sector' (stale records of the previous transactions, while their checksums hold)
+ *   -q  don't list the records
+ *   -j  summary in JSON
+ *
+ * exit code: 0 = OK, 1 = usage or I/O error, 2 = no valid master record or a corrupted record within the transaction
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include "esp_jrnl_format.h"
+#include "esp_jrnl_checksum.h"
+#include "jrnl_tool_image.h"
+
+#define INSPECT_TOP_SECTORS     10
+
+typedef struct {
+    uint32_t sector;                        /* target sector */
+    uint32_t record;                        /* index of the record writing it */
+} sector_ref_t;
+
+typedef struct {
+    uint32_t store_sector;                  /* store sector of the record header */
+    uint32_t offset;                        /* header offset within the sector */
+    esp_jrnl_oper_header_t header;
+    uint32_t store_bytes;                   /* store bytes taken (packed size for inline records) */
+    uint32_t superseded;                    /* target sectors rewritten by a later record */
+    bool stale;                             /* past 'next_free_sector' */
+} record_info_t;
+
+typedef struct {
+    uint32_t records;
+    uint32_t records_by_type[ESP_JRNL_RECORD_TRIM + 1];
+    uint32_t stale_records;
+    uint32_t used_sectors;                  /* store sectors taken by the analyzed records */
+    uint64_t header_bytes;
+    uint64_t payload_bytes;
+    uint64_t decoded_bytes;                 /* journaled target data (sector_count * sector size of data records) */
+    uint64_t sectors_journaled;
+    uint64_t sectors_trimmed;
+    uint64_t duplicate_sectors;             /* journaled target sectors rewritten later */
+    uint64_t duplicate_bytes;               /* store bytes of the rewritten sectors (record share) */
+    uint32_t unique_sectors;
+} inspect_summary_t;
+
+static int cmp_sector_ref(const void* a, const void* b)
+{
+    const sector_ref_t* x = (const sector_ref_t*)a;
+    const sector_ref_t* y = (const sector_ref_t*)b;
+    if (x->sector != y->sector) {
+        return x->sector < y->sector ? -1 : 1;
+    }
+    return x->record < y->record ? -1 : (x->record > y->record);
+}
+
+static void print_master(const esp_jrnl_master_t* master, int slot, size_t image_size)
+{
+    printf("master record (slot %d, generation %" PRIu32 ")\n", slot, master->generation);
+    printf("  status:                 %s\n", jrnl_status_name(master->status));
+    printf("  store size:             %" PRIu32 " sectors (%" PRIu32 " data sectors)\n", master->store_size_sectors, (uint32_t)JRNL_STORE_DATA_SECTORS(master));
+    printf("  store offset:           sector %" PRIu32 "\n", master->store_volume_offset_sector);
+    printf("  next free sector:       %" PRIu32 "\n", master->next_free_sector);
+    printf("  volume:                 %" PRIu32 " bytes, sector %" PRIu32 "\n", master->volume.volume_size, master->volume.disk_sector_size);
+    printf("  store device:           %" PRIu32 " bytes%s\n", master->store_volume.volume_size, master->store_separate ? " (separate)" : "");
+    printf("  file-system sectors:    %" PRIu32 "\n", (uint32_t)JRNL_FS_SECTORS(master));
+    printf("  record checksum:        %s\n", jrnl_checksum_name(master->checksum));
+    if (master->store_volume.volume_size != image_size) {
+        printf("  WARNING: image size %zu differs from the store device size\n", image_size);
+    }
+}
+
+/*
+ * Walks the operation records of the store. Returns the number of records found (up to 'capacity'),
+ * '*corrupted' is set when a record within 'next_free_sector' fails the checks
+ */
+static uint32_t walk_records(const uint8_t* store, const esp_jrnl_master_t* master, bool scan_stale,
+                             record_info_t* records, uint32_t capacity, bool* corrupted)
+{
+    size_t sector_size = master->store_volume.disk_sector_size;
+    uint32_t data_sectors = JRNL_STORE_DATA_SECTORS(master);
+    uint32_t limit = scan_stale ? data_sectors : master->next_free_sector;
+    esp_jrnl_record_pos_t pos = { 0, 0 };
+    uint32_t count = 0;
+
+    *corrupted = false;
+
+    while (pos.sector_index < limit && count < capacity) {
+        const uint8_t* sector_buf = store + (size_t)pos.sector_index * sector_size;
+        esp_jrnl_operation_t oper;
+        memcpy(&oper, sector_buf + pos.offset, sizeof(oper));
+
+        bool stale = pos.sector_index >= master->next_free_sector;
+        uint32_t record_sectors = jrnl_record_sectors(&oper.header, sector_size);
+        if (oper.header.sector_count == 0 ||
+            oper.crc32_header != jrnl_checksum(master->checksum, &oper.header, sizeof(oper.header)) ||
+            pos.sector_index + record_sectors > (stale ? data_sectors : master->next_free_sector)) {
+            if (!stale) {
+                fprintf(stderr, "record at store sector %" PRIu32 " offset %u invalid (header checksum or size)\n", pos.sector_index, (unsigned)pos.offset);
+                *corrupted = true;
+            }
+            break;
+        }
+
+        record_info_t* info = &records[count++];
+        info->store_sector = pos.sector_index;
+        info->offset = (uint32_t)pos.offset;
+        info->header = oper.header;
+        info->store_bytes = record_sectors == 1 ? (uint32_t)JRNL_RECORD_PACKED_SIZE(oper.header.payload_size) : record_sectors * (uint32_t)sector_size;
+        info->superseded = 0;
+        info->stale = stale;
+
+        jrnl_record_next(sector_buf, sector_size, &oper, &pos);
+    }
+
+    return count;
+}
+
+/* marks the target sectors rewritten by later records, fills in the duplicate figures. Returns -1 when out of memory */
+static int analyze_duplicates(record_info_t* records, uint32_t count, inspect_summary_t* sum, sector_ref_t** refs_out, size_t* refs_count)
+{
+    size_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        total += records[i].header.sector_count;
+    }
+
+    sector_ref_t* refs = malloc((total ? total : 1) * sizeof(sector_ref_t));
+    if (refs == NULL) {
+        return -1;
+    }
+
+    size_t n = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t s = 0; s < records[i].header.sector_count; s++) {
+            refs[n].sector = records[i].header.target_sector + s;
+            refs[n].record = i;
+            n++;
+        }
+    }
+    qsort(refs, n, sizeof(sector_ref_t), cmp_sector_ref);
+
+    //each reference followed by another one of the same sector is superseded (trims supersede the writes too)
+    for (size_t i = 0; i < n; i++) {
+        if (i == 0 || refs[i].sector != refs[i - 1].sector) {
+            sum->unique_sectors++;
+        }
+        if (i + 1 < n && refs[i + 1].sector == refs[i].sector) {
+            records[refs[i].record].superseded++;
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        const record_info_t* info = &records[i];
+        if (info->superseded == 0 || info->header.record_type == ESP_JRNL_RECORD_TRIM) {
+            continue;
+        }
+        sum->duplicate_sectors += info->superseded;
+        sum->duplicate_bytes += (uint64_t)info->store_bytes * info->superseded / info->header.sector_count;
+    }
+
+    *refs_out = refs;
+    *refs_count = n;
+    return 0;
+}
+
+/* the target sectors written most often, sorted 'refs' given */
+static void print_top_sectors(const sector_ref_t* refs, size_t n, bool json)
+{
+    uint32_t top_sector[INSPECT_TOP_SECTORS];
+    uint32_t top_count[INSPECT_TOP_SECTORS];
+    uint32_t top_n = 0;
+
+    for (size_t i = 0; i < n;) {
+        size_t j = i;
+        while (j < n && refs[j].sector == refs[i].sector) {
+            j++;
+        }
+        uint32_t writes = (uint32_t)(j - i);
+        //insertion into the descending list (the last item dropped when full)
+        if (writes > 1 && (top_n < INSPECT_TOP_SECTORS || top_count[INSPECT_TOP_SECTORS - 1] < writes)) {
+            uint32_t k = top_n < INSPECT_TOP_SECTORS ? top_n++ : INSPECT_TOP_SECTORS - 1;
+            while (k > 0 && top_count[k - 1] < writes) {
+                top_sector[k] = top_sector[k - 1];
+                top_count[k] = top_count[k - 1];
+                k--;
+            }
+            top_sector[k] = refs[i].sector;
+            top_count[k] = writes;
+        }
+        i = j;
+    }
+
+    if (json) {
+        printf("  \"top_duplicates\": [");
+        for (uint32_t i = 0; i < top_n; i++) {
+            printf("%s{\"sector\": %" PRIu32 ", \"writes\": %" PRIu32 "}", i ? ", " : "", top_sector[i], top_count[i]);
+        }
+        printf("]\n");
+        return;
+    }
+
+    if (top_n == 0) {
+        printf("  no duplicate target sectors\n");
+        return;
+    }
+    printf("  most rewritten target sectors:");
+    for (uint32_t i = 0; i < top_n; i++) {
+        printf(" %" PRIu32 "(x%" PRIu32 ")", top_sector[i], top_count[i]);
+    }
+    printf("\n");
+}
+
+static double ratio(uint64_t part, uint64_t whole)
+{
+    return whole ? (double)part / (double)whole : 0.0;
+}
+
+int main(int argc, char** argv)
+{
+    size_t sector_size = 0;
+    long offset = 0;
+    long length = 0;
+    bool scan_stale = false;
+    bool quiet = false;
+    bool json = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:o:l:aqj")) != -1) {
+        switch (opt) {
+            case 's': sector_size = strtoul(optarg, NULL, 0); break;
+            case 'o': offset = strtol(optarg, NULL, 0); break;
+            case 'l': length = strtol(optarg, NULL, 0); break;
+            case 'a': scan_stale = true; break;
+            case 'q': quiet = true; break;
+            case 'j': json = true; break;
+            default: optind = argc + 1; break;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "usage: %s [-s sector_size] [-o offset] [-l length] [-a] [-q] [-j] image\n", argv[0]);
+        return 1;
+    }
+
+    jrnl_tool_image_t image;
+    if (jrnl_tool_image_load(&image, argv[optind], offset, length) != 0) {
+        return 1;
+    }
+
+    esp_jrnl_master_t master;
+    int slot = jrnl_find_master_in_image(image.data, image.size, sector_size, &master);
+    if (slot < 0) {
+        fprintf(stderr, "%s: %s\n", argv[optind], slot == JRNL_IMAGE_ERR_NO_MASTER ? "no valid journal master record found" :
+                "master record inconsistent with the image (store geometry or checksum engine)");
+        free(image.data);
+        return 2;
+    }
+    sector_size = master.store_volume.disk_sector_size;
+
+    const uint8_t* store = image.data + (size_t)master.store_volume_offset_sector * sector_size;
+    uint32_t data_sectors = JRNL_STORE_DATA_SECTORS(&master);
+
+    //one record per store sector at least, packed inline records several
+    uint32_t capacity = (uint32_t)(data_sectors * (sector_size / sizeof(esp_jrnl_operation_t)));
+    record_info_t* records = malloc(capacity * sizeof(record_info_t));
+    if (records == NULL) {
+        fprintf(stderr, "out of memory\n");
+        free(image.data);
+        return 1;
+    }
+
+    bool corrupted = false;
+    uint32_t count = walk_records(store, &master, scan_stale, records, capacity, &corrupted);
+
+    inspect_summary_t sum = { 0 };
+    for (uint32_t i = 0; i < count; i++) {
+        const record_info_t* info = &records[i];
+        uint32_t record_sectors = jrnl_record_sectors(&info->header, sector_size);
+
+        sum.records++;
+        sum.stale_records += info->stale;
+        if (info->header.record_type <= ESP_JRNL_RECORD_TRIM) {
+            sum.records_by_type[info->header.record_type]++;
+        }
+        if (info->store_sector + record_sectors > sum.used_sectors) {
+            sum.used_sectors = info->store_sector + record_sectors;
+        }
+        //the header sector of a non-inline record carries nothing else
+        sum.header_bytes += record_sectors == 1 ? info->store_bytes - info->header.payload_size : sector_size;
+        sum.payload_bytes += info->header.payload_size;
+        if (info->header.record_type == ESP_JRNL_RECORD_TRIM) {
+            sum.sectors_trimmed += info->header.sector_count;
+        } else {
+            sum.sectors_journaled += info->header.sector_count;
+            sum.decoded_bytes += (uint64_t)info->header.sector_count * sector_size;
+        }
+    }
+
+    sector_ref_t* refs = NULL;
+    size_t refs_count = 0;
+    if (analyze_duplicates(records, count, &sum, &refs, &refs_count) != 0) {
+        fprintf(stderr, "out of memory\n");
+        free(records);
+        free(image.data);
+        return 1;
+    }
+
+    uint64_t used_bytes = (uint64_t)sum.used_sectors * sector_size;
+
+    if (json) {
+        printf("{\n");
+        printf("  \"sector_size\": %zu,\n", sector_size);
+        printf("  \"master_slot\": %d,\n", slot);
+        printf("  \"generation\": %" PRIu32 ",\n", master.generation);
+        printf("  \"status\": \"%s\",\n", jrnl_status_name(master.status));
+        printf("  \"store_size_sectors\": %" PRIu32 ",\n", master.store_size_sectors);
+        printf("  \"store_data_sectors\": %" PRIu32 ",\n", data_sectors);
+        printf("  \"next_free_sector\": %" PRIu32 ",\n", master.next_free_sector);
+        printf("  \"checksum\": \"%s\",\n", jrnl_checksum_name(master.checksum));
+        printf("  \"records\": %" PRIu32 ",\n", sum.records);
+        printf("  \"stale_records\": %" PRIu32 ",\n", sum.stale_records);
+        printf("  \"data_records\": %" PRIu32 ",\n", sum.records_by_type[ESP_JRNL_RECORD_DATA]);
+        printf("  \"trim_records\": %" PRIu32 ",\n", sum.records_by_type[ESP_JRNL_RECORD_TRIM]);
+        printf("  \"used_sectors\": %" PRIu32 ",\n", sum.used_sectors);
+        printf("  \"fill_level\": %.4f,\n", ratio(sum.used_sectors, data_sectors));
+        printf("  \"sectors_journaled\": %" PRIu64 ",\n", sum.sectors_journaled);
+        printf("  \"sectors_trimmed\": %" PRIu64 ",\n", sum.sectors_trimmed);
+        printf("  \"unique_sectors\": %" PRIu32 ",\n", sum.unique_sectors);
+        printf("  \"duplicate_sectors\": %" PRIu64 ",\n", sum.duplicate_sectors);
+        printf("  \"header_bytes\": %" PRIu64 ",\n", sum.header_bytes);
+        printf("  \"payload_bytes\": %" PRIu64 ",\n", sum.payload_bytes);
+        printf("  \"decoded_bytes\": %" PRIu64 ",\n", sum.decoded_bytes);
+        printf("  \"wasted_header_ratio\": %.4f,\n", ratio(sum.header_bytes, used_bytes));
+        printf("  \"wasted_duplicate_ratio\": %.4f,\n", ratio(sum.duplicate_bytes, used_bytes));
+        printf("  \"payload_ratio\": %.4f,\n", ratio(sum.payload_bytes, sum.decoded_bytes));
+        printf("  \"corrupted\": %s,\n", corrupted ? "true" : "false");
+        print_top_sectors(refs, refs_count, true);
+        printf("}\n");
+    } else {
+        print_master(&master, slot, image.size);
+
+        if (!quiet && count > 0) {
+            printf("\n  #     store  off  type   target      count  codec  payload  rewritten\n");
+            for (uint32_t i = 0; i < count; i++) {
+                const record_info_t* info = &records[i];
+                printf("  %-5" PRIu32 " %-6" PRIu32 " %-4" PRIu32 " %-6s %-11" PRIu32 " %-6" PRIu32 " %-6u %-8" PRIu32 " %" PRIu32 "%s\n",
+                       i, info->store_sector, info->offset, jrnl_record_type_name(info->header.record_type),
+                       info->header.target_sector, info->header.sector_count, (unsigned)info->header.codec,
+                       info->header.payload_size, info->superseded, info->stale ? "  (stale)" : "");
+            }
+        }
+
+        printf("\nsummary\n");
+        printf("  records:                %" PRIu32 " (data %" PRIu32 ", trim %" PRIu32 ", stale %" PRIu32 ")\n", sum.records,
+               sum.records_by_type[ESP_JRNL_RECORD_DATA], sum.records_by_type[ESP_JRNL_RECORD_TRIM], sum.stale_records);
+        printf("  store fill level:       %.1f%% (%" PRIu32 " of %" PRIu32 " data sectors)\n", 100.0 * ratio(sum.used_sectors, data_sectors), sum.used_sectors, data_sectors);
+        printf("  target sectors:         %" PRIu64 " journaled, %" PRIu32 " unique, %" PRIu64 " trimmed\n", sum.sectors_journaled, sum.unique_sectors, sum.sectors_trimmed);
+        printf("  wasted header ratio:    %.1f%% (%" PRIu64 " bytes)\n", 100.0 * ratio(sum.header_bytes, used_bytes), sum.header_bytes);
+        printf("  wasted duplicate ratio: %.1f%% (%" PRIu64 " sectors rewritten later)\n", 100.0 * ratio(sum.duplicate_bytes, used_bytes), sum.duplicate_sectors);
+        printf("  payload/data ratio:     %.1f%% (%" PRIu64 " of %" PRIu64 " bytes)\n", 100.0 * ratio(sum.payload_bytes, sum.decoded_bytes), sum.payload_bytes, sum.decoded_bytes);
+        print_top_sectors(refs, refs_count, false);
+        if (corrupted) {
+            printf("  CORRUPTED record within the transaction, the rest not decoded\n");
+        }
+    }
+
+    free(refs);
+    free(records);
+    free(image.data);
+
+    return corrupted ? 2 : 0;
+}
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+"""
+Generates a journaled FAT partition image from a directory tree: the file-system occupies the volume start, the
+journaling store the volume end, with a clean store (TRANS_READY master record in slot 1, generation 1). The first
+mount of such an image only reads the master record - no formatting through the journal, no FS-direct phase.
+
+The FAT part is built by the ESP-IDF generators ($IDF_PATH/components/fatfs/fatfsgen.py, wl_fatfsgen.py), the
+wear-levelled variant (default) wraps the journaled volume into the WL layout expected by esp_vfs_fat_spiflash_mount_jrnl().
+--raw writes the journaled volume itself (SD card or host disk images). The store parameters must match the mount
+configuration (esp_jrnl_config_t.store_size_sectors, checksum) - a mismatching store size is reported as inconsistent
+configuration at the mount.
+
+usage: jrnl_mkimage.py [--partition_size SIZE] [--output_file FILE] [--store_size_sectors N] [--raw] input_directory
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+JRNL_STORE_MARKER = 0x6A6B6C6D
+JRNL_MASTER_SLOT_COUNT = 2
+JRNL_MIN_STORE_SIZE = 4
+ESP_JRNL_STATUS_TRANS_READY = 1
+JRNL_CHECKSUMS = {'crc32': 0, 'crc32c': 1, 'xxh32': 2}
+WL_SECTOR_SIZE = 4096
+
+# esp_jrnl_master_t (see private_include/esp_jrnl_format.h), 'crc32' at offset 48
+MASTER_FORMAT = '<IIIIIIIII?3xII'
+MASTER_CRC_FORMAT = '<I'
+
+
+def import_fatfsgen() -> None:
+    idf_path = os.environ.get('IDF_PATH')
+    if not idf_path:
+        raise RuntimeError('IDF_PATH not set, the FAT image is built by $IDF_PATH/components/fatfs/fatfsgen.py')
+    sys.path.insert(0, os.path.join(idf_path, 'components', 'fatfs'))
+
+
+def master_record(volume_sectors: int, sector_size: int, store_size_sectors: int, checksum: int) -> bytes:
+    volume_size = volume_sectors * sector_size
+    generation = 1
+    master = struct.pack(MASTER_FORMAT,
+                         JRNL_STORE_MARKER,
+                         store_size_sectors,
+                         volume_sectors - store_size_sectors,   # store_volume_offset_sector
+                         0,                                     # next_free_sector
+                         ESP_JRNL_STATUS_TRANS_READY,
+                         volume_size, sector_size,              # volume
+                         volume_size, sector_size,              # store_volume
+                         False,                                 # store_separate
+                         checksum,
+                         generation)
+    # esp_crc32_le(UINT32_MAX, ...) equivalent
+    return master + struct.pack(MASTER_CRC_FORMAT, zlib.crc32(master, 0xFFFFFFFF))
+
+
+def journal_store(volume_sectors: int, sector_size: int, store_size_sectors: int, checksum: int) -> bytes:
+    # record sectors and the spare master slot (slot 0 == the last store sector) erased, generation 1 lives in slot 1
+    store = bytearray(b'\xff' * store_size_sectors * sector_size)
+    master = master_record(volume_sectors, sector_size, store_size_sectors, checksum)
+    slot_offset = (store_size_sectors - 1 - 1 % JRNL_MASTER_SLOT_COUNT) * sector_size
+    store[slot_offset:slot_offset + sector_size] = master + bytes(sector_size - len(master))
+    return bytes(store)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description='Journaled FAT partition image generator (esp_jrnl)')
+    parser.add_argument('input_directory', help='directory tree to be placed in the image')
+    parser.add_argument('--output_file', default='fatfs_jrnl_image.img', help='output image file')
+    parser.add_argument('--partition_size', type=lambda x: int(x, 0), default=1024 * 1024,
+                        help='partition size in bytes (raw volume size with --raw)')
+    parser.add_argument('--sector_size', type=int, default=WL_SECTOR_SIZE, choices=[512, 1024, 2048, 4096],
+                        help='volume sector size (wear-levelled images: 4096 only)')
+    parser.add_argument('--store_size_sectors', type=int, default=32, help='journaling store size (esp_jrnl_config_t.store_size_sectors)')
+    parser.add_argument('--checksum', choices=list(JRNL_CHECKSUMS), default='crc32', help='record checksum engine (esp_jrnl_config_t.checksum)')
+    parser.add_argument('--raw', action='store_true', help='write the journaled volume without the wear-levelling layer')
+    parser.add_argument('--long_name_support', action='store_true', help='long file names (CONFIG_FATFS_LFN_xxx)')
+    parser.add_argument('--use_default_datetime', action='store_true', help='all the entries get the FatFS default timestamp')
+    parser.add_argument('--fat_type', type=int, choices=[12, 16], default=None, help='explicit FAT type (default: by the cluster count)')
+    parser.add_argument('--fat_count', type=int, choices=[1, 2], default=2, help='number of FAT tables (CONFIG_FATFS_ONE_FAT: 1)')
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.input_directory):
+        parser.error('input directory {} not found'.format(args.input_directory))
+    if not args.raw and args.sector_size != WL_SECTOR_SIZE:
+        parser.error('wear-levelled images support {}-byte sectors only'.format(WL_SECTOR_SIZE))
+    if args.partition_size % args.sector_size != 0:
+        parser.error('partition size must be a multiple of the sector size')
+
+    import_fatfsgen()
+    from fatfsgen import FATFS
+    from wl_fatfsgen import WLFATFS
+
+    wl_fatfs = None
+    if args.raw:
+        volume_sectors = args.partition_size // args.sector_size
+    else:
+        # the journaled volume is the WL volume (wl_size()), the generator sizes it by the WL state and config sectors
+        wl_fatfs = WLFATFS(size=args.partition_size, sector_size=args.sector_size, explicit_fat_type=args.fat_type,
+                           long_names_enabled=args.long_name_support, use_default_datetime=args.use_default_datetime,
+                           fat_tables_cnt=args.fat_count)
+        volume_sectors = wl_fatfs.plain_fat_sectors
+
+    # same limits as esp_jrnl_mount(), the file-system needs more than the boot sector
+    fs_sectors = volume_sectors - args.store_size_sectors
+    if args.store_size_sectors < JRNL_MIN_STORE_SIZE or fs_sectors <= 1:
+        print('store of {} sectors does not fit the volume of {} sectors'.format(args.store_size_sectors, volume_sectors), file=sys.stderr)
+        return 1
+
+    fatfs = FATFS(size=fs_sectors * args.sector_size, sector_size=args.sector_size, explicit_fat_type=args.fat_type,
+                  long_names_enabled=args.long_name_support, use_default_datetime=args.use_default_datetime,
+                  fat_tables_cnt=args.fat_count)
+    fatfs.generate(args.input_directory)
+
+    fs_image = bytes(fatfs.state.binary_image)
+    if len(fs_image) != fs_sectors * args.sector_size:
+        print('unexpected FAT image size {} (expected {})'.format(len(fs_image), fs_sectors * args.sector_size), file=sys.stderr)
+        return 1
+
+    volume = fs_image + journal_store(volume_sectors, args.sector_size, args.store_size_sectors, JRNL_CHECKSUMS[args.checksum])
+
+    if wl_fatfs is None:
+        with open(args.output_file, 'wb') as output:
+            output.write(volume)
+    else:
+        wl_fatfs.plain_fatfs.state.binary_image = bytearray(volume)
+        wl_fatfs.init_wl()
+        wl_fatfs.wl_write_filesystem(args.output_file)
+
+    print('{}: volume {} x {} B, file-system {} sectors, journaling store {} sectors (TRANS_READY)'.format(
+        args.output_file, volume_sectors, args.sector_size, fs_sectors, args.store_size_sectors))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,309 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Offline journal replay: does what jrnl_replay() does during esp_jrnl_mount(), on image files. A committed transaction
+ * is verified (record header and data checksums) and transferred
+ * to the file-system sectors, an open (uncommitted) one is discarded, and the master record is reset to TRANS_READY
+ * in the spare slot. The records are parsed and decoded by the component's own format code (esp_jrnl_format.c).
+ * All the checks are done in memory before anything is written back, so an image failing them is left untouched.
+ *
+ * The image must be the device as seen by the journal (eg SD card image, host disk image, or a wear-levelled partition
+ * read out through the WL layer). Several images can be given for batch processing, one summary line each.
+ *
+ * usage: jrnl_replay [-s sector_size] [-o offset] [-l length] [-t target_image] [-T target_offset] [-n] [-q] image [image ...]
+ *   -s  sector size (default: detected from the master record, 512..4096)
+ *   -o  byte offset of the store device within the image files (default 0)
+ *   -l  store device length in bytes (default: the rest of the image file)
+ *   -t  journaled volume image, when the store is on a separate device (one store image only)
+ *   -T  byte offset of the journaled volume within the target image file (default 0)
+ *   -n  check only, don't write anything back
+ *   -q  no per-record lines
+ *
+ * exit code: 0 = all the images clean or repaired, 1 = usage or I/O error, 2 = an image failed the checks (left untouched)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include "esp_jrnl_format.h"
+#include "esp_jrnl_checksum.h"
+#include "jrnl_tool_image.h"
+
+#define REPLAY_OK           0
+#define REPLAY_ERR_IO       1
+#define REPLAY_ERR_CHECK    2
+
+typedef struct {
+    const esp_jrnl_operation_t* oper;       /* record header in the store image */
+    const uint8_t* payload;                 /* stored payload (inline or the following sectors) */
+} record_ref_t;
+
+typedef struct {
+    long offset;
+    long length;
+    size_t sector_size;
+    const char* target_path;
+    long target_offset;
+    bool check_only;
+    bool quiet;
+} replay_options_t;
+
+/* walks the records of the transaction, header checksums and record bounds verified. Returns the record count, -1 on failure */
+static int collect_records(const jrnl_tool_image_t* store, const esp_jrnl_master_t* master, record_ref_t** records_out)
+{
+    size_t sector_size = master->store_volume.disk_sector_size;
+    const uint8_t* store_data = store->data + (size_t)master->store_volume_offset_sector * sector_size;
+    uint32_t capacity = (uint32_t)(master->next_free_sector * (sector_size / sizeof(esp_jrnl_operation_t)));
+    record_ref_t* records = malloc((capacity ? capacity : 1) * sizeof(record_ref_t));
+    if (records == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return -1;
+    }
+
+    esp_jrnl_record_pos_t pos = { 0, 0 };
+    uint32_t count = 0;
+
+    while (pos.sector_index < master->next_free_sector && count < capacity) {
+        const uint8_t* sector_buf = store_data + (size_t)pos.sector_index * sector_size;
+        const esp_jrnl_operation_t* oper = (const esp_jrnl_operation_t*)(sector_buf + pos.offset);
+        uint32_t record_sectors = jrnl_record_sectors(&oper->header, sector_size);
+
+        if (oper->header.sector_count == 0 ||
+            oper->crc32_header != jrnl_checksum(master->checksum, &oper->header, sizeof(oper->header)) ||
+            pos.sector_index + record_sectors > master->next_free_sector ||
+            (uint64_t)oper->header.target_sector + oper->header.sector_count > JRNL_FS_SECTORS(master)) {
+            fprintf(stderr, "%s: record at store sector %" PRIu32 " offset %u invalid (header checksum or bounds)\n",
+                    store->path, pos.sector_index, (unsigned)pos.offset);
+            free(records);
+            return -1;
+        }
+
+        records[count].oper = oper;
+        records[count].payload = record_sectors == 1 ? (const uint8_t*)(oper + 1) : sector_buf + sector_size;
+        count++;
+
+        jrnl_record_next(sector_buf, sector_size, oper, &pos);
+    }
+
+    *records_out = records;
+    return (int)count;
+}
+
+/* applies the records to the target image in memory, the journal order kept */
+static int apply_records(const record_ref_t* records, int count, const esp_jrnl_master_t* master, jrnl_tool_image_t* target, bool quiet,
+                         uint32_t* applied)
+{
+    size_t sector_size = master->volume.disk_sector_size;
+    int ret = REPLAY_OK;
+
+    uint8_t* data = NULL;
+    for (int i = 0; i < count && ret == REPLAY_OK; i++) {
+        const esp_jrnl_oper_header_t* header = &records[i].oper->header;
+        uint8_t* target_data = target->data + (size_t)header->target_sector * sector_size;
+        size_t data_size = (size_t)header->sector_count * sector_size;
+
+        //discarded sectors read back erased
+        if (header->record_type == ESP_JRNL_RECORD_TRIM) {
+            memset(target_data, 0xFF, data_size);
+            (*applied)++;
+            if (!quiet) {
+                printf("  #%-4d %-5s %" PRIu32 "+%" PRIu32 " erased\n", i, jrnl_record_type_name(header->record_type), header->target_sector, header->sector_count);
+            }
+            continue;
+        }
+
+        uint8_t* grown = realloc(data, data_size);
+        if (grown == NULL) {
+            fprintf(stderr, "out of memory\n");
+            ret = REPLAY_ERR_IO;
+            break;
+        }
+        data = grown;
+
+        int decode_err = jrnl_record_decode(header, records[i].payload, data, sector_size);
+        if (decode_err != JRNL_RECORD_DECODE_OK) {
+            fprintf(stderr, "%s: record #%d payload can't be decoded (%d)\n", target->path, i, decode_err);
+            ret = REPLAY_ERR_CHECK;
+            break;
+        }
+        if (jrnl_checksum(master->checksum, data, data_size) != header->crc32_data) {
+            fprintf(stderr, "%s: record #%d data checksum mismatch\n", target->path, i);
+            ret = REPLAY_ERR_CHECK;
+            break;
+        }
+        memcpy(target_data, data, data_size);
+        (*applied)++;
+
+        if (!quiet) {
+            printf("  #%-4d %-5s %" PRIu32 "+%" PRIu32 " applied\n", i, jrnl_record_type_name(header->record_type), header->target_sector, header->sector_count);
+        }
+    }
+
+    free(data);
+    return ret;
+}
+
+/* TRANS_READY master programmed to the spare slot, the stale slot erased (see jrnl_reset_master()) */
+static void reset_master(jrnl_tool_image_t* store, esp_jrnl_master_t* master)
+{
+    size_t sector_size = master->store_volume.disk_sector_size;
+    uint8_t* store_data = store->data + (size_t)master->store_volume_offset_sector * sector_size;
+
+    master->jrnl_magic_mark = JRNL_STORE_MARKER;
+    master->next_free_sector = 0;
+    master->status = ESP_JRNL_STATUS_TRANS_READY;
+    uint32_t slot = jrnl_master_advance(master);
+
+    uint8_t* slot_sector = store_data + (size_t)JRNL_MASTER_SLOT_SECTOR(master, slot) * sector_size;
+    memset(slot_sector, 0, sector_size);
+    memcpy(slot_sector, master, sizeof(esp_jrnl_master_t));
+
+    uint8_t* stale_sector = store_data + (size_t)JRNL_MASTER_SLOT_SECTOR(master, JRNL_MASTER_SLOT(master->generation + 1)) * sector_size;
+    memset(stale_sector, 0xFF, sector_size);
+}
+
+static int replay_image(const char* path, const replay_options_t* opts)
+{
+    jrnl_tool_image_t store;
+    jrnl_tool_image_t target_image = { 0 };
+    if (jrnl_tool_image_load(&store, path, opts->offset, opts->length) != 0) {
+        return REPLAY_ERR_IO;
+    }
+
+    esp_jrnl_master_t master;
+    int slot = jrnl_find_master_in_image(store.data, store.size, opts->sector_size, &master);
+    record_ref_t* records = NULL;
+    jrnl_tool_image_t* target = &store;
+    int ret = REPLAY_OK;
+
+    do {
+        if (slot == JRNL_IMAGE_ERR_NO_MASTER) {
+            fprintf(stderr, "%s: no valid journal master record found\n", path);
+            ret = REPLAY_ERR_CHECK;
+            break;
+        }
+        if (slot < 0) {
+            fprintf(stderr, "%s: master record inconsistent with the image (store geometry or checksum engine)\n", path);
+            ret = REPLAY_ERR_CHECK;
+            break;
+        }
+        size_t sector_size = master.store_volume.disk_sector_size;
+
+        //the file-system sectors: the journaled volume start, or the whole separate target device
+        if (master.store_separate) {
+            if (opts->target_path == NULL) {
+                fprintf(stderr, "%s: the store is separate, the journaled volume image needed (-t)\n", path);
+                ret = REPLAY_ERR_IO;
+                break;
+            }
+            if (jrnl_tool_image_load(&target_image, opts->target_path, opts->target_offset, 0) != 0) {
+                ret = REPLAY_ERR_IO;
+                break;
+            }
+            target = &target_image;
+        }
+        if ((uint64_t)JRNL_FS_SECTORS(&master) * sector_size > target->size) {
+            fprintf(stderr, "%s: journaled volume smaller than recorded in the master record\n", target->path);
+            ret = REPLAY_ERR_CHECK;
+            break;
+        }
+
+        uint32_t generation = master.generation;
+        esp_jrnl_trans_status_t initial_status = master.status;
+        const char* status = jrnl_status_name(initial_status);
+        uint32_t applied = 0;
+        int count = 0;
+
+        switch (master.status) {
+            case ESP_JRNL_STATUS_TRANS_READY:
+                printf("%s: %s, generation %" PRIu32 ", nothing to replay\n", path, status, generation);
+                break;
+            case ESP_JRNL_STATUS_FS_INIT:
+                printf("%s: %s (file-system formatting not finished), generation %" PRIu32 ", left for the mount\n", path, status, generation);
+                break;
+            case ESP_JRNL_STATUS_TRANS_OPEN:
+            case ESP_JRNL_STATUS_TRANS_COMMIT:
+                //uncommitted transaction discarded as it is, committed one transferred
+                if (master.status == ESP_JRNL_STATUS_TRANS_COMMIT) {
+                    count = collect_records(&store, &master, &records);
+                    if (count < 0) {
+                        ret = REPLAY_ERR_CHECK;
+                        break;
+                    }
+                    ret = apply_records(records, count, &master, target, opts->quiet, &applied);
+                    if (ret != REPLAY_OK) {
+                        break;
+                    }
+                }
+                reset_master(&store, &master);
+                if (!opts->check_only) {
+                    if (target != &store && jrnl_tool_image_store(target) != 0) {
+                        ret = REPLAY_ERR_IO;
+                    }
+                    if (ret == REPLAY_OK && jrnl_tool_image_store(&store) != 0) {
+                        ret = REPLAY_ERR_IO;
+                    }
+                    if (ret != REPLAY_OK) {
+                        break;
+                    }
+                }
+                if (initial_status == ESP_JRNL_STATUS_TRANS_OPEN) {
+                    printf("%s: %s -> Ready, uncommitted transaction discarded, generation %" PRIu32 " -> %" PRIu32 "%s\n",
+                           path, status, generation, master.generation, opts->check_only ? " (check only, not written)" : "");
+                } else {
+                    printf("%s: %s -> Ready, %d records, %" PRIu32 " applied, generation %" PRIu32 " -> %" PRIu32 "%s\n",
+                           path, status, count, applied, generation, master.generation, opts->check_only ? " (check only, not written)" : "");
+                }
+                break;
+            default:
+                fprintf(stderr, "%s: unknown transaction status %u\n", path, (unsigned)master.status);
+                ret = REPLAY_ERR_CHECK;
+                break;
+        }
+    } while (0);
+
+    free(records);
+    free(target_image.data);
+    free(store.data);
+
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    replay_options_t opts = { 0 };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:o:l:t:T:nq")) != -1) {
+        switch (opt) {
+            case 's': opts.sector_size = strtoul(optarg, NULL, 0); break;
+            case 'o': opts.offset = strtol(optarg, NULL, 0); break;
+            case 'l': opts.length = strtol(optarg, NULL, 0); break;
+            case 't': opts.target_path = optarg; break;
+            case 'T': opts.target_offset = strtol(optarg, NULL, 0); break;
+            case 'n': opts.check_only = true; break;
+            case 'q': opts.quiet = true; break;
+            default: optind = argc + 1; break;
+        }
+    }
+    if (optind >= argc || (opts.target_path != NULL && optind != argc - 1)) {
+        fprintf(stderr, "usage: %s [-s sector_size] [-o offset] [-l length] [-t target_image] [-T target_offset] [-n] [-q] image [image ...]\n", argv[0]);
+        return REPLAY_ERR_IO;
+    }
+
+    int ret = REPLAY_OK;
+    for (int i = optind; i < argc; i++) {
+        int image_ret = replay_image(argv[i], &opts);
+        if (image_ret > ret) {
+            ret = image_ret;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+"""
+Converts the journaling event trace printed by esp_jrnl_trace_dump() to the Chrome trace event format
+(open in https://ui.perfetto.dev or chrome://tracing).
+
+The input may be a whole device log (serial monitor capture, pytest log), the lines not belonging to the trace are
+skipped. When the log holds several dumps, the last one is converted unless --all is given.
+
+Each journaling instance is shown as a process, its events are split into lanes: transactions, master record,
+target disk, journaling store, checksums and the transaction lock (lock wait spans plus the computed lock hold spans).
+
+usage: jrnl_trace2json.py [-o trace.json] [--all] [log_file]
+"""
+
+import argparse
+import json
+import sys
+from typing import Dict, List, Optional, TextIO, Tuple
+
+TRACE_FORMAT_VERSION = 1
+
+# lane name -> thread ID within the instance process
+LANES = {
+    'transaction': 1,
+    'master': 2,
+    'disk': 3,
+    'store': 4,
+    'checksum': 5,
+    'lock': 6,
+}
+
+# event name -> lane name
+EVENTS = {
+    'TRANS_OPEN': 'transaction',
+    'TRANS_COMMIT': 'transaction',
+    'TRANS_CANCEL': 'transaction',
+    'RECORD_APPEND': 'transaction',
+    'RECORD_TRIM': 'transaction',
+    'REPLAY': 'transaction',
+    'REPLAY_RECORD': 'transaction',
+    'MASTER_UPDATE': 'master',
+    'DISK_READ': 'disk',
+    'DISK_WRITE': 'disk',
+    'DISK_ERASE': 'disk',
+    'STORE_READ': 'store',
+    'STORE_WRITE': 'store',
+    'STORE_ERASE': 'store',
+    'CHECKSUM': 'checksum',
+    'LOCK_ACQUIRE': 'lock',
+    'LOCK_RELEASE': 'lock',
+}
+
+RECORD_TYPES = {0: 'data', 2: 'trim'}
+TRANS_STATUS = {0: 'fs_direct', 1: 'ready', 2: 'open', 3: 'commit'}
+
+Entry = Tuple[int, int, int, str, int, int]
+
+
+def parse_dumps(stream: TextIO) -> List[Tuple[List[Entry], int]]:
+    """Returns the list of (entries, dropped count) of all the dumps found in the stream"""
+    dumps = []
+    entries: Optional[List[Entry]] = None
+    dropped = 0
+    for line in stream:
+        # the log prefix (timestamps, pytest decorations) precedes the marker
+        pos = line.find('JRNL_TRACE')
+        if pos < 0:
+            continue
+        fields = line[pos:].split()
+        if fields[0] == 'JRNL_TRACE_BEGIN':
+            if int(fields[1]) != TRACE_FORMAT_VERSION:
+                raise ValueError('unsupported trace format version {}'.format(fields[1]))
+            entries = []
+            dropped = int(fields[3])
+        elif fields[0] == 'JRNL_TRACE_END':
+            # entries overwritten while being dumped (absent in the older dumps)
+            if len(fields) > 1:
+                dropped += int(fields[1])
+            if entries is not None:
+                dumps.append((entries, dropped))
+            entries = None
+        elif fields[0] == 'JRNL_TRACE' and entries is not None and len(fields) == 7:
+            ts, dur, handle, name, arg0, arg1 = fields[1:]
+            entries.append((int(ts), int(dur), int(handle), name, int(arg0), int(arg1)))
+    return dumps
+
+
+def event_args(name: str, arg0: int, arg1: int) -> Dict[str, object]:
+    if name in ('RECORD_APPEND', 'RECORD_TRIM'):
+        return {'sector': arg0, 'count': arg1}
+    if name == 'REPLAY_RECORD':
+        return {'sector': arg0, 'count': arg1 & 0xFFFFFF, 'type': RECORD_TYPES.get(arg1 >> 24, arg1 >> 24)}
+    if name == 'TRANS_OPEN':
+        return {'generation': arg0}
+    if name == 'TRANS_COMMIT':
+        return {'store_sectors': arg0, 'batched_ops': arg1}
+    if name == 'MASTER_UPDATE':
+        return {'generation': arg0, 'status': TRANS_STATUS.get(arg1, arg1)}
+    if name == 'REPLAY':
+        return {'records': arg0, 'error': '0x{:X}'.format(arg1)}
+    if name.startswith('DISK_') or name.startswith('STORE_'):
+        return {'addr': '0x{:X}'.format(arg0), 'size': arg1}
+    if name == 'CHECKSUM':
+        return {'size': arg0}
+    return {}
+
+
+def convert(entries: List[Entry]) -> List[Dict[str, object]]:
+    events: List[Dict[str, object]] = []
+    handles = sorted({e[2] for e in entries})
+    for handle in handles:
+        events.append({'ph': 'M', 'name': 'process_name', 'pid': handle, 'args': {'name': 'esp_jrnl[{}]'.format(handle)}})
+        for lane, tid in LANES.items():
+            events.append({'ph': 'M', 'name': 'thread_name', 'pid': handle, 'tid': tid, 'args': {'name': lane}})
+            events.append({'ph': 'M', 'name': 'thread_sort_index', 'pid': handle, 'tid': tid, 'args': {'sort_index': tid}})
+
+    # lock hold: from the end of the acquire span to the release
+    lock_taken: Dict[int, int] = {}
+    for ts, dur, handle, name, arg0, arg1 in sorted(entries, key=lambda e: e[0] + e[1]):
+        tid = LANES[EVENTS.get(name, 'transaction')]
+        if name == 'LOCK_ACQUIRE':
+            lock_taken[handle] = ts + dur
+            if dur == 0:
+                continue
+            name = 'LOCK_WAIT'
+        elif name == 'LOCK_RELEASE':
+            taken = lock_taken.pop(handle, None)
+            if taken is not None:
+                events.append({'ph': 'X', 'name': 'LOCK_HELD', 'cat': 'lock', 'pid': handle, 'tid': tid,
+                               'ts': taken, 'dur': ts - taken})
+            continue
+        event = {'name': name, 'cat': EVENTS.get(name, 'unknown'), 'pid': handle, 'tid': tid, 'ts': ts,
+                 'args': event_args(name, arg0, arg1)}
+        if dur > 0 or name in ('TRANS_COMMIT', 'REPLAY', 'MASTER_UPDATE', 'RECORD_APPEND', 'RECORD_TRIM'):
+            event.update({'ph': 'X', 'dur': dur})
+        else:
+            event.update({'ph': 'i', 's': 't'})
+        events.append(event)
+
+    return events
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description='esp_jrnl trace dump to Chrome trace/Perfetto JSON converter')
+    parser.add_argument('log_file', nargs='?', help='device log with the trace dump (default: stdin)')
+    parser.add_argument('-o', '--output', help='output JSON file (default: stdout)')
+    parser.add_argument('--all', action='store_true', help='merge all the dumps found in the log (default: the last one)')
+    args = parser.parse_args()
+
+    if args.log_file:
+        with open(args.log_file, 'r', errors='replace') as f:
+            dumps = parse_dumps(f)
+    else:
+        dumps = parse_dumps(sys.stdin)
+
+    if not dumps:
+        print('no JRNL_TRACE dump found', file=sys.stderr)
+        return 1
+
+    selected = dumps if args.all else dumps[-1:]
+    entries = [e for dump, _ in selected for e in dump]
+    dropped = sum(d for _, d in selected)
+    if dropped:
+        print('warning: {} trace entries were overwritten before or during the dump (raise CONFIG_ESP_JRNL_TRACE_ENTRIES)'.format(dropped),
+              file=sys.stderr)
+
+    trace = {'traceEvents': convert(entries), 'displayTimeUnit': 'ms'}
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+        sys.stdout.write('\n')
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())